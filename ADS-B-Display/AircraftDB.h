@@ -2,7 +2,9 @@
 
 #ifndef AircraftDBH
 #define AircraftDBH
-#include "ght_hash_table.h"
+#include <stdint.h>
+#include "AircraftRegistry.h"
+#include "ICAORanges.h"
 
 #define  AC_DB_NUM_FIELDS          27
 #define  AC_DB_ICAO                 0
@@ -33,13 +35,33 @@
 #define  AC_DB_Notes               25
 #define  AC_DB_CategoryDescription 26
 
+/**
+ * What is known about an aircraft, filled by GetAircraftDBRecord() with one
+ * registry lookup. The fields are views into the mapped registry image, valid
+ * for as long as the program runs, so nothing is copied or allocated and the
+ * struct can be filled every frame and on any thread.
+ */
 typedef struct
 {
-  uint32_t    ICAO24;
-  AnsiString  Fields[AC_DB_NUM_FIELDS];
-} TAircraftData;
+ uint32_t     ICAO;
+ bool         Found;                    /* Otherwise every field is AR_UNKNOWN. */
+ bool         IsHelicopter;             /* By its ICAO aircraft type. */
+ TICAOClass   Class;                    /* By the address alone, also when not Found. */
+ const char  *Field[AC_DB_NUM_FIELDS];  /* Indexed by AC_DB_..., never NULL */
+} TAircraftDBInfo;
 
 bool InitAircraftDB(AnsiString FileName);
-const char * GetAircraftDBInfo(uint32_t addr);
+/** The aircraft DB once loaded, NULL while loading or without one (see AircraftDBState()). */
+const TAircraftRegistry *AircraftDB(void);
+TAircraftRegistryState AircraftDBState(void);
+/** @return Info->Found */
+bool GetAircraftDBRecord(uint32_t addr, TAircraftDBInfo *Info);
+/**
+ * Describe an aircraft in text, for display or speech.
+ * @return the length of the text, as snprintf()
+ */
+int  FormatAircraftDBInfo(const TAircraftDBInfo *Info, char *buf, size_t size);
+/** Look up and format an aircraft into buf. @return buf */
+const char * GetAircraftDBInfo(uint32_t addr, char *buf, size_t size);
 //---------------------------------------------------------------------------
 #endif
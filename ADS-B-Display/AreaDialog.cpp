@@ -31,11 +31,12 @@ void __fastcall TAreaConfirm::OkButtonClick(TObject *Sender)
    }
  }
 
- triangulatePoly(Form1->AreaTemp->Points,Form1->AreaTemp->NumPoints,
-				 &Form1->AreaTemp->Triangles);
+ Form1->TriangulateArea(Form1->AreaTemp);
 
  Form1->AreaTemp->Name=AreaName->Text;
  Form1->AreaTemp->Color=ColorBox1->Selected;
+ Form1->AreaTemp->Fence=Form1->Geofence->AddFence(Form1->AreaPoints(Form1->AreaTemp),Form1->AreaNumPoints(Form1->AreaTemp),
+													Form1->AreaTemp->LowerAltitude,Form1->AreaTemp->UpperAltitude);
  Form1->Areas->Add(Form1->AreaTemp);
 
 
@@ -46,6 +47,7 @@ void __fastcall TAreaConfirm::OkButtonClick(TObject *Sender)
  Form1->AreaListView->Items->Item[Row]->Caption=Form1->AreaTemp->Name;
  Form1->AreaListView->Items->Item[Row]->Data=Form1->AreaTemp;
  Form1->AreaListView->Items->Item[Row]->SubItems->Add("");
+ Form1->AreaListView->Items->Item[Row]->SubItems->Add("0");
  Form1->AreaListView->Items->EndUpdate();
 
 
@@ -66,7 +68,7 @@ void __fastcall TAreaConfirm::CancelButtonClick(TObject *Sender)
  TArea *Temp;
  Temp= Form1->AreaTemp;
  Form1->AreaTemp=NULL;
- delete  Temp;
+ Form1->FreeArea(Temp);
  Form1->Insert->Enabled=true;
  Form1->Complete->Enabled=false;
  Form1->Cancel->Enabled=false;
@@ -0,0 +1,225 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "AsyncWriter.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+static size_t RoundUpPowerOfTwo(size_t n);
+//---------------------------------------------------------------------------
+static size_t RoundUpPowerOfTwo(size_t n)
+{
+ size_t p=1;
+ while (p<n) p<<=1;
+ return p;
+}
+//---------------------------------------------------------------------------
+TAsyncWriter::TAsyncWriter(const char *FileName, size_t BufferSize,
+						   TFsyncPolicy FsyncPolicy, unsigned FlushIntervalMs,
+						   unsigned FsyncIntervalMs)
+  : File(NULL), Ring(NULL), Capacity(RoundUpPowerOfTwo(BufferSize)),
+	FsyncPolicy(FsyncPolicy), FlushIntervalMs(FlushIntervalMs),
+	FsyncIntervalMs(FsyncIntervalMs), Reserved(0), Committed(0), Consumed(0),
+	Written(0), Dropped(0), DroppedRecords(0), StopRequested(false),
+	FlushRequested(false)
+{
+ Ring=(char *)malloc(Capacity);
+ if (Ring==NULL)
+   {
+	printf("AsyncWriter: cannot allocate %u byte buffer for %s\n",(unsigned)Capacity,FileName);
+	return;
+   }
+ File=fopen(FileName,"wb");
+ if (File==NULL)
+   {
+	printf("AsyncWriter: cannot open %s\n",FileName);
+	free(Ring);
+	Ring=NULL;
+	return;
+   }
+ /* The flush thread already writes in large chunks, stdio buffering only adds a copy. */
+ setvbuf(File,NULL,_IONBF,0);
+ FlushThread=std::thread(&TAsyncWriter::Run,this);
+}
+//---------------------------------------------------------------------------
+TAsyncWriter::~TAsyncWriter()
+{
+ if (File)
+   {
+	{
+	 std::lock_guard<std::mutex> Lock(WakeMutex);
+	 StopRequested.store(true);
+	}
+	Wake.notify_one();
+	FlushThread.join();
+	if (FsyncPolicy!=AW_FSYNC_NEVER) Sync();
+	fclose(File);
+	if (Dropped.load()>0)
+	  printf("AsyncWriter: %llu bytes in %llu records dropped\n",
+			 (unsigned long long)Dropped.load(),(unsigned long long)DroppedRecords.load());
+   }
+ free(Ring);
+}
+//---------------------------------------------------------------------------
+bool TAsyncWriter::Write(const char *Data, size_t Len)
+{
+ return Append(Data,Len,NULL,0);
+}
+//---------------------------------------------------------------------------
+bool TAsyncWriter::WriteLine(const char *Line)
+{
+ return Append(Line,strlen(Line),AW_NEWLINE,sizeof(AW_NEWLINE)-1);
+}
+//---------------------------------------------------------------------------
+void TAsyncWriter::Flush(void)
+{
+ FlushRequested.store(true,std::memory_order_relaxed);
+ Wake.notify_one();
+}
+//---------------------------------------------------------------------------
+/**
+ * Claim space in the ring, copy the record in and publish it.
+ *
+ * Space is claimed with a compare-and-swap on Reserved so concurrent
+ * producers get disjoint ranges without taking a lock. Ranges are published
+ * in claim order by advancing Committed, which is what the flush thread
+ * reads up to; a producer that finishes its copy early waits only for the
+ * producers that claimed space just before it.
+ */
+bool TAsyncWriter::Append(const char *Data, size_t Len, const char *Tail, size_t TailLen)
+{
+ size_t   Total=Len+TailLen;
+ uint64_t Start;
+
+ if (File==NULL) return false;
+
+ Start=Reserved.load(std::memory_order_relaxed);
+ do
+   {
+	if (Start+Total-Consumed.load(std::memory_order_acquire)>Capacity)
+	  {
+	   Dropped.fetch_add(Total,std::memory_order_relaxed);
+	   DroppedRecords.fetch_add(1,std::memory_order_relaxed);
+	   return false;
+	  }
+   }
+ while (!Reserved.compare_exchange_weak(Start,Start+Total,
+										std::memory_order_relaxed,
+										std::memory_order_relaxed));
+
+ CopyIn(Start,Data,Len);
+ if (TailLen) CopyIn(Start+Len,Tail,TailLen);
+
+ while (Committed.load(std::memory_order_acquire)!=Start)
+	std::this_thread::yield();
+ Committed.store(Start+Total,std::memory_order_release);
+
+ if (Start+Total-Consumed.load(std::memory_order_relaxed)>=AW_FLUSH_CHUNK_SIZE &&
+	 Start-Consumed.load(std::memory_order_relaxed)<AW_FLUSH_CHUNK_SIZE)
+	Wake.notify_one();
+ return true;
+}
+//---------------------------------------------------------------------------
+void TAsyncWriter::CopyIn(uint64_t Pos, const char *Data, size_t Len)
+{
+ size_t Offset=(size_t)(Pos & (Capacity-1));
+ size_t First=Capacity-Offset;
+
+ if (First>=Len) memcpy(Ring+Offset,Data,Len);
+ else
+   {
+	memcpy(Ring+Offset,Data,First);
+	memcpy(Ring,Data+First,Len-First);
+   }
+}
+//---------------------------------------------------------------------------
+/**
+ * Write everything committed so far. The range may wrap around the end of
+ * the ring, in which case it goes out as two writes.
+ * @return true if anything was written.
+ */
+bool TAsyncWriter::WritePending(void)
+{
+ uint64_t Begin=Consumed.load(std::memory_order_relaxed);
+ uint64_t End=Committed.load(std::memory_order_acquire);
+ size_t   Offset,Len,First;
+
+ if (End==Begin) return false;
+
+ Offset=(size_t)(Begin & (Capacity-1));
+ Len=(size_t)(End-Begin);
+ First=Capacity-Offset;
+ if (First>=Len) fwrite(Ring+Offset,1,Len,File);
+ else
+   {
+	fwrite(Ring+Offset,1,First,File);
+	fwrite(Ring,1,Len-First,File);
+   }
+ Written.fetch_add(Len,std::memory_order_relaxed);
+ Consumed.store(End,std::memory_order_release);
+ return true;
+}
+//---------------------------------------------------------------------------
+void TAsyncWriter::Sync(void)
+{
+ fflush(File);
+#ifdef _WIN32
+ _commit(_fileno(File));
+#else
+ fsync(fileno(File));
+#endif
+}
+//---------------------------------------------------------------------------
+void TAsyncWriter::Run(void)
+{
+ std::chrono::steady_clock::time_point LastSync=std::chrono::steady_clock::now();
+ bool Dirty=false;
+
+ for (;;)
+  {
+   bool Stopping;
+   {
+	std::unique_lock<std::mutex> Lock(WakeMutex);
+	Wake.wait_for(Lock,std::chrono::milliseconds(FlushIntervalMs),[this]
+	  {
+	   return StopRequested.load() || FlushRequested.load() ||
+			  Committed.load()-Consumed.load()>=AW_FLUSH_CHUNK_SIZE;
+	  });
+	Stopping=StopRequested.load();
+   }
+   FlushRequested.store(false,std::memory_order_relaxed);
+
+   if (WritePending())
+	 {
+	  Dirty=true;
+	  if (FsyncPolicy==AW_FSYNC_EVERY_FLUSH)
+		{
+		 Sync();
+		 Dirty=false;
+		}
+	 }
+   if (Dirty && FsyncPolicy==AW_FSYNC_PERIODIC &&
+	   std::chrono::steady_clock::now()-LastSync>=std::chrono::milliseconds(FsyncIntervalMs))
+	 {
+	  Sync();
+	  LastSync=std::chrono::steady_clock::now();
+	  Dirty=false;
+	 }
+   if (Stopping)
+	 {
+	  /* Producers may still have been copying when the stop was requested. */
+	  while (Committed.load()!=Reserved.load()) std::this_thread::yield();
+	  WritePending();
+	  break;
+	 }
+  }
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,112 @@
+//---------------------------------------------------------------------------
+
+#ifndef AsyncWriterH
+#define AsyncWriterH
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+//---------------------------------------------------------------------------
+#define AW_DEFAULT_BUFFER_SIZE      (4*1024*1024) /* Bytes of memory held per stream. */
+#define AW_DEFAULT_FLUSH_INTERVAL    200          /* Max time data waits in memory (msec). */
+#define AW_DEFAULT_FSYNC_INTERVAL   1000          /* Used with AW_FSYNC_PERIODIC (msec). */
+#define AW_FLUSH_CHUNK_SIZE         (64*1024)     /* Pending bytes that wake the flush thread early. */
+
+#ifdef _WIN32
+#define AW_NEWLINE "\r\n"
+#else
+#define AW_NEWLINE "\n"
+#endif
+
+/**
+ * When the flush thread forces written data to stable storage.
+ */
+typedef enum
+{
+  AW_FSYNC_NEVER=0,       /**< Leave it to the operating system. */
+  AW_FSYNC_ON_CLOSE=1,    /**< Once, when the file is closed. */
+  AW_FSYNC_PERIODIC=2,    /**< At most every FsyncIntervalMs and on close. */
+  AW_FSYNC_EVERY_FLUSH=3  /**< After every chunk written. */
+} TFsyncPolicy;
+
+/**
+ * Append-only file writer that never blocks its producers.
+ *
+ * Producers copy their bytes into a bounded ring buffer and return
+ * immediately; a dedicated thread writes the buffered data to the file in
+ * large chunks. If the ring is full (slow or stalled disk) the record is
+ * dropped whole and counted instead of waiting for space, so a disk hiccup
+ * can never stall the thread that produces the data.
+ *
+ * Write() and WriteLine() may be called from any number of threads. Each
+ * call is stored as one unit, so a dropped record never leaves a partial
+ * line behind.
+ */
+class TAsyncWriter
+{
+public:
+  TAsyncWriter(const char *FileName,
+			   size_t BufferSize=AW_DEFAULT_BUFFER_SIZE,
+			   TFsyncPolicy FsyncPolicy=AW_FSYNC_ON_CLOSE,
+			   unsigned FlushIntervalMs=AW_DEFAULT_FLUSH_INTERVAL,
+			   unsigned FsyncIntervalMs=AW_DEFAULT_FSYNC_INTERVAL);
+
+  /** Drains everything still buffered, applies the fsync policy and closes the file. */
+  ~TAsyncWriter();
+
+  /** @return true if the file was opened and the flush thread is running. */
+  bool IsOpen(void) const { return File!=NULL; }
+
+  /**
+   * Queue Len bytes for writing.
+   * @return false if the data was dropped because the buffer is full.
+   */
+  bool Write(const char *Data, size_t Len);
+
+  /** Queue Line followed by AW_NEWLINE as a single record. */
+  bool WriteLine(const char *Line);
+
+  /** Ask the flush thread to write out whatever is buffered now. Does not wait. */
+  void Flush(void);
+
+  uint64_t BytesWritten(void) const { return Written.load(std::memory_order_relaxed); }
+  uint64_t BytesDropped(void) const { return Dropped.load(std::memory_order_relaxed); }
+  uint64_t RecordsDropped(void) const { return DroppedRecords.load(std::memory_order_relaxed); }
+
+private:
+  TAsyncWriter(const TAsyncWriter &);
+  TAsyncWriter &operator=(const TAsyncWriter &);
+
+  bool Append(const char *Data, size_t Len, const char *Tail, size_t TailLen);
+  void CopyIn(uint64_t Pos, const char *Data, size_t Len);
+  void Run(void);
+  bool WritePending(void);
+  void Sync(void);
+
+  FILE                   *File;
+  char                   *Ring;
+  size_t                  Capacity;         ///< Ring size, a power of two
+  TFsyncPolicy            FsyncPolicy;
+  unsigned                FlushIntervalMs;
+  unsigned                FsyncIntervalMs;
+
+  /* Positions are running byte counts, taken modulo Capacity to index Ring. */
+  std::atomic<uint64_t>   Reserved;         ///< End of space claimed by producers
+  std::atomic<uint64_t>   Committed;        ///< End of data fully copied into Ring
+  std::atomic<uint64_t>   Consumed;         ///< End of data handed to the file
+
+  std::atomic<uint64_t>   Written;
+  std::atomic<uint64_t>   Dropped;
+  std::atomic<uint64_t>   DroppedRecords;
+
+  std::atomic<bool>       StopRequested;
+  std::atomic<bool>       FlushRequested;
+  std::mutex              WakeMutex;
+  std::condition_variable Wake;
+  std::thread             FlushThread;
+};
+//---------------------------------------------------------------------------
+#endif
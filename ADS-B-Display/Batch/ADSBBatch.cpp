@@ -0,0 +1,493 @@
+//---------------------------------------------------------------------------
+// ADSBBatch - headless reprocessing of raw and SBS recordings.
+//
+// Reads files written by the display's Raw/SBS Record buttons (a time stamp
+// line followed by a message line) or plain message captures (timed as if
+// the messages came -i msec apart), decodes them as fast as the disk allows
+// and writes, per input file:
+//
+//   <name>.positions.csv|.bin  one row per position change
+//   <name>.tracks.csv          one summary row per aircraft
+//   <name>.conflicts.csv       predicted conflicts (with -c)
+//   <name>.store/              track store for adsb_query (with -s)
+//
+// Files are independent, so each worker thread takes the next unprocessed
+// file and decodes it into its own TADS_B_Context.
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include "ADSBCore.h"
+#include "DecodeRawADS_B.h"
+#include "Aircraft.h"
+#include "SBS_Message.h"
+#include "ConflictDetect.h"
+#include "TrackStore.h"
+
+#define MAX_LINE_SIZE              1024
+#define OUTPUT_BUFFER_SIZE         (1024*1024)
+#define EARTH_RADIUS_NM            3440.065
+
+#define PLAIN_MESSAGE_INTERVAL     50       /* Default time between messages of a plain capture (msec). */
+#define CPA_SCAN_INTERVAL          10000    /* Recording time between conflict scans (msec). */
+#define CPA_ACTIVE_TIME            60000    /* Aircraft not heard from for longer are ignored (msec). */
+#define CPA_MAX_TCPA               300.0    /* Look ahead (sec). */
+#define CPA_MIN_HORIZONTAL_NM      5.0
+#define CPA_MIN_VERTICAL_FT        1000.0
+
+#define POSITION_FILE_MAGIC        "ADSBPOS1"
+
+/**
+ * Record layout of the binary position file, written after the 8 byte
+ * POSITION_FILE_MAGIC. All fields are little endian.
+ */
+#pragma pack(push,1)
+typedef struct
+{
+ int64_t  Time;              /* Recording time stamp (msec, as in the input file). */
+ uint32_t ICAO;
+ char     FlightNum[8];      /* Space padded, not terminated. */
+ double   Latitude;
+ double   Longitude;
+ float    Altitude;          /* Feet. */
+ float    Speed;             /* Knots. */
+ float    Heading;           /* Degrees. */
+ float    VerticalRate;      /* Feet per minute. */
+} TPositionRecord;
+#pragma pack(pop)
+
+typedef enum
+{
+ OutputCSV=0,
+ OutputBinary=1
+} TOutputFormat;
+
+typedef struct
+{
+ std::string   OutDir;
+ TOutputFormat Format;
+ bool          Conflicts;
+ bool          Store;
+ unsigned      Threads;
+ int64_t       PlainInterval;     /* Time given to each message without a time stamp (msec). */
+} TBatchOptions;
+
+/**
+ * What we keep per aircraft beyond TADS_B_Aircraft itself.
+ */
+typedef struct
+{
+ int64_t  FirstSeen;
+ int64_t  LastSeen;
+ long     NumPositions;
+ double   MinAltitude,MaxAltitude;
+ double   MinLatitude,MaxLatitude;
+ double   MinLongitude,MaxLongitude;
+ double   DistanceNM;
+ double   LastLatitude,LastLongitude,LastAltitude;
+} TTrackSummary;
+
+typedef struct
+{
+ long Lines;
+ long RawMessages;
+ long SBSMessages;
+ long Errors;
+ long Aircraft;
+ long Positions;
+ long Conflicts;
+} TFileStats;
+
+typedef std::unordered_map<uint32_t,TTrackSummary> TTrackMap;
+
+static void Usage(void);
+static bool ParseArgs(int argc, char *argv[], TBatchOptions &Opt, std::vector<std::string> &Files);
+static std::string OutputName(const TBatchOptions &Opt, const std::string &InFile, const char *Suffix);
+static FILE *OpenOutput(const std::string &FileName, const char *Mode);
+static double DistanceNM(double lat1, double lon1, double lat2, double lon2);
+static void UpdateTrack(TTrackMap &Tracks, TADS_B_Aircraft *a, int64_t Time,
+						FILE *Positions, TOutputFormat Format, TFileStats &Stats);
+static void ScanConflicts(TConflictDetector &Detector, TADS_B_Context *Ctx, FILE *Out, TFileStats &Stats);
+static void WriteTracks(ght_hash_table_t *HashTable, TTrackMap &Tracks, FILE *Out);
+static bool ProcessFile(const TBatchOptions &Opt, const std::string &InFile, TFileStats &Stats);
+
+static std::mutex ConsoleMutex;
+//---------------------------------------------------------------------------
+static void Usage(void)
+{
+ fprintf(stderr,
+  "usage: adsb_batch [-o dir] [-j threads] [-f csv|bin] [-c] [-s] [-i msec] file...\n"
+  "  -o dir      write output files to dir (default: next to each input)\n"
+  "  -j threads  number of files processed in parallel (default: all cores)\n"
+  "  -f csv|bin  position output format (default: csv)\n"
+  "  -c          also write predicted conflicts (CPA) per file\n"
+  "  -s          also write a track store per file (see adsb_query)\n"
+  "  -i msec     time between messages of a capture without time stamps,\n"
+  "              about 1000 / messages per second received (default: %d)\n",
+  PLAIN_MESSAGE_INTERVAL);
+}
+//---------------------------------------------------------------------------
+static bool ParseArgs(int argc, char *argv[], TBatchOptions &Opt, std::vector<std::string> &Files)
+{
+ Opt.Format=OutputCSV;
+ Opt.Conflicts=false;
+ Opt.Store=false;
+ Opt.PlainInterval=PLAIN_MESSAGE_INTERVAL;
+ Opt.Threads=std::thread::hardware_concurrency();
+ if (Opt.Threads==0) Opt.Threads=1;
+
+ for (int i = 1; i < argc; i++)
+  {
+   if (strcmp(argv[i],"-o")==0 && i+1<argc) Opt.OutDir=argv[++i];
+   else if (strcmp(argv[i],"-j")==0 && i+1<argc)
+	 {
+	  int n=atoi(argv[++i]);
+	  if (n<1) return false;
+	  Opt.Threads=n;
+	 }
+   else if (strcmp(argv[i],"-f")==0 && i+1<argc)
+	 {
+	  i++;
+	  if (strcmp(argv[i],"csv")==0) Opt.Format=OutputCSV;
+	  else if (strcmp(argv[i],"bin")==0) Opt.Format=OutputBinary;
+	  else return false;
+	 }
+   else if (strcmp(argv[i],"-i")==0 && i+1<argc)
+	 {
+	  int n=atoi(argv[++i]);
+	  if (n<1) return false;
+	  Opt.PlainInterval=n;
+	 }
+   else if (strcmp(argv[i],"-c")==0) Opt.Conflicts=true;
+   else if (strcmp(argv[i],"-s")==0) Opt.Store=true;
+   else if (argv[i][0]=='-') return false;
+   else Files.push_back(argv[i]);
+  }
+ return !Files.empty();
+}
+//---------------------------------------------------------------------------
+static std::string OutputName(const TBatchOptions &Opt, const std::string &InFile, const char *Suffix)
+{
+ size_t Slash=InFile.find_last_of("/\\");
+ std::string Dir=(Slash==std::string::npos) ? std::string() : InFile.substr(0,Slash+1);
+ std::string Base=(Slash==std::string::npos) ? InFile : InFile.substr(Slash+1);
+ size_t Dot=Base.find_last_of('.');
+
+ if (Dot!=std::string::npos && Dot>0) Base.erase(Dot);
+ if (!Opt.OutDir.empty())
+   {
+	Dir=Opt.OutDir;
+	if (Dir[Dir.size()-1]!='/' && Dir[Dir.size()-1]!='\\') Dir+='/';
+   }
+ return Dir+Base+Suffix;
+}
+//---------------------------------------------------------------------------
+static FILE *OpenOutput(const std::string &FileName, const char *Mode)
+{
+ FILE *f=fopen(FileName.c_str(),Mode);
+ if (f==NULL)
+   {
+	std::lock_guard<std::mutex> Lock(ConsoleMutex);
+	fprintf(stderr,"Cannot create %s\n",FileName.c_str());
+	return NULL;
+   }
+ setvbuf(f,NULL,_IOFBF,OUTPUT_BUFFER_SIZE);
+ return f;
+}
+//---------------------------------------------------------------------------
+/* Great circle distance; plenty for summing up track length. */
+static double DistanceNM(double lat1, double lon1, double lat2, double lon2)
+{
+ double dlat=(lat2-lat1)*M_PI/180.0;
+ double dlon=(lon2-lon1)*M_PI/180.0;
+ double a=sin(dlat/2)*sin(dlat/2)+
+		  cos(lat1*M_PI/180.0)*cos(lat2*M_PI/180.0)*sin(dlon/2)*sin(dlon/2);
+ return 2.0*EARTH_RADIUS_NM*atan2(sqrt(a),sqrt(1.0-a));
+}
+//---------------------------------------------------------------------------
+/**
+ * Fold the aircraft's current state into its track summary and emit a
+ * position row if its position or altitude changed.
+ */
+static void UpdateTrack(TTrackMap &Tracks, TADS_B_Aircraft *a, int64_t Time,
+						FILE *Positions, TOutputFormat Format, TFileStats &Stats)
+{
+ std::pair<TTrackMap::iterator,bool> Ins=Tracks.insert(std::make_pair(a->ICAO,TTrackSummary()));
+ TTrackSummary &t=Ins.first->second;
+
+ if (Ins.second)
+   {
+	memset(&t,0,sizeof(t));
+	t.FirstSeen=Time;
+   }
+ t.LastSeen=Time;
+
+ if (!a->HaveLatLon) return;
+ if (t.NumPositions>0 && t.LastLatitude==a->Latitude && t.LastLongitude==a->Longitude &&
+	 t.LastAltitude==a->Altitude) return;
+
+ if (t.NumPositions==0)
+   {
+	t.MinLatitude=t.MaxLatitude=a->Latitude;
+	t.MinLongitude=t.MaxLongitude=a->Longitude;
+	t.MinAltitude=t.MaxAltitude=a->Altitude;
+   }
+ else
+   {
+	t.DistanceNM+=DistanceNM(t.LastLatitude,t.LastLongitude,a->Latitude,a->Longitude);
+	if (a->Latitude<t.MinLatitude) t.MinLatitude=a->Latitude;
+	if (a->Latitude>t.MaxLatitude) t.MaxLatitude=a->Latitude;
+	if (a->Longitude<t.MinLongitude) t.MinLongitude=a->Longitude;
+	if (a->Longitude>t.MaxLongitude) t.MaxLongitude=a->Longitude;
+	if (a->Altitude<t.MinAltitude) t.MinAltitude=a->Altitude;
+	if (a->Altitude>t.MaxAltitude) t.MaxAltitude=a->Altitude;
+   }
+ t.LastLatitude=a->Latitude;
+ t.LastLongitude=a->Longitude;
+ t.LastAltitude=a->Altitude;
+ t.NumPositions++;
+ Stats.Positions++;
+
+ if (Format==OutputBinary)
+   {
+	TPositionRecord r;
+	r.Time=Time;
+	r.ICAO=a->ICAO;
+	memset(r.FlightNum,' ',sizeof(r.FlightNum));
+	if (a->HaveFlightNum)
+	  memcpy(r.FlightNum,a->FlightNum,strnlen(a->FlightNum,sizeof(r.FlightNum)));
+	r.Latitude=a->Latitude;
+	r.Longitude=a->Longitude;
+	r.Altitude=(float)a->Altitude;
+	r.Speed=(float)a->Speed;
+	r.Heading=(float)a->Heading;
+	r.VerticalRate=(float)a->VerticalRate;
+	fwrite(&r,sizeof(r),1,Positions);
+   }
+ else fprintf(Positions,"%lld,%s,%s,%.6f,%.6f,%.0f,%.0f,%.1f,%.0f\n",
+			  (long long)Time,a->HexAddr,a->HaveFlightNum ? a->FlightNum : "",
+			  a->Latitude,a->Longitude,a->Altitude,a->Speed,a->Heading,a->VerticalRate);
+}
+//---------------------------------------------------------------------------
+/**
+ * Write the predicted losses of separation within CPA_MAX_TCPA seconds
+ * between recently heard aircraft with full state, soonest first.
+ */
+static void ScanConflicts(TConflictDetector &Detector, TADS_B_Context *Ctx, FILE *Out, TFileStats &Stats)
+{
+ std::vector<TConflictAlert> Alerts;
+
+ Detector.Evaluate(Ctx,CPA_ACTIVE_TIME,Alerts);
+ for (size_t i = 0; i < Alerts.size(); i++)
+   {
+	const TConflictAlert &c=Alerts[i];
+	fprintf(Out,"%lld,%06X,%06X,%.1f,%.2f,%.0f\n",(long long)Ctx->CurrentTime,
+			(unsigned)c.ICAO1,(unsigned)c.ICAO2,c.TCPA,c.HorizontalNM,c.VerticalFt);
+   }
+ Stats.Conflicts+=(long)Alerts.size();
+}
+//---------------------------------------------------------------------------
+static void WriteTracks(ght_hash_table_t *HashTable, TTrackMap &Tracks, FILE *Out)
+{
+ ght_iterator_t iterator;
+ const void *Key;
+ TADS_B_Aircraft *a;
+
+ fprintf(Out,"ICAO,Callsign,FirstSeen,LastSeen,MessagesRaw,MessagesSBS,Positions,"
+			 "MinAltitude,MaxAltitude,MinLatitude,MaxLatitude,MinLongitude,MaxLongitude,DistanceNM\n");
+ for (a = (TADS_B_Aircraft *)ght_first(HashTable, &iterator, &Key); a;
+	  a = (TADS_B_Aircraft *)ght_next(HashTable, &iterator, &Key))
+   {
+	TTrackMap::const_iterator it=Tracks.find(a->ICAO);
+	if (it==Tracks.end()) continue;
+	const TTrackSummary &t=it->second;
+	fprintf(Out,"%s,%s,%lld,%lld,%ld,%ld,%ld",a->HexAddr,a->HaveFlightNum ? a->FlightNum : "",
+			(long long)t.FirstSeen,(long long)t.LastSeen,a->NumMessagesRaw,a->NumMessagesSBS,
+			t.NumPositions);
+	if (t.NumPositions) fprintf(Out,",%.0f,%.0f,%.6f,%.6f,%.6f,%.6f,%.2f\n",
+								t.MinAltitude,t.MaxAltitude,t.MinLatitude,t.MaxLatitude,
+								t.MinLongitude,t.MaxLongitude,t.DistanceNM);
+	else fprintf(Out,",,,,,,,\n");
+   }
+}
+//---------------------------------------------------------------------------
+static bool ProcessFile(const TBatchOptions &Opt, const std::string &InFile, TFileStats &Stats)
+{
+ char              Line[MAX_LINE_SIZE];
+ FILE             *In,*Positions,*TracksOut,*Conflicts=NULL;
+ TADS_B_Context   *Ctx;
+ TTrackMap         Tracks;
+ TTrackStore       Store;
+ TConflictDetector Detector(CPA_MAX_TCPA,CPA_MIN_HORIZONTAL_NM,CPA_MIN_VERTICAL_FT);
+ int64_t           NextScan=0;
+ bool              Stamped=false;
+
+ memset(&Stats,0,sizeof(Stats));
+ In=fopen(InFile.c_str(),"rb");
+ if (In==NULL)
+   {
+	std::lock_guard<std::mutex> Lock(ConsoleMutex);
+	fprintf(stderr,"Cannot open %s\n",InFile.c_str());
+	return false;
+   }
+ setvbuf(In,NULL,_IOFBF,OUTPUT_BUFFER_SIZE);
+
+ if (Opt.Format==OutputBinary)
+   {
+	Positions=OpenOutput(OutputName(Opt,InFile,".positions.bin"),"wb");
+	if (Positions) fwrite(POSITION_FILE_MAGIC,1,8,Positions);
+   }
+ else
+   {
+	Positions=OpenOutput(OutputName(Opt,InFile,".positions.csv"),"w");
+	if (Positions) fprintf(Positions,"Time,ICAO,Callsign,Latitude,Longitude,Altitude,Speed,Heading,VerticalRate\n");
+   }
+ TracksOut=OpenOutput(OutputName(Opt,InFile,".tracks.csv"),"w");
+ if (Opt.Conflicts)
+   {
+	Conflicts=OpenOutput(OutputName(Opt,InFile,".conflicts.csv"),"w");
+	if (Conflicts) fprintf(Conflicts,"Time,ICAO1,ICAO2,TCPA,CPADistanceNM,VerticalFt\n");
+   }
+ if (!Positions || !TracksOut || (Opt.Conflicts && !Conflicts))
+   {
+	fclose(In);
+	if (Positions) fclose(Positions);
+	if (TracksOut) fclose(TracksOut);
+	if (Conflicts) fclose(Conflicts);
+	return false;
+   }
+
+ if (Opt.Store && !Store.Open(OutputName(Opt,InFile,".store").c_str()))
+   {
+	fclose(In);
+	fclose(Positions);
+	fclose(TracksOut);
+	if (Conflicts) fclose(Conflicts);
+	return false;
+   }
+
+ Ctx=ADS_B_CreateContext(50000);
+ if (Ctx==NULL)
+   {
+	fclose(In);
+	fclose(Positions);
+	fclose(TracksOut);
+	if (Conflicts) fclose(Conflicts);
+	return false;
+   }
+
+ while (fgets(Line,sizeof(Line),In))
+  {
+   TADS_B_Aircraft *a=NULL;
+   size_t Len=strlen(Line);
+   char  *p;
+
+   while (Len && (Line[Len-1]=='\n' || Line[Len-1]=='\r')) Line[--Len]='\0';
+   if (Len==0) continue;
+   Stats.Lines++;
+
+   for (p=Line; isdigit((unsigned char)*p); p++);
+   if (*p=='\0')
+	 {
+	  /* Time stamp line of a recording, applies to the message that follows. */
+	  Ctx->CurrentTime=strtoll(Line,NULL,10);
+	  Stamped=true;
+	  continue;
+	 }
+   /* A plain capture has no time stamps: space the messages evenly, so
+	  * that CPR halves still pair up and the output times increase. */
+   if (!Stamped) Ctx->CurrentTime+=Opt.PlainInterval;
+   Stamped=false;
+
+   if (Line[0]=='*')
+	 {
+	  modeS_message mm;
+	  if (decode_RAW_message(Ctx,Line,&mm)==HaveMsg)
+		{
+		 uint32_t addr=(mm.AA[0] << 16) | (mm.AA[1] << 8) | mm.AA[2];
+		 a=FindOrAddAircraft(Ctx,addr);
+		 RawToAircraft(Ctx,&mm,a);
+		 Stats.RawMessages++;
+		}
+	 }
+   else
+	 {
+	  a=SBS_Message_Decode(Ctx,Line);
+	  if (a) Stats.SBSMessages++;
+	 }
+
+   if (a==NULL)
+	 {
+	  Stats.Errors++;
+	  continue;
+	 }
+   UpdateTrack(Tracks,a,Ctx->CurrentTime,Positions,Opt.Format,Stats);
+   if (Opt.Store) Store.AppendAircraft(a,Ctx->CurrentTime);
+
+   if (Conflicts && Ctx->CurrentTime>=NextScan)
+	 {
+	  ScanConflicts(Detector,Ctx,Conflicts,Stats);
+	  NextScan=Ctx->CurrentTime+CPA_SCAN_INTERVAL;
+	 }
+  }
+
+ WriteTracks(Ctx->HashTable,Tracks,TracksOut);
+ Stats.Aircraft=ght_size(Ctx->HashTable);
+ ADS_B_FreeContext(Ctx);
+
+ fclose(In);
+ fclose(Positions);
+ fclose(TracksOut);
+ if (Conflicts) fclose(Conflicts);
+ return true;
+}
+//---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+ TBatchOptions            Opt;
+ std::vector<std::string> Files;
+ std::vector<std::thread> Workers;
+ std::atomic<size_t>      NextFile(0);
+ std::atomic<int>         Failed(0);
+
+ if (!ParseArgs(argc,argv,Opt,Files))
+   {
+	Usage();
+	return 2;
+   }
+ if (Opt.Threads>Files.size()) Opt.Threads=(unsigned)Files.size();
+
+ for (unsigned i = 0; i < Opt.Threads; i++)
+   Workers.push_back(std::thread([&]()
+	{
+	 for (size_t f=NextFile++; f<Files.size(); f=NextFile++)
+	   {
+		TFileStats Stats;
+		bool Ok=ProcessFile(Opt,Files[f],Stats);
+		std::lock_guard<std::mutex> Lock(ConsoleMutex);
+		if (!Ok)
+		  {
+		   Failed++;
+		   continue;
+		  }
+		printf("%s: %ld lines, %ld raw, %ld SBS, %ld errors, %ld aircraft, %ld positions",
+			   Files[f].c_str(),Stats.Lines,Stats.RawMessages,Stats.SBSMessages,
+			   Stats.Errors,Stats.Aircraft,Stats.Positions);
+		if (Opt.Conflicts) printf(", %ld conflicts",Stats.Conflicts);
+		printf("\n");
+	   }
+	}));
+
+ for (size_t i = 0; i < Workers.size(); i++) Workers[i].join();
+ return Failed ? 1 : 0;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,101 @@
+//---------------------------------------------------------------------------
+// ADSBQuery - command line queries against a track store.
+//
+// The store is the directory written by the display (TrackStore) or by
+// adsb_batch -s, opened read-only so it can be queried while it is being
+// recorded into. Results go to stdout as CSV in the same columns as
+// adsb_batch's positions file; a summary with the query time goes to stderr.
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+#include "TrackStore.h"
+
+static void Usage(void);
+static bool ParseTimes(int argc, char *argv[], int First, int64_t &t0, int64_t &t1);
+static void PrintPoints(const std::vector<TTrackPoint> &Points);
+//---------------------------------------------------------------------------
+static void Usage(void)
+{
+ fprintf(stderr,
+  "usage: adsb_query store icao HEX [t0 t1]\n"
+  "       adsb_query store box MINLAT MINLON MAXLAT MAXLON [t0 t1]\n"
+  "  store  directory of the track store\n"
+  "  t0 t1  time range (msec, as in recordings), default everything\n");
+}
+//---------------------------------------------------------------------------
+static bool ParseTimes(int argc, char *argv[], int First, int64_t &t0, int64_t &t1)
+{
+ t0=INT64_MIN;
+ t1=INT64_MAX;
+ if (argc==First) return true;
+ if (argc!=First+2) return false;
+ t0=strtoll(argv[First],NULL,10);
+ t1=strtoll(argv[First+1],NULL,10);
+ return t0<=t1;
+}
+//---------------------------------------------------------------------------
+static void PrintPoints(const std::vector<TTrackPoint> &Points)
+{
+ printf("Time,ICAO,Callsign,Latitude,Longitude,Altitude,Speed,Heading,VerticalRate\n");
+ for (size_t i=0;i<Points.size();i++)
+   {
+	const TTrackPoint &p=Points[i];
+	int Len=sizeof(p.FlightNum);
+	while (Len>0 && p.FlightNum[Len-1]==' ') Len--;
+	printf("%lld,%06X,%.*s,%.6f,%.6f,%.0f,%.0f,%.1f,%.0f\n",
+		   (long long)p.Time,(unsigned)p.ICAO,Len,p.FlightNum,p.Latitude,p.Longitude,
+		   p.Altitude,p.Speed,p.Heading,p.VerticalRate);
+   }
+}
+//---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+ TTrackStore              Store;
+ std::vector<TTrackPoint> Points;
+ int64_t                  t0,t1;
+
+ if (argc<4)
+   {
+	Usage();
+	return 2;
+   }
+ if (!Store.Open(argv[1],true)) return 1;
+
+ std::chrono::steady_clock::time_point Start=std::chrono::steady_clock::now();
+ if (strcmp(argv[2],"icao")==0)
+   {
+	if (!ParseTimes(argc,argv,4,t0,t1))
+	  {
+	   Usage();
+	   return 2;
+	  }
+	Store.QueryICAO((uint32_t)strtoul(argv[3],NULL,16),t0,t1,Points);
+   }
+ else if (strcmp(argv[2],"box")==0 && argc>=7)
+   {
+	if (!ParseTimes(argc,argv,7,t0,t1))
+	  {
+	   Usage();
+	   return 2;
+	  }
+	Store.QueryBox(atof(argv[3]),atof(argv[4]),atof(argv[5]),atof(argv[6]),t0,t1,Points);
+   }
+ else
+   {
+	Usage();
+	return 2;
+   }
+ double Ms=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-Start).count();
+
+ PrintPoints(Points);
+ fprintf(stderr,"%u positions from %u partitions (%llu stored) in %.3f ms\n",
+		 (unsigned)Points.size(),Store.NumPartitions(),
+		 (unsigned long long)Store.NumPoints(),Ms);
+ return 0;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,85 @@
+//---------------------------------------------------------------------------
+// ADSBRegistry - compile the aircraft database into a registry image.
+//
+// The image (TAircraftRegistry) is written next to the CSV file with the
+// extension AR_EXTENSION, where the display looks for it, unless it is
+// already up to date. Addresses given after the file name are then looked
+// up and their fields printed, one aircraft per line.
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include "AircraftRegistry.h"
+
+#define NUM_FIELDS          27      /* AC_DB_NUM_FIELDS of the display's AircraftDB.h */
+
+static void        Usage(void);
+static std::string ImageName(const char *SourceFile);
+//---------------------------------------------------------------------------
+static void Usage(void)
+{
+ fprintf(stderr,
+  "usage: adsb_registry aircraftDatabase.csv [HEX ...]\n"
+  "  HEX  ICAO addresses to look up\n");
+}
+//---------------------------------------------------------------------------
+static std::string ImageName(const char *SourceFile)
+{
+ std::string Name(SourceFile);
+ size_t      Dot=Name.find_last_of('.');
+ size_t      Slash=Name.find_last_of("/\\");
+
+ if (Dot!=std::string::npos && (Slash==std::string::npos || Dot>Slash)) Name.erase(Dot);
+ return Name+AR_EXTENSION;
+}
+//---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+ TAircraftRegistry Registry;
+ std::string       Image;
+
+ if (argc<2)
+   {
+	Usage();
+	return 2;
+   }
+ Image=ImageName(argv[1]);
+
+ std::chrono::steady_clock::time_point Start=std::chrono::steady_clock::now();
+ if (!Registry.Open(Image.c_str(),argv[1]))
+   {
+	int Count=CompileAircraftRegistry(argv[1],Image.c_str(),NUM_FIELDS);
+	if (Count<0) return 1;
+	double Ms=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-Start).count();
+	fprintf(stderr,"compiled %d aircraft into %s in %.0f ms\n",Count,Image.c_str(),Ms);
+	Start=std::chrono::steady_clock::now();
+	if (!Registry.Open(Image.c_str(),argv[1]))
+	  {
+	   fprintf(stderr,"cannot open %s\n",Image.c_str());
+	   return 1;
+	  }
+   }
+ double Ms=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-Start).count();
+ fprintf(stderr,"%s: %u aircraft, opened in %.3f ms\n",Image.c_str(),Registry.NumAircraft(),Ms);
+
+ for (int i = 2; i < argc; i++)
+   {
+	uint32_t ICAO=(uint32_t)strtoul(argv[i],NULL,16);
+	int      Record=Registry.Find(ICAO);
+
+	if (Record<0)
+	  {
+	   printf("%06X: not found\n",ICAO);
+	   continue;
+	  }
+	printf("%06X:",ICAO);
+	for (unsigned f = 0; f < Registry.NumFields(); f++)
+	  printf(" %s%s",Registry.Field(Record,f),f+1<Registry.NumFields() ? "," : "\n");
+   }
+ return 0;
+}
+//---------------------------------------------------------------------------
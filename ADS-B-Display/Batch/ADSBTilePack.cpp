@@ -0,0 +1,170 @@
+//---------------------------------------------------------------------------
+// ADSBTilePack - move a map tile cache into a tile archive.
+//
+// The display used to keep every map tile in its own file, named by its
+// quadkey under a directory per four levels (GoogleMap\0\0000\...\<key>.jpg,
+// and likewise VFR_Map, IFR_Low_Map and IFR_High_Map). It now keeps them in
+// a TTileArchive in the same directory, reading the old files only when a
+// tile is not in the archive yet. This packs a whole tree at once; with -d
+// the packed files and the directories left empty are removed.
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "TileArchive.h"
+
+#define TILE_TYPE_TEXTURE   1       /* TILETYPE_TEXTURE of Map/MapSrc/Tile.h */
+#define TILE_EXTENSION      ".jpg"
+
+namespace fs = std::filesystem;
+
+static void Usage(void);
+static bool KeyFromName(const std::string &Name, uint64_t &Key);
+static int  Pack(const char *Directory, bool Delete);
+//---------------------------------------------------------------------------
+static void Usage(void)
+{
+ fprintf(stderr,
+  "usage: adsb_tilepack [-d] DIRECTORY ...\n"
+  "  -d  remove the tile files packed, and the directories left empty\n");
+}
+//---------------------------------------------------------------------------
+/*
+ * The file name is the quadkey: one digit per level from level 0, 0 for
+ * the top left quarter, 1 top right, 3 bottom left and 2 bottom right
+ * (FilesystemStorage::PathFromCoordsGE).
+ */
+static bool KeyFromName(const std::string &Name, uint64_t &Key)
+{
+ size_t Len=Name.size()-strlen(TILE_EXTENSION);
+ int    x=0,y=0;
+
+ if (Len==0 || Len>TA_MAX_LEVEL+1) return false;
+ for (size_t i = 0; i < Len; i++)
+   {
+	char d=Name[i];
+	if (d<'0' || d>'3') return false;
+	x=(x<<1)|(d=='1' || d=='2');
+	y=(y<<1)|(d=='3' || d=='2');
+   }
+ Key=TileArchiveKey(x,y,(int)Len-1,TILE_TYPE_TEXTURE);
+ return Key!=0;
+}
+//---------------------------------------------------------------------------
+static int Pack(const char *Directory, bool Delete)
+{
+ TTileArchive          Archive;
+ std::vector<fs::path> Packed;
+ std::vector<char>     Buffer;
+ unsigned              Added=0,Present=0,Skipped=0;
+ uint64_t              Bytes=0;
+ std::error_code       Error;
+
+ std::chrono::steady_clock::time_point Start=std::chrono::steady_clock::now();
+ if (!Archive.Open(Directory)) return 1;
+
+ for (fs::recursive_directory_iterator it(Directory,Error), end; !Error && it!=end; it.increment(Error))
+   {
+	if (!it->is_regular_file()) continue;
+	std::string Name=it->path().filename().string();
+	uint64_t    Key;
+
+	if (Name.size()<=strlen(TILE_EXTENSION) ||
+		Name.compare(Name.size()-strlen(TILE_EXTENSION),std::string::npos,TILE_EXTENSION)!=0)
+	  continue;
+	if (!KeyFromName(Name,Key))
+	  {
+	   fprintf(stderr,"%s: not a tile name, skipped\n",it->path().string().c_str());
+	   Skipped++;
+	   continue;
+	  }
+	if (Archive.Contains(Key))
+	  {
+	   Present++;
+	   Packed.push_back(it->path());
+	   continue;
+	  }
+
+	FILE *File=fopen(it->path().string().c_str(),"rb");
+	if (File==NULL)
+	  {
+	   fprintf(stderr,"%s: cannot open, skipped\n",it->path().string().c_str());
+	   Skipped++;
+	   continue;
+	  }
+	uintmax_t FileSize=it->file_size();
+	Buffer.resize((size_t)FileSize+1);
+	size_t Read=fread(&Buffer[0],1,Buffer.size(),File);
+	fclose(File);
+	if (Read!=FileSize)
+	  {
+	   fprintf(stderr,"%s: cannot read, skipped\n",it->path().string().c_str());
+	   Skipped++;
+	   continue;
+	  }
+	if (!Archive.Add(Key,&Buffer[0],(uint32_t)Read)) return 1;
+	Packed.push_back(it->path());
+	Added++;
+	Bytes+=Read;
+   }
+ if (Error)
+   {
+	fprintf(stderr,"%s: %s\n",Directory,Error.message().c_str());
+	return 1;
+   }
+
+ uint64_t SizeAfter=Archive.DataSize();
+ unsigned Tiles=Archive.NumTiles();
+ if (!Archive.Close()) return 1;
+ double Ms=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-Start).count();
+ fprintf(stderr,"%s: %u tiles added (%llu bytes), %u already packed, %u skipped; "
+				"%u tiles, %llu bytes in archive, %.0f ms\n",
+		 Directory,Added,(unsigned long long)Bytes,Present,Skipped,Tiles,
+		 (unsigned long long)SizeAfter,Ms);
+
+ if (Delete)
+   {
+	/* only now that the index is written */
+	for (size_t i = 0; i < Packed.size(); i++)
+	  {
+	   fs::path Dir=Packed[i].parent_path();
+	   fs::remove(Packed[i],Error);
+	   while (!Error && Dir!=fs::path(Directory) && fs::is_empty(Dir,Error) && !Error)
+		 {
+		  fs::remove(Dir,Error);
+		  Dir=Dir.parent_path();
+		 }
+	   Error.clear();
+	  }
+	fprintf(stderr,"%s: %u tile files removed\n",Directory,(unsigned)Packed.size());
+   }
+ return 0;
+}
+//---------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+ bool Delete=false;
+ int  First=1;
+ int  Result=0;
+
+ if (argc>1 && strcmp(argv[1],"-d")==0)
+   {
+	Delete=true;
+	First=2;
+   }
+ if (First>=argc)
+   {
+	Usage();
+	return 2;
+   }
+ for (int i = First; i < argc; i++)
+   if (Pack(argv[i],Delete)!=0) Result=1;
+ return Result;
+}
+//---------------------------------------------------------------------------
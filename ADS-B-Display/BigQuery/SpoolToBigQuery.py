@@ -0,0 +1,150 @@
+'''
+Uploads the Parquet files written by ADS-B-Display (ColumnarExport.cpp) to
+BigQuery. The files are loaded as they are, compressed and typed, nothing is
+decoded here.
+
+Usage: python SpoolToBigQuery.py <BigQuery directory> [table id]
+
+Finished files appear in <BigQuery directory>/spool. Each one is claimed by
+renaming it to *.uploading, so two uploaders never load the same file, then
+loaded and deleted. A file BigQuery rejects is moved to spool/failed; one that
+failed for another reason (network, credentials) is put back for the next
+pass. A claim older than STALE_CLAIM_SECONDS was left by an uploader that was
+stopped mid-load, and is put back too. The script
+keeps watching while the display is still exporting (a *.active file exists)
+and exits once the spool is empty, or a load failed, and no export is in
+progress.
+
+Rows go to TABLE_ID, created on the first load with the column names and
+types of the Parquet files (times as TIMESTAMP, HexIdent and Squawk as
+STRING, the flags as BOOLEAN). That is not the table SimpleCSVtoBigQuery.py
+loaded the CSV files into: those have the message times split in date and
+time columns, and column types guessed from the CSV. To query both, or to
+copy the old rows over once:
+
+  INSERT INTO `scs-lg-solvit.SBS_Data.SBS_Messages`
+  SELECT Message_Type, Transmission_Type, SessionID, AircraftID,
+         UPPER(CAST(HexIdent AS STRING)), FlightID,
+         TIMESTAMP(CONCAT(REPLACE(CAST(Date_MSG_Generated AS STRING), '/', '-'),
+                          ' ', CAST(Time_MSG_Generated AS STRING))),
+         TIMESTAMP(CONCAT(REPLACE(CAST(Date_MSG_Logged AS STRING), '/', '-'),
+                          ' ', CAST(Time_MSG_Logged AS STRING))),
+         Callsign, Altitude, GroundSpeed, Track, Latitude, Longitude,
+         VerticalRate, LPAD(CAST(Squawk AS STRING), 4, '0'),
+         CAST(Alert AS BOOL), CAST(Emergency AS BOOL), CAST(SPI AS BOOL),
+         CAST(IsOnGround AS BOOL)
+  FROM `scs-lg-solvit.SBS_Data.FirstRun`
+
+Make sure the following is installed:
+pip install google-cloud-bigquery
+pip install --upgrade google-api-python-client
+'''
+
+import os
+import sys
+import time
+
+TABLE_ID = "scs-lg-solvit.SBS_Data.SBS_Messages"
+POLL_SECONDS = 5
+FAILED_DIR = 'failed'
+SPOOL_EXTENSION = '.parquet'
+CLAIM_EXTENSION = '.uploading'
+STALE_CLAIM_SECONDS = 3600
+
+
+def set_aside(path):
+    '''Move a file that will never load out of the spool.'''
+    failed_dir = os.path.join(os.path.dirname(path), FAILED_DIR)
+    os.makedirs(failed_dir, exist_ok=True)
+    os.replace(path, os.path.join(failed_dir, os.path.basename(path)))
+    print(f"File '{path}' moved to {failed_dir}")
+
+
+def claim(path):
+    '''Take a spooled file for this uploader. Returns the claimed name, or None
+    if another uploader got it first.'''
+    claimed = path + CLAIM_EXTENSION
+    try:
+        os.rename(path, claimed)
+    except OSError:
+        return None
+    os.utime(claimed)  # The claim's age, see release_stale_claims().
+    return claimed
+
+
+def release_stale_claims(spool_dir):
+    now = time.time()
+    for name in os.listdir(spool_dir):
+        if name.endswith(CLAIM_EXTENSION):
+            claimed = os.path.join(spool_dir, name)
+            try:
+                if now - os.path.getmtime(claimed) > STALE_CLAIM_SECONDS:
+                    os.rename(claimed, claimed[:-len(CLAIM_EXTENSION)])
+                    print(f"File '{claimed}' released")
+            except OSError:
+                pass  # Loaded or released by another uploader meanwhile.
+
+
+def upload_file(client, job_config, table_id, path):
+    from google.api_core.exceptions import BadRequest
+    claimed = claim(path)
+    if claimed is None:
+        return 0
+    try:
+        with open(claimed, 'rb') as f:
+            job = client.load_table_from_file(f, table_id, job_config=job_config)
+            job.result()  # Waits for the job to complete.
+        print(f"Loaded file: {path} ({job.output_rows} rows)")
+        os.remove(claimed)
+        print(f"File '{path}' deleted successfully.")
+        return 0
+    except BadRequest as e:
+        # A file or schema BigQuery rejects: retrying cannot help.
+        print(f"Error loading file {path}: {e}")
+        os.replace(claimed, path)
+        set_aside(path)
+        return 1
+    except Exception as e:
+        print(f"Error loading file {path}: {e}")
+        os.replace(claimed, path)
+        return 1
+
+
+def export_in_progress(export_dir):
+    return any(name.endswith('.active') for name in os.listdir(export_dir))
+
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        print("Usage: SpoolToBigQuery.py <BigQuery directory> [table id]")
+        return 1
+    export_dir = sys.argv[1]
+    table_id = sys.argv[2] if len(sys.argv) == 3 else TABLE_ID
+    spool_dir = os.path.join(export_dir, 'spool')
+
+    from google.cloud import bigquery
+    os.environ["GOOGLE_APPLICATION_CREDENTIALS"] = os.path.join(export_dir, "YourJsonFile.json")
+    client = bigquery.Client()
+    job_config = bigquery.LoadJobConfig(
+        source_format=bigquery.SourceFormat.PARQUET,
+        create_disposition=bigquery.CreateDisposition.CREATE_IF_NEEDED,
+        write_disposition=bigquery.WriteDisposition.WRITE_APPEND,
+    )
+
+    while True:
+        failures = 0
+        if os.path.isdir(spool_dir):
+            release_stale_claims(spool_dir)
+            for name in sorted(os.listdir(spool_dir)):
+                if name.endswith(SPOOL_EXTENSION):
+                    failures += upload_file(client, job_config, table_id, os.path.join(spool_dir, name))
+        spooled = os.path.isdir(spool_dir) and any(n.endswith(SPOOL_EXTENSION) for n in os.listdir(spool_dir))
+        if not export_in_progress(export_dir) and (not spooled or failures):
+            break
+        time.sleep(POLL_SECONDS)
+    print("Export finished, exiting")
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
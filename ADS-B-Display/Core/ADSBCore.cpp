@@ -0,0 +1,59 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdlib.h>
+#include "ADSBCore.h"
+#include "Aircraft.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+//---------------------------------------------------------------------------
+TADS_B_Context *ADS_B_CreateContext(unsigned int TableSize)
+{
+ TADS_B_Context *Ctx=(TADS_B_Context *)calloc(1,sizeof(TADS_B_Context));
+
+ if (Ctx==NULL) return(NULL);
+ Ctx->HashTable=ght_create(TableSize);
+ Ctx->ICAO_cache=(uint32_t *)calloc(2*MODES_ICAO_CACHE_LEN,sizeof(uint32_t));
+ if (Ctx->HashTable==NULL || Ctx->ICAO_cache==NULL)
+   {
+	if (Ctx->HashTable) ght_finalize(Ctx->HashTable);
+	free(Ctx->ICAO_cache);
+	free(Ctx);
+	return(NULL);
+   }
+ ght_set_rehash(Ctx->HashTable, 1);
+ return(Ctx);
+}
+//---------------------------------------------------------------------------
+void ADS_B_FreeContext(TADS_B_Context *Ctx)
+{
+ if (Ctx==NULL) return;
+ Ctx->OnRemoveAircraft=NULL;
+ ADS_B_PurgeAircraft(Ctx,0);
+ ght_finalize(Ctx->HashTable);
+ free(Ctx->ICAO_cache);
+ free(Ctx);
+}
+//---------------------------------------------------------------------------
+unsigned int ADS_B_PurgeAircraft(TADS_B_Context *Ctx, int64_t StaleTimeInMs)
+{
+ uint32_t        *Key;
+ ght_iterator_t   iterator;
+ TADS_B_Aircraft *Data;
+ unsigned int     Removed=0;
+
+ for(Data = (TADS_B_Aircraft *)ght_first(Ctx->HashTable, &iterator,(const void **) &Key);
+	 Data; Data = (TADS_B_Aircraft *)ght_next(Ctx->HashTable, &iterator, (const void **)&Key))
+   {
+	if (StaleTimeInMs<=0 || (Ctx->CurrentTime-Data->LastSeen)>=StaleTimeInMs)
+	  {
+	   if (Ctx->OnRemoveAircraft) Ctx->OnRemoveAircraft(Ctx,Data);
+	   /* Removing the entry the iterator is on is allowed by ght. */
+	   ght_remove(Ctx->HashTable,sizeof(*Key), Key);
+	   delete Data;
+	   Removed++;
+	  }
+   }
+ return(Removed);
+}
+//---------------------------------------------------------------------------
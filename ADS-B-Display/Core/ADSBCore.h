@@ -0,0 +1,49 @@
+//---------------------------------------------------------------------------
+
+#ifndef ADSBCoreH
+#define ADSBCoreH
+//---------------------------------------------------------------------------
+#include <stdint.h>
+#include "ght_hash_table.h"
+
+struct TADS_B_Aircraft;
+struct TADS_B_Context;
+
+typedef void (*TAircraftCallback)(struct TADS_B_Context *Ctx, struct TADS_B_Aircraft *ADS_B_Aircraft);
+
+/**
+ * Everything the decoders keep between messages.
+ *
+ * One context is one independent view of the sky: the display owns one, the
+ * batch tool one per input file. Nothing in the core library touches global
+ * state, so separate contexts may be used from separate threads. A single
+ * context is not thread safe.
+ */
+typedef struct TADS_B_Context
+{
+ ght_hash_table_t  *HashTable;       /**< Aircraft keyed by ICAO address. */
+ uint32_t          *ICAO_cache;      /**< Recently seen addresses, see DecodeRawADS_B.cpp. */
+ int64_t            CurrentTime;     /**< Time stamp (msec) given to the next decoded message. */
+ TAircraftCallback  OnNewAircraft;   /**< Called once for each aircraft the decoders create. */
+ TAircraftCallback  OnAircraftUpdate;/**< Called after a message changed an aircraft's position, altitude or velocity. */
+ TAircraftCallback  OnRemoveAircraft;/**< Called before ADS_B_PurgeAircraft() frees an aircraft. */
+ void              *UserData;        /**< For the owner of the context. */
+} TADS_B_Context;
+
+/**
+ * Create a context with an aircraft table of TableSize buckets (it grows as
+ * needed). Returns NULL if out of memory.
+ */
+TADS_B_Context *ADS_B_CreateContext(unsigned int TableSize);
+
+/** Free the context together with every aircraft in it, without calling OnRemoveAircraft. */
+void ADS_B_FreeContext(TADS_B_Context *Ctx);
+
+/**
+ * Remove and free aircraft not heard from for StaleTimeInMs or longer,
+ * measured against Ctx->CurrentTime. Pass StaleTimeInMs <= 0 to remove all.
+ * @return the number of aircraft removed
+ */
+unsigned int ADS_B_PurgeAircraft(TADS_B_Context *Ctx, int64_t StaleTimeInMs);
+//---------------------------------------------------------------------------
+#endif
@@ -2,16 +2,24 @@
 
 #pragma hdrstop
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include "Aircraft.h"
-#include "TimeFunctions.h"
+#include "CPA.h"
 
 //---------------------------------------------------------------------------
 #pragma package(smart_init)
+#define EARTH_RADIUS_KM   6371.0     /* As CPA.cpp */
+#define KNOTS_TO_KMS      (1.852/3600.0)
+#define FPM_TO_KMS        (0.0003048/60.0)
+
 static int cprModFunction(int a, int b);
 static int cprNLFunction(double lat);
 static int cprNFunction(double lat, int isodd);
 static double cprDlonFunction(double lat, int isodd);
-static void decodeCPR(TADS_B_Aircraft *a);
+static bool decodeCPR(TADS_B_Aircraft *a);
 
 //---------------------------------------------------------------------------
 /* Always positive MOD operation, used for CPR decoding. */
@@ -109,7 +117,7 @@ static double cprDlonFunction(double lat, int isodd)
  *    simplicity. This may provide a position that is less fresh of a few
  *    seconds.
  */
-static void decodeCPR(TADS_B_Aircraft *a)
+static bool decodeCPR(TADS_B_Aircraft *a)
 {
     const double AirDlat0 = 360.0 / 60;
     const double AirDlat1 = 360.0 / 59;
@@ -127,7 +135,7 @@ static void decodeCPR(TADS_B_Aircraft *a)
     if (rlat1 >= 270) rlat1 -= 360;
 
     /* Check that both are in the same latitude zone, or abort. */
-    if (cprNLFunction(rlat0) != cprNLFunction(rlat1)) return;
+    if (cprNLFunction(rlat0) != cprNLFunction(rlat1)) return false;
 
     /* Compute ni and the longitude index m */
     if (a->even_cprtime > a->odd_cprtime) {
@@ -146,12 +154,77 @@ static void decodeCPR(TADS_B_Aircraft *a)
         a->Latitude = rlat1;
     }
     if (a->Longitude > 180) a->Longitude -= 360;
+    return true;
 }
 
  //---------------------------------------------------------------------------
- void RawToAircraft(modeS_message *mm,TADS_B_Aircraft *ADS_B_Aircraft)
+ void InitAircraft(TADS_B_Aircraft *ADS_B_Aircraft,uint32_t addr)
  {
-	  __int64 CurrentTime=GetCurrentTimeInMsec();
+  ADS_B_Aircraft->ICAO=addr;
+  snprintf(ADS_B_Aircraft->HexAddr,sizeof(ADS_B_Aircraft->HexAddr),"%06X",(int)addr);
+  ADS_B_Aircraft->Class=ICAOClassify(addr);
+  ADS_B_Aircraft->NumMessagesSBS=0;
+  ADS_B_Aircraft->NumMessagesRaw=0;
+  ADS_B_Aircraft->LastSeen=0;
+  ADS_B_Aircraft->odd_cprlat=0;
+  ADS_B_Aircraft->odd_cprlon=0;
+  ADS_B_Aircraft->even_cprlat=0;
+  ADS_B_Aircraft->even_cprlon=0;
+  ADS_B_Aircraft->odd_cprtime=0;
+  ADS_B_Aircraft->even_cprtime=0;
+  ADS_B_Aircraft->HaveOddCPR=false;
+  ADS_B_Aircraft->HaveEvenCPR=false;
+  ADS_B_Aircraft->FlightNum[0]=0;
+  ADS_B_Aircraft->Altitude=0;
+  ADS_B_Aircraft->Latitude=0;
+  ADS_B_Aircraft->Longitude=0;
+  ADS_B_Aircraft->Heading=0;
+  ADS_B_Aircraft->Speed=0;
+  ADS_B_Aircraft->VerticalRate=0;
+  ADS_B_Aircraft->HaveAltitude=false;
+  ADS_B_Aircraft->HaveLatLon=false;
+  ADS_B_Aircraft->HaveSpeedAndHeading=false;
+  ADS_B_Aircraft->HaveFlightNum=false;
+  ADS_B_Aircraft->HaveRoute=false;
+  ADS_B_Aircraft->Route[0]=0;
+  ADS_B_Aircraft->SpriteImage=0;
+  ADS_B_Aircraft->SinLat=ADS_B_Aircraft->SinLon=0;
+  ADS_B_Aircraft->CosLat=ADS_B_Aircraft->CosLon=1;
+  for (int k = 0; k < 3; k++)
+	{
+	 ADS_B_Aircraft->ECEF[k]=0;
+	 ADS_B_Aircraft->VelocityENU[k]=0;
+	 ADS_B_Aircraft->VelocityECEF[k]=0;
+	}
+  ADS_B_Aircraft->MercatorX=ADS_B_Aircraft->MercatorY=0;
+  ADS_B_Aircraft->MercatorPerKm=0;
+ }
+ //---------------------------------------------------------------------------
+ /**
+  * Look up addr in the context's aircraft table, creating and inserting a
+  * fresh aircraft (and calling Ctx->OnNewAircraft) if it is not there yet.
+  */
+ TADS_B_Aircraft *FindOrAddAircraft(TADS_B_Context *Ctx,uint32_t addr)
+ {
+  TADS_B_Aircraft *ADS_B_Aircraft;
+
+  ADS_B_Aircraft =(TADS_B_Aircraft *) ght_get(Ctx->HashTable,sizeof(addr),&addr);
+  if (ADS_B_Aircraft) return(ADS_B_Aircraft);
+
+  ADS_B_Aircraft= new TADS_B_Aircraft;
+  InitAircraft(ADS_B_Aircraft,addr);
+  if (ght_insert(Ctx->HashTable,ADS_B_Aircraft,sizeof(addr), &addr) < 0)
+	{
+	 printf("ght_insert Error - Should Not Happen\n");
+	}
+  if (Ctx->OnNewAircraft) Ctx->OnNewAircraft(Ctx,ADS_B_Aircraft);
+  return(ADS_B_Aircraft);
+ }
+ //---------------------------------------------------------------------------
+ void RawToAircraft(TADS_B_Context *Ctx,modeS_message *mm,TADS_B_Aircraft *ADS_B_Aircraft)
+ {
+	 int64_t CurrentTime=Ctx->CurrentTime;
+	 bool    Moved=false;
 	 ADS_B_Aircraft->LastSeen =CurrentTime;
 	 ADS_B_Aircraft->NumMessagesRaw++;
 
@@ -159,6 +232,7 @@ static void decodeCPR(TADS_B_Aircraft *a)
 	  {
 		ADS_B_Aircraft->Altitude = mm->altitude;
 		ADS_B_Aircraft->HaveAltitude=true;
+		Moved=true;
 	  }
 	else if (mm->msg_type == 17)
 	  {
@@ -171,24 +245,28 @@ static void decodeCPR(TADS_B_Aircraft *a)
 		{
 			ADS_B_Aircraft->Altitude = mm->altitude;
 			ADS_B_Aircraft->HaveAltitude=true;
+			Moved=true;
 			if (mm->odd_flag)
 			  {
 				ADS_B_Aircraft->odd_cprlat = mm->raw_latitude;
 				ADS_B_Aircraft->odd_cprlon = mm->raw_longitude;
 				ADS_B_Aircraft->odd_cprtime = CurrentTime;
+				ADS_B_Aircraft->HaveOddCPR = true;
               }
 			 else
              {
 				ADS_B_Aircraft->even_cprlat = mm->raw_latitude;
                 ADS_B_Aircraft->even_cprlon = mm->raw_longitude;
 				ADS_B_Aircraft->even_cprtime =CurrentTime;
+				ADS_B_Aircraft->HaveEvenCPR = true;
              }
-			/* If the two data is less than 10 seconds apart, compute
-             * the position. */
-			if (llabs(ADS_B_Aircraft->even_cprtime - ADS_B_Aircraft->odd_cprtime) <= 10000)
+			/* If we have both halves and they are less than 10 seconds
+             * apart, compute the position. */
+			if (ADS_B_Aircraft->HaveOddCPR && ADS_B_Aircraft->HaveEvenCPR &&
+				llabs(ADS_B_Aircraft->even_cprtime - ADS_B_Aircraft->odd_cprtime) <= 10000)
             {
-				decodeCPR(ADS_B_Aircraft);
-				ADS_B_Aircraft->HaveLatLon=true;
+				if (decodeCPR(ADS_B_Aircraft))
+				  ADS_B_Aircraft->HaveLatLon=true;
 			}
 		}
 		else if (mm->ME_type == 19) {
@@ -198,9 +276,77 @@ static void decodeCPR(TADS_B_Aircraft *a)
 				ADS_B_Aircraft->Heading = mm->heading;
                 ADS_B_Aircraft->VerticalRate=(mm->vert_rate_sign==0?1:-1) * (mm->vert_rate-1) * 64;
 				ADS_B_Aircraft->HaveSpeedAndHeading=true;
+				Moved=true;
 			}
 		}
 	}
+	if (Moved)
+	  {
+	   UpdateAircraftKinematics(ADS_B_Aircraft);
+	   if (Ctx->OnAircraftUpdate) Ctx->OnAircraftUpdate(Ctx,ADS_B_Aircraft);
+	  }
+ }
+ //---------------------------------------------------------------------------
+ /**
+  * Recompute the derived state (trig of the position, ECEF position and
+  * velocity, Mercator coordinates) after the position, altitude or velocity
+  * changed. The decoders call it; everyone else reads the cached values
+  * instead of redoing the trig for each use.
+  */
+ void UpdateAircraftKinematics(TADS_B_Aircraft *ADS_B_Aircraft)
+ {
+  TADS_B_Aircraft *a=ADS_B_Aircraft;
+  if (!a->HaveLatLon) return;
 
+  double lat=a->Latitude*(M_PI/180.0);
+  double lon=a->Longitude*(M_PI/180.0);
+  a->SinLat=sin(lat);
+  a->CosLat=cos(lat);
+  a->SinLon=sin(lon);
+  a->CosLon=cos(lon);
+  sinCosToECEF(a->SinLat,a->CosLat,a->SinLon,a->CosLon,a->Altitude,
+			   &a->ECEF[0],&a->ECEF[1],&a->ECEF[2]);
+
+  /* asinh(tan(lat)) is atanh(sin(lat)); no new trig. */
+  a->MercatorX=a->Longitude/360.0;
+  a->MercatorY=atanh(a->SinLat)/(2*M_PI);
+  a->MercatorPerKm=1.0/(2*M_PI*EARTH_RADIUS_KM*a->CosLat);
+
+  if (a->HaveSpeedAndHeading)
+	{
+	 double heading=a->Heading*(M_PI/180.0);
+	 double speed=a->Speed*KNOTS_TO_KMS;
+	 a->VelocityENU[0]=speed*sin(heading);
+	 a->VelocityENU[1]=speed*cos(heading);
+	 a->VelocityENU[2]=a->VerticalRate*FPM_TO_KMS;
+	}
+  else a->VelocityENU[0]=a->VelocityENU[1]=a->VelocityENU[2]=0;
+  enuToECEF(a->SinLat,a->CosLat,a->SinLon,a->CosLon,a->VelocityENU[0],a->VelocityENU[1],
+			&a->VelocityECEF[0],&a->VelocityECEF[1],&a->VelocityECEF[2]);
+ }
+ //---------------------------------------------------------------------------
+ /**
+  * Mercator position Seconds ahead along the aircraft's ground track, by the
+  * local scale of the map at its latitude. For 80 NM ahead the end is off
+  * by about 1% of the length at 40 degrees and 4% at 70, which is fine
+  * for leader lines.
+  */
+ void AircraftMercatorAhead(const TADS_B_Aircraft *ADS_B_Aircraft,double Seconds,double *X,double *Y)
+ {
+  double Scale=ADS_B_Aircraft->MercatorPerKm*Seconds;
+  *X=ADS_B_Aircraft->MercatorX+ADS_B_Aircraft->VelocityENU[0]*Scale;
+  *Y=ADS_B_Aircraft->MercatorY+ADS_B_Aircraft->VelocityENU[1]*Scale;
+ }
+ //---------------------------------------------------------------------------
+ /** computeCPA() of two aircraft from their cached ECEF state. */
+ bool AircraftCPA(const TADS_B_Aircraft *a1,const TADS_B_Aircraft *a2,
+				  double &tcpa,double &cpa_distance_nm,double &vertical_cpa)
+ {
+  TCPAStates First={&a1->ECEF[0],&a1->ECEF[1],&a1->ECEF[2],&a1->VelocityECEF[0],
+					&a1->VelocityECEF[1],&a1->VelocityECEF[2],&a1->Altitude};
+  TCPAStates Second={&a2->ECEF[0],&a2->ECEF[1],&a2->ECEF[2],&a2->VelocityECEF[0],
+					 &a2->VelocityECEF[1],&a2->VelocityECEF[2],&a2->Altitude};
+  computeCPABatch(First,Second,1,&tcpa,&cpa_distance_nm,&vertical_cpa);
+  return(tcpa>=0);
  }
   //---------------------------------------------------------------------------
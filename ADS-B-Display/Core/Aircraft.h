@@ -0,0 +1,62 @@
+//---------------------------------------------------------------------------
+
+#ifndef AircraftH
+#define AircraftH
+#include <stdint.h>
+#include "DecodeRawADS_B.h"
+#include "ADSBCore.h"
+#include "ICAORanges.h"
+
+#define MODES_NON_ICAO_ADDRESS       (1<<24) // Set on addresses to indicate they are not ICAO addresses
+
+typedef struct TADS_B_Aircraft
+{
+ uint32_t            ICAO;
+ char                HexAddr[7];       /* Printable ICAO address */
+ TICAOClass          Class;            /* Country and military range of the address, set once by InitAircraft(). */
+ int64_t             LastSeen;             /* Time at which the last packet was received. */
+ long                NumMessagesRaw;      /* Number of Mode S messages received. */
+ long                NumMessagesSBS;
+ int                 odd_cprlat;       /* Encoded latitude and longitude as extracted by odd and even */
+ int                 odd_cprlon;       /* CPR encoded messages. */
+ int                 even_cprlat;
+ int                 even_cprlon;
+ int64_t             odd_cprtime;
+ int64_t             even_cprtime;
+ bool                HaveOddCPR;       /* Set once a half of each kind was received, */
+ bool                HaveEvenCPR;      /* position is decoded only from a pair. */
+ char                FlightNum[9];     /* Flight number */
+ bool                HaveFlightNum;
+ bool                HaveAltitude;
+ double              Altitude;
+ bool                HaveLatLon;
+ double              Latitude;      /* Coordinated obtained from CPR encoded data. */
+ double              Longitude;     /* Coordinated obtained from CPR encoded data. */
+ bool                HaveSpeedAndHeading;
+ double              Heading;
+ double              Speed;
+ double              VerticalRate;
+ /* Derived from the above by UpdateAircraftKinematics(), valid with HaveLatLon. */
+ double              SinLat,CosLat;
+ double              SinLon,CosLon;
+ double              ECEF[3];          /* Position, km (as latLonToECEF) */
+ double              VelocityENU[3];   /* East, north, up, km/s; zero without HaveSpeedAndHeading */
+ double              VelocityECEF[3];  /* Horizontal velocity, km/s (as velocityVector) */
+ double              MercatorX;        /* Web Mercator, world width 1, origin at 0,0 */
+ double              MercatorY;
+ double              MercatorPerKm;    /* Mercator units per km at the aircraft's latitude */
+ int                 SpriteImage;
+ bool                HaveRoute;
+ char                Route[128];
+} TADS_B_Aircraft;
+
+
+void InitAircraft(TADS_B_Aircraft *ADS_B_Aircraft,uint32_t addr);
+TADS_B_Aircraft *FindOrAddAircraft(TADS_B_Context *Ctx,uint32_t addr);
+void RawToAircraft(TADS_B_Context *Ctx,modeS_message *mm,TADS_B_Aircraft *ADS_B_Aircraft);
+void UpdateAircraftKinematics(TADS_B_Aircraft *ADS_B_Aircraft);
+void AircraftMercatorAhead(const TADS_B_Aircraft *ADS_B_Aircraft,double Seconds,double *X,double *Y);
+bool AircraftCPA(const TADS_B_Aircraft *a1,const TADS_B_Aircraft *a2,
+				 double &tcpa,double &cpa_distance_nm,double &vertical_cpa);
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,275 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include "AircraftRegistry.h"
+#include "csv.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+#define AR_MAGIC            "ADSBREG1"
+
+static bool ParseICAO(const char *s, uint32_t &ICAO);
+static int  CompileRows(void *User, const CSV_row *Rows, unsigned NumRows);
+
+typedef struct
+{
+ TAircraftRegistryWriter *Writer;
+ const std::atomic<bool> *Cancel;
+} TCompileState;
+//---------------------------------------------------------------------------
+TAircraftRegistry::TAircraftRegistry() : Header(NULL), Buckets(NULL), Addresses(NULL),
+										 Offsets(NULL), Pool(NULL)
+{
+}
+//---------------------------------------------------------------------------
+bool TAircraftRegistry::SourceStamp(const char *FileName, uint64_t &Size, int64_t &Time)
+{
+ struct stat st;
+
+ if (stat(FileName,&st)!=0) return false;
+ Size=(uint64_t)st.st_size;
+ Time=(int64_t)st.st_mtime;
+ return true;
+}
+//---------------------------------------------------------------------------
+bool TAircraftRegistry::Open(const char *ImageFile, const char *SourceFile)
+{
+ uint64_t Size;
+ int64_t  Time;
+
+ Close();
+ if (!SourceStamp(SourceFile,Size,Time) || !File.Open(ImageFile)) return false;
+
+ const TAircraftRegistryHeader *h=(const TAircraftRegistryHeader *)File.Data();
+ bool Valid=File.Size()>=sizeof(TAircraftRegistryHeader) &&
+			memcmp(h->Magic,AR_MAGIC,sizeof(h->Magic))==0 &&
+			h->SourceSize==Size && h->SourceTime==Time && h->NumFields>0 &&
+			h->PoolSize>0 &&
+			File.Size()==sizeof(TAircraftRegistryHeader)+
+						 (AR_NUM_BUCKETS+1)*sizeof(uint32_t)+
+						 (size_t)h->NumAircraft*sizeof(uint32_t)+
+						 (size_t)h->NumAircraft*h->NumFields*sizeof(uint32_t)+
+						 h->PoolSize;
+ if (Valid)
+   {
+	Buckets=(const uint32_t *)(h+1);
+	Addresses=Buckets+AR_NUM_BUCKETS+1;
+	Offsets=Addresses+h->NumAircraft;
+	Pool=(const char *)(Offsets+(size_t)h->NumAircraft*h->NumFields);
+	Valid=Pool[h->PoolSize-1]==0 && Buckets[0]==0 && Buckets[AR_NUM_BUCKETS]==h->NumAircraft;
+	for (int i = 0; Valid && i < AR_NUM_BUCKETS; i++)
+	  Valid=Buckets[i]<=Buckets[i+1];
+   }
+ if (!Valid)
+   {
+	Close();
+	return false;
+   }
+ Header=h;
+ return true;
+}
+//---------------------------------------------------------------------------
+void TAircraftRegistry::Close(void)
+{
+ File.Close();
+ Header=NULL;
+ Buckets=NULL;
+ Addresses=NULL;
+ Offsets=NULL;
+ Pool=NULL;
+}
+//---------------------------------------------------------------------------
+int TAircraftRegistry::Find(uint32_t ICAO) const
+{
+ if (Header==NULL || ICAO>0xFFFFFF) return -1;
+
+ uint32_t        Bucket=ICAO>>(24-AR_BUCKET_BITS);
+ const uint32_t *First=Addresses+Buckets[Bucket];
+ const uint32_t *Last=Addresses+Buckets[Bucket+1];
+ const uint32_t *p=std::lower_bound(First,Last,ICAO);
+
+ if (p==Last || *p!=ICAO) return -1;
+ return (int)(p-Addresses);
+}
+//---------------------------------------------------------------------------
+const char *TAircraftRegistry::Field(int Record, unsigned Field) const
+{
+ if (Field>=Header->NumFields) return AR_UNKNOWN;
+ uint32_t Offset=Offsets[(size_t)Record*Header->NumFields+Field];
+ return Offset<Header->PoolSize ? Pool+Offset : AR_UNKNOWN;
+}
+//---------------------------------------------------------------------------
+TAircraftRegistryWriter::TAircraftRegistryWriter(unsigned NumFields) : Fields(NumFields)
+{
+ Intern(AR_UNKNOWN);
+}
+//---------------------------------------------------------------------------
+uint32_t TAircraftRegistryWriter::Intern(const char *s)
+{
+ std::pair<std::unordered_map<std::string,uint32_t>::iterator,bool> r=
+	Strings.insert(std::make_pair(std::string(s),(uint32_t)Pool.size()));
+
+ if (r.second) Pool.append(s,strlen(s)+1);
+ return r.first->second;
+}
+//---------------------------------------------------------------------------
+void TAircraftRegistryWriter::Add(uint32_t ICAO, const char *const *Fields)
+{
+ Addresses.push_back(ICAO);
+ for (unsigned i = 0; i < this->Fields; i++)
+   Offsets.push_back(Fields[i] && Fields[i][0] ? Intern(Fields[i]) : 0);
+}
+//---------------------------------------------------------------------------
+bool TAircraftRegistryWriter::Save(const char *ImageFile, const char *SourceFile)
+{
+ TAircraftRegistryHeader Header;
+ std::vector<uint32_t>   Order(Addresses.size());
+ std::vector<uint32_t>   Buckets(AR_NUM_BUCKETS+1,0);
+ std::vector<uint32_t>   SortedAddresses,SortedOffsets;
+ std::string             TempName=std::string(ImageFile)+".tmp";
+ FILE                   *File;
+ bool                    Ok;
+
+ memset(&Header,0,sizeof(Header));
+ memcpy(Header.Magic,AR_MAGIC,sizeof(Header.Magic));
+ if (!TAircraftRegistry::SourceStamp(SourceFile,Header.SourceSize,Header.SourceTime)) return false;
+
+ for (size_t i = 0; i < Order.size(); i++) Order[i]=(uint32_t)i;
+ std::stable_sort(Order.begin(),Order.end(),
+				  [this](uint32_t a, uint32_t b) { return Addresses[a]<Addresses[b]; });
+ for (size_t i = 0; i < Order.size(); i++)
+   {
+	uint32_t ICAO=Addresses[Order[i]];
+	if (ICAO>0xFFFFFF) continue;
+	if (!SortedAddresses.empty() && SortedAddresses.back()==ICAO)
+	  {
+	   printf("Duplicate Aircraft Record %06X\n",ICAO);
+	   continue;
+	  }
+	SortedAddresses.push_back(ICAO);
+	SortedOffsets.insert(SortedOffsets.end(),Offsets.begin()+(size_t)Order[i]*Fields,
+						 Offsets.begin()+(size_t)(Order[i]+1)*Fields);
+	Buckets[(ICAO>>(24-AR_BUCKET_BITS))+1]++;
+   }
+ for (int i = 0; i < AR_NUM_BUCKETS; i++) Buckets[i+1]+=Buckets[i];
+
+ Header.NumAircraft=(uint32_t)SortedAddresses.size();
+ Header.NumFields=Fields;
+ Header.PoolSize=(uint32_t)Pool.size();
+
+ File=fopen(TempName.c_str(),"wb");
+ if (File==NULL)
+   {
+	printf("AircraftRegistry: cannot create %s\n",TempName.c_str());
+	return false;
+   }
+ Ok=fwrite(&Header,sizeof(Header),1,File)==1;
+ Ok=Ok && fwrite(&Buckets[0],sizeof(uint32_t),Buckets.size(),File)==Buckets.size();
+ if (!SortedAddresses.empty())
+   {
+	Ok=Ok && fwrite(&SortedAddresses[0],sizeof(uint32_t),SortedAddresses.size(),File)==SortedAddresses.size();
+	Ok=Ok && fwrite(&SortedOffsets[0],sizeof(uint32_t),SortedOffsets.size(),File)==SortedOffsets.size();
+   }
+ Ok=Ok && fwrite(Pool.data(),1,Pool.size(),File)==Pool.size();
+ Ok=(fclose(File)==0) && Ok;
+ if (Ok)
+   {
+	remove(ImageFile);
+	Ok=rename(TempName.c_str(),ImageFile)==0;
+   }
+ if (!Ok)
+   {
+	printf("AircraftRegistry: cannot write %s\n",ImageFile);
+	remove(TempName.c_str());
+   }
+ return Ok;
+}
+//---------------------------------------------------------------------------
+static bool ParseICAO(const char *s, uint32_t &ICAO)
+{
+ size_t Len=strlen(s);
+
+ if (Len==0 || Len>6 || strspn(s,"0123456789abcdefABCDEF")!=Len) return false;
+ ICAO=(uint32_t)strtoul(s,NULL,16);
+ return ICAO!=0;
+}
+//---------------------------------------------------------------------------
+static int CompileRows(void *User, const CSV_row *Rows, unsigned NumRows)
+{
+ TCompileState            *State=(TCompileState *)User;
+ TAircraftRegistryWriter  *Writer=State->Writer;
+ std::vector<const char *> Fields(Writer->NumFields(),(const char *)NULL);
+ uint32_t                  ICAO;
+
+ if (State->Cancel && State->Cancel->load(std::memory_order_relaxed)) return 0;
+
+ for (unsigned r = 0; r < NumRows; r++)
+   {
+	if (!ParseICAO(Rows[r].fields[0],ICAO)) continue;
+	for (size_t i = 0; i < Fields.size(); i++)
+	  Fields[i]=i<Rows[r].num_fields ? Rows[r].fields[i] : NULL;
+	Writer->Add(ICAO,&Fields[0]);
+   }
+ return 1;
+}
+//---------------------------------------------------------------------------
+int CompileAircraftRegistry(const char *SourceFile, const char *ImageFile, unsigned NumFields,
+							const std::atomic<bool> *Cancel)
+{
+ TAircraftRegistryWriter Writer(NumFields);
+ TCompileState           State;
+
+ if (NumFields==0) return -1;
+ State.Writer=&Writer;
+ State.Cancel=Cancel;
+ if (CSV_parse_file_parallel(SourceFile,',',0,CompileRows,&State)<0)
+   {
+	printf("Parsing of \"%s\" failed: %s\n",SourceFile,strerror(errno));
+	return -1;
+   }
+ if (Cancel && Cancel->load()) return -1;
+ if (!Writer.Save(ImageFile,SourceFile)) return -1;
+ return (int)Writer.NumAircraft();
+}
+//---------------------------------------------------------------------------
+TAircraftRegistryLoader::TAircraftRegistryLoader() : Published(NULL), Status(AR_PENDING), Cancel(false)
+{
+}
+//---------------------------------------------------------------------------
+TAircraftRegistryLoader::~TAircraftRegistryLoader()
+{
+ Cancel.store(true);
+ if (Thread.joinable()) Thread.join();
+}
+//---------------------------------------------------------------------------
+void TAircraftRegistryLoader::Start(const char *SourceFile, const char *ImageFile, unsigned NumFields)
+{
+ if (Thread.joinable()) return;
+ Thread=std::thread(&TAircraftRegistryLoader::Run,this,std::string(SourceFile),
+					std::string(ImageFile),NumFields);
+}
+//---------------------------------------------------------------------------
+void TAircraftRegistryLoader::Run(std::string SourceFile, std::string ImageFile, unsigned NumFields)
+{
+ if (!Loaded.Open(ImageFile.c_str(),SourceFile.c_str()))
+   {
+	printf("Compiling Aircraft DB %s\n",SourceFile.c_str());
+	if (CompileAircraftRegistry(SourceFile.c_str(),ImageFile.c_str(),NumFields,&Cancel)<0 ||
+		!Loaded.Open(ImageFile.c_str(),SourceFile.c_str()))
+	  {
+	   if (!Cancel.load()) printf("Compiling of \"%s\" failed\n",SourceFile.c_str());
+	   Status.store(AR_FAILED,std::memory_order_release);
+	   return;
+	  }
+   }
+ printf("Aircraft DB: %u aircraft\n",Loaded.NumAircraft());
+ Published.store(&Loaded,std::memory_order_release);
+ Status.store(AR_READY,std::memory_order_release);
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,161 @@
+//---------------------------------------------------------------------------
+
+#ifndef AircraftRegistryH
+#define AircraftRegistryH
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include "MappedFile.h"
+//---------------------------------------------------------------------------
+#define AR_EXTENSION        ".reg"
+#define AR_BUCKET_BITS      12      /* Top bits of the 24 bit address picking a bucket. */
+#define AR_NUM_BUCKETS      (1<<AR_BUCKET_BITS)
+#define AR_UNKNOWN          "?"     /* Stored for empty fields, at offset 0 of the pool. */
+
+/** Header of a registry image, followed by its arrays (see TAircraftRegistry). */
+typedef struct
+{
+ char     Magic[8];          /* "ADSBREG1" */
+ uint64_t SourceSize;        /* Of the CSV file it was compiled from. */
+ int64_t  SourceTime;        /* Its modification time. */
+ uint32_t NumAircraft;
+ uint32_t NumFields;
+ uint32_t PoolSize;          /* Bytes of strings. */
+ uint32_t Reserved;
+} TAircraftRegistryHeader;
+
+/**
+ * The aircraft database compiled into a read-only image.
+ *
+ * The image holds, after the header:
+ *
+ *  - AR_NUM_BUCKETS+1 offsets into the sorted addresses, one bucket per
+ *    value of the address's top AR_BUCKET_BITS bits;
+ *  - the ICAO addresses, sorted;
+ *  - NumFields offsets into the string pool per aircraft, in the same order;
+ *  - the string pool, zero terminated strings each stored once.
+ *
+ * Open() maps the file and checks that it was compiled from the CSV file as
+ * it is now (by size and modification time); nothing is parsed or copied.
+ * Find() is a bucket lookup and a binary search over the few hundred
+ * addresses of the bucket, and fields are pointers into the mapping.
+ *
+ * Lookups do not change anything, so any number of threads may use an open
+ * registry.
+ */
+class TAircraftRegistry
+{
+public:
+  TAircraftRegistry();
+
+  /** Map ImageFile if it was compiled from SourceFile as it is now. */
+  bool Open(const char *ImageFile, const char *SourceFile);
+  void Close(void);
+  bool IsOpen(void) const { return Header!=NULL; }
+
+  /** @return the aircraft's record, -1 if not in the registry */
+  int         Find(uint32_t ICAO) const;
+  uint32_t    ICAO(int Record) const { return Addresses[Record]; }
+  /** A field of a record, never NULL. */
+  const char *Field(int Record, unsigned Field) const;
+
+  unsigned    NumAircraft(void) const { return Header ? Header->NumAircraft : 0; }
+  unsigned    NumFields(void) const { return Header ? Header->NumFields : 0; }
+
+  /** Size and modification time of a file, as kept in the header. */
+  static bool SourceStamp(const char *FileName, uint64_t &Size, int64_t &Time);
+
+private:
+  TAircraftRegistry(const TAircraftRegistry &);
+  TAircraftRegistry &operator=(const TAircraftRegistry &);
+
+  TMappedFile                    File;
+  const TAircraftRegistryHeader *Header;
+  const uint32_t                *Buckets;
+  const uint32_t                *Addresses;
+  const uint32_t                *Offsets;
+  const char                    *Pool;
+};
+
+/** Collects aircraft and writes them as a TAircraftRegistry image. */
+class TAircraftRegistryWriter
+{
+public:
+  TAircraftRegistryWriter(unsigned NumFields);
+
+  /** Add an aircraft; NULL or empty fields are stored as AR_UNKNOWN. */
+  void Add(uint32_t ICAO, const char *const *Fields);
+  /** Sort and write the image. Of duplicate addresses the first added is kept. */
+  bool Save(const char *ImageFile, const char *SourceFile);
+
+  unsigned NumAircraft(void) const { return (unsigned)Addresses.size(); }
+  unsigned NumFields(void) const { return Fields; }
+
+private:
+  uint32_t Intern(const char *s);
+
+  unsigned                                  Fields;
+  std::vector<uint32_t>                     Addresses;
+  std::vector<uint32_t>                     Offsets;
+  std::string                               Pool;
+  std::unordered_map<std::string,uint32_t>  Strings;
+};
+
+/**
+ * Compile an aircraft database CSV file (one aircraft per line, the hex
+ * ICAO address first, NumFields fields) into a registry image. Lines without
+ * an address, such as the header line, are skipped. The file is parsed
+ * by CSV_parse_file_parallel(). Setting *Cancel stops it early.
+ * @return the number of aircraft lines read, -1 on failure or if cancelled
+ */
+int CompileAircraftRegistry(const char *SourceFile, const char *ImageFile, unsigned NumFields,
+							const std::atomic<bool> *Cancel=NULL);
+
+typedef enum
+{
+ AR_PENDING,        /* Still opening or compiling. */
+ AR_READY,
+ AR_FAILED
+} TAircraftRegistryState;
+
+/**
+ * Opens a registry image on a background thread, compiling it from the CSV
+ * file first if it is missing or stale, so that nothing waits for the
+ * database at startup.
+ *
+ * The registry is published once it is open: Registry() is NULL until then
+ * and the same registry from then on, so callers on any thread check it on
+ * every lookup and treat NULL as "not known yet" (or, with AR_FAILED, as no
+ * database).
+ */
+class TAircraftRegistryLoader
+{
+public:
+  TAircraftRegistryLoader();
+  /** Cancels a compile still running and waits for the thread. */
+  ~TAircraftRegistryLoader();
+
+  /** Start loading. Only the first call does anything. */
+  void Start(const char *SourceFile, const char *ImageFile, unsigned NumFields);
+
+  const TAircraftRegistry *Registry(void) const { return Published.load(std::memory_order_acquire); }
+  TAircraftRegistryState   State(void) const { return (TAircraftRegistryState)Status.load(std::memory_order_acquire); }
+
+private:
+  TAircraftRegistryLoader(const TAircraftRegistryLoader &);
+  TAircraftRegistryLoader &operator=(const TAircraftRegistryLoader &);
+
+  void Run(std::string SourceFile, std::string ImageFile, unsigned NumFields);
+
+  TAircraftRegistry                      Loaded;
+  std::atomic<const TAircraftRegistry *> Published;
+  std::atomic<int>                       Status;
+  std::atomic<bool>                      Cancel;
+  std::thread                            Thread;
+};
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,149 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdio.h>
+#include <string.h>
+#include "BoundaryCache.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+#define BC_MAGIC            "ADSBGEO1"
+#define FNV_OFFSET          14695981039346656037ULL
+#define FNV_PRIME           1099511628211ULL
+//---------------------------------------------------------------------------
+TBoundaryCache::TBoundaryCache() : Header(NULL), Records(NULL), PointData(NULL), IndexData(NULL)
+{
+}
+//---------------------------------------------------------------------------
+bool TBoundaryCache::HashFile(const char *FileName, uint64_t &Hash, uint64_t &Size)
+{
+ TMappedFile          Source;
+ const unsigned char *p;
+
+ if (!Source.Open(FileName)) return false;
+ p=(const unsigned char *)Source.Data();
+ Hash=FNV_OFFSET;
+ Size=Source.Size();
+ for (size_t i = 0; i < Source.Size(); i++)
+   {
+	Hash^=p[i];
+	Hash*=FNV_PRIME;
+   }
+ return true;
+}
+//---------------------------------------------------------------------------
+bool TBoundaryCache::Open(const char *CacheFile, const char *SourceFile)
+{
+ uint64_t Hash,Size;
+
+ Close();
+ if (!HashFile(SourceFile,Hash,Size) || !File.Open(CacheFile)) return false;
+
+ const TBoundaryCacheHeader *h=(const TBoundaryCacheHeader *)File.Data();
+ bool Valid=File.Size()>=sizeof(TBoundaryCacheHeader) &&
+			memcmp(h->Magic,BC_MAGIC,sizeof(h->Magic))==0 && h->Version==BC_VERSION &&
+			h->SourceHash==Hash && h->SourceSize==Size &&
+			File.Size()==sizeof(TBoundaryCacheHeader)+
+						 (size_t)h->NumAreas*sizeof(TBoundaryRecord)+
+						 (size_t)h->NumPoints*sizeof(pfVec3)+
+						 (size_t)h->NumIndices*sizeof(uint32_t);
+ if (!Valid)
+   {
+	File.Close();
+	return false;
+   }
+ Records=(const TBoundaryRecord *)(h+1);
+ PointData=(const pfVec3 *)(Records+h->NumAreas);
+ IndexData=(const uint32_t *)(PointData+h->NumPoints);
+ for (uint32_t i = 0; i < h->NumAreas; i++)
+   {
+	const TBoundaryRecord &r=Records[i];
+	if ((uint64_t)r.FirstPoint+r.NumPoints>h->NumPoints ||
+		(uint64_t)r.FirstIndex+r.NumIndices>h->NumIndices ||
+		memchr(r.Name,0,BC_MAX_NAME)==NULL)
+	  {
+	   Close();
+	   return false;
+	  }
+	for (uint32_t k = 0; k < r.NumIndices; k++)
+	  if (IndexData[r.FirstIndex+k]>=r.NumPoints)
+		{
+		 Close();
+		 return false;
+		}
+   }
+ Header=h;
+ return true;
+}
+//---------------------------------------------------------------------------
+void TBoundaryCache::Close(void)
+{
+ File.Close();
+ Header=NULL;
+ Records=NULL;
+ PointData=NULL;
+ IndexData=NULL;
+}
+//---------------------------------------------------------------------------
+void TBoundaryCacheWriter::Add(const char *Name, double LowerAltitude, double UpperAltitude,
+							   const pfVec3 *Points, unsigned NumPoints,
+							   const unsigned int *Indices, unsigned NumIndices)
+{
+ TBoundaryRecord r;
+
+ memset(&r,0,sizeof(r));
+ strncpy(r.Name,Name,BC_MAX_NAME-1);
+ r.LowerAltitude=LowerAltitude;
+ r.UpperAltitude=UpperAltitude;
+ r.FirstPoint=(uint32_t)(this->Points.size()/3);
+ r.NumPoints=NumPoints;
+ r.FirstIndex=(uint32_t)this->Indices.size();
+ r.NumIndices=NumIndices;
+ for (unsigned i = 0; i < NumPoints; i++)
+   this->Points.insert(this->Points.end(),Points[i],Points[i]+3);
+ this->Indices.insert(this->Indices.end(),Indices,Indices+NumIndices);
+ Records.push_back(r);
+}
+//---------------------------------------------------------------------------
+bool TBoundaryCacheWriter::Save(const char *CacheFile, const char *SourceFile)
+{
+ TBoundaryCacheHeader Header;
+ std::string          TempName=std::string(CacheFile)+".tmp";
+ FILE                *File;
+ bool                 Ok;
+
+ memset(&Header,0,sizeof(Header));
+ memcpy(Header.Magic,BC_MAGIC,sizeof(Header.Magic));
+ Header.Version=BC_VERSION;
+ if (!TBoundaryCache::HashFile(SourceFile,Header.SourceHash,Header.SourceSize)) return false;
+ Header.NumAreas=(uint32_t)Records.size();
+ Header.NumPoints=(uint32_t)(Points.size()/3);
+ Header.NumIndices=(uint32_t)Indices.size();
+
+ File=fopen(TempName.c_str(),"wb");
+ if (File==NULL)
+   {
+	printf("BoundaryCache: cannot create %s\n",TempName.c_str());
+	return false;
+   }
+ Ok=fwrite(&Header,sizeof(Header),1,File)==1;
+ if (!Records.empty())
+   Ok=Ok && fwrite(&Records[0],sizeof(TBoundaryRecord),Records.size(),File)==Records.size();
+ if (!Points.empty())
+   Ok=Ok && fwrite(&Points[0],sizeof(double),Points.size(),File)==Points.size();
+ if (!Indices.empty())
+   Ok=Ok && fwrite(&Indices[0],sizeof(uint32_t),Indices.size(),File)==Indices.size();
+ Ok=(fclose(File)==0) && Ok;
+ if (Ok)
+   {
+	remove(CacheFile);
+	Ok=rename(TempName.c_str(),CacheFile)==0;
+   }
+ if (!Ok)
+   {
+	printf("BoundaryCache: cannot write %s\n",CacheFile);
+	remove(TempName.c_str());
+   }
+ return Ok;
+}
+//---------------------------------------------------------------------------
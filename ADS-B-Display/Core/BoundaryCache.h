@@ -0,0 +1,96 @@
+//---------------------------------------------------------------------------
+
+#ifndef BoundaryCacheH
+#define BoundaryCacheH
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "TriangulatPoly.h"
+//---------------------------------------------------------------------------
+#define BC_EXTENSION        ".geo"
+#define BC_MAX_NAME         32
+/*
+ * Version of the file layout and of what is stored in it: bump it whenever
+ * either changes, including the output of triangulatePoly() or of the
+ * checks and reordering done before it, so that old caches are rebuilt.
+ */
+#define BC_VERSION          2
+
+/** One area in a boundary cache. 64 bytes, no padding. */
+typedef struct
+{
+ char     Name[BC_MAX_NAME];     /* Zero terminated. */
+ double   LowerAltitude;         /* Feet. */
+ double   UpperAltitude;
+ uint32_t FirstPoint,NumPoints;  /* Into the cache's points. */
+ uint32_t FirstIndex,NumIndices; /* Into its triangle indices, which count from FirstPoint. */
+} TBoundaryRecord;
+
+/** Header of a cache file, followed by the records, points and indices. */
+typedef struct
+{
+ char     Magic[8];          /* "ADSBGEO1" */
+ uint32_t Version;           /* BC_VERSION */
+ uint32_t NumAreas;
+ uint64_t SourceHash;        /* FNV-1a of the source file. */
+ uint64_t SourceSize;
+ uint32_t NumPoints;
+ uint32_t NumIndices;
+} TBoundaryCacheHeader;
+
+/**
+ * Compiled area boundaries, so that a boundary file is only parsed,
+ * checked and triangulated once.
+ *
+ * The cache holds each area's points, already in counterclockwise order,
+ * its triangles and altitude band, in a file laid out as the arrays are
+ * used in memory. Open() maps it and only checks that it is of BC_VERSION
+ * and was built from the source file as it is now (by size and hash); the
+ * arrays are then used in place.
+ */
+class TBoundaryCache
+{
+public:
+  TBoundaryCache();
+
+  /** Map CacheFile if it was built from SourceFile as it is now. */
+  bool Open(const char *CacheFile, const char *SourceFile);
+  void Close(void);
+
+  unsigned               NumAreas(void) const { return Header ? Header->NumAreas : 0; }
+  const TBoundaryRecord *Area(unsigned i) const { return &Records[i]; }
+  const pfVec3          *Points(unsigned i) const { return &PointData[Records[i].FirstPoint]; }
+  const uint32_t        *Indices(unsigned i) const { return &IndexData[Records[i].FirstIndex]; }
+
+  /** Size and FNV-1a hash of a file's contents. */
+  static bool HashFile(const char *FileName, uint64_t &Hash, uint64_t &Size);
+
+private:
+  TBoundaryCache(const TBoundaryCache &);
+  TBoundaryCache &operator=(const TBoundaryCache &);
+
+  TMappedFile                 File;
+  const TBoundaryCacheHeader *Header;
+  const TBoundaryRecord      *Records;
+  const pfVec3               *PointData;
+  const uint32_t             *IndexData;
+};
+
+/** Collects areas and writes them as a TBoundaryCache file. */
+class TBoundaryCacheWriter
+{
+public:
+  void Add(const char *Name, double LowerAltitude, double UpperAltitude,
+		   const pfVec3 *Points, unsigned NumPoints,
+		   const unsigned int *Indices, unsigned NumIndices);
+  bool Save(const char *CacheFile, const char *SourceFile);
+
+private:
+  std::vector<TBoundaryRecord> Records;
+  std::vector<double>          Points;
+  std::vector<uint32_t>        Indices;
+};
+//---------------------------------------------------------------------------
+#endif
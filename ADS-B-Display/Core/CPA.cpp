@@ -0,0 +1,137 @@
+//---------------------------------------------------------------------------
+#pragma hdrstop
+
+#include "CPA.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+#include <stdio.h>
+#include <math.h>
+
+#include <stdio.h>
+#include <math.h>
+
+// Constants
+#define EARTH_RADIUS 6371.0 // Earth's radius in kilometers
+#define KNOTS_TO_KMPH 1.852 // Convert knots to km/h
+#define KM_TO_NM 0.539957    // Convert km to nautical miles
+#define FEET_TO_KM 0.0003048 // Convert feet to km
+#define DEG_TO_RAD (M_PI / 180.0) // Degrees to radians
+
+// Structure to store aircraft information
+typedef struct {
+    double lat;      // Latitude in degrees
+    double lon;      // Longitude in degrees
+    double speed;    // Speed in knots
+    double heading;  // Heading in degrees
+    double altitude; // Altitude in feet
+} Aircraft;
+
+// Convert lat, lon, and altitude to Earth-Centered Earth-Fixed (ECEF) coordinates
+void latLonToECEF(double lat, double lon, double altitude, double *x, double *y, double *z) {
+    lat *= DEG_TO_RAD;
+    lon *= DEG_TO_RAD;
+	sinCosToECEF(sin(lat), cos(lat), sin(lon), cos(lon), altitude, x, y, z);
+}
+
+// Convert speed and heading to ECEF velocity components
+void velocityVector(double lat, double lon, double speed, double heading, double *vx, double *vy, double *vz) {
+    speed *= KNOTS_TO_KMPH / 3600.0; // Convert knots to km/s
+    heading *= DEG_TO_RAD;
+    lat *= DEG_TO_RAD;
+    lon *= DEG_TO_RAD;
+
+    // Compute velocity components in the local tangent plane
+    double v_north = speed * cos(heading);
+    double v_east = speed * sin(heading);
+
+	enuToECEF(sin(lat), cos(lat), sin(lon), cos(lon), v_east, v_north, vx, vy, vz);
+}
+
+// ECEF position from precomputed sines and cosines
+void sinCosToECEF(double sinLat, double cosLat, double sinLon, double cosLon, double altitude,
+				  double *x, double *y, double *z) {
+	altitude *= FEET_TO_KM; // Convert feet to km
+	double R = EARTH_RADIUS + altitude;
+
+	*x = R * cosLat * cosLon;
+	*y = R * cosLat * sinLon;
+	*z = R * sinLat;
+}
+
+// Convert velocity components in the local tangent plane to ECEF
+void enuToECEF(double sinLat, double cosLat, double sinLon, double cosLon, double east, double north,
+			   double *vx, double *vy, double *vz) {
+	*vx = -north * sinLat * cosLon - east * sinLon;
+	*vy = -north * sinLat * sinLon + east * cosLon;
+	*vz = north * cosLat;
+}
+
+// Compute CPA and TCPA for many pairs at once
+void computeCPABatch(const TCPAStates &First, const TCPAStates &Second, unsigned int Count,
+					 double *__restrict tcpa, double *__restrict cpa_distance_nm,
+					 double *__restrict vertical_cpa) {
+	// Local copies of the array pointers, which the stores below cannot change
+	const double *x1 = First.x, *y1 = First.y, *z1 = First.z, *alt1 = First.altitude;
+	const double *vx1 = First.vx, *vy1 = First.vy, *vz1 = First.vz;
+	const double *x2 = Second.x, *y2 = Second.y, *z2 = Second.z, *alt2 = Second.altitude;
+	const double *vx2 = Second.vx, *vy2 = Second.vy, *vz2 = Second.vz;
+
+	for (unsigned int i = 0; i < Count; i++) {
+		// Relative position and velocity
+		double dx = x2[i] - x1[i], dy = y2[i] - y1[i], dz = z2[i] - z1[i];
+		double dvx = vx2[i] - vx1[i], dvy = vy2[i] - vy1[i], dvz = vz2[i] - vz1[i];
+
+		// TCPA using vector projection. The same velocity means no closest
+		// point and gives -1; written without branches so the loop vectorizes
+		double dv2 = dvx * dvx + dvy * dvy + dvz * dvz;
+		double same = (double)(dv2 < 1e-12);
+		double t = -(dx * dvx + dy * dvy + dz * dvz) / (dv2 + same);
+		t -= same * (t + 1.0);
+
+		// CPA positions of both aircraft at TCPA time
+		double cx1 = x1[i] + vx1[i] * t, cx2 = x2[i] + vx2[i] * t;
+		double cy1 = y1[i] + vy1[i] * t, cy2 = y2[i] + vy2[i] * t;
+		double cz1 = z1[i] + vz1[i] * t, cz2 = z2[i] + vz2[i] * t;
+
+		// Half the chord between the two directions on the unit sphere; the
+		// great-circle angle is 2*asin of it (the haversine formula without
+		// going through latitude and longitude)
+		double r1 = 1.0 / sqrt(cx1 * cx1 + cy1 * cy1 + cz1 * cz1);
+		double r2 = 1.0 / sqrt(cx2 * cx2 + cy2 * cy2 + cz2 * cz2);
+		double ux = cx2 * r2 - cx1 * r1, uy = cy2 * r2 - cy1 * r1, uz = cz2 * r2 - cz1 * r1;
+		double h = 0.5 * sqrt(ux * ux + uy * uy + uz * uz);
+
+		tcpa[i] = t;
+		cpa_distance_nm[i] = h;
+		vertical_cpa[i] = fabs(alt1[i] - alt2[i]); // in feet
+	}
+	// Great-circle distance in nautical miles, kept out of the loop above
+	for (unsigned int i = 0; i < Count; i++) {
+		double h = cpa_distance_nm[i] < 1.0 ? cpa_distance_nm[i] : 1.0;
+		cpa_distance_nm[i] = 2.0 * asin(h) * EARTH_RADIUS * KM_TO_NM;
+	}
+}
+
+// Compute CPA and TCPA
+bool computeCPA(double lat1, double lon1,double altitude1, double speed1, double heading1,
+				double lat2, double lon2,double altitude2, double speed2, double heading2,
+				double &tcpa,double &cpa_distance_nm, double &vertical_cpa) {
+    double x1, y1, z1, x2, y2, z2;
+    double vx1, vy1, vz1, vx2, vy2, vz2;
+
+    // Convert positions of both aircraft to ECEF coordinates
+	latLonToECEF(lat1, lon1, altitude1, &x1, &y1, &z1);
+	latLonToECEF(lat2, lon2, altitude2, &x2, &y2, &z2);
+
+    // Compute velocity vectors for both aircraft in ECEF frame
+	velocityVector(lat1, lon1, speed1, heading1, &vx1, &vy1, &vz1);
+	velocityVector(lat2, lon2, speed2, heading2, &vx2, &vy2, &vz2);
+
+	TCPAStates First = { &x1, &y1, &z1, &vx1, &vy1, &vz1, &altitude1 };
+	TCPAStates Second = { &x2, &y2, &z2, &vx2, &vy2, &vz2, &altitude2 };
+	computeCPABatch(First, Second, 1, &tcpa, &cpa_distance_nm, &vertical_cpa);
+
+    // If TCPA is negative, the aircraft are diverging, no CPA will occur
+	return(tcpa >= 0);
+}
+ //---------------------------------------------------------------------------
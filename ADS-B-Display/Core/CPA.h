@@ -0,0 +1,41 @@
+//---------------------------------------------------------------------------
+
+#ifndef CPAH
+#define CPAH
+//---------------------------------------------------------------------------
+/* Position (km) and velocity (km/s) in Earth-Centered Earth-Fixed coordinates. */
+void latLonToECEF(double lat, double lon, double altitude, double *x, double *y, double *z);
+void velocityVector(double lat, double lon, double speed, double heading, double *vx, double *vy, double *vz);
+
+/* The same from the sines and cosines of latitude and longitude, speed as east and north km/s. */
+void sinCosToECEF(double sinLat, double cosLat, double sinLon, double cosLon, double altitude,
+				  double *x, double *y, double *z);
+void enuToECEF(double sinLat, double cosLat, double sinLon, double cosLon, double east, double north,
+			   double *vx, double *vy, double *vz);
+
+/**
+ * Aircraft state for computeCPABatch(), one array per component so that
+ * the kernel streams through memory. Element i of each array belongs to
+ * the same aircraft.
+ */
+typedef struct
+{
+ const double *x,*y,*z;         /* ECEF position, km (latLonToECEF) */
+ const double *vx,*vy,*vz;      /* ECEF velocity, km/s (velocityVector) */
+ const double *altitude;        /* Feet */
+} TCPAStates;
+
+/**
+ * CPA of Count pairs: pair i is element i of First against element i of
+ * Second. The main loop has no branches, calls or I/O so the compiler can
+ * vectorize it; the one asin per pair is done in a separate pass. tcpa[i] is negative when the pair
+ * never gets closer (diverging or same velocity), and the other outputs of
+ * that pair are then meaningless.
+ */
+void computeCPABatch(const TCPAStates &First, const TCPAStates &Second, unsigned int Count,
+					 double *tcpa, double *cpa_distance_nm, double *vertical_cpa);
+
+bool computeCPA(double lat1, double lon1,double altitude1, double speed1, double heading1,
+				double lat2, double lon2,double altitude2, double speed2, double heading2,
+				double &tcpa,double &cpa_distance_nm, double &vertical_cpa);
+#endif
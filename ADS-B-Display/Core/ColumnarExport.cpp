@@ -0,0 +1,724 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <chrono>
+#ifdef _WIN32
+#include <direct.h>
+#define PATH_SEPARATOR '\\'
+#else
+#include <sys/stat.h>
+#define PATH_SEPARATOR '/'
+#endif
+#include "zlib.h"
+#include "SBS_Message.h"
+#include "ColumnarExport.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+#define CE_MAGIC          "PAR1"
+#define CE_MAX_LINE       512
+#define CE_CREATED_BY     "ADS-B-Display ColumnarExport"
+
+/* Parquet enums (parquet.thrift). */
+#define PQ_BOOLEAN            0
+#define PQ_INT32              1
+#define PQ_INT64              2
+#define PQ_DOUBLE             5
+#define PQ_BYTE_ARRAY         6
+#define PQ_OPTIONAL           1
+#define PQ_UTF8               0
+#define PQ_TIMESTAMP_MILLIS   9
+#define PQ_PLAIN              0
+#define PQ_RLE                3
+#define PQ_UNCOMPRESSED       0
+#define PQ_GZIP               2
+#define PQ_DATA_PAGE          0
+
+/* Thrift compact protocol field types. */
+#define TC_I32                5
+#define TC_I64                6
+#define TC_BINARY             8
+#define TC_LIST               9
+#define TC_STRUCT             12
+
+typedef struct
+{
+ const char  *Name;
+ TColumnType  Type;
+ size_t       Offset;
+} TColumnDef;
+
+/* Column n of a file is Columns[n]; its null flag is bit n of TSBSRecord.Present. */
+static const TColumnDef Columns[]=
+{
+ {"Message_Type",      CE_STRING,  offsetof(TSBSRecord,MessageType)},
+ {"Transmission_Type", CE_INT8,    offsetof(TSBSRecord,TransmissionType)},
+ {"SessionID",         CE_INT32,   offsetof(TSBSRecord,SessionID)},
+ {"AircraftID",        CE_INT32,   offsetof(TSBSRecord,AircraftID)},
+ {"HexIdent",          CE_STRING,  offsetof(TSBSRecord,HexIdent)},
+ {"FlightID",          CE_INT32,   offsetof(TSBSRecord,FlightID)},
+ {"MSG_Generated",     CE_TIMESTAMP,offsetof(TSBSRecord,Generated)},
+ {"MSG_Logged",        CE_TIMESTAMP,offsetof(TSBSRecord,Logged)},
+ {"Callsign",          CE_STRING,  offsetof(TSBSRecord,Callsign)},
+ {"Altitude",          CE_INT32,   offsetof(TSBSRecord,Altitude)},
+ {"GroundSpeed",       CE_FLOAT64, offsetof(TSBSRecord,GroundSpeed)},
+ {"Track",             CE_FLOAT64, offsetof(TSBSRecord,Track)},
+ {"Latitude",          CE_FLOAT64, offsetof(TSBSRecord,Latitude)},
+ {"Longitude",         CE_FLOAT64, offsetof(TSBSRecord,Longitude)},
+ {"VerticalRate",      CE_INT32,   offsetof(TSBSRecord,VerticalRate)},
+ {"Squawk",            CE_STRING,  offsetof(TSBSRecord,Squawk)},
+ {"Alert",             CE_BOOL,    offsetof(TSBSRecord,Alert)},
+ {"Emergency",         CE_BOOL,    offsetof(TSBSRecord,Emergency)},
+ {"SPI",               CE_BOOL,    offsetof(TSBSRecord,SPI)},
+ {"IsOnGround",        CE_BOOL,    offsetof(TSBSRecord,IsOnGround)},
+};
+#define NUM_COLUMNS  (sizeof(Columns)/sizeof(Columns[0]))
+
+enum
+{
+ COL_MESSAGE_TYPE, COL_TRANSMISSION_TYPE, COL_SESSION_ID, COL_AIRCRAFT_ID,
+ COL_HEX_IDENT, COL_FLIGHT_ID, COL_GENERATED, COL_LOGGED, COL_CALLSIGN,
+ COL_ALTITUDE, COL_GROUND_SPEED, COL_TRACK, COL_LATITUDE, COL_LONGITUDE,
+ COL_VERTICAL_RATE, COL_SQUAWK, COL_ALERT, COL_EMERGENCY, COL_SPI,
+ COL_IS_ON_GROUND
+};
+
+static int64_t NowInMs(void);
+static int64_t DaysFromCivil(int y, unsigned m, unsigned d);
+static bool ParseInt(const char *Field, int32_t *Value);
+static bool ParseDouble(const char *Field, double *Value);
+static bool ParseTime(const char *Date, const char *Time, int64_t *Value);
+static int PhysicalType(TColumnType Type);
+static void PutU32(unsigned char *Out, uint32_t Value);
+static bool Gzip(const std::vector<unsigned char> &In, std::vector<unsigned char> &Out);
+static std::string JoinPath(const std::string &Dir, const std::string &Name);
+static bool MakeDir(const char *Dir);
+//---------------------------------------------------------------------------
+static int64_t NowInMs(void)
+{
+ return std::chrono::duration_cast<std::chrono::milliseconds>(
+		  std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//---------------------------------------------------------------------------
+/**
+ * Days since 1970-01-01 of a proleptic Gregorian date.
+ */
+static int64_t DaysFromCivil(int y, unsigned m, unsigned d)
+{
+ y-= m<=2;
+ int      era=(y>=0 ? y : y-399)/400;
+ unsigned yoe=(unsigned)(y-era*400);
+ unsigned doy=(153*(m>2 ? m-3 : m+9)+2)/5+d-1;
+ unsigned doe=yoe*365+yoe/4-yoe/100+doy;
+ return (int64_t)era*146097+(int64_t)doe-719468;
+}
+//---------------------------------------------------------------------------
+static bool ParseInt(const char *Field, int32_t *Value)
+{
+ char *End;
+ long  v;
+
+ if (*Field=='\0') return false;
+ v=strtol(Field,&End,10);
+ if (End==Field || *End!='\0') return false;
+ *Value=(int32_t)v;
+ return true;
+}
+//---------------------------------------------------------------------------
+static bool ParseDouble(const char *Field, double *Value)
+{
+ char  *End;
+ double v;
+
+ if (*Field=='\0') return false;
+ v=strtod(Field,&End);
+ if (End==Field || *End!='\0' || !isfinite(v)) return false;
+ *Value=v;
+ return true;
+}
+//---------------------------------------------------------------------------
+/**
+ * "2023/10/20" and "22:33:49.364" to msec since 1970.
+ */
+static bool ParseTime(const char *Date, const char *Time, int64_t *Value)
+{
+ unsigned Year,Month,Day,Hour,Minute;
+ double   Second;
+
+ if (sscanf(Date,"%u/%u/%u",&Year,&Month,&Day)!=3) return false;
+ if (sscanf(Time,"%u:%u:%lf",&Hour,&Minute,&Second)!=3) return false;
+ if (Month<1 || Month>12 || Day<1 || Day>31 || Hour>23 || Minute>59 ||
+	 Second<0.0 || Second>=61.0) return false;
+ *Value=(DaysFromCivil((int)Year,Month,Day)*86400+Hour*3600+Minute*60)*1000+
+		(int64_t)(Second*1000.0+0.5);
+ return true;
+}
+//---------------------------------------------------------------------------
+bool SBS_ParseRecord(const char *Line, TSBSRecord *Record)
+{
+ char    Buffer[CE_MAX_LINE];
+ char   *Fields[SBS_FIELD_COUNT];
+ size_t  Len=strlen(Line);
+ int     NumFields=0;
+ int32_t v;
+ char   *p;
+
+ while (Len>0 && (Line[Len-1]=='\r' || Line[Len-1]=='\n')) Len--;
+ if (Len==0 || Len>=sizeof(Buffer)) return false;
+ memcpy(Buffer,Line,Len);
+ Buffer[Len]='\0';
+
+ p=Buffer;
+ while (NumFields<SBS_FIELD_COUNT)
+  {
+   Fields[NumFields++]=p;
+   p=strchr(p,',');
+   if (p==NULL) break;
+   *p++='\0';
+  }
+ /* Everything up to the logged time is always present, the rest may be cut short. */
+ if (NumFields<=SBS_TIME_LOGGED) return false;
+ for (int i=NumFields;i<SBS_FIELD_COUNT;i++) Fields[i]=(char *)"";
+
+ memset(Record,0,sizeof(*Record));
+ if (strlen(Fields[SBS_MESSAGE_TYPE])==0 || strlen(Fields[SBS_MESSAGE_TYPE])>=sizeof(Record->MessageType))
+   return false;
+ strcpy(Record->MessageType,Fields[SBS_MESSAGE_TYPE]);
+ Record->Present|=1u<<COL_MESSAGE_TYPE;
+
+ if (ParseInt(Fields[SBS_TRANSMISSION_TYPE],&v))
+   {
+	Record->TransmissionType=(int8_t)v;
+	Record->Present|=1u<<COL_TRANSMISSION_TYPE;
+   }
+ if (ParseInt(Fields[SBS_SESSION_ID],&Record->SessionID)) Record->Present|=1u<<COL_SESSION_ID;
+ if (ParseInt(Fields[SBS_AIRCRAFT_ID],&Record->AircraftID)) Record->Present|=1u<<COL_AIRCRAFT_ID;
+ if (*Fields[SBS_HEX_INDENT])
+   {
+	char *End;
+	unsigned long Addr=strtoul(Fields[SBS_HEX_INDENT],&End,16);
+	if (*End=='\0' && Addr<=0xFFFFFF)
+	  {
+	   snprintf(Record->HexIdent,sizeof(Record->HexIdent),"%06lX",Addr);
+	   Record->Present|=1u<<COL_HEX_IDENT;
+	  }
+   }
+ if (ParseInt(Fields[SBS_FLIGHT_ID],&Record->FlightID)) Record->Present|=1u<<COL_FLIGHT_ID;
+ if (ParseTime(Fields[SBS_DATE_GENERATED],Fields[SBS_TIME_GENERATED],&Record->Generated))
+   Record->Present|=1u<<COL_GENERATED;
+ if (ParseTime(Fields[SBS_DATE_LOGGED],Fields[SBS_TIME_LOGGED],&Record->Logged))
+   Record->Present|=1u<<COL_LOGGED;
+
+ p=Fields[SBS_CALLSIGN];
+ while (*p==' ') p++;
+ Len=strlen(p);
+ while (Len>0 && p[Len-1]==' ') Len--;
+ if (Len>0 && Len<sizeof(Record->Callsign))
+   {
+	memcpy(Record->Callsign,p,Len);
+	Record->Present|=1u<<COL_CALLSIGN;
+   }
+
+ if (ParseInt(Fields[SBS_ALTITUDE],&Record->Altitude)) Record->Present|=1u<<COL_ALTITUDE;
+ if (ParseDouble(Fields[SBS_GROUND_SPEED],&Record->GroundSpeed)) Record->Present|=1u<<COL_GROUND_SPEED;
+ if (ParseDouble(Fields[SBS_TRACK_HEADING],&Record->Track)) Record->Present|=1u<<COL_TRACK;
+ if (ParseDouble(Fields[SBS_LATITUDE],&Record->Latitude)) Record->Present|=1u<<COL_LATITUDE;
+ if (ParseDouble(Fields[SBS_LONGITUDE],&Record->Longitude)) Record->Present|=1u<<COL_LONGITUDE;
+ if (ParseInt(Fields[SBS_VERTICAL_RATE],&Record->VerticalRate)) Record->Present|=1u<<COL_VERTICAL_RATE;
+ if (ParseInt(Fields[SBS_SQUAWK],&v) && v>=0 && v<=7777)
+   {
+	snprintf(Record->Squawk,sizeof(Record->Squawk),"%04d",(int)v);
+	Record->Present|=1u<<COL_SQUAWK;
+   }
+
+ /* Flags are sent as -1 (set) or 0. */
+ if (ParseInt(Fields[SBS_ALERT],&v))        { Record->Alert=(v!=0);      Record->Present|=1u<<COL_ALERT; }
+ if (ParseInt(Fields[SBS_EMERGENCY],&v))    { Record->Emergency=(v!=0);  Record->Present|=1u<<COL_EMERGENCY; }
+ if (ParseInt(Fields[SBS_SBI],&v))          { Record->SPI=(v!=0);        Record->Present|=1u<<COL_SPI; }
+ if (ParseInt(Fields[SBS_IS_ON_GROUND],&v)) { Record->IsOnGround=(v!=0); Record->Present|=1u<<COL_IS_ON_GROUND; }
+ return true;
+}
+//---------------------------------------------------------------------------
+static int PhysicalType(TColumnType Type)
+{
+ switch (Type)
+  {
+   case CE_INT8:
+   case CE_INT32:     return PQ_INT32;
+   case CE_TIMESTAMP: return PQ_INT64;
+   case CE_FLOAT64:   return PQ_DOUBLE;
+   case CE_BOOL:      return PQ_BOOLEAN;
+   default:           return PQ_BYTE_ARRAY;
+  }
+}
+//---------------------------------------------------------------------------
+static void PutU32(unsigned char *Out, uint32_t Value)
+{
+ Out[0]=(unsigned char)Value;
+ Out[1]=(unsigned char)(Value>>8);
+ Out[2]=(unsigned char)(Value>>16);
+ Out[3]=(unsigned char)(Value>>24);
+}
+//---------------------------------------------------------------------------
+/**
+ * Compress In as a gzip stream, which is what Parquet's GZIP codec holds.
+ */
+static bool Gzip(const std::vector<unsigned char> &In, std::vector<unsigned char> &Out)
+{
+ z_stream Stream;
+ int      Result;
+
+ memset(&Stream,0,sizeof(Stream));
+ if (deflateInit2(&Stream,Z_DEFAULT_COMPRESSION,Z_DEFLATED,15+16,8,Z_DEFAULT_STRATEGY)!=Z_OK)
+   return false;
+ /* This zlib's bound allows for the 6 byte zlib wrapper, not gzip's 18. */
+ Out.resize(deflateBound(&Stream,(uLong)In.size())+12);
+ Stream.next_in=(Bytef *)(In.empty() ? NULL : &In[0]);
+ Stream.avail_in=(uInt)In.size();
+ Stream.next_out=&Out[0];
+ Stream.avail_out=(uInt)Out.size();
+ Result=deflate(&Stream,Z_FINISH);
+ Out.resize(Stream.total_out);
+ deflateEnd(&Stream);
+ return Result==Z_STREAM_END;
+}
+//---------------------------------------------------------------------------
+/**
+ * Just enough of the Thrift compact protocol to write Parquet page headers
+ * and the file footer.
+ */
+class TThriftWriter
+{
+public:
+  TThriftWriter(std::vector<unsigned char> &Out) : Out(Out), Depth(0) { Last[0]=0; }
+
+  void I32(int Id, int32_t Value)   { Field(Id,TC_I32); ZigZag(Value); }
+  void I64(int Id, int64_t Value)   { Field(Id,TC_I64); ZigZag(Value); }
+  void String(int Id, const char *Value)
+  {
+   Field(Id,TC_BINARY);
+   ListString(Value);
+  }
+  void BeginStruct(int Id)          { Field(Id,TC_STRUCT); Push(); }
+  void EndStruct(void)              { Out.push_back(0); Depth--; }
+  void BeginList(int Id, int Type, size_t Size)
+  {
+   Field(Id,TC_LIST);
+   if (Size<15) Out.push_back((unsigned char)((Size<<4)|Type));
+   else
+	 {
+	  Out.push_back((unsigned char)(0xF0|Type));
+	  Varint(Size);
+	 }
+  }
+  /* List elements. */
+  void ListI32(int32_t Value)       { ZigZag(Value); }
+  void ListString(const char *Value)
+  {
+   size_t Len=strlen(Value);
+   Varint(Len);
+   Out.insert(Out.end(),Value,Value+Len);
+  }
+  void BeginListStruct(void)        { Push(); }
+  /* The message itself is a struct without a field header. */
+  void End(void)                    { Out.push_back(0); }
+
+private:
+  void Push(void)                   { Last[++Depth]=0; }
+  void Field(int Id, int Type)
+  {
+   if (Id>Last[Depth] && Id-Last[Depth]<=15) Out.push_back((unsigned char)(((Id-Last[Depth])<<4)|Type));
+   else
+	 {
+	  Out.push_back((unsigned char)Type);
+	  ZigZag(Id);
+	 }
+   Last[Depth]=Id;
+  }
+  void Varint(uint64_t Value)
+  {
+   while (Value>=0x80)
+	 {
+	  Out.push_back((unsigned char)(Value|0x80));
+	  Value>>=7;
+	 }
+   Out.push_back((unsigned char)Value);
+  }
+  void ZigZag(int64_t Value)        { Varint(((uint64_t)Value<<1)^(uint64_t)(Value>>63)); }
+
+  std::vector<unsigned char> &Out;
+  int                         Last[8];
+  int                         Depth;
+};
+//---------------------------------------------------------------------------
+static std::string JoinPath(const std::string &Dir, const std::string &Name)
+{
+ if (Dir.empty()) return Name;
+ if (Dir[Dir.size()-1]=='/' || Dir[Dir.size()-1]=='\\') return Dir+Name;
+ return Dir+PATH_SEPARATOR+Name;
+}
+//---------------------------------------------------------------------------
+static bool MakeDir(const char *Dir)
+{
+#ifdef _WIN32
+ if (_mkdir(Dir)==0) return true;
+#else
+ if (mkdir(Dir,0755)==0) return true;
+#endif
+ return errno==EEXIST;
+}
+//---------------------------------------------------------------------------
+TColumnarExporter::TColumnarExporter(const char *Dir, const char *SpoolDir, const char *BaseName,
+									 unsigned RowsPerFile, unsigned SecondsPerFile,
+									 unsigned RowsPerGroup)
+  : Dir(Dir), SpoolDir(SpoolDir), BaseName(BaseName),
+	ActiveName(JoinPath(Dir,std::string(BaseName)+CE_ACTIVE_EXTENSION)), RowsPerFile(RowsPerFile),
+	SecondsPerFile(SecondsPerFile), RowsPerGroup(RowsPerGroup), Running(false),
+	File(NULL), FileSequence(0), FileRows(0), FileOpened(0), FilePos(0), PendingSince(0),
+	StopRequested(false), Written(0), Rejected(0), Dropped(0), FileBytes(0), Spooled(0)
+{
+ if (this->RowsPerGroup==0) this->RowsPerGroup=CE_DEFAULT_ROWS_PER_GROUP;
+ if (this->RowsPerFile<this->RowsPerGroup) this->RowsPerFile=this->RowsPerGroup;
+ if (!MakeDir(SpoolDir))
+   {
+	printf("ColumnarExport: cannot create spool directory %s\n",SpoolDir);
+	return;
+   }
+ FILE *Active=fopen(ActiveName.c_str(),"wb");
+ if (Active==NULL)
+   {
+	printf("ColumnarExport: cannot create %s\n",ActiveName.c_str());
+	return;
+   }
+ fclose(Active);
+ Pending.reserve(this->RowsPerGroup);
+ WriterThread=std::thread(&TColumnarExporter::Run,this);
+ Running=true;
+}
+//---------------------------------------------------------------------------
+TColumnarExporter::~TColumnarExporter()
+{
+ if (Running)
+   {
+	{
+	 std::lock_guard<std::mutex> Lock(PendingMutex);
+	 StopRequested=true;
+	}
+	Wake.notify_one();
+	WriterThread.join();
+	remove(ActiveName.c_str());
+	if (Dropped.load()>0)
+	  printf("ColumnarExport: %llu rows dropped\n",(unsigned long long)Dropped.load());
+   }
+}
+//---------------------------------------------------------------------------
+bool TColumnarExporter::Append(const char *Line)
+{
+ TSBSRecord Record;
+
+ if (!Running) return false;
+ if (!SBS_ParseRecord(Line,&Record))
+   {
+	Rejected.fetch_add(1,std::memory_order_relaxed);
+	return false;
+   }
+ {
+  std::lock_guard<std::mutex> Lock(PendingMutex);
+  if (Pending.size()>=CE_MAX_PENDING_ROWS)
+	{
+	 Dropped.fetch_add(1,std::memory_order_relaxed);
+	 return false;
+	}
+  if (Pending.empty()) PendingSince=NowInMs();
+  Pending.push_back(Record);
+  if (Pending.size()!=RowsPerGroup) return true;
+ }
+ Wake.notify_one();
+ return true;
+}
+//---------------------------------------------------------------------------
+/**
+ * Rows are written once a full row group is queued, when the current file
+ * (or, with no file open, the oldest queued row) is SecondsPerFile old, and
+ * on shutdown. A file is spooled when it reaches RowsPerFile rows or its
+ * age limit.
+ */
+void TColumnarExporter::Run(void)
+{
+ std::vector<TSBSRecord> Batch;
+ int64_t                 MaxAge=(int64_t)SecondsPerFile*1000;
+
+ Batch.reserve(RowsPerGroup);
+ for (;;)
+  {
+   bool    Stopping,Due;
+   int64_t BatchSince;
+   {
+	std::unique_lock<std::mutex> Lock(PendingMutex);
+	Wake.wait_for(Lock,std::chrono::seconds(1),[this]
+	  {
+	   return StopRequested || Pending.size()>=RowsPerGroup;
+	  });
+	Stopping=StopRequested;
+	int64_t Now=NowInMs();
+	Due=(File && Now-FileOpened>=MaxAge) ||
+		(!Pending.empty() && Now-PendingSince>=MaxAge);
+	BatchSince=PendingSince;
+	if (Pending.size()>=RowsPerGroup || Due || Stopping) Batch.swap(Pending);
+   }
+
+   size_t Done=0;
+   while (Done<Batch.size())
+	{
+	 if (File==NULL)
+	   {
+		if (!OpenFile())
+		  {
+		   Dropped.fetch_add(Batch.size()-Done,std::memory_order_relaxed);
+		   break;
+		  }
+		FileOpened=BatchSince;
+	   }
+	 size_t Count=Batch.size()-Done;
+	 if (Count>RowsPerGroup) Count=RowsPerGroup;
+	 if (Count>RowsPerFile-FileRows) Count=RowsPerFile-FileRows;
+	 WriteGroup(&Batch[Done],(unsigned)Count);
+	 Done+=Count;
+	 if (FileRows>=RowsPerFile) CloseFile();
+	}
+   Batch.clear();
+
+   if (File && (Stopping || NowInMs()-FileOpened>=MaxAge)) CloseFile();
+   if (Stopping) break;
+  }
+}
+//---------------------------------------------------------------------------
+bool TColumnarExporter::OpenFile(void)
+{
+ char       Stamp[32];
+ time_t     t=time(NULL);
+ struct tm  tm;
+
+#ifdef _WIN32
+ localtime_s(&tm,&t);
+#else
+ localtime_r(&t,&tm);
+#endif
+ strftime(Stamp,sizeof(Stamp),"%Y%m%d_%H%M%S",&tm);
+ FileName=BaseName+"_"+Stamp+"_"+std::to_string(FileSequence++)+CE_FILE_EXTENSION;
+ PartName=JoinPath(Dir,FileName+CE_PART_EXTENSION);
+
+ File=fopen(PartName.c_str(),"wb");
+ if (File==NULL)
+   {
+	printf("ColumnarExport: cannot open %s\n",PartName.c_str());
+	return false;
+   }
+ FileRows=0;
+ Chunks.clear();
+ GroupRows.clear();
+ fwrite(CE_MAGIC,1,4,File);
+ FilePos=4;
+ return true;
+}
+//---------------------------------------------------------------------------
+void TColumnarExporter::CloseFile(void)
+{
+ std::string SpoolName=JoinPath(SpoolDir,FileName);
+
+ WriteFooter();
+ FileBytes.fetch_add(FilePos,std::memory_order_relaxed);
+ if (fclose(File)!=0)
+   {
+	/* A file without its footer is unreadable; leave it out of the spool. */
+	printf("ColumnarExport: cannot write %s\n",PartName.c_str());
+	File=NULL;
+	return;
+   }
+ File=NULL;
+ if (rename(PartName.c_str(),SpoolName.c_str())!=0)
+   printf("ColumnarExport: cannot move %s to %s\n",PartName.c_str(),SpoolName.c_str());
+ else Spooled.fetch_add(1,std::memory_order_relaxed);
+}
+//---------------------------------------------------------------------------
+void TColumnarExporter::WriteGroup(const TSBSRecord *Rows, unsigned Count)
+{
+ for (size_t c=0;c<NUM_COLUMNS;c++) WriteColumn(c,Rows,Count);
+ GroupRows.push_back(Count);
+ FileRows+=Count;
+ Written.fetch_add(Count,std::memory_order_relaxed);
+}
+//---------------------------------------------------------------------------
+/**
+ * Write one column of a row group as a single data page. The definition
+ * levels (1 for a value, 0 for a null) are one bit-packed run of the
+ * hybrid RLE encoding, which at one bit per row is the null bitmap itself.
+ */
+void TColumnarExporter::WriteColumn(size_t c, const TSBSRecord *Rows, unsigned Count)
+{
+ const TColumnDef &Col=Columns[c];
+ uint32_t          Bit=1u<<c;
+ size_t            Groups=(Count+7)/8;
+ size_t            Levels;
+ TChunk            Chunk;
+ unsigned          NumBits=0;
+
+ /* Definition levels: length, run header, bitmap. */
+ Raw.assign(4,0);
+ for (size_t Run=(Groups<<1)|1; ; Run>>=7)
+   {
+	Raw.push_back((unsigned char)(Run>=0x80 ? (Run|0x80) : Run));
+	if (Run<0x80) break;
+   }
+ Levels=Raw.size();
+ Raw.resize(Levels+Groups,0);
+ for (unsigned i=0;i<Count;i++)
+   if (Rows[i].Present & Bit) Raw[Levels+(i>>3)]|=(unsigned char)(1<<(i&7));
+ PutU32(&Raw[0],(uint32_t)(Raw.size()-4));
+
+ /* The values present, PLAIN encoded: numbers little endian as they are in memory. */
+ for (unsigned i=0;i<Count;i++)
+   {
+	const char *Field=(const char *)&Rows[i]+Col.Offset;
+	if (!(Rows[i].Present & Bit)) continue;
+	switch (Col.Type)
+	 {
+	  case CE_INT8:
+		{
+		 int32_t v=*(const int8_t *)Field;
+		 Raw.insert(Raw.end(),(const unsigned char *)&v,(const unsigned char *)&v+4);
+		 break;
+		}
+	  case CE_INT32:
+		 Raw.insert(Raw.end(),(const unsigned char *)Field,(const unsigned char *)Field+4);
+		 break;
+	  case CE_TIMESTAMP:
+	  case CE_FLOAT64:
+		 Raw.insert(Raw.end(),(const unsigned char *)Field,(const unsigned char *)Field+8);
+		 break;
+	  case CE_BOOL:
+		 if ((NumBits&7)==0) Raw.push_back(0);
+		 if (*Field) Raw.back()|=(unsigned char)(1<<(NumBits&7));
+		 NumBits++;
+		 break;
+	  default:
+		{
+		 size_t Len=strlen(Field);
+		 Raw.resize(Raw.size()+4);
+		 PutU32(&Raw[Raw.size()-4],(uint32_t)Len);
+		 Raw.insert(Raw.end(),(const unsigned char *)Field,(const unsigned char *)Field+Len);
+		 break;
+		}
+	 }
+   }
+
+ Chunk.Codec=PQ_GZIP;
+ if (!Gzip(Raw,Packed))
+   {
+	/* Only possible when out of memory; store the column uncompressed. */
+	printf("ColumnarExport: compress failed for %s\n",Col.Name);
+	Packed=Raw;
+	Chunk.Codec=PQ_UNCOMPRESSED;
+   }
+
+ Header.clear();
+ TThriftWriter Page(Header);
+ Page.I32(1,PQ_DATA_PAGE);
+ Page.I32(2,(int32_t)Raw.size());
+ Page.I32(3,(int32_t)Packed.size());
+ Page.BeginStruct(5);
+ Page.I32(1,(int32_t)Count);
+ Page.I32(2,PQ_PLAIN);
+ Page.I32(3,PQ_RLE);
+ Page.I32(4,PQ_RLE);
+ Page.EndStruct();
+ Page.End();
+
+ fwrite(&Header[0],1,Header.size(),File);
+ fwrite(&Packed[0],1,Packed.size(),File);
+ Chunk.Offset=FilePos;
+ Chunk.Compressed=Header.size()+Packed.size();
+ Chunk.Uncompressed=Header.size()+Raw.size();
+ FilePos+=Chunk.Compressed;
+ Chunks.push_back(Chunk);
+}
+//---------------------------------------------------------------------------
+/**
+ * The footer: the schema, then where each row group's column chunks are,
+ * followed by its length and the magic again.
+ */
+void TColumnarExporter::WriteFooter(void)
+{
+ unsigned char Length[4];
+ int64_t       Rows=0;
+
+ for (size_t g=0;g<GroupRows.size();g++) Rows+=GroupRows[g];
+
+ Header.clear();
+ TThriftWriter Meta(Header);
+ Meta.I32(1,1);
+ Meta.BeginList(2,TC_STRUCT,NUM_COLUMNS+1);
+ Meta.BeginListStruct();
+ Meta.String(4,"schema");
+ Meta.I32(5,(int32_t)NUM_COLUMNS);
+ Meta.EndStruct();
+ for (size_t c=0;c<NUM_COLUMNS;c++)
+   {
+	Meta.BeginListStruct();
+	Meta.I32(1,PhysicalType(Columns[c].Type));
+	Meta.I32(3,PQ_OPTIONAL);
+	Meta.String(4,Columns[c].Name);
+	if (Columns[c].Type==CE_STRING) Meta.I32(6,PQ_UTF8);
+	else if (Columns[c].Type==CE_TIMESTAMP) Meta.I32(6,PQ_TIMESTAMP_MILLIS);
+	Meta.EndStruct();
+   }
+ Meta.I64(3,Rows);
+ Meta.BeginList(4,TC_STRUCT,GroupRows.size());
+ for (size_t g=0;g<GroupRows.size();g++)
+   {
+	int64_t Total=0;
+
+	Meta.BeginListStruct();
+	Meta.BeginList(1,TC_STRUCT,NUM_COLUMNS);
+	for (size_t c=0;c<NUM_COLUMNS;c++)
+	  {
+	   const TChunk &Chunk=Chunks[g*NUM_COLUMNS+c];
+
+	   Total+=(int64_t)Chunk.Uncompressed;
+	   Meta.BeginListStruct();
+	   Meta.I64(2,(int64_t)Chunk.Offset);
+	   Meta.BeginStruct(3);
+	   Meta.I32(1,PhysicalType(Columns[c].Type));
+	   Meta.BeginList(2,TC_I32,2);
+	   Meta.ListI32(PQ_PLAIN);
+	   Meta.ListI32(PQ_RLE);
+	   Meta.BeginList(3,TC_BINARY,1);
+	   Meta.ListString(Columns[c].Name);
+	   Meta.I32(4,Chunk.Codec);
+	   Meta.I64(5,GroupRows[g]);
+	   Meta.I64(6,(int64_t)Chunk.Uncompressed);
+	   Meta.I64(7,(int64_t)Chunk.Compressed);
+	   Meta.I64(9,(int64_t)Chunk.Offset);
+	   Meta.EndStruct();
+	   Meta.EndStruct();
+	  }
+	Meta.I64(2,Total);
+	Meta.I64(3,GroupRows[g]);
+	Meta.EndStruct();
+   }
+ Meta.String(6,CE_CREATED_BY);
+ Meta.End();
+
+ PutU32(Length,(uint32_t)Header.size());
+ fwrite(&Header[0],1,Header.size(),File);
+ fwrite(Length,1,4,File);
+ fwrite(CE_MAGIC,1,4,File);
+ FilePos+=Header.size()+8;
+}
+//---------------------------------------------------------------------------
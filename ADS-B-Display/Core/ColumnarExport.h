@@ -0,0 +1,177 @@
+//---------------------------------------------------------------------------
+
+#ifndef ColumnarExportH
+#define ColumnarExportH
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+//---------------------------------------------------------------------------
+#define CE_DEFAULT_ROWS_PER_FILE     500000  /* Rotate after this many rows... */
+#define CE_DEFAULT_SECONDS_PER_FILE  300     /* ...or once the file is this old. */
+#define CE_DEFAULT_ROWS_PER_GROUP    16384   /* Rows compressed together per column. */
+#define CE_MAX_PENDING_ROWS          262144  /* Rows queued before Append() drops. */
+#define CE_FILE_EXTENSION            ".parquet"
+#define CE_PART_EXTENSION            ".part"
+#define CE_ACTIVE_EXTENSION          ".active"
+
+/** Types of the columns in an export file, with the Parquet types they are written as. */
+typedef enum
+{
+  CE_INT8=1,       /**< INT32 */
+  CE_INT32=2,      /**< INT32 */
+  CE_TIMESTAMP=3,  /**< INT64 msec since 1970 UTC, TIMESTAMP_MILLIS */
+  CE_FLOAT64=4,    /**< DOUBLE */
+  CE_STRING=5,     /**< BYTE_ARRAY, UTF8 */
+  CE_BOOL=6        /**< BOOLEAN */
+} TColumnType;
+
+/**
+ * One SBS (BaseStation) line, parsed.
+ *
+ * Present has bit n set when column n (see ColumnarExport.cpp) had a value,
+ * empty SBS fields become nulls rather than zeros. Times are msec since
+ * 1970 taken as UTC. The hex ident (the ICAO address, upper case) and the
+ * squawk (four octal digits) are kept as text, as they are shown.
+ */
+typedef struct
+{
+ uint32_t Present;
+ char     MessageType[4];
+ int8_t   TransmissionType;
+ int32_t  SessionID;
+ int32_t  AircraftID;
+ char     HexIdent[7];
+ int32_t  FlightID;
+ int64_t  Generated;
+ int64_t  Logged;
+ char     Callsign[9];
+ int32_t  Altitude;
+ double   GroundSpeed;
+ double   Track;
+ double   Latitude;
+ double   Longitude;
+ int32_t  VerticalRate;
+ char     Squawk[5];
+ int8_t   Alert;
+ int8_t   Emergency;
+ int8_t   SPI;
+ int8_t   IsOnGround;
+} TSBSRecord;
+
+/**
+ * Parse an SBS line into Record.
+ * @return false if the line is not an SBS message.
+ */
+bool SBS_ParseRecord(const char *Line, TSBSRecord *Record);
+
+/**
+ * Writes SBS messages as compressed, column oriented files and hands each
+ * finished file to an uploader through a spool directory.
+ *
+ * Append() parses the line and queues the typed row; it never touches the
+ * disk. A background thread transposes queued rows into columns and
+ * appends them to <Dir>/<name>.parquet.part as a row group. When the file
+ * reaches RowsPerFile rows or SecondsPerFile age its footer is written and
+ * it is renamed into SpoolDir, so anything found there is complete. Dir and
+ * SpoolDir must be on the same volume for the rename to be atomic.
+ * <Dir>/<BaseName>.active exists for as long as the exporter does, so an
+ * uploader knows whether more files may follow.
+ *
+ * The files are Parquet, which BigQuery loads as they are. Every column is
+ * optional (an empty SBS field is a null) and each column chunk is a single
+ * data page: the definition levels as one bit-packed run, then the values
+ * present in PLAIN encoding, compressed with GZIP. There are no dictionary
+ * pages or statistics.
+ *
+ * Append() may be called from any thread.
+ */
+class TColumnarExporter
+{
+public:
+  TColumnarExporter(const char *Dir, const char *SpoolDir, const char *BaseName,
+					unsigned RowsPerFile=CE_DEFAULT_ROWS_PER_FILE,
+					unsigned SecondsPerFile=CE_DEFAULT_SECONDS_PER_FILE,
+					unsigned RowsPerGroup=CE_DEFAULT_ROWS_PER_GROUP);
+
+  /** Writes out queued rows and spools the last file. */
+  ~TColumnarExporter();
+
+  /** @return true if the spool directory exists and the writer thread is running. */
+  bool IsOpen(void) const { return Running; }
+
+  /**
+   * Parse an SBS line and queue it.
+   * @return false if the line was not SBS or the queue is full.
+   */
+  bool Append(const char *Line);
+
+  uint64_t RowsWritten(void) const { return Written.load(std::memory_order_relaxed); }
+  uint64_t RowsRejected(void) const { return Rejected.load(std::memory_order_relaxed); }
+  uint64_t RowsDropped(void) const { return Dropped.load(std::memory_order_relaxed); }
+  uint64_t BytesWritten(void) const { return FileBytes.load(std::memory_order_relaxed); }
+  unsigned FilesSpooled(void) const { return Spooled.load(std::memory_order_relaxed); }
+
+private:
+  TColumnarExporter(const TColumnarExporter &);
+  TColumnarExporter &operator=(const TColumnarExporter &);
+
+  /** Where a column chunk went, for the footer. */
+  struct TChunk
+  {
+   uint64_t Offset;
+   uint64_t Compressed;               ///< Bytes in the file, page header included
+   uint64_t Uncompressed;
+   int      Codec;
+  };
+
+  void Run(void);
+  bool OpenFile(void);
+  void CloseFile(void);
+  void WriteGroup(const TSBSRecord *Rows, unsigned Count);
+  void WriteColumn(size_t c, const TSBSRecord *Rows, unsigned Count);
+  void WriteFooter(void);
+
+  std::string              Dir;
+  std::string              SpoolDir;
+  std::string              BaseName;
+  std::string              ActiveName;
+  unsigned                 RowsPerFile;
+  unsigned                 SecondsPerFile;
+  unsigned                 RowsPerGroup;
+  bool                     Running;
+
+  /* Owned by the writer thread. */
+  FILE                    *File;
+  std::string              PartName;
+  std::string              FileName;
+  unsigned                 FileSequence;
+  unsigned                 FileRows;
+  int64_t                  FileOpened;
+  uint64_t                 FilePos;
+  std::vector<TChunk>      Chunks;            ///< Of every row group so far, column by column
+  std::vector<unsigned>    GroupRows;
+  std::vector<unsigned char> Raw;
+  std::vector<unsigned char> Packed;
+  std::vector<unsigned char> Header;
+
+  std::vector<TSBSRecord>  Pending;           ///< Rows queued by Append()
+  int64_t                  PendingSince;      ///< When the oldest of them was queued
+  std::mutex               PendingMutex;
+  std::condition_variable  Wake;
+  bool                     StopRequested;
+  std::thread              WriterThread;
+
+  std::atomic<uint64_t>    Written;
+  std::atomic<uint64_t>    Rejected;
+  std::atomic<uint64_t>    Dropped;
+  std::atomic<uint64_t>    FileBytes;
+  std::atomic<unsigned>    Spooled;
+};
+//---------------------------------------------------------------------------
+#endif
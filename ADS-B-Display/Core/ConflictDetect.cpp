@@ -0,0 +1,524 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <math.h>
+#include <algorithm>
+#include "ConflictDetect.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+#define NM_TO_KM            1.852
+#define FT_TO_KM            0.0003048
+#define CELL_BITS           21
+#define CELL_OFFSET         (1 << (CELL_BITS-1))
+#define CELL_MASK           ((1 << CELL_BITS)-1)
+
+static double   BoxGrow(double MinHorizontalNM, double MinVerticalFt);
+static void     SweptBox(const double p[3], const double v[3], double Seconds, double Grow,
+						 double Min[3], double Max[3]);
+static bool     BoxesOverlap(const double Min1[3], const double Max1[3],
+							 const double Min2[3], const double Max2[3]);
+static uint64_t PackCell(int64_t x, int64_t y, int64_t z);
+static uint64_t CellOf(const double p[3], double CellSize);
+static uint64_t PairKey(uint32_t ICAO1, uint32_t ICAO2);
+static void     RemovePartner(std::vector<uint32_t> &Partners, uint32_t ICAO);
+static bool     CompareAlerts(const TConflictAlert &a, const TConflictAlert &b);
+//---------------------------------------------------------------------------
+/*
+ * computeCPA() measures the horizontal distance on the sphere between the
+ * two straight-line positions; half the minimum plus a little for the
+ * altitude and for the lines dipping below the surface is enough margin
+ * on each box that no conflicting pair is missed.
+ */
+static double BoxGrow(double MinHorizontalNM, double MinVerticalFt)
+{
+ return 0.5*(MinHorizontalNM*NM_TO_KM*1.01+MinVerticalFt*FT_TO_KM)+0.5;
+}
+//---------------------------------------------------------------------------
+static void SweptBox(const double p[3], const double v[3], double Seconds, double Grow,
+					 double Min[3], double Max[3])
+{
+ for (int k = 0; k < 3; k++)
+   {
+	double End=p[k]+v[k]*Seconds;
+	Min[k]=std::min(p[k],End)-Grow;
+	Max[k]=std::max(p[k],End)+Grow;
+   }
+}
+//---------------------------------------------------------------------------
+static bool BoxesOverlap(const double Min1[3], const double Max1[3],
+						 const double Min2[3], const double Max2[3])
+{
+ for (int k = 0; k < 3; k++)
+   if (Min1[k]>Max2[k] || Min2[k]>Max1[k]) return false;
+ return true;
+}
+//---------------------------------------------------------------------------
+static uint64_t PackCell(int64_t x, int64_t y, int64_t z)
+{
+ return ((uint64_t)((x+CELL_OFFSET) & CELL_MASK) << (2*CELL_BITS)) |
+		((uint64_t)((y+CELL_OFFSET) & CELL_MASK) << CELL_BITS) |
+		 (uint64_t)((z+CELL_OFFSET) & CELL_MASK);
+}
+//---------------------------------------------------------------------------
+static uint64_t CellOf(const double p[3], double CellSize)
+{
+ return PackCell((int64_t)floor(p[0]/CellSize),(int64_t)floor(p[1]/CellSize),
+				 (int64_t)floor(p[2]/CellSize));
+}
+//---------------------------------------------------------------------------
+static uint64_t PairKey(uint32_t ICAO1, uint32_t ICAO2)
+{
+ if (ICAO1>ICAO2) std::swap(ICAO1,ICAO2);
+ return ((uint64_t)ICAO1 << 32) | ICAO2;
+}
+//---------------------------------------------------------------------------
+static void RemovePartner(std::vector<uint32_t> &Partners, uint32_t ICAO)
+{
+ for (size_t i = 0; i < Partners.size(); i++)
+   if (Partners[i]==ICAO)
+	 {
+	  Partners[i]=Partners.back();
+	  Partners.pop_back();
+	  return;
+	 }
+}
+//---------------------------------------------------------------------------
+void TCPAStateArrays::Clear(void)
+{
+ x.clear(); y.clear(); z.clear();
+ vx.clear(); vy.clear(); vz.clear();
+ altitude.clear();
+}
+//---------------------------------------------------------------------------
+void TCPAStateArrays::Add(const double p[3], const double v[3], double Altitude)
+{
+ x.push_back(p[0]);
+ y.push_back(p[1]);
+ z.push_back(p[2]);
+ vx.push_back(v[0]);
+ vy.push_back(v[1]);
+ vz.push_back(v[2]);
+ altitude.push_back(Altitude);
+}
+//---------------------------------------------------------------------------
+TCPAStates TCPAStateArrays::States(void) const
+{
+ TCPAStates s={&x[0],&y[0],&z[0],&vx[0],&vy[0],&vz[0],&altitude[0]};
+ return s;
+}
+//---------------------------------------------------------------------------
+TConflictDetector::TConflictDetector(double LookAheadSec, double MinHorizontalNM, double MinVerticalFt)
+  : LookAheadSec(LookAheadSec), MinHorizontalNM(MinHorizontalNM),
+	MinVerticalFt(MinVerticalFt), CellSize(1.0), PairsTested(0)
+{
+}
+//---------------------------------------------------------------------------
+size_t TConflictDetector::Evaluate(const TADS_B_Context *Ctx, int64_t MaxAgeMs,
+								   std::vector<TConflictAlert> &Alerts)
+{
+ ght_iterator_t iterator;
+ const void *Key;
+ TADS_B_Aircraft *a;
+ double Grow=BoxGrow(MinHorizontalNM,MinVerticalFt);
+ double Extent=0.0;
+
+ Alerts.clear();
+ Tracks.clear();
+ Cells.clear();
+ Oversized.clear();
+ Pairs.clear();
+ PairsTested=0;
+
+ for (a = (TADS_B_Aircraft *)ght_first(Ctx->HashTable, &iterator, &Key); a;
+	  a = (TADS_B_Aircraft *)ght_next(Ctx->HashTable, &iterator, &Key))
+   {
+	if (!a->HaveLatLon || !a->HaveSpeedAndHeading || !a->HaveAltitude ||
+		Ctx->CurrentTime-a->LastSeen>MaxAgeMs) continue;
+
+	TTrack t;
+	double Longest=0.0;
+	t.ICAO=a->ICAO;
+	t.Altitude=a->Altitude;
+	t.Oversized=false;
+	for (int k = 0; k < 3; k++)
+	  {
+	   t.p[k]=a->ECEF[k];
+	   t.v[k]=a->VelocityECEF[k];
+	  }
+	SweptBox(t.p,t.v,LookAheadSec,Grow,t.Min,t.Max);
+	for (int k = 0; k < 3; k++) Longest=std::max(Longest,t.Max[k]-t.Min[k]);
+	Extent+=Longest;
+	Tracks.push_back(t);
+   }
+ if (Tracks.size()<2) return 0;
+
+ /* Cells the size of an average box put most aircraft in at most 8 cells. */
+ CellSize=Extent/Tracks.size();
+ for (uint32_t i = 0; i < Tracks.size(); i++)
+   {
+	TTrack &t=Tracks[i];
+	int64_t Lo[3],Hi[3];
+	int64_t Count=1;
+
+	for (int k = 0; k < 3; k++)
+	  {
+	   Lo[k]=(int64_t)floor(t.Min[k]/CellSize);
+	   Hi[k]=(int64_t)floor(t.Max[k]/CellSize);
+	   Count*=Hi[k]-Lo[k]+1;
+	  }
+	if (Count>CD_MAX_CELLS_PER_AIRCRAFT)
+	  {
+	   t.Oversized=true;
+	   Oversized.push_back(i);
+	   continue;
+	  }
+	for (int64_t x = Lo[0]; x <= Hi[0]; x++)
+	 for (int64_t y = Lo[1]; y <= Hi[1]; y++)
+	  for (int64_t z = Lo[2]; z <= Hi[2]; z++)
+		{
+		 TCellEntry e;
+		 e.Cell=PackCell(x,y,z);
+		 e.Track=i;
+		 Cells.push_back(e);
+		}
+   }
+ std::sort(Cells.begin(),Cells.end(),CompareCells);
+
+ for (size_t Start = 0; Start < Cells.size(); )
+   {
+	size_t End=Start+1;
+	while (End<Cells.size() && Cells[End].Cell==Cells[Start].Cell) End++;
+
+	for (size_t i = Start; i < End; i++)
+	  for (size_t j = i+1; j < End; j++)
+		{
+		 const TTrack &t1=Tracks[Cells[i].Track];
+		 const TTrack &t2=Tracks[Cells[j].Track];
+		 double Corner[3];
+
+		 /*
+		  * Boxes sharing several cells meet in each of them; only the
+		  * cell holding the low corner of their overlap tests the pair.
+		  */
+		 for (int k = 0; k < 3; k++) Corner[k]=std::max(t1.Min[k],t2.Min[k]);
+		 if (CellOf(Corner,CellSize)==Cells[Start].Cell) AddCandidate(Cells[i].Track,Cells[j].Track);
+		}
+	Start=End;
+   }
+
+ /* The few aircraft with huge boxes (bad speeds mostly) go against everyone. */
+ for (size_t i = 0; i < Oversized.size(); i++)
+   for (uint32_t j = 0; j < Tracks.size(); j++)
+	 {
+	  if (Tracks[j].Oversized && j<=Oversized[i]) continue;
+	  AddCandidate(Oversized[i],j);
+	 }
+
+ PairsTested=(unsigned)(Pairs.size()/2);
+ if (PairsTested==0) return 0;
+ First.Clear();
+ Second.Clear();
+ for (size_t n = 0; n < Pairs.size(); n+=2)
+   {
+	const TTrack &t1=Tracks[Pairs[n]],&t2=Tracks[Pairs[n+1]];
+	First.Add(t1.p,t1.v,t1.Altitude);
+	Second.Add(t2.p,t2.v,t2.Altitude);
+   }
+ TCPA.resize(PairsTested);
+ HorizontalNM.resize(PairsTested);
+ VerticalFt.resize(PairsTested);
+ computeCPABatch(First.States(),Second.States(),PairsTested,
+				 &TCPA[0],&HorizontalNM[0],&VerticalFt[0]);
+
+ for (unsigned n = 0; n < PairsTested; n++)
+   {
+	if (TCPA[n]<0 || TCPA[n]>LookAheadSec || HorizontalNM[n]>=MinHorizontalNM ||
+		VerticalFt[n]>=MinVerticalFt) continue;
+
+	TConflictAlert Alert;
+	uint32_t ICAO1=Tracks[Pairs[2*n]].ICAO;
+	uint32_t ICAO2=Tracks[Pairs[2*n+1]].ICAO;
+	Alert.ICAO1=std::min(ICAO1,ICAO2);
+	Alert.ICAO2=std::max(ICAO1,ICAO2);
+	Alert.TCPA=TCPA[n];
+	Alert.HorizontalNM=HorizontalNM[n];
+	Alert.VerticalFt=VerticalFt[n];
+	Alerts.push_back(Alert);
+   }
+ std::sort(Alerts.begin(),Alerts.end(),CompareAlerts);
+ return Alerts.size();
+}
+//---------------------------------------------------------------------------
+void TConflictDetector::AddCandidate(uint32_t i, uint32_t j)
+{
+ const TTrack &t1=Tracks[i],&t2=Tracks[j];
+
+ if (fabs(t1.Altitude-t2.Altitude)>=MinVerticalFt) return;
+ if (!BoxesOverlap(t1.Min,t1.Max,t2.Min,t2.Max)) return;
+ Pairs.push_back(i);
+ Pairs.push_back(j);
+}
+//---------------------------------------------------------------------------
+bool TConflictDetector::CompareCells(const TCellEntry &a, const TCellEntry &b)
+{
+ if (a.Cell!=b.Cell) return a.Cell<b.Cell;
+ return a.Track<b.Track;
+}
+//---------------------------------------------------------------------------
+TConflictMonitor::TConflictMonitor(double LookAheadSec, double MinHorizontalNM, double MinVerticalFt,
+								   int64_t MaxAgeMs, double CellSizeKm)
+  : LookAheadSec(LookAheadSec), MinHorizontalNM(MinHorizontalNM),
+	MinVerticalFt(MinVerticalFt), MaxAgeMs(MaxAgeMs), CellSize(CellSizeKm),
+	Grow(BoxGrow(MinHorizontalNM,MinVerticalFt)), PairsTested(0)
+{
+}
+//---------------------------------------------------------------------------
+void TConflictMonitor::Clear(void)
+{
+ Tracks.clear();
+ Cells.clear();
+ Pairs.clear();
+ Dirty.clear();
+ Updates.clear();
+ PairsTested=0;
+}
+//---------------------------------------------------------------------------
+void TConflictMonitor::Update(const TADS_B_Aircraft *a)
+{
+ if (!a->HaveLatLon || !a->HaveSpeedAndHeading || !a->HaveAltitude) return;
+
+ TTrackMap::iterator it=Tracks.find(a->ICAO);
+ if (it==Tracks.end())
+   {
+	TTrack New=TTrack();
+	New.ICAO=a->ICAO;
+	it=Tracks.insert(std::make_pair(a->ICAO,New)).first;
+   }
+ TTrack &t=it->second;
+ t.Time=a->LastSeen;
+ t.Altitude=a->Altitude;
+ for (int k = 0; k < 3; k++)
+   {
+	t.p[k]=a->ECEF[k];
+	t.v[k]=a->VelocityECEF[k];
+   }
+ if (!t.Dirty)
+   {
+	t.Dirty=true;
+	Dirty.push_back(t.ICAO);
+   }
+ Updates.push_back(std::make_pair(t.Time,t.ICAO));
+}
+//---------------------------------------------------------------------------
+size_t TConflictMonitor::Evaluate(int64_t Time, std::vector<TConflictAlert> &Alerts)
+{
+ TTrackMap::iterator it;
+
+ Alerts.clear();
+ PairsTested=0;
+
+ /* Drop aircraft not updated for MaxAgeMs; later updates are further back in the queue. */
+ while (!Updates.empty() && Time-Updates.front().first>MaxAgeMs)
+   {
+	it=Tracks.find(Updates.front().second);
+	if (it!=Tracks.end() && Time-it->second.Time>MaxAgeMs) RemoveTrack(it->first);
+	Updates.pop_front();
+   }
+
+ /* Move every updated aircraft before pairing any so they all see each other. */
+ for (size_t i = 0; i < Dirty.size(); i++)
+   {
+	it=Tracks.find(Dirty[i]);
+	if (it==Tracks.end()) continue;
+	TTrack &t=it->second;
+	RemovePairs(t);
+	GridRemove(t);
+	SweptBox(t.p,t.v,LookAheadSec+MaxAgeMs/1000.0,Grow,t.Min,t.Max);
+	GridInsert(t);
+   }
+ Candidates.clear();
+ for (size_t i = 0; i < Dirty.size(); i++)
+   {
+	it=Tracks.find(Dirty[i]);
+	if (it!=Tracks.end()) FindCandidates(it->second);
+   }
+ for (size_t i = 0; i < Dirty.size(); i++)
+   {
+	it=Tracks.find(Dirty[i]);
+	if (it!=Tracks.end()) it->second.Dirty=false;
+   }
+ Dirty.clear();
+
+ PairsTested=(unsigned)(Candidates.size()/2);
+ if (PairsTested>0)
+   {
+	First.Clear();
+	Second.Clear();
+	for (size_t n = 0; n < Candidates.size(); n++)
+	  {
+	   const TTrack *t=Candidates[n];
+	   double dt=(Time-t->Time)/1000.0;
+	   double p[3]={t->p[0]+t->v[0]*dt,t->p[1]+t->v[1]*dt,t->p[2]+t->v[2]*dt};
+	   if (n & 1) Second.Add(p,t->v,t->Altitude);
+	   else First.Add(p,t->v,t->Altitude);
+	  }
+	TCPA.resize(PairsTested);
+	HorizontalNM.resize(PairsTested);
+	VerticalFt.resize(PairsTested);
+	computeCPABatch(First.States(),Second.States(),PairsTested,
+					&TCPA[0],&HorizontalNM[0],&VerticalFt[0]);
+
+	/*
+	 * Keep every pair that will lose separation, even beyond the
+	 * look-ahead: it becomes an alert as its CPA draws near.
+	 */
+	for (unsigned n = 0; n < PairsTested; n++)
+	  {
+	   if (TCPA[n]<0 || HorizontalNM[n]>=MinHorizontalNM || VerticalFt[n]>=MinVerticalFt) continue;
+
+	   TTrack *t1=Candidates[2*n],*t2=Candidates[2*n+1];
+	   TPair   Pair;
+	   Pair.CPATime=Time+(int64_t)floor(TCPA[n]*1000.0+0.5);
+	   Pair.HorizontalNM=HorizontalNM[n];
+	   Pair.VerticalFt=VerticalFt[n];
+	   Pairs[PairKey(t1->ICAO,t2->ICAO)]=Pair;
+	   t1->Partners.push_back(t2->ICAO);
+	   t2->Partners.push_back(t1->ICAO);
+	  }
+   }
+
+ for (TPairMap::iterator p = Pairs.begin(); p != Pairs.end(); )
+   {
+	uint32_t ICAO1=(uint32_t)(p->first >> 32),ICAO2=(uint32_t)p->first;
+
+	if (p->second.CPATime<Time)
+	  {
+	   /* Past the CPA: diverging from here on. */
+	   it=Tracks.find(ICAO1);
+	   if (it!=Tracks.end()) RemovePartner(it->second.Partners,ICAO2);
+	   it=Tracks.find(ICAO2);
+	   if (it!=Tracks.end()) RemovePartner(it->second.Partners,ICAO1);
+	   p=Pairs.erase(p);
+	   continue;
+	  }
+	double Remaining=(p->second.CPATime-Time)/1000.0;
+	if (Remaining<=LookAheadSec)
+	  {
+	   TConflictAlert Alert;
+	   Alert.ICAO1=ICAO1;
+	   Alert.ICAO2=ICAO2;
+	   Alert.TCPA=Remaining;
+	   Alert.HorizontalNM=p->second.HorizontalNM;
+	   Alert.VerticalFt=p->second.VerticalFt;
+	   Alerts.push_back(Alert);
+	  }
+	++p;
+   }
+ std::sort(Alerts.begin(),Alerts.end(),CompareAlerts);
+ return Alerts.size();
+}
+//---------------------------------------------------------------------------
+void TConflictMonitor::RemoveTrack(uint32_t ICAO)
+{
+ TTrackMap::iterator it=Tracks.find(ICAO);
+
+ if (it==Tracks.end()) return;
+ RemovePairs(it->second);
+ GridRemove(it->second);
+ Tracks.erase(it);
+}
+//---------------------------------------------------------------------------
+void TConflictMonitor::RemovePairs(TTrack &t)
+{
+ for (size_t i = 0; i < t.Partners.size(); i++)
+   {
+	Pairs.erase(PairKey(t.ICAO,t.Partners[i]));
+	TTrackMap::iterator it=Tracks.find(t.Partners[i]);
+	if (it!=Tracks.end()) RemovePartner(it->second.Partners,t.ICAO);
+   }
+ t.Partners.clear();
+}
+//---------------------------------------------------------------------------
+void TConflictMonitor::GridRemove(TTrack &t)
+{
+ if (!t.InGrid) return;
+ for (int64_t x = t.Lo[0]; x <= t.Hi[0]; x++)
+  for (int64_t y = t.Lo[1]; y <= t.Hi[1]; y++)
+   for (int64_t z = t.Lo[2]; z <= t.Hi[2]; z++)
+	 {
+	  TCellMap::iterator c=Cells.find(PackCell(x,y,z));
+	  if (c==Cells.end()) continue;
+	  std::vector<TTrack *> &In=c->second;
+	  for (size_t i = 0; i < In.size(); i++)
+		if (In[i]==&t)
+		  {
+		   In[i]=In.back();
+		   In.pop_back();
+		   break;
+		  }
+	  if (In.empty()) Cells.erase(c);
+	 }
+ t.InGrid=false;
+}
+//---------------------------------------------------------------------------
+/*
+ * An aircraft whose box would cover more than CD_MAX_CELLS_PER_AIRCRAFT
+ * cells is moving at thousands of knots, i.e. has a bad speed, and is
+ * left out of the grid (and so of conflict detection) until it updates.
+ */
+void TConflictMonitor::GridInsert(TTrack &t)
+{
+ int64_t Count=1;
+
+ for (int k = 0; k < 3; k++)
+   {
+	t.Lo[k]=(int64_t)floor(t.Min[k]/CellSize);
+	t.Hi[k]=(int64_t)floor(t.Max[k]/CellSize);
+	Count*=t.Hi[k]-t.Lo[k]+1;
+   }
+ if (Count>CD_MAX_CELLS_PER_AIRCRAFT) return;
+ for (int64_t x = t.Lo[0]; x <= t.Hi[0]; x++)
+  for (int64_t y = t.Lo[1]; y <= t.Hi[1]; y++)
+   for (int64_t z = t.Lo[2]; z <= t.Hi[2]; z++)
+	 Cells[PackCell(x,y,z)].push_back(&t);
+ t.InGrid=true;
+}
+//---------------------------------------------------------------------------
+void TConflictMonitor::FindCandidates(TTrack &t)
+{
+ if (!t.InGrid) return;
+ for (int64_t x = t.Lo[0]; x <= t.Hi[0]; x++)
+  for (int64_t y = t.Lo[1]; y <= t.Hi[1]; y++)
+   for (int64_t z = t.Lo[2]; z <= t.Hi[2]; z++)
+	 {
+	  uint64_t Cell=PackCell(x,y,z);
+	  TCellMap::iterator c=Cells.find(Cell);
+	  if (c==Cells.end()) continue;
+
+	  const std::vector<TTrack *> &In=c->second;
+	  for (size_t i = 0; i < In.size(); i++)
+		{
+		 TTrack *o=In[i];
+		 double  Corner[3];
+
+		 /* Two updated aircraft are paired once, from the lower address. */
+		 if (o==&t || (o->Dirty && o->ICAO<t.ICAO)) continue;
+		 if (fabs(t.Altitude-o->Altitude)>=MinVerticalFt) continue;
+		 if (!BoxesOverlap(t.Min,t.Max,o->Min,o->Max)) continue;
+		 for (int k = 0; k < 3; k++) Corner[k]=std::max(t.Min[k],o->Min[k]);
+		 if (CellOf(Corner,CellSize)!=Cell) continue;
+		 Candidates.push_back(&t);
+		 Candidates.push_back(o);
+		}
+	 }
+}
+//---------------------------------------------------------------------------
+static bool CompareAlerts(const TConflictAlert &a, const TConflictAlert &b)
+{
+ if (a.TCPA!=b.TCPA) return a.TCPA<b.TCPA;
+ if (a.HorizontalNM!=b.HorizontalNM) return a.HorizontalNM<b.HorizontalNM;
+ if (a.ICAO1!=b.ICAO1) return a.ICAO1<b.ICAO1;
+ return a.ICAO2<b.ICAO2;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,200 @@
+//---------------------------------------------------------------------------
+
+#ifndef ConflictDetectH
+#define ConflictDetectH
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include "Aircraft.h"
+#include "CPA.h"
+//---------------------------------------------------------------------------
+#define CD_DEFAULT_LOOKAHEAD_SEC     300.0    /* Conflicts further ahead are ignored. */
+#define CD_DEFAULT_HORIZONTAL_NM     5.0      /* Separation minima. */
+#define CD_DEFAULT_VERTICAL_FT       1000.0
+#define CD_DEFAULT_MAX_AGE_MS        60000    /* TConflictMonitor drops aircraft not updated for longer. */
+#define CD_DEFAULT_CELL_KM           100.0    /* Grid cell of TConflictMonitor. */
+#define CD_MAX_CELLS_PER_AIRCRAFT    512      /* Larger swept boxes skip the grid. */
+
+/** A predicted loss of separation between two aircraft. */
+typedef struct
+{
+ uint32_t ICAO1;             /* ICAO1 < ICAO2 */
+ uint32_t ICAO2;
+ double   TCPA;              /* Seconds from now to the closest point of approach. */
+ double   HorizontalNM;      /* Horizontal distance at the closest point. */
+ double   VerticalFt;        /* Vertical separation. */
+} TConflictAlert;
+
+/** Backing store of a TCPAStates. */
+struct TCPAStateArrays
+{
+ std::vector<double> x,y,z,vx,vy,vz,altitude;
+
+ void       Clear(void);
+ void       Add(const double p[3], const double v[3], double Altitude);
+ TCPAStates States(void) const;
+};
+
+/**
+ * Traffic-wide conflict detection.
+ *
+ * Every aircraft with a position, altitude and velocity is moved along a
+ * straight line for the look-ahead time; the box around that line, grown
+ * by half the separation minima, is its swept volume. The boxes are binned
+ * into a uniform grid in ECEF coordinates whose cell size follows the
+ * average box, so each aircraft lands in a handful of cells and only
+ * aircraft sharing a cell become candidate pairs. The candidates are then
+ * run through computeCPABatch() in one call. The cost grows with the
+ * number of aircraft and of close pairs rather than with all pairs.
+ *
+ * The boxes are conservative: a pair the grid rejects cannot come within
+ * the minima before the look-ahead time, so the alerts are the same as
+ * testing every pair.
+ */
+class TConflictDetector
+{
+public:
+  TConflictDetector(double LookAheadSec=CD_DEFAULT_LOOKAHEAD_SEC,
+					double MinHorizontalNM=CD_DEFAULT_HORIZONTAL_NM,
+					double MinVerticalFt=CD_DEFAULT_VERTICAL_FT);
+
+  /**
+   * Check the aircraft in Ctx heard from within MaxAgeMs of Ctx->CurrentTime.
+   * Alerts is replaced by the predicted conflicts, soonest first.
+   * @return the number of alerts
+   */
+  size_t Evaluate(const TADS_B_Context *Ctx, int64_t MaxAgeMs, std::vector<TConflictAlert> &Alerts);
+
+  double LookAhead(void) const { return LookAheadSec; }
+
+  /** Figures from the last Evaluate(), for diagnostics. */
+  unsigned NumAircraft(void) const { return (unsigned)Tracks.size(); }
+  unsigned NumPairsTested(void) const { return PairsTested; }
+
+private:
+  struct TTrack
+  {
+   uint32_t ICAO;
+   double   p[3],v[3];         /* ECEF km, km/s */
+   double   Altitude;
+   double   Min[3],Max[3];     /* Swept box, km. */
+   bool     Oversized;
+  };
+  struct TCellEntry
+  {
+   uint64_t Cell;
+   uint32_t Track;
+  };
+
+  static bool CompareCells(const TCellEntry &a, const TCellEntry &b);
+  void     AddCandidate(uint32_t i, uint32_t j);
+
+  double                  LookAheadSec;
+  double                  MinHorizontalNM;
+  double                  MinVerticalFt;
+  double                  CellSize;        /* km */
+  unsigned                PairsTested;
+  std::vector<TTrack>     Tracks;
+  std::vector<TCellEntry> Cells;
+  std::vector<uint32_t>   Oversized;
+  std::vector<uint32_t>   Pairs;           /* Candidates, two tracks each. */
+  TCPAStateArrays         First,Second;    /* Candidates' states. */
+  std::vector<double>     TCPA,HorizontalNM,VerticalFt;
+};
+
+/**
+ * Incremental conflict detection for a live feed.
+ *
+ * Update() is called whenever a message changes an aircraft's position,
+ * altitude or velocity (see TADS_B_Context::OnAircraftUpdate). It only
+ * copies the state and marks the aircraft. Evaluate() moves the marked
+ * aircraft in a persistent grid of swept boxes (as TConflictDetector's)
+ * and runs computeCPABatch() on their candidate pairs alone, both sides
+ * extrapolated to the evaluation time.
+ *
+ * Pairs predicted to lose separation are kept with the absolute time of
+ * their CPA, so an alert counts down with no further work until one of the
+ * two aircraft updates again; once that time has passed the pair is
+ * diverging and is dropped. With straight-line motion nothing about a pair
+ * changes unless one of its aircraft does, so the cost of Evaluate()
+ * follows the number of updates since the last call rather than the
+ * traffic. The boxes cover the look-ahead plus MaxAgeMs so that they stay
+ * valid until their aircraft is dropped for age.
+ */
+class TConflictMonitor
+{
+public:
+  TConflictMonitor(double LookAheadSec=CD_DEFAULT_LOOKAHEAD_SEC,
+				   double MinHorizontalNM=CD_DEFAULT_HORIZONTAL_NM,
+				   double MinVerticalFt=CD_DEFAULT_VERTICAL_FT,
+				   int64_t MaxAgeMs=CD_DEFAULT_MAX_AGE_MS,
+				   double CellSizeKm=CD_DEFAULT_CELL_KM);
+
+  /** Take the aircraft's cached ECEF state as of its LastSeen time. Ignored without full state. */
+  void   Update(const TADS_B_Aircraft *a);
+
+  /**
+   * Bring the pairs of updated aircraft up to date and replace Alerts by
+   * the conflicts predicted as of Time (msec), soonest first.
+   * @return the number of alerts
+   */
+  size_t Evaluate(int64_t Time, std::vector<TConflictAlert> &Alerts);
+
+  void   Clear(void);
+
+  double LookAhead(void) const { return LookAheadSec; }
+
+  unsigned NumAircraft(void) const { return (unsigned)Tracks.size(); }
+  unsigned NumPairs(void) const { return (unsigned)Pairs.size(); }
+  /** Pairs run through the CPA kernel by the last Evaluate(). */
+  unsigned NumPairsTested(void) const { return PairsTested; }
+
+private:
+  struct TTrack
+  {
+   uint32_t              ICAO;
+   int64_t               Time;            /* Of the state below. */
+   double                p[3],v[3];       /* ECEF km, km/s */
+   double                Altitude;
+   double                Min[3],Max[3];   /* Swept box, km. */
+   int64_t               Lo[3],Hi[3];     /* Cells the box is in. */
+   bool                  InGrid;
+   bool                  Dirty;
+   std::vector<uint32_t> Partners;        /* Other side of each kept pair. */
+  };
+  struct TPair
+  {
+   int64_t CPATime;
+   double  HorizontalNM;
+   double  VerticalFt;
+  };
+  typedef std::unordered_map<uint32_t,TTrack>                 TTrackMap;
+  typedef std::unordered_map<uint64_t,std::vector<TTrack *> > TCellMap;
+  typedef std::unordered_map<uint64_t,TPair>                  TPairMap;
+
+  void RemoveTrack(uint32_t ICAO);
+  void RemovePairs(TTrack &t);
+  void GridRemove(TTrack &t);
+  void GridInsert(TTrack &t);
+  void FindCandidates(TTrack &t);
+
+  double                  LookAheadSec;
+  double                  MinHorizontalNM;
+  double                  MinVerticalFt;
+  int64_t                 MaxAgeMs;
+  double                  CellSize;        /* km */
+  double                  Grow;            /* km added to each side of a box. */
+  unsigned                PairsTested;
+  TTrackMap               Tracks;
+  TCellMap                Cells;
+  TPairMap                Pairs;
+  std::vector<uint32_t>   Dirty;
+  std::deque<std::pair<int64_t,uint32_t> > Updates;   /* For aging, oldest first. */
+  std::vector<TTrack *>   Candidates;      /* Two tracks each. */
+  TCPAStateArrays         First,Second;
+  std::vector<double>     TCPA,HorizontalNM,VerticalFt;
+};
+//---------------------------------------------------------------------------
+#endif
@@ -1,31 +1,30 @@
 //---------------------------------------------------------------------------
 
 #pragma hdrstop
-#include <vcl.h>
-#include "DecodeRawADS_B.h"
-#include "DisplayGUI.h"
+#include <stdlib.h>
+#include <ctype.h>
 #include <cstring>
 #include <string.h>
+#include "DecodeRawADS_B.h"
 
 //---------------------------------------------------------------------------
 #pragma package(smart_init)
 static int hex_digit_val (int c);
-static int decode_modeS_message (modeS_message *mm, const uint8_t *_msg);
+static int decode_modeS_message (TADS_B_Context *Ctx, modeS_message *mm, const uint8_t *_msg);
 static int modeS_message_len_by_type (int type);
 static uint32_t CRC_get (const uint8_t *msg, int bits);
 static uint32_t CRC_check (const uint8_t *msg, int bits);
 static int fix_two_bits_errors (uint8_t *msg, int bits);
 static int fix_single_bit_errors (uint8_t *msg, int bits);
-static bool brute_force_AP (const uint8_t *msg, modeS_message *mm);
+static bool brute_force_AP (TADS_B_Context *Ctx, const uint8_t *msg, modeS_message *mm);
 static int decode_AC12_field (uint8_t *msg, metric_unit_t *unit);
 static int decode_AC13_field (const uint8_t *msg, metric_unit_t *unit);
 static uint32_t aircraft_get_addr (uint8_t a0, uint8_t a1, uint8_t a2);
-static void ICAO_cache_add_address (uint32_t addr);
-static bool ICAO_address_recently_seen (uint32_t addr);
+static void ICAO_cache_add_address (TADS_B_Context *Ctx, uint32_t addr);
+static bool ICAO_address_recently_seen (TADS_B_Context *Ctx, uint32_t addr);
 static uint32_t ICAO_cache_hash_address (uint32_t a);
 
 
-static uint32_t         *ICAO_cache=NULL;               /**< Recently seen ICAO addresses. */
 
 /**
  * Parity table for MODE S Messages.
@@ -66,10 +65,6 @@ static const uint32_t checksum_table [MODES_LONG_MSG_BITS] = {
            };
 
 
-void InitDecodeRawADS_B(void)
-{
- ICAO_cache =(uint32_t *) calloc (2 * sizeof(uint32_t) * MODES_ICAO_CACHE_LEN, 1);
-}
 
 
 /**
@@ -94,27 +89,28 @@ static uint32_t ICAO_cache_hash_address (uint32_t a)
  * Note that we also add a timestamp so that we can make sure that the
  * entry is only valid for `MODES_ICAO_CACHE_TTL` seconds.
  */
-static void ICAO_cache_add_address (uint32_t addr)
+static void ICAO_cache_add_address (TADS_B_Context *Ctx, uint32_t addr)
 {
   uint32_t h = ICAO_cache_hash_address (addr);
 
-  ICAO_cache [h*2]   = addr;
-  ICAO_cache [h*2+1] = (uint32_t) time (NULL);
+  Ctx->ICAO_cache [h*2]   = addr;
+  Ctx->ICAO_cache [h*2+1] = (uint32_t) (Ctx->CurrentTime / 1000);
 }
 
 /**
  * Returns true if the specified ICAO address was seen in a DF format with
  * proper checksum (not XORed with address) no more than
- * `MODES_ICAO_CACHE_TTL` seconds ago.
+ * `MODES_ICAO_CACHE_TTL` seconds ago, going by the context's clock.
  * Otherwise returns false.
  */
-static bool ICAO_address_recently_seen (uint32_t addr)
+static bool ICAO_address_recently_seen (TADS_B_Context *Ctx, uint32_t addr)
 {
   uint32_t h_idx = ICAO_cache_hash_address (addr);
-  uint32_t _addr = ICAO_cache [2*h_idx];
-  uint32_t seen  = ICAO_cache [2*h_idx + 1];
+  uint32_t _addr = Ctx->ICAO_cache [2*h_idx];
+  uint32_t seen  = Ctx->ICAO_cache [2*h_idx + 1];
+  uint32_t now   = (uint32_t) (Ctx->CurrentTime / 1000);
 
-  return (_addr && _addr == addr && (time(NULL) - seen) <= MODES_ICAO_CACHE_TTL);
+  return (_addr && _addr == addr && (uint32_t)(now - seen) <= MODES_ICAO_CACHE_TTL);
 }
 
 /**
@@ -143,7 +139,7 @@ static uint32_t aircraft_get_addr (uint8_t a0, uint8_t a1, uint8_t a2)
  * \retval true   successfully recovered a message with a correct checksum.
  * \retval false  failed to recover a message with a correct checksum.
  */
-static bool brute_force_AP (const uint8_t *msg, modeS_message *mm)
+static bool brute_force_AP (TADS_B_Context *Ctx, const uint8_t *msg, modeS_message *mm)
 {
   uint8_t aux [MODES_LONG_MSG_BYTES];
   int     msg_type = mm->msg_type;
@@ -178,7 +174,7 @@ static bool brute_force_AP (const uint8_t *msg, modeS_message *mm)
      * the message valid.
      */
     addr = aircraft_get_addr (aux[last_byte-2], aux[last_byte-1], aux[last_byte]);
-    if (ICAO_address_recently_seen(addr))
+    if (ICAO_address_recently_seen(Ctx, addr))
     {
       mm->AA [0] = aux [last_byte-2];
       mm->AA [1] = aux [last_byte-1];
@@ -410,14 +406,16 @@ static uint32_t CRC_get (const uint8_t *msg, int bits)
   return (CRC);
 }
 
-TDecodeStatus decode_RAW_message (AnsiString MsgIn,modeS_message *mm)
+TDecodeStatus decode_RAW_message (TADS_B_Context *Ctx,const char *MsgIn,modeS_message *mm)
 {
   uint8_t       bin_msg [MODES_LONG_MSG_BYTES];
   int           len, j, msg_len;
   uint8_t      *hex, *end;
   uint8_t       msg[512];
 
-  strcpy((char *)msg,MsgIn.c_str());
+  if (strlen(MsgIn) >= sizeof(msg)-1)
+     return (BadMessageTooLong);
+  strcpy((char *)msg,MsgIn);
   strcat((char *)msg,"\n");
   msg_len=strlen((char *)msg);
 
@@ -497,7 +495,7 @@ TDecodeStatus decode_RAW_message (AnsiString MsgIn,modeS_message *mm)
     bin_msg[j/2] = (high << 4) | low;
   }
 
-  decode_modeS_message (mm, bin_msg);
+  decode_modeS_message (Ctx, mm, bin_msg);
   if (mm->CRC_ok) return HaveMsg;
 
   return (CRCError);
@@ -508,7 +506,7 @@ TDecodeStatus decode_RAW_message (AnsiString MsgIn,modeS_message *mm)
  *
  * And split it into fields populating a `modeS_message` structure.
  */
-static int decode_modeS_message (modeS_message *mm, const uint8_t *_msg)
+static int decode_modeS_message (TADS_B_Context *Ctx, modeS_message *mm, const uint8_t *_msg)
 {
   uint32_t    CRC;   /* Computed CRC, used to verify the message CRC. */
   const char *AIS_charset = "?ABCDEFGHIJKLMNOPQRSTUVWXYZ????? ???????????????0123456789??????";
@@ -616,7 +614,7 @@ static int decode_modeS_message (modeS_message *mm, const uint8_t *_msg)
      * the checksum is XORed with the aircraft ICAO address. We try to
      * brute force it using a list of recently seen aircraft addresses.
      */
-    if (brute_force_AP(msg, mm))
+    if (brute_force_AP(Ctx, msg, mm))
     {
       /* We recovered the message, mark the checksum as valid.
        */
@@ -631,7 +629,7 @@ static int decode_modeS_message (modeS_message *mm, const uint8_t *_msg)
      * to the list of recently seen addresses.
      */
     if (mm->CRC_ok && mm->error_bit == -1)
-       ICAO_cache_add_address (aircraft_get_addr(mm->AA[0], mm->AA[1], mm->AA[2]));
+       ICAO_cache_add_address (Ctx, aircraft_get_addr(mm->AA[0], mm->AA[1], mm->AA[2]));
   }
 
   /* Decode 13 bit altitude for DF0, DF4, DF16, DF20
@@ -3,6 +3,9 @@
 #ifndef DecodeRawADS_BH
 #define DecodeRawADS_BH
 //---------------------------------------------------------------------------
+#include <stdint.h>
+#include <math.h>
+#include "ADSBCore.h"
 #define TWO_PI             (2 * M_PI)
 #define MODES_PREAMBLE_US             8         /* microseconds */
 #define MODES_LONG_MSG_BITS         112
@@ -95,6 +98,5 @@ typedef enum
   BadMessageEmpty2=8
 } TDecodeStatus;
 
-TDecodeStatus decode_RAW_message(AnsiString MsgIn,modeS_message *mm);
-void InitDecodeRawADS_B(void);
+TDecodeStatus decode_RAW_message(TADS_B_Context *Ctx,const char *MsgIn,modeS_message *mm);
 #endif
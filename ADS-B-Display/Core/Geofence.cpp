@@ -0,0 +1,327 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <math.h>
+#include <algorithm>
+#include "Geofence.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+#define CELL_OUT            0
+#define CELL_IN             1
+#define CELL_EDGE           2
+
+static int      CellOf(double Offset, double Size, int Count);
+static uint32_t IndexKey(int LatCell, int LonCell);
+static int      IndexCell(double Degrees);
+//---------------------------------------------------------------------------
+static int CellOf(double Offset, double Size, int Count)
+{
+ int c=(int)floor(Offset/Size);
+ if (c<0) return 0;
+ if (c>=Count) return Count-1;
+ return c;
+}
+//---------------------------------------------------------------------------
+static uint32_t IndexKey(int LatCell, int LonCell)
+{
+ return ((uint32_t)(LatCell+32768) << 16) | (uint32_t)((LonCell+32768) & 0xFFFF);
+}
+//---------------------------------------------------------------------------
+static int IndexCell(double Degrees)
+{
+ return (int)floor(Degrees/GF_INDEX_CELL_DEG);
+}
+//---------------------------------------------------------------------------
+TGeofenceEngine::TGeofenceEngine() : NumActive(0)
+{
+}
+//---------------------------------------------------------------------------
+int TGeofenceEngine::AddFence(const pfVec3 *Points, unsigned int NumPoints,
+							  double LowerFt, double UpperFt)
+{
+ if (NumPoints<3 || !(LowerFt<UpperFt)) return -1;
+
+ Fences.push_back(TFence());
+ TFence &f=Fences.back();
+ int Id=(int)Fences.size()-1;
+ unsigned n=NumPoints;
+
+ f.Active=true;
+ f.Inside=0;
+ f.Lower=LowerFt;
+ f.Upper=UpperFt;
+ f.X.resize(n);
+ f.Y.resize(n);
+ for (unsigned i = 0; i < n; i++)
+   {
+	f.X[i]=Points[i][0];
+	f.Y[i]=Points[i][1];
+   }
+ f.MinX=*std::min_element(f.X.begin(),f.X.end());
+ f.MaxX=*std::max_element(f.X.begin(),f.X.end());
+ f.MinY=*std::min_element(f.Y.begin(),f.Y.end());
+ f.MaxY=*std::max_element(f.Y.begin(),f.Y.end());
+
+ /* About one vertex per cell along each side. */
+ f.NX=f.NY=std::min(GF_MAX_GRID,std::max(1,(int)ceil(sqrt((double)n))));
+ f.CellW=f.MaxX>f.MinX ? (f.MaxX-f.MinX)/f.NX : 1.0;
+ f.CellH=f.MaxY>f.MinY ? (f.MaxY-f.MinY)/f.NY : 1.0;
+
+ /* Edge i runs from vertex i-1 to vertex i; list it in every row it spans. */
+ std::vector<int> Lo(n),Hi(n);
+ f.RowStart.assign(f.NY+1,0);
+ for (unsigned i = 0; i < n; i++)
+   {
+	unsigned j=i ? i-1 : n-1;
+	Lo[i]=CellOf(std::min(f.Y[i],f.Y[j])-f.MinY,f.CellH,f.NY);
+	Hi[i]=CellOf(std::max(f.Y[i],f.Y[j])-f.MinY,f.CellH,f.NY);
+	for (int r = Lo[i]; r <= Hi[i]; r++) f.RowStart[r+1]++;
+   }
+ for (int r = 0; r < f.NY; r++) f.RowStart[r+1]+=f.RowStart[r];
+ f.RowEdges.resize(f.RowStart[f.NY]);
+ std::vector<uint32_t> Fill(f.RowStart.begin(),f.RowStart.end()-1);
+ for (unsigned i = 0; i < n; i++)
+   for (int r = Lo[i]; r <= Hi[i]; r++) f.RowEdges[Fill[r]++]=i;
+
+ /* Cells an edge's box touches need the exact test; the rest take the state of their centre. */
+ f.Cells.assign(f.NX*f.NY,CELL_OUT);
+ for (unsigned i = 0; i < n; i++)
+   {
+	unsigned j=i ? i-1 : n-1;
+	int x0=CellOf(std::min(f.X[i],f.X[j])-f.MinX,f.CellW,f.NX);
+	int x1=CellOf(std::max(f.X[i],f.X[j])-f.MinX,f.CellW,f.NX);
+	for (int r = Lo[i]; r <= Hi[i]; r++)
+	  for (int c = x0; c <= x1; c++) f.Cells[r*f.NX+c]=CELL_EDGE;
+   }
+ for (int r = 0; r < f.NY; r++)
+   for (int c = 0; c < f.NX; c++)
+	 if (f.Cells[r*f.NX+c]!=CELL_EDGE)
+	   f.Cells[r*f.NX+c]=RowTest(f,r,f.MinX+(c+0.5)*f.CellW,f.MinY+(r+0.5)*f.CellH) ? CELL_IN : CELL_OUT;
+
+ for (int la = IndexCell(f.MinY); la <= IndexCell(f.MaxY); la++)
+   for (int lo = IndexCell(f.MinX); lo <= IndexCell(f.MaxX); lo++)
+	 {
+	  uint32_t Key=IndexKey(la,lo);
+	  TBand b;
+	  b.Lower=LowerFt;
+	  b.Upper=UpperFt;
+	  b.Fence=Id;
+	  std::vector<TBand> &Bands=Index[Key];
+	  Bands.push_back(b);
+	  SortBands(Bands);
+	  f.IndexKeys.push_back(Key);
+	 }
+ NumActive++;
+ return Id;
+}
+//---------------------------------------------------------------------------
+void TGeofenceEngine::RemoveFence(int Fence)
+{
+ if (Fence<0 || Fence>=(int)Fences.size() || !Fences[Fence].Active) return;
+ TFence &f=Fences[Fence];
+
+ for (size_t k = 0; k < f.IndexKeys.size(); k++)
+   {
+	TIndex::iterator it=Index.find(f.IndexKeys[k]);
+	if (it==Index.end()) continue;
+	std::vector<TBand> &Bands=it->second;
+	for (size_t b = 0; b < Bands.size(); b++)
+	  if (Bands[b].Fence==Fence)
+		{
+		 Bands.erase(Bands.begin()+b);
+		 break;
+		}
+	if (Bands.empty()) Index.erase(it);
+	else SortBands(Bands);
+   }
+ if (f.Inside)
+   for (TAircraftMap::iterator it = Aircraft.begin(); it != Aircraft.end(); )
+	 {
+	  std::vector<int> &In=it->second;
+	  In.erase(std::remove(In.begin(),In.end(),Fence),In.end());
+	  /* As in Update(), only aircraft inside some fence are kept. */
+	  if (In.empty()) it=Aircraft.erase(it);
+	  else ++it;
+	 }
+ f=TFence();
+ f.Active=false;
+ NumActive--;
+}
+//---------------------------------------------------------------------------
+/*
+ * The crossing test of PointInPolygon() over the edges listed for the row
+ * holding y. An edge that straddles y spans that row, so no crossing is
+ * missed and the answer is the same as testing every edge.
+ */
+bool TGeofenceEngine::RowTest(const TFence &f, int Row, double x, double y)
+{
+ bool In=false;
+ unsigned n=(unsigned)f.X.size();
+
+ for (uint32_t k = f.RowStart[Row]; k < f.RowStart[Row+1]; k++)
+   {
+	unsigned i=f.RowEdges[k];
+	unsigned j=i ? i-1 : n-1;
+	if (((f.Y[i]>y) != (f.Y[j]>y)) &&
+		(x < (f.X[j]-f.X[i]) * (y-f.Y[i]) / (f.Y[j]-f.Y[i]) + f.X[i]))
+	  In=!In;
+   }
+ return In;
+}
+//---------------------------------------------------------------------------
+/*
+ * Keep a cell's bands in order of lower altitude, with the highest upper
+ * altitude up to each, for Candidates().
+ */
+void TGeofenceEngine::SortBands(std::vector<TBand> &Bands)
+{
+ size_t k=Bands.size()-1;
+ while (k>0 && Bands[k].Lower<Bands[k-1].Lower)
+   {
+	std::swap(Bands[k],Bands[k-1]);
+	k--;
+   }
+ for (k = 0; k < Bands.size(); k++)
+   Bands[k].MaxUpper=k ? std::max(Bands[k-1].MaxUpper,Bands[k].Upper) : Bands[k].Upper;
+}
+//---------------------------------------------------------------------------
+/*
+ * Fences of the point's index cell whose band holds AltitudeFt (all of them
+ * if it is NULL) and whose polygon holds the point. The bands with a lower
+ * altitude at or below the altitude come first; scanning those back from the
+ * last, once the highest upper altitude so far is at or below the altitude
+ * no earlier band can hold it either.
+ */
+void TGeofenceEngine::Candidates(double Latitude, double Longitude, const double *AltitudeFt,
+								 std::vector<int> &Out) const
+{
+ TIndex::const_iterator Cell=Index.find(IndexKey(IndexCell(Latitude),IndexCell(Longitude)));
+ if (Cell==Index.end()) return;
+ const std::vector<TBand> &Bands=Cell->second;
+
+ if (!AltitudeFt)
+   {
+	for (size_t k = 0; k < Bands.size(); k++)
+	  if (FenceContains(Fences[Bands[k].Fence],Longitude,Latitude))
+		Out.push_back(Bands[k].Fence);
+	return;
+   }
+ double Alt=*AltitudeFt;
+ size_t Lo=0,Hi=Bands.size();
+ while (Lo<Hi)
+   {
+	size_t Mid=(Lo+Hi)/2;
+	if (Bands[Mid].Lower<=Alt) Lo=Mid+1;
+	else Hi=Mid;
+   }
+ for (size_t k = Lo; k > 0 && Bands[k-1].MaxUpper>Alt; k--)
+   if (Bands[k-1].Upper>Alt && FenceContains(Fences[Bands[k-1].Fence],Longitude,Latitude))
+	 Out.push_back(Bands[k-1].Fence);
+}
+//---------------------------------------------------------------------------
+bool TGeofenceEngine::FenceContains(const TFence &f, double x, double y)
+{
+ if (x<f.MinX || x>f.MaxX || y<f.MinY || y>f.MaxY) return false;
+
+ int r=CellOf(y-f.MinY,f.CellH,f.NY);
+ uint8_t Cell=f.Cells[r*f.NX+CellOf(x-f.MinX,f.CellW,f.NX)];
+ if (Cell!=CELL_EDGE) return Cell==CELL_IN;
+ return RowTest(f,r,x,y);
+}
+//---------------------------------------------------------------------------
+bool TGeofenceEngine::Contains(int Fence, double Latitude, double Longitude, double AltitudeFt) const
+{
+ if (Fence<0 || Fence>=(int)Fences.size() || !Fences[Fence].Active) return false;
+ const TFence &f=Fences[Fence];
+ if (AltitudeFt<f.Lower || AltitudeFt>=f.Upper) return false;
+ return FenceContains(f,Longitude,Latitude);
+}
+//---------------------------------------------------------------------------
+void TGeofenceEngine::Query(double Latitude, double Longitude, double AltitudeFt, std::vector<int> &Out) const
+{
+ size_t First=Out.size();
+ Candidates(Latitude,Longitude,&AltitudeFt,Out);
+ std::sort(Out.begin()+First,Out.end());
+}
+//---------------------------------------------------------------------------
+int TGeofenceEngine::Owner(double Latitude, double Longitude, double AltitudeFt) const
+{
+ std::vector<int> In;
+ int              Best=-1;
+
+ Candidates(Latitude,Longitude,&AltitudeFt,In);
+ for (size_t k = 0; k < In.size(); k++)
+   if (Best<0 || Fences[In[k]].Lower>Fences[Best].Lower ||
+	   (Fences[In[k]].Lower==Fences[Best].Lower && In[k]<Best))
+	 Best=In[k];
+ return Best;
+}
+//---------------------------------------------------------------------------
+unsigned TGeofenceEngine::NumInside(int Fence) const
+{
+ if (Fence<0 || Fence>=(int)Fences.size()) return 0;
+ return Fences[Fence].Inside;
+}
+//---------------------------------------------------------------------------
+void TGeofenceEngine::Update(const TADS_B_Aircraft *a, std::vector<TGeofenceEvent> &Events)
+{
+ if (!a->HaveLatLon) return;
+
+ Now.clear();
+ Candidates(a->Latitude,a->Longitude,a->HaveAltitude ? &a->Altitude : NULL,Now);
+
+ TAircraftMap::iterator it=Aircraft.find(a->ICAO);
+ if (it==Aircraft.end())
+   {
+	if (Now.empty()) return;
+	it=Aircraft.insert(std::make_pair(a->ICAO,std::vector<int>())).first;
+   }
+ std::vector<int> &Before=it->second;
+ std::sort(Now.begin(),Now.end());
+ if (Now==Before) return;
+
+ TGeofenceEvent e;
+ size_t i=0,j=0;
+ e.ICAO=a->ICAO;
+ e.Time=a->LastSeen;
+ while (i<Before.size() || j<Now.size())
+   {
+	if (j==Now.size() || (i<Before.size() && Before[i]<Now[j]))
+	  {
+	   e.Fence=Before[i++];
+	   e.Type=GEOFENCE_EXIT;
+	   Fences[e.Fence].Inside--;
+	  }
+	else if (i==Before.size() || Now[j]<Before[i])
+	  {
+	   e.Fence=Now[j++];
+	   e.Type=GEOFENCE_ENTER;
+	   Fences[e.Fence].Inside++;
+	  }
+	else
+	  {
+	   i++;
+	   j++;
+	   continue;
+	  }
+	Events.push_back(e);
+   }
+ if (Now.empty()) Aircraft.erase(it);
+ else Before=Now;
+}
+//---------------------------------------------------------------------------
+void TGeofenceEngine::Forget(uint32_t ICAO)
+{
+ TAircraftMap::iterator it=Aircraft.find(ICAO);
+ if (it==Aircraft.end()) return;
+ for (size_t k = 0; k < it->second.size(); k++) Fences[it->second[k]].Inside--;
+ Aircraft.erase(it);
+}
+//---------------------------------------------------------------------------
+void TGeofenceEngine::ForgetAll(void)
+{
+ Aircraft.clear();
+ for (size_t k = 0; k < Fences.size(); k++) Fences[k].Inside=0;
+}
+//---------------------------------------------------------------------------
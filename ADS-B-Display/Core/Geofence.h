@@ -0,0 +1,134 @@
+//---------------------------------------------------------------------------
+
+#ifndef GeofenceH
+#define GeofenceH
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include "Aircraft.h"
+#include "TriangulatPoly.h"
+//---------------------------------------------------------------------------
+#define GF_INDEX_CELL_DEG   1.0     /* Cell of the index from positions to fences. */
+#define GF_MAX_GRID         64      /* Most cells per side of a fence's own grid. */
+#define GF_NO_FLOOR         -1e9    /* Altitude band of a fence covering all altitudes. */
+#define GF_NO_CEILING       1e9
+
+typedef enum
+{
+ GEOFENCE_ENTER,
+ GEOFENCE_EXIT
+} TGeofenceEventType;
+
+/** An aircraft crossing into or out of a fence. */
+typedef struct
+{
+ uint32_t           ICAO;
+ int                Fence;       /* As returned by TGeofenceEngine::AddFence() */
+ TGeofenceEventType Type;
+ int64_t            Time;        /* The aircraft's LastSeen */
+} TGeofenceEvent;
+
+/**
+ * Continuous aircraft-in-airspace evaluation.
+ *
+ * Fences are volumes: a polygon in longitude/latitude (as TArea::Points),
+ * tested the same way as PointInPolygon(), between a lower (inclusive) and
+ * upper (exclusive) altitude in feet. Each position update goes through:
+ *
+ *  - an index of GF_INDEX_CELL_DEG cells holding the fences whose bounding
+ *    box covers them. Each cell keeps its fences sorted by lower altitude
+ *    with the running maximum of the upper altitudes, so the fences whose
+ *    band holds an altitude are found by a binary search and a short scan
+ *    back, and only those go on;
+ *  - the fence's bounding box;
+ *  - the fence's own grid, whose cells are known to be inside or outside
+ *    unless an edge passes through them;
+ *  - for those edge cells only, the crossing test over the edges spanning
+ *    the cell's row rather than the whole polygon.
+ *
+ * The fences each aircraft was in are kept, and Update() reports the
+ * difference as enter and exit events. Aircraft away from fence boundaries,
+ * which is nearly all of them, cost a couple of hash lookups per update.
+ * NumInside() is then the load of each fence (sector).
+ *
+ * Not thread safe.
+ */
+class TGeofenceEngine
+{
+public:
+  TGeofenceEngine();
+
+  /**
+   * Add a polygon of NumPoints longitude/latitude points spanning altitudes
+   * LowerFt up to UpperFt. @return its id, -1 if degenerate
+   */
+  int  AddFence(const pfVec3 *Points, unsigned int NumPoints,
+				double LowerFt=GF_NO_FLOOR, double UpperFt=GF_NO_CEILING);
+
+  /** Remove a fence. Aircraft inside it are dropped from it without events. */
+  void RemoveFence(int Fence);
+
+  /**
+   * Check the aircraft's position; enter and exit events are appended to
+   * Events. Without an altitude the bands are not looked at.
+   */
+  void Update(const TADS_B_Aircraft *a, std::vector<TGeofenceEvent> &Events);
+
+  /** Forget an aircraft (e.g. purged), without events. */
+  void Forget(uint32_t ICAO);
+  void ForgetAll(void);
+
+  bool Contains(int Fence, double Latitude, double Longitude, double AltitudeFt) const;
+
+  /** Fences holding the point, appended to Out in id order. */
+  void Query(double Latitude, double Longitude, double AltitudeFt, std::vector<int> &Out) const;
+
+  /**
+   * The sector owning the point: of the fences holding it, the one with the
+   * highest floor (the most specific of stacked volumes). @return -1 if none
+   */
+  int  Owner(double Latitude, double Longitude, double AltitudeFt) const;
+
+  /** Number of aircraft inside the fence as of their last update. */
+  unsigned NumInside(int Fence) const;
+  unsigned NumFences(void) const { return NumActive; }
+
+private:
+  struct TFence
+  {
+   bool                  Active;
+   unsigned              Inside;        /* Aircraft in it. */
+   double                Lower,Upper;   /* Altitude band, feet. */
+   std::vector<double>   X,Y;           /* Longitude, latitude of the vertices. */
+   double                MinX,MinY,MaxX,MaxY;
+   int                   NX,NY;
+   double                CellW,CellH;
+   std::vector<uint8_t>  Cells;         /* NX*NY, row by row. */
+   std::vector<uint32_t> RowStart;      /* NY+1 offsets into RowEdges. */
+   std::vector<uint32_t> RowEdges;      /* Edges (by end vertex) spanning each row. */
+   std::vector<uint32_t> IndexKeys;     /* Index cells it is listed in. */
+  };
+  struct TBand
+  {
+   double Lower,Upper;
+   double MaxUpper;                     /* Of this and all earlier bands in the cell. */
+   int    Fence;
+  };
+  typedef std::unordered_map<uint32_t,std::vector<TBand> > TIndex;
+  typedef std::unordered_map<uint32_t,std::vector<int> > TAircraftMap;
+
+  static bool RowTest(const TFence &f, int Row, double x, double y);
+  static bool FenceContains(const TFence &f, double x, double y);
+  static void SortBands(std::vector<TBand> &Bands);
+  void        Candidates(double Latitude, double Longitude, const double *AltitudeFt,
+						 std::vector<int> &Out) const;
+
+  std::vector<TFence>   Fences;
+  unsigned              NumActive;
+  TIndex                Index;
+  TAircraftMap          Aircraft;       /* Fences each aircraft is in, sorted. */
+  std::vector<int>      Now;
+};
+//---------------------------------------------------------------------------
+#endif
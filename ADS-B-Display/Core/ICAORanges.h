@@ -0,0 +1,42 @@
+//---------------------------------------------------------------------------
+
+#ifndef ICAORangesH
+#define ICAORangesH
+
+#include <stdint.h>
+//---------------------------------------------------------------------------
+#define ICAO_INDEX_BITS     12      /* Top bits of the 24 bit address indexing the lookup. */
+
+/**
+ * What the address allocation says about an aircraft: the country its
+ * address block was allocated to and the military range it falls in, as
+ * indexes to pass to ICAOCountryName() and ICAOMilitaryCountry(). -1 if none.
+ */
+typedef struct
+{
+ int16_t Country;
+ int16_t Military;
+} TICAOClass;
+
+/**
+ * Classify an address.
+ *
+ * The country and military ranges overlap (territories inside the United
+ * Kingdom's block, military blocks inside countries); the tables are
+ * flattened once into sorted segments with the answer of both already
+ * resolved, and the top ICAO_INDEX_BITS bits of the address index the
+ * segment to start from, so a lookup is a table read and a step or two
+ * forward. Non-ICAO addresses (MODES_NON_ICAO_ADDRESS) are unclassified.
+ */
+TICAOClass  ICAOClassify(uint32_t addr);
+
+/** @return NULL for -1 */
+const char *ICAOCountryName(int Country, bool Short);
+/** Country a military range is known to belong to, NULL if unknown. */
+const char *ICAOMilitaryCountry(int Military);
+
+const char *aircraft_get_country (uint32_t addr, bool get_short);
+bool aircraft_is_military (uint32_t addr, const char **country);
+const char *aircraft_get_military (uint32_t addr);
+//---------------------------------------------------------------------------
+#endif
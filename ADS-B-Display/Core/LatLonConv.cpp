@@ -4,6 +4,9 @@
 //---------------------------------------------------------------------------
 
 #define EPS 0.00000000000005          // a small number
+#define E2  (1.0-sqr(EllipseMinor)/sqr(EllipseMajor))  // first eccentricity squared
+
+static void RadiiOfCurvature(double Latitude, double *Meridian, double *PrimeVertical);
 //---------------------------------------------------------------------------
 TCoordConvStatus VInverse(double Latitude1, double Longitude1,
 						  double Latitude2, double Longitude2,
@@ -331,4 +334,144 @@ static double ModLongitude(double lon)
  return(modulus(lon + M_PI, 2.0 * M_PI) - M_PI);
 }
 //---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+// Radii of curvature of the ellipsoid (nautical miles) at Latitude (radians)
+static void RadiiOfCurvature(double Latitude, double *Meridian, double *PrimeVertical)
+{
+ double w = 1.0 - E2 * sqr(sin(Latitude));
+
+ *PrimeVertical = EllipseMajor / sqrt(w);
+ *Meridian = *PrimeVertical * (1.0 - E2) / w;
+}
+//---------------------------------------------------------------------------
+TCoordConvStatus FastDirect(double Latitude1,  double Longitude1,
+							double Azimuth12,  double Distance,
+							double *Latitude2, double *Longitude2,
+							double *Azimuth21)
+{
+  double lat1, lat2, long2, az12, latm, M, N, sigma, sl1, cl1, ss, cs, sa, ca;
+
+  if (Distance == 0.0)
+	{
+	  *Latitude2 = Latitude1;
+	  *Longitude2 = Longitude1;
+	  *Azimuth21 = 0.0;
+	  return(ZERODIST);
+	}
+
+  lat1 = DEGTORAD(Latitude1);
+  az12 = DEGTORAD(Azimuth12);
+  sa = sin(az12);
+  ca = cos(az12);
+
+  // the mid latitude on a flat earth is close enough to pick the sphere
+  latm = lat1 + 0.5 * Distance * ca / EllipseMajor;
+  if (latm > M_PI / 2.0) latm = M_PI / 2.0;
+  if (latm < -M_PI / 2.0) latm = -M_PI / 2.0;
+  RadiiOfCurvature(latm, &M, &N);
+
+  sigma = Distance / N;
+  sl1 = sin(lat1);
+  cl1 = cos(lat1);
+  ss = sin(sigma);
+  cs = cos(sigma);
+
+  lat2 = asin(sl1 * cs + cl1 * ss * ca);      // on the sphere
+  long2 = atan2(sa * ss * cl1, cs - sl1 * sin(lat2));
+  *Azimuth21 = RADTODEG(ModAzimuth(atan2(-sa * cl1, sl1 * ss - cl1 * cs * ca)));
+
+  lat2 = ModLatitude(lat1 + (lat2 - lat1) * N / M);
+  *Latitude2 = RADTODEG(lat2);
+  *Longitude2 = RADTODEG(ModLongitude(DEGTORAD(Longitude1) + long2));
+  return(OKNOERROR);
+}
+//---------------------------------------------------------------------------
+TCoordConvStatus FastInverse(double Latitude1, double Longitude1,
+							 double Latitude2, double Longitude2,
+							 double *Distance, double *Azimuth12,
+							 double *Azimuth21)
+{
+  double lat1, lat2, dlong, M, N, sl1, cl1, sl2, cl2, sdl, cdl, hav;
+
+  if ((fabs(Latitude1 - Latitude2) < 0.000001) &&
+	  (fabs(Longitude1 - Longitude2) < 0.000001))
+	{
+	  *Azimuth12 = 0.0;
+	  *Azimuth21 = 0.0;
+	  *Distance = 0.0;
+	  return(SAMEPT);
+	}
+
+  lat1 = DEGTORAD(Latitude1);
+  lat2 = DEGTORAD(Latitude2);
+  dlong = DEGTORAD(Longitude2 - Longitude1);
+  RadiiOfCurvature(0.5 * (lat1 + lat2), &M, &N);
+
+  lat2 = lat1 + (lat2 - lat1) * M / N;        // on the sphere
+  sl1 = sin(lat1);
+  cl1 = cos(lat1);
+  sl2 = sin(lat2);
+  cl2 = cos(lat2);
+  sdl = sin(dlong);
+  cdl = cos(dlong);
+
+  hav = sqr(sin(0.5 * (lat2 - lat1))) + cl1 * cl2 * sqr(sin(0.5 * dlong));
+  *Distance = 2.0 * asin(sqrt(hav < 1.0 ? hav : 1.0)) * N;
+  *Azimuth12 = RADTODEG(ModAzimuth(atan2(sdl * cl2, cl1 * sl2 - sl1 * cl2 * cdl)));
+  *Azimuth21 = RADTODEG(ModAzimuth(atan2(-sdl * cl1, cl2 * sl1 - sl2 * cl1 * cdl)));
+  return(OKNOERROR);
+}
+//---------------------------------------------------------------------------
+TCoordConvStatus GeoDirect(double Latitude1,  double Longitude1,
+						   double Azimuth12,  double Distance,
+						   double *Latitude2, double *Longitude2,
+						   double *Azimuth21)
+{
+ if (fabs(Distance) <= FAST_GEODESIC_MAX_NM)
+   return(FastDirect(Latitude1, Longitude1, Azimuth12, Distance, Latitude2, Longitude2, Azimuth21));
+ return(VDirect(Latitude1, Longitude1, Azimuth12, Distance, Latitude2, Longitude2, Azimuth21));
+}
+//---------------------------------------------------------------------------
+TCoordConvStatus GeoInverse(double Latitude1, double Longitude1,
+							double Latitude2, double Longitude2,
+							double *Distance, double *Azimuth12,
+							double *Azimuth21)
+{
+ TCoordConvStatus Status;
+
+ Status = FastInverse(Latitude1, Longitude1, Latitude2, Longitude2, Distance, Azimuth12, Azimuth21);
+ if (Status == OKNOERROR && *Distance > FAST_GEODESIC_MAX_NM)
+   Status = VInverse(Latitude1, Longitude1, Latitude2, Longitude2, Distance, Azimuth12, Azimuth21);
+ return(Status);
+}
+//---------------------------------------------------------------------------
+void GeoDirectBatch(const double *Latitude1, const double *Longitude1,
+					const double *Azimuth12, const double *Distance, unsigned int Count,
+					double *Latitude2, double *Longitude2)
+{
+ double az21;
 
+ for (unsigned int i = 0; i < Count; i++)
+   if (GeoDirect(Latitude1[i], Longitude1[i], Azimuth12[i], Distance[i],
+				 &Latitude2[i], &Longitude2[i], &az21) != OKNOERROR)
+	 {
+	  Latitude2[i] = Latitude1[i];
+	  Longitude2[i] = Longitude1[i];
+	 }
+}
+//---------------------------------------------------------------------------
+void GeoInverseBatch(const double *Latitude1, const double *Longitude1,
+					 const double *Latitude2, const double *Longitude2, unsigned int Count,
+					 double *Distance, double *Azimuth12)
+{
+ double az21;
+ TCoordConvStatus Status;
+
+ for (unsigned int i = 0; i < Count; i++)
+   {
+	Status = GeoInverse(Latitude1[i], Longitude1[i], Latitude2[i], Longitude2[i],
+						&Distance[i], &Azimuth12[i], &az21);
+	if (Status != OKNOERROR && Status != SAMEPT) Distance[i] = -1.0;
+   }
+}
+//---------------------------------------------------------------------------
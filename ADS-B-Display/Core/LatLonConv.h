@@ -0,0 +1,89 @@
+//---------------------------------------------------------------------------
+
+#ifndef LatLonConvH
+#define LatLonConvH
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#define DEGTORAD(degree) ((M_PI  / 180.0f) * (degree)) // converts from degrees to radians
+#define RADTODEG(radian) ((180.0f / M_PI ) * (radian)) // converts from radians to degrees
+#define METERS_PER_NAUICAL_MILE 1852.0
+#define EllipseMajorInMeters  6378137.000 // wgs 84 in meters
+#define EllipseMinorInMeters  6356752.314 // wgs 84 in meters
+#define EllipseMajor   (EllipseMajorInMeters/METERS_PER_NAUICAL_MILE)  // wgs 84 in Data Miles
+#define EllipseMinor   (EllipseMinorInMeters/METERS_PER_NAUICAL_MILE)  // wgs 84 in Data Miles
+
+typedef enum
+{ OKNOERROR  = 0,     // no error
+  LONGERR    = 1,     // longitude maximum exceeded
+  LATERR     = 2,     // latitude maximum exceeded
+  ANTIPODAL  = 3,     // using antipodal points in VInverse
+  SAMEPT     = 4,     // lat/longs are same point - VInverse
+  ZERODIST   = 5,     // distance is zero - VDirect
+  NOCONVERGE = 6      // loop did not converge
+} TCoordConvStatus;
+
+ TCoordConvStatus VInverse(double Latitude1, double Longitude1,
+						   double Latitude2, double Longitude2,
+						   double *Distance, double *Azimuth1,
+						   double *Azimuth2);
+ TCoordConvStatus VDirect(double Latitude1,  double Longitude1,
+						  double Azimuth12,  double Distance,
+						  double *Latitude2, double *Longitude2,
+						  double *Azimuth21);
+
+ // Fast forms of VDirect/VInverse for short ranges, same arguments and units
+ // (degrees, nautical miles). Instead of iterating on the ellipsoid they solve
+ // the great circle on a sphere fitted at the mid latitude: radius of the prime
+ // vertical, latitude differences scaled by the meridian radius. No loops.
+ // Against Vincenty up to 250 NM, at latitudes up to 89 degrees:
+ //   FastDirect  end point within 35 m, back azimuth within 0.008 degrees
+ //   FastInverse distance within 25 m, azimuths within 0.003 degrees
+ // The worst cases are about 31 m and 23 m, near 45 degrees of latitude on a
+ // 45 degree azimuth; the back azimuth is worst on paths passing a pole.
+ // The error grows with the square of the distance beyond that.
+ // Tests/GeodesicTest.cpp (adsb_geodesic_test) checks these bounds.
+ TCoordConvStatus FastDirect(double Latitude1,  double Longitude1,
+							 double Azimuth12,  double Distance,
+							 double *Latitude2, double *Longitude2,
+							 double *Azimuth21);
+ TCoordConvStatus FastInverse(double Latitude1, double Longitude1,
+							  double Latitude2, double Longitude2,
+							  double *Distance, double *Azimuth12,
+							  double *Azimuth21);
+
+ // The fast form up to FAST_GEODESIC_MAX_NM, Vincenty beyond.
+ #define FAST_GEODESIC_MAX_NM 250.0
+ TCoordConvStatus GeoDirect(double Latitude1,  double Longitude1,
+							double Azimuth12,  double Distance,
+							double *Latitude2, double *Longitude2,
+							double *Azimuth21);
+ TCoordConvStatus GeoInverse(double Latitude1, double Longitude1,
+							 double Latitude2, double Longitude2,
+							 double *Distance, double *Azimuth12,
+							 double *Azimuth21);
+
+ // GeoDirect/GeoInverse over arrays, element i of each array going together.
+ // Elements that fail keep their start point (direct) or get distance -1 (inverse).
+ void GeoDirectBatch(const double *Latitude1, const double *Longitude1,
+					 const double *Azimuth12, const double *Distance, unsigned int Count,
+					 double *Latitude2, double *Longitude2);
+ void GeoInverseBatch(const double *Latitude1, const double *Longitude1,
+					  const double *Latitude2, const double *Longitude2, unsigned int Count,
+					  double *Distance, double *Azimuth12);
+
+ static double Frac(double Num1);
+ static double modulus(double Num1, double Num2);
+ //static double  modulus (const double  X, double Y);
+ static TCoordConvStatus Antipod(double latin,   double lonin,
+						  double *latout, double *lonout);
+ static bool IsAntipodal(double Latitude1, double Latitude2,
+				  double Longitude1,double Longitude2);
+ static double sqr(double X);
+ static double ModAzimuth(double az);
+ static double ModLatitude(double lat);
+ static double ModLongitude(double lon);
+
+
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,105 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "MappedFile.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+//---------------------------------------------------------------------------
+TMappedFile::TMappedFile()
+  : Opened(false), View(NULL), Length(0)
+#ifdef _WIN32
+	, FileHandle(INVALID_HANDLE_VALUE), MappingHandle(NULL)
+#endif
+{
+}
+//---------------------------------------------------------------------------
+TMappedFile::~TMappedFile()
+{
+ Close();
+}
+//---------------------------------------------------------------------------
+bool TMappedFile::Open(const char *FileName)
+{
+ Close();
+#ifdef _WIN32
+ LARGE_INTEGER FileSize;
+
+ FileHandle=CreateFileA(FileName,GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,NULL,
+						OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL|FILE_FLAG_RANDOM_ACCESS,NULL);
+ if (FileHandle==INVALID_HANDLE_VALUE) return false;
+ if (!GetFileSizeEx(FileHandle,&FileSize))
+   {
+	Close();
+	return false;
+   }
+ Length=(size_t)FileSize.QuadPart;
+ if (Length>0)
+   {
+	MappingHandle=CreateFileMappingA(FileHandle,NULL,PAGE_READONLY,0,0,NULL);
+	if (MappingHandle==NULL)
+	  {
+	   Close();
+	   return false;
+	  }
+	View=MapViewOfFile(MappingHandle,FILE_MAP_READ,0,0,0);
+	if (View==NULL)
+	  {
+	   Close();
+	   return false;
+	  }
+   }
+#else
+ struct stat st;
+ int         fd=open(FileName,O_RDONLY);
+
+ if (fd<0) return false;
+ if (fstat(fd,&st)!=0)
+   {
+	close(fd);
+	return false;
+   }
+ Length=(size_t)st.st_size;
+ if (Length>0)
+   {
+	View=mmap(NULL,Length,PROT_READ,MAP_SHARED,fd,0);
+	if (View==MAP_FAILED)
+	  {
+	   View=NULL;
+	   Length=0;
+	   close(fd);
+	   return false;
+	  }
+	madvise(View,Length,MADV_RANDOM);
+   }
+ /* The mapping keeps its own reference to the file. */
+ close(fd);
+#endif
+ Opened=true;
+ return true;
+}
+//---------------------------------------------------------------------------
+void TMappedFile::Close(void)
+{
+#ifdef _WIN32
+ if (View) UnmapViewOfFile(View);
+ if (MappingHandle) CloseHandle(MappingHandle);
+ if (FileHandle!=INVALID_HANDLE_VALUE) CloseHandle(FileHandle);
+ MappingHandle=NULL;
+ FileHandle=INVALID_HANDLE_VALUE;
+#else
+ if (View) munmap(View,Length);
+#endif
+ View=NULL;
+ Length=0;
+ Opened=false;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,44 @@
+//---------------------------------------------------------------------------
+
+#ifndef MappedFileH
+#define MappedFileH
+
+#include <stddef.h>
+//---------------------------------------------------------------------------
+/**
+ * Read-only memory mapping of a whole file.
+ *
+ * Pages are read on first touch and may be dropped by the operating system
+ * at any time, so a mapped file costs address space rather than memory.
+ * An empty file opens successfully with Data() NULL and Size() 0. The file
+ * may be open for writing elsewhere (see TTileArchive, which appends to a
+ * file it maps); the mapping covers the size it had when opened.
+ */
+class TMappedFile
+{
+public:
+  TMappedFile();
+  ~TMappedFile();
+
+  /** Map FileName, closing any previous mapping. @return false on error. */
+  bool Open(const char *FileName);
+  void Close(void);
+
+  bool        IsOpen(void) const { return Opened; }
+  const void *Data(void) const { return View; }
+  size_t      Size(void) const { return Length; }
+
+private:
+  TMappedFile(const TMappedFile &);
+  TMappedFile &operator=(const TMappedFile &);
+
+  bool    Opened;
+  void   *View;
+  size_t  Length;
+#ifdef _WIN32
+  void   *FileHandle;
+  void   *MappingHandle;
+#endif
+};
+//---------------------------------------------------------------------------
+#endif
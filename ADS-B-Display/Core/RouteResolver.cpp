@@ -0,0 +1,262 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "RouteResolver.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+#define RR_MAGIC            "ADSBROUTE1"
+#define RR_MAX_ROUTE        255     /* Longer answers are not routes. */
+
+static bool    CleanCallsign(const char *Callsign, std::string &Clean);
+static bool    CleanRoute(std::string &Route);
+static int64_t Now(void);
+//---------------------------------------------------------------------------
+static int64_t Now(void)
+{
+ return (int64_t)time(NULL);
+}
+//---------------------------------------------------------------------------
+/* Callsigns are letters and digits; anything else is not looked up. */
+static bool CleanCallsign(const char *Callsign, std::string &Clean)
+{
+ Clean.clear();
+ for (const char *p = Callsign; *p; p++)
+   {
+	if (*p==' ') continue;
+	if (!isalnum((unsigned char)*p) || Clean.size()==RR_MAX_CALLSIGN) return false;
+	Clean+=(char)toupper((unsigned char)*p);
+   }
+ return !Clean.empty();
+}
+//---------------------------------------------------------------------------
+/* One line of text, as shown in the route label and kept in the cache file. */
+static bool CleanRoute(std::string &Route)
+{
+ for (size_t i = 0; i < Route.size(); i++)
+   if ((unsigned char)Route[i]<' ') Route[i]=' ';
+ size_t First=Route.find_first_not_of(' ');
+ if (First==std::string::npos) return false;
+ Route=Route.substr(First,Route.find_last_not_of(' ')-First+1);
+ return Route.size()<=RR_MAX_ROUTE;
+}
+//---------------------------------------------------------------------------
+TRouteResolver::TRouteResolver(TRouteFetch Fetch, const char *CacheFile, unsigned Workers,
+							   int64_t TTLSec, int64_t NegativeTTLSec, int64_t RetrySec)
+  : Fetch(Fetch), CacheFile(CacheFile ? CacheFile : ""), TTL(TTLSec),
+	NegativeTTL(NegativeTTLSec), Retry(RetrySec), Fetches(0), Dirty(false), Stop(false)
+{
+ if (!this->CacheFile.empty()) Load();
+ if (Workers==0) Workers=1;
+ for (unsigned i = 0; i < Workers; i++)
+   this->Workers.push_back(std::thread(&TRouteResolver::Run,this));
+}
+//---------------------------------------------------------------------------
+TRouteResolver::~TRouteResolver()
+{
+ {
+  std::lock_guard<std::mutex> Guard(Lock);
+  Stop=true;
+  Queue.clear();
+ }
+ Wake.notify_all();
+ for (size_t i = 0; i < Workers.size(); i++) Workers[i].join();
+ Save();
+}
+//---------------------------------------------------------------------------
+TRouteState TRouteResolver::Lookup(const char *Callsign, char *Route, size_t RouteSize)
+{
+ std::string Key;
+
+ if (!CleanCallsign(Callsign,Key)) return ROUTE_UNKNOWN;
+
+ std::unique_lock<std::mutex> Guard(Lock);
+ std::unordered_map<std::string,TEntry>::iterator it=Entries.find(Key);
+
+ if (it!=Entries.end() && (it->second.State==ROUTE_PENDING || it->second.Expires>Now()))
+   {
+	const TEntry &Entry=it->second;
+	if (Entry.State!=ROUTE_KNOWN) return Entry.State;
+	if (Entry.Route.size()>=RouteSize) return ROUTE_UNKNOWN;
+	memcpy(Route,Entry.Route.c_str(),Entry.Route.size()+1);
+	return ROUTE_KNOWN;
+   }
+ if (Stop) return ROUTE_UNKNOWN;
+
+ TEntry &Entry=Entries[Key];
+ Entry.State=ROUTE_PENDING;
+ Entry.Expires=0;
+ Entry.Failed=false;
+ Entry.Route.clear();
+ Queue.push_back(Key);
+ Guard.unlock();
+ Wake.notify_one();
+ return ROUTE_PENDING;
+}
+//---------------------------------------------------------------------------
+void TRouteResolver::Run(void)
+{
+ std::unique_lock<std::mutex> Guard(Lock);
+
+ for (;;)
+   {
+	Wake.wait(Guard,[this] { return Stop || !Queue.empty(); });
+	if (Stop) return;
+
+	std::string Callsign=Queue.front();
+	std::string Route;
+	Queue.pop_front();
+	Fetches++;
+	Guard.unlock();
+	TRouteFetchResult Result;
+	try
+	  {
+	   Result=Fetch(Callsign,Route);
+	  }
+	catch (...)
+	  {
+	   Result=RF_ERROR;
+	  }
+	if (Result==RF_FOUND && !CleanRoute(Route)) Result=RF_NOT_FOUND;
+	Guard.lock();
+
+	TEntry &Entry=Entries[Callsign];
+	Entry.Failed=Result==RF_ERROR;
+	switch (Result)
+	  {
+	   case RF_FOUND:
+		   Entry.State=ROUTE_KNOWN;
+		   Entry.Expires=Now()+TTL;
+		   Entry.Route=Route;
+		   break;
+	   case RF_NOT_FOUND:
+		   Entry.State=ROUTE_UNKNOWN;
+		   Entry.Expires=Now()+NegativeTTL;
+		   break;
+	   default:
+		   Entry.State=ROUTE_UNKNOWN;
+		   Entry.Expires=Now()+Retry;
+		   break;
+	  }
+	if (!Entry.Failed) Dirty=true;
+   }
+}
+//---------------------------------------------------------------------------
+/*
+ * The cache file is RR_MAGIC on the first line, then one line per callsign:
+ * the callsign, a tab, the expiry (Unix time), a tab and the route, which is
+ * empty for callsigns without one.
+ */
+void TRouteResolver::Load(void)
+{
+ FILE    *File=fopen(CacheFile.c_str(),"r");
+ char     Line[RR_MAX_ROUTE+64];
+ int64_t  Time=Now();
+ unsigned Count=0;
+
+ if (File==NULL) return;
+ if (fgets(Line,sizeof(Line),File)==NULL || strncmp(Line,RR_MAGIC,strlen(RR_MAGIC))!=0)
+   {
+	printf("RouteResolver: %s is not a route cache\n",CacheFile.c_str());
+	fclose(File);
+	return;
+   }
+ while (fgets(Line,sizeof(Line),File))
+   {
+	char *Tab1=strchr(Line,'\t');
+	char *Tab2=Tab1 ? strchr(Tab1+1,'\t') : NULL;
+	char *End=strchr(Line,'\n');
+	if (Tab2==NULL || End==NULL) continue;
+	*Tab1=0;
+	*End=0;
+
+	std::string Callsign;
+	int64_t     Expires=strtoll(Tab1+1,NULL,10);
+	if (!CleanCallsign(Line,Callsign) || Expires<=Time) continue;
+
+	TEntry &Entry=Entries[Callsign];
+	Entry.Route=Tab2+1;
+	Entry.State=Entry.Route.empty() ? ROUTE_UNKNOWN : ROUTE_KNOWN;
+	Entry.Expires=Expires;
+	Entry.Failed=false;
+	Count++;
+   }
+ fclose(File);
+ printf("RouteResolver: %u cached routes\n",Count);
+}
+//---------------------------------------------------------------------------
+bool TRouteResolver::Save(void)
+{
+ std::string Text;
+ std::string TempName=CacheFile+".tmp";
+ FILE       *File;
+ bool        Ok;
+
+ if (CacheFile.empty()) return false;
+ {
+  std::lock_guard<std::mutex> Guard(Lock);
+  int64_t                     Time=Now();
+  char                        Expires[32];
+
+  if (!Dirty) return true;
+  Text=RR_MAGIC "\n";
+  for (std::unordered_map<std::string,TEntry>::iterator it=Entries.begin(); it!=Entries.end(); )
+	{
+	 const TEntry &Entry=it->second;
+	 if (Entry.State!=ROUTE_PENDING && Entry.Expires<=Time)
+	   {
+		it=Entries.erase(it);
+		continue;
+	   }
+	 if (Entry.State!=ROUTE_PENDING && !Entry.Failed)
+	   {
+		snprintf(Expires,sizeof(Expires),"%lld",(long long)Entry.Expires);
+		Text+=it->first+"\t"+Expires+"\t"+Entry.Route+"\n";
+	   }
+	 ++it;
+	}
+  Dirty=false;
+ }
+
+ File=fopen(TempName.c_str(),"wb");
+ if (File==NULL)
+   {
+	printf("RouteResolver: cannot create %s\n",TempName.c_str());
+	std::lock_guard<std::mutex> Guard(Lock);
+	Dirty=true;
+	return false;
+   }
+ Ok=fwrite(Text.data(),1,Text.size(),File)==Text.size();
+ Ok=(fclose(File)==0) && Ok;
+ if (Ok)
+   {
+	remove(CacheFile.c_str());
+	Ok=rename(TempName.c_str(),CacheFile.c_str())==0;
+   }
+ if (!Ok)
+   {
+	printf("RouteResolver: cannot write %s\n",CacheFile.c_str());
+	remove(TempName.c_str());
+	std::lock_guard<std::mutex> Guard(Lock);
+	Dirty=true;
+   }
+ return Ok;
+}
+//---------------------------------------------------------------------------
+unsigned TRouteResolver::NumEntries(void)
+{
+ std::lock_guard<std::mutex> Guard(Lock);
+ return (unsigned)Entries.size();
+}
+//---------------------------------------------------------------------------
+unsigned TRouteResolver::NumFetches(void)
+{
+ std::lock_guard<std::mutex> Guard(Lock);
+ return Fetches;
+}
+//---------------------------------------------------------------------------
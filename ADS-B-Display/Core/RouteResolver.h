@@ -0,0 +1,108 @@
+//---------------------------------------------------------------------------
+
+#ifndef RouteResolverH
+#define RouteResolverH
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+//---------------------------------------------------------------------------
+#define RR_DEFAULT_WORKERS      2
+#define RR_DEFAULT_TTL_SEC      (7*24*3600)  /* Routes found. */
+#define RR_NEGATIVE_TTL_SEC     (6*3600)     /* Callsigns the service has no route for. */
+#define RR_RETRY_SEC            120          /* After a failed request; not kept on disk. */
+#define RR_MAX_CALLSIGN         8
+
+typedef enum
+{
+ RF_FOUND,
+ RF_NOT_FOUND,      /* The service answered that it has no route. */
+ RF_ERROR           /* No answer; asked again after the retry delay. */
+} TRouteFetchResult;
+
+/**
+ * Asks the route service for a callsign's route. Called on the resolver's
+ * worker threads, several at a time, so it must not touch the GUI.
+ */
+typedef std::function<TRouteFetchResult(const std::string &Callsign, std::string &Route)> TRouteFetch;
+
+typedef enum
+{
+ ROUTE_PENDING,     /* Being looked up; ask again later. */
+ ROUTE_KNOWN,
+ ROUTE_UNKNOWN      /* No route (or the lookup failed). */
+} TRouteState;
+
+/**
+ * Callsign to route lookups that never block the caller.
+ *
+ * Lookup() only consults the cache: a callsign seen for the first time (or
+ * whose entry has expired) is queued for the worker threads and reported
+ * pending, and the caller asks again on a later frame. Only one request per
+ * callsign is ever in flight however often it is asked for. Routes found
+ * are kept for the positive TTL and "no route" answers for the shorter
+ * negative TTL; failed requests are retried after RetrySec.
+ *
+ * The cache is kept in CacheFile (a text file, one callsign per line) so
+ * that routes survive restarts: it is read by the constructor and written
+ * by Save() and the destructor, dropping expired entries.
+ *
+ * The fetch function is the only thing that talks to the network, so the
+ * resolver can be driven by a stub.
+ */
+class TRouteResolver
+{
+public:
+  TRouteResolver(TRouteFetch Fetch, const char *CacheFile=NULL, unsigned Workers=RR_DEFAULT_WORKERS,
+				 int64_t TTLSec=RR_DEFAULT_TTL_SEC, int64_t NegativeTTLSec=RR_NEGATIVE_TTL_SEC,
+				 int64_t RetrySec=RR_RETRY_SEC);
+  /** Drops queued lookups, waits for those in flight and saves the cache. */
+  ~TRouteResolver();
+
+  /** Route is filled with ROUTE_KNOWN only. Callsigns are trimmed of spaces. */
+  TRouteState Lookup(const char *Callsign, char *Route, size_t RouteSize);
+  /** Write the cache file if anything changed. */
+  bool        Save(void);
+
+  unsigned    NumEntries(void);
+  /** Requests made to the fetch function. */
+  unsigned    NumFetches(void);
+
+private:
+  TRouteResolver(const TRouteResolver &);
+  TRouteResolver &operator=(const TRouteResolver &);
+
+  typedef struct
+  {
+   TRouteState State;
+   int64_t     Expires;        /* Unix time; 0 while pending */
+   bool        Failed;         /* Unknown because the request failed. */
+   std::string Route;
+  } TEntry;
+
+  void Run(void);
+  void Load(void);
+
+  TRouteFetch                            Fetch;
+  std::string                            CacheFile;
+  int64_t                                TTL;
+  int64_t                                NegativeTTL;
+  int64_t                                Retry;
+  std::mutex                             Lock;
+  std::condition_variable                Wake;
+  std::unordered_map<std::string,TEntry> Entries;
+  std::deque<std::string>                Queue;
+  std::vector<std::thread>               Workers;
+  unsigned                               Fetches;
+  bool                                   Dirty;
+  bool                                   Stop;
+};
+//---------------------------------------------------------------------------
+#endif
@@ -1,11 +1,21 @@
 //---------------------------------------------------------------------------
 
 #pragma hdrstop
-#include "DisplayGUI.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <time.h>
+#include <strings.h>
+#define stricmp strcasecmp
+#endif
 #include "Aircraft.h"
 #include "SBS_Message.h"
-#include "TimeFunctions.h"
-#include <math.h>
 
 //---------------------------------------------------------------------------
 #pragma package(smart_init)
@@ -14,34 +24,14 @@
 #define VALID_POS(pos)   (fabs(pos->Longitude) >= SMALL_VAL && fabs(pos->Longitude) < 180.0 && \
 						  fabs(pos->Latitude) >= SMALL_VAL && fabs(pos->Latitude) < 90.0)
 
-#define SBS_MESSAGE_TYPE      0
-#define SBS_TRANSMISSION_TYPE 1
-#define SBS_SESSION_ID        2
-#define SBS_AIRCRAFT_ID       3
-#define SBS_HEX_INDENT        4
-#define SBS_FLIGHT_ID         5
-#define SBS_DATE_GENERATED    6
-#define SBS_TIME_GENERATED    7
-#define SBS_DATE_LOGGED       8
-#define SBS_TIME_LOGGED       9
-#define SBS_CALLSIGN          10
-#define SBS_ALTITUDE          11
-#define SBS_GROUND_SPEED      12
-#define SBS_TRACK_HEADING     13
-#define SBS_LATITUDE          14
-#define SBS_LONGITUDE         15
-#define SBS_VERTICAL_RATE     16
-#define SBS_SQUAWK            17
-#define SBS_ALERT             18
-#define SBS_EMERGENCY         19
-#define SBS_SBI               20
-#define SBS_IS_ON_GROUND      21
-
-
+#ifdef _WIN32
 static char *strsep (char **stringp, const char *delim);
+#endif
 static  int hexDigitVal(int c);
 static const char *get_SBS_timestamp (void);
+#ifdef _WIN32
 static void get_FILETIME_now (FILETIME *ft);
+#endif
 static uint32_t aircraft_get_addr (uint8_t a0, uint8_t a1, uint8_t a2);
 //---------------------------------------------------------------------------
 static  int hexDigitVal(int c) {
@@ -51,6 +41,8 @@ static  int hexDigitVal(int c) {
     else return -1;
 }
 //---------------------------------------------------------------------------
+#ifdef _WIN32
+/* The C library has this everywhere else. */
 static char *strsep (char **stringp, const char *delim)
 {
   char *start = *stringp;
@@ -83,6 +75,7 @@ static char *strsep (char **stringp, const char *delim)
 
   return start;
 }
+#endif
 //---------------------------------------------------------------------------
 
 /**
@@ -94,6 +87,7 @@ static const char *get_SBS_timestamp (void)
   char        ts_buf [30];
   static char timestamp [2*sizeof(ts_buf)];
 
+#ifdef _WIN32
   FILETIME    ft;
   SYSTEMTIME  st;
 
@@ -101,6 +95,16 @@ static const char *get_SBS_timestamp (void)
   FileTimeToSystemTime (&ft, &st);
   ts_len = snprintf (ts_buf, sizeof(ts_buf), "%04u/%02u/%02u,%02u:%02u:%02u.%03u,",
                      st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
+#else
+  struct timeval tv;
+  struct tm      tm;
+
+  gettimeofday (&tv, NULL);
+  gmtime_r (&tv.tv_sec, &tm);
+  ts_len = snprintf (ts_buf, sizeof(ts_buf), "%04u/%02u/%02u,%02u:%02u:%02u.%03u,",
+                     tm.tm_year+1900, tm.tm_mon+1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                     (unsigned)(tv.tv_usec/1000));
+#endif
 
   /* Since the date,time,date,time is just a repeat, build the whole string once and
    * then add it to each MSG output.
@@ -111,10 +115,12 @@ static const char *get_SBS_timestamp (void)
   return (timestamp);
 }
 //---------------------------------------------------------------------------
+#ifdef _WIN32
 static void get_FILETIME_now (FILETIME *ft)
 {
   GetSystemTimePreciseAsFileTime (ft);
 }
+#endif
 //---------------------------------------------------------------------------
 /**
  * Convert 24-bit big-endian (network order) to host order format.
@@ -237,33 +243,35 @@ static void trimwhitespace(char *str)
   return ;
 }
 //---------------------------------------------------------------------------
-bool SBS_Message_Decode( char *msg)
+/**
+ * Decode one SBS (BaseStation) line and apply it to the matching aircraft in
+ * the context, creating the aircraft if needed. msg is modified in place.
+ * The aircraft's LastSeen is set to Ctx->CurrentTime.
+ *
+ * @return the updated aircraft, or NULL if msg is not a usable SBS MSG line
+ */
+TADS_B_Aircraft *SBS_Message_Decode(TADS_B_Context *Ctx, char *msg)
 {
-   bool  HaveSpeed=false;
-   bool  HaveHeading=false;
-   bool  HaveLat=false;
-   bool  HaveLon=false;
    TADS_B_Aircraft *ADS_B_Aircraft;
-   int FieldNumber=0;
    uint32_t addr=0;
-   __int64 CurrentTime=GetCurrentTimeInMsec();
+   bool     Moved=false;
 
-   char *SBS_Fields[22];
+   char *SBS_Fields[SBS_FIELD_COUNT];
    char FixHex[7];
 
-   for (int i = 0; i < 22; i++)
+   for (int i = 0; i < SBS_FIELD_COUNT; i++)
 	 {
 		SBS_Fields[i] = strsep(&msg, DELIMITER);
-		if (!msg && i < 21)
+		if (!msg && i < SBS_FIELD_COUNT-1)
 		  {
-			return(false);
+			return(NULL);
 		  }
 	 }
 
    if ((SBS_Fields[SBS_MESSAGE_TYPE]==0) || (stricmp(SBS_Fields[SBS_MESSAGE_TYPE],"MSG")!=0))
 	{
 	  printf("not a SBS MSG\n");
-	  return(false);
+	  return(NULL);
 	}
 
 	if ((SBS_Fields[SBS_HEX_INDENT]==0) || (strlen(SBS_Fields[SBS_HEX_INDENT]) < 6) || (strlen(SBS_Fields[SBS_HEX_INDENT]) > 7))  // icao must be 6 characters
@@ -271,7 +279,7 @@ bool SBS_Message_Decode( char *msg)
 		if ((SBS_Fields[SBS_HEX_INDENT]==0) || (strlen(SBS_Fields[SBS_HEX_INDENT]) > 7))
 		{
 		 printf("invalid ICAO 1 Field is %s\n",SBS_Fields[SBS_HEX_INDENT]);
-		 return(false);
+		 return(NULL);
 		}
 		else
 		{
@@ -299,7 +307,7 @@ bool SBS_Message_Decode( char *msg)
         if (high == -1 || low == -1)
 		  {
            printf("invalid ICAO 2\n");
-           return(false);
+           return(NULL);
           }
 
          chars[2 - j / 2] = (high << 4) | low;
@@ -307,32 +315,9 @@ bool SBS_Message_Decode( char *msg)
      //printf("%06X\n",(int)addr);
      if (non_icao) addr |= MODES_NON_ICAO_ADDRESS;
 
-     ADS_B_Aircraft =(TADS_B_Aircraft *) ght_get(Form1->HashTable,sizeof(addr),&addr);
-     if (ADS_B_Aircraft==NULL)
-        {
-         ADS_B_Aircraft= new TADS_B_Aircraft;
-         ADS_B_Aircraft->ICAO=addr;
-         snprintf(ADS_B_Aircraft->HexAddr,sizeof(ADS_B_Aircraft->HexAddr),"%06X",(int)addr);
-         ADS_B_Aircraft->NumMessagesSBS=0;
-         ADS_B_Aircraft->NumMessagesRaw=0;
-         ADS_B_Aircraft->VerticalRate=0;
-         ADS_B_Aircraft->HaveAltitude=false;
-         ADS_B_Aircraft->HaveLatLon=false;
-         ADS_B_Aircraft->HaveSpeedAndHeading=false;
-         ADS_B_Aircraft->HaveFlightNum=false;
-         ADS_B_Aircraft->HaveRoute=false;
-         ADS_B_Aircraft->RequestedRoute=false;
-         ADS_B_Aircraft->Route[0]=NULL;
-         ADS_B_Aircraft->SpriteImage=Form1->CurrentSpriteImage;
-         if (Form1->CycleImages->Checked)
-              Form1->CurrentSpriteImage=(Form1->CurrentSpriteImage+1)%Form1->NumSpriteImages;
-		 if (ght_insert(Form1->HashTable,ADS_B_Aircraft,sizeof(addr), &addr) < 0)
-             {
-			  printf("ght_insert Error-Should Not Happen");
-             }
-        }
-
-      ADS_B_Aircraft->LastSeen =CurrentTime;
+     ADS_B_Aircraft=FindOrAddAircraft(Ctx,addr);
+
+      ADS_B_Aircraft->LastSeen =Ctx->CurrentTime;
       ADS_B_Aircraft->NumMessagesSBS++;
 
 	  if ((SBS_Fields[SBS_CALLSIGN]) && strlen(SBS_Fields[SBS_CALLSIGN]) > 0)
@@ -365,6 +350,7 @@ bool SBS_Message_Decode( char *msg)
 			  {
 			   ADS_B_Aircraft->HaveAltitude=true;
 			   ADS_B_Aircraft->Altitude=tmp;
+			   Moved=true;
 			  }
 		 }
 	  if ((SBS_Fields[SBS_GROUND_SPEED]) && strlen(SBS_Fields[SBS_GROUND_SPEED]) > 0)
@@ -375,6 +361,7 @@ bool SBS_Message_Decode( char *msg)
 		  if (endptr != SBS_Fields[SBS_GROUND_SPEED] && isfinite(tmp))
 			  {
 			   ADS_B_Aircraft->Speed=tmp;
+			   Moved=true;
 			  }
 		 }
 	  if ((SBS_Fields[SBS_TRACK_HEADING]) && strlen(SBS_Fields[SBS_TRACK_HEADING]) > 0)
@@ -386,6 +373,7 @@ bool SBS_Message_Decode( char *msg)
 			  {
 			   ADS_B_Aircraft->Heading=tmp;
 			   ADS_B_Aircraft->HaveSpeedAndHeading=true;
+			   Moved=true;
 			  }
 		 }
 	  if (SBS_Fields[SBS_LATITUDE]  && (strlen(SBS_Fields[SBS_LATITUDE]) > 0) &&
@@ -399,12 +387,13 @@ bool SBS_Message_Decode( char *msg)
                 TempLon=strtod(SBS_Fields[SBS_LONGITUDE], &endptr);
                 if (endptr != SBS_Fields[SBS_LONGITUDE] && isfinite(TempLon))
                 {
-                  if ((ADS_B_Aircraft->Latitude< 90.0) && (ADS_B_Aircraft->Latitude>=-90.0) &&
-                      (ADS_B_Aircraft->Longitude>= -180.0) && (ADS_B_Aircraft->Longitude<=180.0))
+                  if ((TempLat< 90.0) && (TempLat>=-90.0) &&
+                      (TempLon>= -180.0) && (TempLon<=180.0))
                   {
                    ADS_B_Aircraft->Latitude=TempLat;
                    ADS_B_Aircraft->Longitude=TempLon;
                    ADS_B_Aircraft->HaveLatLon=true;
+                   Moved=true;
                   }
 
                 }
@@ -421,6 +410,11 @@ bool SBS_Message_Decode( char *msg)
 			   ADS_B_Aircraft->VerticalRate=tmp;
 			  }
 		  }
-  return(true);
+  if (Moved)
+	{
+	 UpdateAircraftKinematics(ADS_B_Aircraft);
+	 if (Ctx->OnAircraftUpdate) Ctx->OnAircraftUpdate(Ctx,ADS_B_Aircraft);
+	}
+  return(ADS_B_Aircraft);
 }
 //---------------------------------------------------------------------------
@@ -0,0 +1,36 @@
+//---------------------------------------------------------------------------
+
+#ifndef SBS_MessageH
+#define SBS_MessageH
+#include "Aircraft.h"
+#define MODES_MAX_SBS_SIZE          256
+
+/* Field positions in an SBS (BaseStation) line. */
+#define SBS_MESSAGE_TYPE      0
+#define SBS_TRANSMISSION_TYPE 1
+#define SBS_SESSION_ID        2
+#define SBS_AIRCRAFT_ID       3
+#define SBS_HEX_INDENT        4
+#define SBS_FLIGHT_ID         5
+#define SBS_DATE_GENERATED    6
+#define SBS_TIME_GENERATED    7
+#define SBS_DATE_LOGGED       8
+#define SBS_TIME_LOGGED       9
+#define SBS_CALLSIGN          10
+#define SBS_ALTITUDE          11
+#define SBS_GROUND_SPEED      12
+#define SBS_TRACK_HEADING     13
+#define SBS_LATITUDE          14
+#define SBS_LONGITUDE         15
+#define SBS_VERTICAL_RATE     16
+#define SBS_SQUAWK            17
+#define SBS_ALERT             18
+#define SBS_EMERGENCY         19
+#define SBS_SBI               20
+#define SBS_IS_ON_GROUND      21
+#define SBS_FIELD_COUNT       22
+
+bool ModeS_Build_SBS_Message (const modeS_message *mm, TADS_B_Aircraft *a, char *msg);
+TADS_B_Aircraft *SBS_Message_Decode(TADS_B_Context *Ctx, char *msg);
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,345 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "TileArchive.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+#define TA_DATA_MAGIC       "ADSBTIL1"
+#define TA_INDEX_MAGIC      "ADSBTIX1"
+#define TA_RECORD_MAGIC     0x43455254u     /* "TREC" */
+
+static uint64_t FileSize(FILE *File);
+static bool     EntryLess(const TTileIndexEntry &a, const TTileIndexEntry &b);
+static bool     ReadAt(FILE *File, uint64_t Offset, char *Data, uint32_t Size);
+//---------------------------------------------------------------------------
+static uint64_t FileSize(FILE *File)
+{
+#ifdef _WIN32
+ _fseeki64(File,0,SEEK_END);
+ return (uint64_t)_ftelli64(File);
+#else
+ fseeko(File,0,SEEK_END);
+ return (uint64_t)ftello(File);
+#endif
+}
+//---------------------------------------------------------------------------
+static bool ReadAt(FILE *File, uint64_t Offset, char *Data, uint32_t Size)
+{
+#ifdef _WIN32
+ if (_fseeki64(File,(__int64)Offset,SEEK_SET)!=0) return false;
+#else
+ if (fseeko(File,(off_t)Offset,SEEK_SET)!=0) return false;
+#endif
+ return fread(Data,1,Size,File)==Size;
+}
+//---------------------------------------------------------------------------
+static bool EntryLess(const TTileIndexEntry &a, const TTileIndexEntry &b)
+{
+ return a.Key<b.Key;
+}
+//---------------------------------------------------------------------------
+uint64_t TileArchiveKey(int x, int y, int level, int type)
+{
+ if (level<0 || level>TA_MAX_LEVEL || type<=0 || type>255) return 0;
+ if (x<0 || y<0 || x>=(1<<level) || y>=(1<<level)) return 0;
+ return ((uint64_t)type<<56)|((uint64_t)level<<48)|((uint64_t)x<<24)|(uint64_t)y;
+}
+//---------------------------------------------------------------------------
+TTileArchive::TTileArchive() : Appender(NULL), Size(0), Entries(NULL), NumEntries(0), Reader(NULL)
+{
+}
+//---------------------------------------------------------------------------
+TTileArchive::~TTileArchive()
+{
+ Close();
+}
+//---------------------------------------------------------------------------
+bool TTileArchive::Open(const char *Directory)
+{
+ std::string     Dir(Directory);
+ TTileDataHeader Header;
+
+ Close();
+ if (!Dir.empty() && Dir[Dir.size()-1]!='/' && Dir[Dir.size()-1]!='\\') Dir+='/';
+ DataName=Dir+TA_DATA_FILE;
+ IndexName=Dir+TA_INDEX_FILE;
+
+ std::lock_guard<std::mutex> Guard(Lock);
+ Appender=fopen(DataName.c_str(),"ab");
+ if (Appender==NULL)
+   {
+	printf("TileArchive: cannot open %s\n",DataName.c_str());
+	return false;
+   }
+ Size=FileSize(Appender);
+ if (Size==0)
+   {
+	memset(&Header,0,sizeof(Header));
+	memcpy(Header.Magic,TA_DATA_MAGIC,sizeof(Header.Magic));
+	if (fwrite(&Header,sizeof(Header),1,Appender)!=1 || fflush(Appender)!=0)
+	  {
+	   printf("TileArchive: cannot write %s\n",DataName.c_str());
+	   fclose(Appender);
+	   Appender=NULL;
+	   return false;
+	  }
+	Size=sizeof(Header);
+   }
+
+ Reader=fopen(DataName.c_str(),"rb");
+ if (Reader==NULL || !Map.Open(DataName.c_str()) || Map.Size()<sizeof(TTileDataHeader) ||
+	 memcmp(Map.Data(),TA_DATA_MAGIC,sizeof(Header.Magic))!=0)
+   {
+	printf("TileArchive: %s is not a tile archive\n",DataName.c_str());
+	fclose(Appender);
+	Appender=NULL;
+	if (Reader) fclose(Reader);
+	Reader=NULL;
+	Map.Close();
+	return false;
+   }
+
+ if (!OpenIndex(Size))
+   {
+	Index.Close();
+	Entries=NULL;
+	NumEntries=0;
+	Recover(sizeof(TTileDataHeader));
+   }
+ else Recover(((const TTileIndexHeader *)Index.Data())->DataSize);
+ return true;
+}
+//---------------------------------------------------------------------------
+bool TTileArchive::OpenIndex(uint64_t FileSize)
+{
+ if (!Index.Open(IndexName.c_str()) || Index.Size()<sizeof(TTileIndexHeader)) return false;
+
+ const TTileIndexHeader *h=(const TTileIndexHeader *)Index.Data();
+ if (memcmp(h->Magic,TA_INDEX_MAGIC,sizeof(h->Magic))!=0 || h->DataSize>FileSize ||
+	 h->DataSize<sizeof(TTileDataHeader) ||
+	 Index.Size()!=sizeof(TTileIndexHeader)+(size_t)h->NumTiles*sizeof(TTileIndexEntry))
+   {
+	printf("TileArchive: ignoring index %s\n",IndexName.c_str());
+	return false;
+   }
+ Entries=(const TTileIndexEntry *)(h+1);
+ NumEntries=h->NumTiles;
+ return true;
+}
+//---------------------------------------------------------------------------
+/* Find tiles appended after the index was last written. */
+void TTileArchive::Recover(uint64_t From)
+{
+ const char *Data=(const char *)Map.Data();
+ uint64_t    End=Map.Size();
+ uint64_t    Offset=From;
+ unsigned    Count=0;
+
+ while (Offset+sizeof(TTileRecordHeader)<=End)
+   {
+	TTileRecordHeader r;
+	memcpy(&r,Data+Offset,sizeof(r));   /* records are not aligned */
+	if (r.Magic!=TA_RECORD_MAGIC || r.Size>End-Offset-sizeof(TTileRecordHeader)) break;
+	TLocation &Location=Added[r.Key];
+	Location.Offset=Offset+sizeof(TTileRecordHeader);
+	Location.Size=r.Size;
+	Offset=Location.Offset+r.Size;
+	Count++;
+   }
+ if (Offset!=End)
+   printf("TileArchive: %s has %llu bytes of unreadable records at %llu\n",DataName.c_str(),
+		  (unsigned long long)(End-Offset),(unsigned long long)Offset);
+ if (Count)
+   printf("TileArchive: %u tiles recovered past the index of %s\n",Count,DataName.c_str());
+}
+//---------------------------------------------------------------------------
+bool TTileArchive::Close(void)
+{
+ bool Ok=true;
+
+ std::lock_guard<std::mutex> Guard(Lock);
+ if (Appender==NULL) return true;
+ if (!Added.empty()) Ok=WriteIndex();
+ fclose(Appender);
+ Appender=NULL;
+ fclose(Reader);
+ Reader=NULL;
+ Index.Close();
+ Entries=NULL;
+ NumEntries=0;
+ Map.Close();
+ Added.clear();
+ Size=0;
+ return Ok;
+}
+//---------------------------------------------------------------------------
+bool TTileArchive::WriteIndex(void)
+{
+ std::vector<TTileIndexEntry> All;
+ TTileIndexHeader             Header;
+ std::string                  TempName=IndexName+".tmp";
+ FILE                        *File;
+ bool                         Ok;
+
+ All.reserve(NumEntries+Added.size());
+ for (uint32_t i = 0; i < NumEntries; i++)
+   if (Added.find(Entries[i].Key)==Added.end()) All.push_back(Entries[i]);
+ for (std::unordered_map<uint64_t,TLocation>::const_iterator it=Added.begin(); it!=Added.end(); ++it)
+   {
+	TTileIndexEntry e;
+	e.Key=it->first;
+	e.Offset=it->second.Offset;
+	e.Size=it->second.Size;
+	e.Reserved=0;
+	All.push_back(e);
+   }
+ std::sort(All.begin(),All.end(),EntryLess);
+
+ memset(&Header,0,sizeof(Header));
+ memcpy(Header.Magic,TA_INDEX_MAGIC,sizeof(Header.Magic));
+ Header.DataSize=Size;
+ Header.NumTiles=(uint32_t)All.size();
+
+ /* the old index stays mapped until now, and cannot be replaced while it is */
+ Index.Close();
+ Entries=NULL;
+ NumEntries=0;
+
+ File=fopen(TempName.c_str(),"wb");
+ if (File==NULL)
+   {
+	printf("TileArchive: cannot create %s\n",TempName.c_str());
+	return false;
+   }
+ Ok=fwrite(&Header,sizeof(Header),1,File)==1;
+ if (!All.empty()) Ok=Ok && fwrite(&All[0],sizeof(TTileIndexEntry),All.size(),File)==All.size();
+ Ok=(fclose(File)==0) && Ok;
+ if (Ok)
+   {
+	remove(IndexName.c_str());
+	Ok=rename(TempName.c_str(),IndexName.c_str())==0;
+   }
+ if (!Ok)
+   {
+	printf("TileArchive: cannot write %s\n",IndexName.c_str());
+	remove(TempName.c_str());
+   }
+ return Ok;
+}
+//---------------------------------------------------------------------------
+/* Where the tile is in the data file, from the tiles added or the index. */
+bool TTileArchive::Locate(uint64_t Key, TLocation &Location)
+{
+ if (Appender==NULL) return false;
+
+ std::unordered_map<uint64_t,TLocation>::const_iterator it=Added.find(Key);
+ if (it!=Added.end())
+   {
+	Location=it->second;
+	return true;
+   }
+
+ TTileIndexEntry Probe;
+ Probe.Key=Key;
+ const TTileIndexEntry *e=std::lower_bound(Entries,Entries+NumEntries,Probe,EntryLess);
+ if (e==Entries+NumEntries || e->Key!=Key) return false;
+ Location.Offset=e->Offset;
+ Location.Size=e->Size;
+ return true;
+}
+//---------------------------------------------------------------------------
+/*
+ * Copy a tile out of the mapping, or out of the file if it was added after
+ * the mapping was made. Once the file has doubled since, it is mapped again
+ * (which unmaps the old mapping), so remaps are few however many tiles are
+ * added and read back.
+ */
+bool TTileArchive::Read(const TLocation &Location, char *Data)
+{
+ uint64_t End=Location.Offset+Location.Size;
+
+ if (Map.Size()<End && Size>=2*(uint64_t)Map.Size() && !Map.Open(DataName.c_str()))
+   printf("TileArchive: cannot map %s\n",DataName.c_str());
+ if (Map.Size()>=End)
+   {
+	memcpy(Data,(const char *)Map.Data()+Location.Offset,Location.Size);
+	return true;
+   }
+ return ReadAt(Reader,Location.Offset,Data,Location.Size);
+}
+//---------------------------------------------------------------------------
+bool TTileArchive::Find(uint64_t Key, std::vector<char> &Data)
+{
+ TLocation Location;
+
+ std::lock_guard<std::mutex> Guard(Lock);
+ if (!Locate(Key,Location)) return false;
+ Data.resize(Location.Size);
+ if (Location.Size==0) return true;
+ if (!Read(Location,&Data[0]))
+   {
+	printf("TileArchive: cannot read %s\n",DataName.c_str());
+	Data.clear();
+	return false;
+   }
+ return true;
+}
+//---------------------------------------------------------------------------
+bool TTileArchive::Contains(uint64_t Key)
+{
+ TLocation Location;
+
+ std::lock_guard<std::mutex> Guard(Lock);
+ return Locate(Key,Location);
+}
+//---------------------------------------------------------------------------
+bool TTileArchive::Add(uint64_t Key, const void *Data, uint32_t Size)
+{
+ TTileRecordHeader Record;
+
+ std::lock_guard<std::mutex> Guard(Lock);
+ if (Appender==NULL || Key==0) return false;
+
+ Record.Magic=TA_RECORD_MAGIC;
+ Record.Size=Size;
+ Record.Key=Key;
+ if (fwrite(&Record,sizeof(Record),1,Appender)!=1 ||
+	 (Size>0 && fwrite(Data,1,Size,Appender)!=Size) || fflush(Appender)!=0)
+   {
+	/* whatever got written is skipped: the size is taken from the file again */
+	printf("TileArchive: cannot write %s\n",DataName.c_str());
+	this->Size=FileSize(Appender);
+	return false;
+   }
+
+ TLocation &Location=Added[Key];
+ Location.Offset=this->Size+sizeof(Record);
+ Location.Size=Size;
+ this->Size=Location.Offset+Size;
+ return true;
+}
+//---------------------------------------------------------------------------
+unsigned TTileArchive::NumTiles(void)
+{
+ std::lock_guard<std::mutex> Guard(Lock);
+ unsigned Count=NumEntries;
+
+ for (std::unordered_map<uint64_t,TLocation>::const_iterator it=Added.begin(); it!=Added.end(); ++it)
+   {
+	TTileIndexEntry Probe;
+	Probe.Key=it->first;
+	if (!std::binary_search(Entries,Entries+NumEntries,Probe,EntryLess)) Count++;
+   }
+ return Count;
+}
+//---------------------------------------------------------------------------
+uint64_t TTileArchive::DataSize(void)
+{
+ std::lock_guard<std::mutex> Guard(Lock);
+ return Size;
+}
+//---------------------------------------------------------------------------
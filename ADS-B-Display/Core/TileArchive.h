@@ -0,0 +1,134 @@
+//---------------------------------------------------------------------------
+
+#ifndef TileArchiveH
+#define TileArchiveH
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include "MappedFile.h"
+//---------------------------------------------------------------------------
+#define TA_DATA_FILE        "Tiles.dat"
+#define TA_INDEX_FILE       "Tiles.idx"
+#define TA_MAX_LEVEL        24
+
+/** Header of the data file, followed by the records. */
+typedef struct
+{
+ char     Magic[8];          /* "ADSBTIL1" */
+ uint64_t Reserved;
+} TTileDataHeader;
+
+/** One tile in the data file, followed by Size bytes (none for a null tile). */
+typedef struct
+{
+ uint32_t Magic;             /* TA_RECORD_MAGIC */
+ uint32_t Size;
+ uint64_t Key;
+} TTileRecordHeader;
+
+/** Header of the index file, followed by NumTiles entries sorted by key. */
+typedef struct
+{
+ char     Magic[8];          /* "ADSBTIX1" */
+ uint64_t DataSize;          /* Bytes of the data file the index covers. */
+ uint32_t NumTiles;
+ uint32_t Reserved;
+} TTileIndexHeader;
+
+typedef struct
+{
+ uint64_t Key;
+ uint64_t Offset;            /* Of the tile's bytes in the data file. */
+ uint32_t Size;
+ uint32_t Reserved;
+} TTileIndexEntry;
+
+/**
+ * Tile identity: the type and level in the top 16 bits, then the x and y
+ * coordinates (each below 2^level). @return 0 for an invalid tile
+ */
+uint64_t TileArchiveKey(int x, int y, int level, int type);
+
+/**
+ * Map tiles packed into two files in a directory, in place of a file per
+ * tile.
+ *
+ * TA_DATA_FILE holds the tiles one after another, each behind a small
+ * header naming it; tiles are only ever appended, and a tile stored again
+ * replaces the earlier copy. TA_INDEX_FILE holds the key, offset and size
+ * of every tile sorted by key, so Open() maps it and Find() is a binary
+ * search over the mapping followed by a copy out of the mapped data file:
+ * nothing is read at open.
+ *
+ * The data file is mapped once, as large as it is at Open(). Tiles added
+ * after that are read from the file, until it has grown to twice the mapped
+ * size and is mapped again in place of the old mapping, so an archive
+ * holds one mapping of its data file however many tiles are added.
+ *
+ * Tiles added since the index was written are kept in a table and the
+ * index is rewritten by Close(). If that never happened (the program
+ * stopped), Open() finds them again by walking the records past the part
+ * of the data file the index covers.
+ *
+ * All methods may be called from several threads.
+ */
+class TTileArchive
+{
+public:
+  TTileArchive();
+  ~TTileArchive();
+
+  /** Open the archive in Directory, creating it if there is none. */
+  bool     Open(const char *Directory);
+  /** Write the index if tiles were added, and close. @return false if it could not be written */
+  bool     Close(void);
+  bool     IsOpen(void) const { return Appender!=NULL; }
+
+  /**
+   * Look a tile up and copy it into Data, which is left empty for a tile
+   * stored as known not to exist.
+   */
+  bool     Find(uint64_t Key, std::vector<char> &Data);
+  /** @return true if the tile is stored. Reads nothing from the data file. */
+  bool     Contains(uint64_t Key);
+  /** Append a tile. Size 0 stores a null tile. */
+  bool     Add(uint64_t Key, const void *Data, uint32_t Size);
+
+  unsigned NumTiles(void);
+  /** Bytes in the data file. */
+  uint64_t DataSize(void);
+
+private:
+  TTileArchive(const TTileArchive &);
+  TTileArchive &operator=(const TTileArchive &);
+
+  typedef struct
+  {
+   uint64_t Offset;
+   uint32_t Size;
+  } TLocation;
+
+  bool     OpenIndex(uint64_t FileSize);
+  void     Recover(uint64_t From);
+  bool     Locate(uint64_t Key, TLocation &Location);
+  bool     Read(const TLocation &Location, char *Data);
+  bool     WriteIndex(void);
+
+  std::mutex                              Lock;
+  std::string                             DataName;
+  std::string                             IndexName;
+  FILE                                   *Appender;
+  uint64_t                                Size;
+  TMappedFile                             Index;
+  const TTileIndexEntry                  *Entries;
+  uint32_t                                NumEntries;
+  TMappedFile                             Map;        /* Of the data file, up to the size it had when mapped. */
+  FILE                                   *Reader;     /* Of the data file, for tiles past Map. */
+  std::unordered_map<uint64_t,TLocation>  Added;      /* Tiles the index does not have. */
+};
+//---------------------------------------------------------------------------
+#endif
@@ -3,24 +3,41 @@
 #pragma hdrstop
 #include <stdio.h>
 #include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <time.h>
+#endif
 #include "TimeFunctions.h"
 //---------------------------------------------------------------------------
 #pragma package(smart_init)
+
+#define MSEC_1601_TO_1970  11644473600000LL
 //---------------------------------------------------------------------------
-__int64   GetCurrentTimeInMsec(void)
+int64_t   GetCurrentTimeInMsec(void)
 {
+#ifdef _WIN32
   FILETIME FileTime;
   FILETIME LocalFileTime;
-  __int64  ReturnValue;
+  int64_t  ReturnValue;
 
   GetSystemTimeAsFileTime(&FileTime);
   FileTimeToLocalFileTime(&FileTime,&LocalFileTime);
-  memcpy(&ReturnValue,&LocalFileTime,sizeof(__int64));
+  memcpy(&ReturnValue,&LocalFileTime,sizeof(int64_t));
   ReturnValue/=10000;
   return(ReturnValue);
+#else
+  struct timeval tv;
+  struct tm      tm;
+
+  gettimeofday(&tv,NULL);
+  localtime_r(&tv.tv_sec,&tm);
+  return(((int64_t)tv.tv_sec+tm.tm_gmtoff)*1000+tv.tv_usec/1000+MSEC_1601_TO_1970);
+#endif
 }
 //---------------------------------------------------------------------------
-char * TimeToChar(__int64 hmsm)
+char * TimeToChar(int64_t hmsm)
 {
 char h,m,s;
 int ms;
@@ -0,0 +1,13 @@
+//---------------------------------------------------------------------------
+
+#ifndef TimeFunctionsH
+#define TimeFunctionsH
+#include <stdint.h>
+
+/* Local time in msec since 1601-01-01 (the Windows FILETIME epoch), the
+ * time base used by recordings and TADS_B_Aircraft::LastSeen.
+ */
+ int64_t   GetCurrentTimeInMsec(void);
+ char * TimeToChar(int64_t hmsm);
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,78 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdio.h>
+#include <chrono>
+#include "TrackRecorder.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+//---------------------------------------------------------------------------
+TTrackRecorder::TTrackRecorder()
+  : Dropped(0), StopRequested(false)
+{
+}
+//---------------------------------------------------------------------------
+TTrackRecorder::~TTrackRecorder()
+{
+ if (WriteThread.joinable())
+   {
+	{
+	 std::lock_guard<std::mutex> Lock(QueueMutex);
+	 StopRequested=true;
+	}
+	Wake.notify_one();
+	WriteThread.join();
+   }
+ Store.Close();
+ if (Dropped.load()>0)
+   printf("TrackRecorder: %llu positions dropped\n",(unsigned long long)Dropped.load());
+}
+//---------------------------------------------------------------------------
+bool TTrackRecorder::Open(const char *StoreDir, int64_t MaxAgeMs, uint64_t MaxBytes)
+{
+ if (WriteThread.joinable() || !Store.Open(StoreDir)) return false;
+ Store.SetRetention(MaxAgeMs,MaxBytes);
+ WriteThread=std::thread(&TTrackRecorder::Run,this);
+ return true;
+}
+//---------------------------------------------------------------------------
+bool TTrackRecorder::AppendAircraft(const TADS_B_Aircraft *a, int64_t Time)
+{
+ TTrackPoint Point;
+
+ if (!WriteThread.joinable() || !TrackPointFromAircraft(a,Time,Point)) return false;
+ {
+  std::lock_guard<std::mutex> Lock(QueueMutex);
+  if (Queue.size()<TR_MAX_QUEUED)
+	{
+	 Queue.push_back(Point);
+	 return true;
+	}
+ }
+ Dropped.fetch_add(1,std::memory_order_relaxed);
+ return false;
+}
+//---------------------------------------------------------------------------
+void TTrackRecorder::Run(void)
+{
+ std::vector<TTrackPoint> Batch;
+
+ for (;;)
+  {
+   bool Stopping;
+   {
+	std::unique_lock<std::mutex> Lock(QueueMutex);
+	Wake.wait_for(Lock,std::chrono::milliseconds(TR_WRITE_INTERVAL),[this]
+	  {
+	   return StopRequested;
+	  });
+	Stopping=StopRequested;
+	Batch.swap(Queue);
+   }
+   for (size_t i=0;i<Batch.size();i++) Store.AppendChanged(Batch[i]);
+   Batch.clear();
+   if (Stopping) break;
+  }
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,66 @@
+//---------------------------------------------------------------------------
+
+#ifndef TrackRecorderH
+#define TrackRecorderH
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "TrackStore.h"
+//---------------------------------------------------------------------------
+#define TR_DEFAULT_MAX_AGE_MS     (7LL*24*60*60*1000)  /* Keep a week of positions. */
+#define TR_DEFAULT_MAX_BYTES      (1024ULL*1024*1024)  /* Keep at most 1 GB of partitions. */
+#define TR_MAX_QUEUED             65536                /* Positions waiting for the writer. */
+#define TR_WRITE_INTERVAL         200                  /* Max time positions wait (msec). */
+
+/**
+ * Records aircraft positions in a TTrackStore without blocking its caller.
+ *
+ * AppendAircraft() copies the position into a queue and returns; a thread
+ * of the recorder's own appends the queue to the store, so sealing a
+ * partition (sorting it and writing its index) and deleting partitions past
+ * the retention limits never stall the display. If the writer falls behind
+ * by TR_MAX_QUEUED positions, new ones are dropped and counted.
+ */
+class TTrackRecorder
+{
+public:
+  TTrackRecorder();
+
+  /** Stores everything still queued and closes the store. */
+  ~TTrackRecorder();
+
+  /**
+   * Open the store in StoreDir, apply the retention limits (see
+   * TTrackStore::SetRetention) and start the writer thread.
+   */
+  bool Open(const char *StoreDir, int64_t MaxAgeMs=TR_DEFAULT_MAX_AGE_MS,
+			uint64_t MaxBytes=TR_DEFAULT_MAX_BYTES);
+
+  /**
+   * Queue the aircraft's position at Time if it has one.
+   * @return false if it has none or it was dropped.
+   */
+  bool AppendAircraft(const TADS_B_Aircraft *a, int64_t Time);
+
+  uint64_t PointsDropped(void) const { return Dropped.load(std::memory_order_relaxed); }
+
+private:
+  TTrackRecorder(const TTrackRecorder &);
+  TTrackRecorder &operator=(const TTrackRecorder &);
+
+  void Run(void);
+
+  TTrackStore              Store;             ///< Used by the writer thread only
+  std::vector<TTrackPoint> Queue;
+  std::atomic<uint64_t>    Dropped;
+  bool                     StopRequested;
+  std::mutex               QueueMutex;
+  std::condition_variable  Wake;
+  std::thread              WriteThread;
+};
+//---------------------------------------------------------------------------
+#endif
@@ -0,0 +1,623 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#define PATH_SEPARATOR '\\'
+#else
+#include <sys/stat.h>
+#include <dirent.h>
+#define PATH_SEPARATOR '/'
+#endif
+#include "TrackStore.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+#define TS_INDEX_MAGIC       "ADSBTIX1"
+#define TS_MAX_QUERY_CELLS   64          /* Geo cells looked up per box query and partition. */
+#define TS_WRITE_BUFFER      (64*1024)
+
+static uint32_t QuantizeLongitude(double Longitude);
+static uint32_t QuantizeLatitude(double Latitude);
+static uint32_t Spread16(uint32_t v);
+static uint32_t GeoKey(double Latitude, double Longitude);
+static bool EntryLess(const TTrackIndexEntry &a, const TTrackIndexEntry &b);
+static void MakePoint(const TADS_B_Aircraft *a, int64_t Time, TTrackPoint &p);
+static bool KeyLess(const TTrackIndexEntry &a, uint32_t Key);
+static bool WriteIndex(const std::string &FileName, const TTrackPoint *Points, uint32_t Count);
+static std::string JoinPath(const std::string &Dir, const std::string &Name);
+static bool MakeDir(const char *Dir);
+static bool FileExists(const std::string &FileName);
+static void ListFiles(const std::string &Dir, const char *Extension, std::vector<std::string> &Names);
+//---------------------------------------------------------------------------
+static uint32_t QuantizeLongitude(double Longitude)
+{
+ double v=(Longitude+180.0)*(65536.0/360.0);
+ if (v<0.0) return 0;
+ if (v>65535.0) return 65535;
+ return (uint32_t)v;
+}
+//---------------------------------------------------------------------------
+static uint32_t QuantizeLatitude(double Latitude)
+{
+ double v=(Latitude+90.0)*(65536.0/180.0);
+ if (v<0.0) return 0;
+ if (v>65535.0) return 65535;
+ return (uint32_t)v;
+}
+//---------------------------------------------------------------------------
+/**
+ * Spread the low 16 bits of v to the even bit positions.
+ */
+static uint32_t Spread16(uint32_t v)
+{
+ v&=0xFFFF;
+ v=(v|(v<<8)) & 0x00FF00FF;
+ v=(v|(v<<4)) & 0x0F0F0F0F;
+ v=(v|(v<<2)) & 0x33333333;
+ v=(v|(v<<1)) & 0x55555555;
+ return v;
+}
+//---------------------------------------------------------------------------
+/**
+ * Morton (Z order) code of a position: nearby positions mostly get nearby
+ * keys, and every aligned square of cells is one contiguous key range.
+ */
+static uint32_t GeoKey(double Latitude, double Longitude)
+{
+ return Spread16(QuantizeLongitude(Longitude)) | (Spread16(QuantizeLatitude(Latitude))<<1);
+}
+//---------------------------------------------------------------------------
+static bool EntryLess(const TTrackIndexEntry &a, const TTrackIndexEntry &b)
+{
+ if (a.Key!=b.Key) return a.Key<b.Key;
+ return a.Record<b.Record;
+}
+//---------------------------------------------------------------------------
+static void MakePoint(const TADS_B_Aircraft *a, int64_t Time, TTrackPoint &p)
+{
+ memset(&p,0,sizeof(p));
+ p.Time=Time;
+ p.Latitude=a->Latitude;
+ p.Longitude=a->Longitude;
+ p.ICAO=a->ICAO;
+ p.Altitude=(float)a->Altitude;
+ p.Speed=(float)a->Speed;
+ p.Heading=(float)a->Heading;
+ p.VerticalRate=(float)a->VerticalRate;
+ memset(p.FlightNum,' ',sizeof(p.FlightNum));
+ if (a->HaveFlightNum)
+   memcpy(p.FlightNum,a->FlightNum,strnlen(a->FlightNum,sizeof(p.FlightNum)));
+}
+//---------------------------------------------------------------------------
+static bool KeyLess(const TTrackIndexEntry &a, uint32_t Key)
+{
+ return a.Key<Key;
+}
+//---------------------------------------------------------------------------
+static bool WriteIndex(const std::string &FileName, const TTrackPoint *Points, uint32_t Count)
+{
+ std::vector<TTrackIndexEntry> ByICAO(Count),ByGeo(Count);
+ TTrackIndexHeader             Header;
+ std::string                   TempName=FileName+".tmp";
+ FILE                         *File;
+ bool                          Ok;
+
+ memset(&Header,0,sizeof(Header));
+ memcpy(Header.Magic,TS_INDEX_MAGIC,sizeof(Header.Magic));
+ Header.Count=Count;
+ for (uint32_t i=0;i<Count;i++)
+   {
+	const TTrackPoint &p=Points[i];
+	if (i==0 || p.Time<Header.MinTime) Header.MinTime=p.Time;
+	if (i==0 || p.Time>Header.MaxTime) Header.MaxTime=p.Time;
+	if (i==0 || p.Latitude<Header.MinLatitude) Header.MinLatitude=p.Latitude;
+	if (i==0 || p.Latitude>Header.MaxLatitude) Header.MaxLatitude=p.Latitude;
+	if (i==0 || p.Longitude<Header.MinLongitude) Header.MinLongitude=p.Longitude;
+	if (i==0 || p.Longitude>Header.MaxLongitude) Header.MaxLongitude=p.Longitude;
+	ByICAO[i].Key=p.ICAO;
+	ByICAO[i].Record=i;
+	ByGeo[i].Key=GeoKey(p.Latitude,p.Longitude);
+	ByGeo[i].Record=i;
+   }
+ std::sort(ByICAO.begin(),ByICAO.end(),EntryLess);
+ std::sort(ByGeo.begin(),ByGeo.end(),EntryLess);
+
+ File=fopen(TempName.c_str(),"wb");
+ if (File==NULL)
+   {
+	printf("TrackStore: cannot create %s\n",TempName.c_str());
+	return false;
+   }
+ Ok=fwrite(&Header,sizeof(Header),1,File)==1;
+ if (Count>0)
+   {
+	Ok=Ok && fwrite(&ByICAO[0],sizeof(TTrackIndexEntry),Count,File)==Count;
+	Ok=Ok && fwrite(&ByGeo[0],sizeof(TTrackIndexEntry),Count,File)==Count;
+   }
+ Ok=(fclose(File)==0) && Ok;
+ if (Ok)
+   {
+	remove(FileName.c_str());
+	Ok=rename(TempName.c_str(),FileName.c_str())==0;
+   }
+ if (!Ok)
+   {
+	printf("TrackStore: cannot write %s\n",FileName.c_str());
+	remove(TempName.c_str());
+   }
+ return Ok;
+}
+//---------------------------------------------------------------------------
+static std::string JoinPath(const std::string &Dir, const std::string &Name)
+{
+ if (Dir.empty()) return Name;
+ if (Dir[Dir.size()-1]=='/' || Dir[Dir.size()-1]=='\\') return Dir+Name;
+ return Dir+PATH_SEPARATOR+Name;
+}
+//---------------------------------------------------------------------------
+static bool DirExists(const char *Dir)
+{
+#ifdef _WIN32
+ DWORD Attributes=GetFileAttributesA(Dir);
+ return Attributes!=INVALID_FILE_ATTRIBUTES && (Attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+ struct stat st;
+ return stat(Dir,&st)==0 && S_ISDIR(st.st_mode);
+#endif
+}
+//---------------------------------------------------------------------------
+static bool MakeDir(const char *Dir)
+{
+#ifdef _WIN32
+ if (_mkdir(Dir)==0) return true;
+#else
+ if (mkdir(Dir,0755)==0) return true;
+#endif
+ return errno==EEXIST;
+}
+//---------------------------------------------------------------------------
+static bool FileExists(const std::string &FileName)
+{
+ FILE *f=fopen(FileName.c_str(),"rb");
+ if (f==NULL) return false;
+ fclose(f);
+ return true;
+}
+//---------------------------------------------------------------------------
+/**
+ * Names (without Extension) of the files in Dir ending in Extension, sorted.
+ */
+static void ListFiles(const std::string &Dir, const char *Extension, std::vector<std::string> &Names)
+{
+ size_t ExtLen=strlen(Extension);
+#ifdef _WIN32
+ WIN32_FIND_DATAA FindData;
+ HANDLE           Find=FindFirstFileA(JoinPath(Dir,std::string("*")+Extension).c_str(),&FindData);
+
+ if (Find!=INVALID_HANDLE_VALUE)
+   {
+	do
+	  {
+	   std::string Name=FindData.cFileName;
+	   if (Name.size()>ExtLen && Name.compare(Name.size()-ExtLen,ExtLen,Extension)==0)
+		 Names.push_back(Name.substr(0,Name.size()-ExtLen));
+	  }
+	while (FindNextFileA(Find,&FindData));
+	FindClose(Find);
+   }
+#else
+ DIR           *d=opendir(Dir.c_str());
+ struct dirent *e;
+
+ if (d!=NULL)
+   {
+	while ((e=readdir(d))!=NULL)
+	  {
+	   std::string Name=e->d_name;
+	   if (Name.size()>ExtLen && Name.compare(Name.size()-ExtLen,ExtLen,Extension)==0)
+		 Names.push_back(Name.substr(0,Name.size()-ExtLen));
+	  }
+	closedir(d);
+   }
+#endif
+ std::sort(Names.begin(),Names.end());
+}
+//---------------------------------------------------------------------------
+TTrackStore::TTrackStore(int64_t PartitionMs)
+  : PartitionMs(PartitionMs>0 ? PartitionMs : TS_DEFAULT_PARTITION_MS),
+	MaxAgeMs(TS_KEEP_ALL), MaxBytes(TS_KEEP_ALL), ReadOnly(false), Active(NULL), ActiveStart(0)
+{
+}
+//---------------------------------------------------------------------------
+TTrackStore::~TTrackStore()
+{
+ Close();
+}
+//---------------------------------------------------------------------------
+bool TTrackStore::Open(const char *StoreDir, bool ReadOnly)
+{
+ std::vector<std::string> Names;
+
+ Close();
+ if (ReadOnly ? !DirExists(StoreDir) : !MakeDir(StoreDir))
+   {
+	printf("TrackStore: cannot %s %s\n",ReadOnly ? "find" : "create",StoreDir);
+	return false;
+   }
+ Dir=StoreDir;
+ this->ReadOnly=ReadOnly;
+ /* The partition another process is writing has no index yet. */
+ ListFiles(Dir,ReadOnly ? TS_INDEX_EXTENSION : TS_DATA_EXTENSION,Names);
+ for (size_t i=0;i<Names.size();i++) OpenPartition(Names[i]);
+ std::stable_sort(Sealed.begin(),Sealed.end(),[](const TPartition *a, const TPartition *b)
+   {
+	return a->Header.MinTime<b->Header.MinTime;
+   });
+ Expire();
+ return true;
+}
+//---------------------------------------------------------------------------
+void TTrackStore::SetRetention(int64_t MaxAgeMs, uint64_t MaxBytes)
+{
+ this->MaxAgeMs=MaxAgeMs;
+ this->MaxBytes=MaxBytes;
+ Expire();
+}
+//---------------------------------------------------------------------------
+void TTrackStore::Close(void)
+{
+ SealActive();
+ for (size_t i=0;i<Sealed.size();i++) delete Sealed[i];
+ Sealed.clear();
+ LastPosition.clear();
+ Dir.clear();
+ ReadOnly=false;
+}
+//---------------------------------------------------------------------------
+/**
+ * Add a sealed partition, (re)building its index if it is missing or does
+ * not match the data file. A read-only store skips such a partition
+ * instead. Only the index header is kept.
+ */
+bool TTrackStore::OpenPartition(const std::string &Name)
+{
+ TPartition *p=new TPartition;
+ std::string DataName=JoinPath(Dir,Name+TS_DATA_EXTENSION);
+ std::string IndexName=JoinPath(Dir,Name+TS_INDEX_EXTENSION);
+ uint32_t    Count;
+
+ p->Name=Name;
+ if (!p->Data.Open(DataName.c_str()))
+   {
+	printf("TrackStore: cannot map %s\n",DataName.c_str());
+	delete p;
+	return false;
+   }
+ Count=(uint32_t)(p->Data.Size()/sizeof(TTrackPoint));
+ if (Count==0)
+   {
+	delete p;
+	if (!ReadOnly)
+	  {
+	   remove(DataName.c_str());
+	   remove(IndexName.c_str());
+	  }
+	return false;
+   }
+
+ bool Valid=p->Index.Open(IndexName.c_str()) &&
+			p->Index.Size()==sizeof(TTrackIndexHeader)+2*(size_t)Count*sizeof(TTrackIndexEntry) &&
+			memcmp(((const TTrackIndexHeader *)p->Index.Data())->Magic,TS_INDEX_MAGIC,8)==0 &&
+			((const TTrackIndexHeader *)p->Index.Data())->Count==Count;
+ if (!Valid && ReadOnly)
+   {
+	printf("TrackStore: %s does not match its index, skipped\n",DataName.c_str());
+	delete p;
+	return false;
+   }
+ if (!Valid)
+   {
+	p->Index.Close();
+	if (!WriteIndex(IndexName,(const TTrackPoint *)p->Data.Data(),Count) ||
+		!p->Index.Open(IndexName.c_str()))
+	  {
+	   delete p;
+	   return false;
+	  }
+   }
+ p->Header=*(const TTrackIndexHeader *)p->Index.Data();
+ p->Bytes=p->Data.Size()+p->Index.Size();
+ p->Data.Close();
+ p->Index.Close();
+ Sealed.push_back(p);
+ return true;
+}
+//---------------------------------------------------------------------------
+/**
+ * Map a sealed partition for a query, checking it still matches the header
+ * read when it was added.
+ */
+bool TTrackStore::MapPartition(TPartition *p)
+{
+ if (p->Data.IsOpen()) return true;
+ if (p->Data.Open(JoinPath(Dir,p->Name+TS_DATA_EXTENSION).c_str()) &&
+	 p->Index.Open(JoinPath(Dir,p->Name+TS_INDEX_EXTENSION).c_str()) &&
+	 p->Data.Size()>=(size_t)p->Header.Count*sizeof(TTrackPoint) &&
+	 p->Index.Size()==sizeof(TTrackIndexHeader)+2*(size_t)p->Header.Count*sizeof(TTrackIndexEntry))
+   return true;
+ printf("TrackStore: cannot map %s\n",p->Name.c_str());
+ p->Data.Close();
+ p->Index.Close();
+ return false;
+}
+//---------------------------------------------------------------------------
+void TTrackStore::UnmapPartitions(void)
+{
+ for (size_t i=0;i<Sealed.size();i++)
+   {
+	Sealed[i]->Data.Close();
+	Sealed[i]->Index.Close();
+   }
+}
+//---------------------------------------------------------------------------
+/**
+ * Apply the retention limits: delete the partitions older than MaxAgeMs
+ * before the newest position, then the oldest while over MaxBytes.
+ */
+void TTrackStore::Expire(void)
+{
+ int64_t  Newest=Active ? ActiveStart : INT64_MIN;
+ uint64_t Total=0;
+
+ if (ReadOnly || (MaxAgeMs==TS_KEEP_ALL && MaxBytes==TS_KEEP_ALL)) return;
+ for (size_t i=0;i<Sealed.size();i++)
+   {
+	if (Sealed[i]->Header.MaxTime>Newest) Newest=Sealed[i]->Header.MaxTime;
+	Total+=Sealed[i]->Bytes;
+   }
+
+ while (!Sealed.empty())
+   {
+	size_t Oldest=0;
+	for (size_t i=1;i<Sealed.size();i++)
+	  if (Sealed[i]->Header.MaxTime<Sealed[Oldest]->Header.MaxTime) Oldest=i;
+
+	TPartition *p=Sealed[Oldest];
+	if (!(MaxAgeMs!=TS_KEEP_ALL && p->Header.MaxTime<Newest-MaxAgeMs) &&
+		!(MaxBytes!=TS_KEEP_ALL && Total>MaxBytes)) break;
+
+	Sealed.erase(Sealed.begin()+Oldest);
+	Total-=p->Bytes;
+	remove(JoinPath(Dir,p->Name+TS_INDEX_EXTENSION).c_str());
+	remove(JoinPath(Dir,p->Name+TS_DATA_EXTENSION).c_str());
+	delete p;
+   }
+}
+//---------------------------------------------------------------------------
+bool TTrackStore::StartActive(int64_t Time)
+{
+ char Name[64];
+
+ ActiveStart=Time-(Time%PartitionMs);
+ for (unsigned Seq=0;;Seq++)
+   {
+	snprintf(Name,sizeof(Name),"P%lld_%u",(long long)ActiveStart,Seq);
+	if (!FileExists(JoinPath(Dir,std::string(Name)+TS_DATA_EXTENSION))) break;
+   }
+ ActiveName=Name;
+ Active=fopen(JoinPath(Dir,ActiveName+TS_DATA_EXTENSION).c_str(),"wb");
+ if (Active==NULL)
+   {
+	printf("TrackStore: cannot create %s\n",ActiveName.c_str());
+	return false;
+   }
+ setvbuf(Active,NULL,_IOFBF,TS_WRITE_BUFFER);
+ return true;
+}
+//---------------------------------------------------------------------------
+void TTrackStore::SealActive(void)
+{
+ if (Active==NULL) return;
+ fclose(Active);
+ Active=NULL;
+ OpenPartition(ActiveName);
+ ActivePoints.clear();
+ ActiveByICAO.clear();
+ /* Every partition starts each track with a full position. */
+ LastPosition.clear();
+ Expire();
+}
+//---------------------------------------------------------------------------
+bool TTrackStore::Append(const TTrackPoint &Point)
+{
+ if (Dir.empty() || ReadOnly) return false;
+ if (Active && (Point.Time<ActiveStart || Point.Time>=ActiveStart+PartitionMs)) SealActive();
+ if (Active==NULL && !StartActive(Point.Time)) return false;
+
+ fwrite(&Point,sizeof(Point),1,Active);
+ ActiveByICAO[Point.ICAO].push_back((uint32_t)ActivePoints.size());
+ ActivePoints.push_back(Point);
+ return true;
+}
+//---------------------------------------------------------------------------
+bool TTrackStore::AppendChanged(const TTrackPoint &Point)
+{
+ std::pair<std::unordered_map<uint32_t,TLastPosition>::iterator,bool> Ins=
+   LastPosition.insert(std::make_pair(Point.ICAO,TLastPosition()));
+ TLastPosition &Last=Ins.first->second;
+ if (!Ins.second && Last.Latitude==Point.Latitude && Last.Longitude==Point.Longitude &&
+	 Last.Altitude==Point.Altitude) return false;
+
+ if (!Append(Point)) return false;
+
+ /* Append() may have sealed the partition and cleared LastPosition. */
+ TLastPosition &Now=LastPosition[Point.ICAO];
+ Now.Latitude=Point.Latitude;
+ Now.Longitude=Point.Longitude;
+ Now.Altitude=Point.Altitude;
+ return true;
+}
+//---------------------------------------------------------------------------
+bool TTrackStore::AppendAircraft(const TADS_B_Aircraft *a, int64_t Time)
+{
+ TTrackPoint p;
+
+ if (!a->HaveLatLon) return false;
+ MakePoint(a,Time,p);
+ return AppendChanged(p);
+}
+//---------------------------------------------------------------------------
+bool TrackPointFromAircraft(const TADS_B_Aircraft *a, int64_t Time, TTrackPoint &Point)
+{
+ if (!a->HaveLatLon) return false;
+ MakePoint(a,Time,Point);
+ return true;
+}
+//---------------------------------------------------------------------------
+size_t TTrackStore::QueryICAO(uint32_t ICAO, int64_t t0, int64_t t1, std::vector<TTrackPoint> &Out)
+{
+ size_t First=Out.size();
+
+ for (size_t i=0;i<Sealed.size();i++)
+   {
+	TPartition *p=Sealed[i];
+	if (p->Header.MaxTime<t0 || p->Header.MinTime>t1) continue;
+	if (!MapPartition(p)) continue;
+
+	const TTrackIndexEntry *Entries=(const TTrackIndexEntry *)((const char *)p->Index.Data()+sizeof(TTrackIndexHeader));
+	const TTrackIndexEntry *End=Entries+p->Header.Count;
+	const TTrackPoint      *Points=(const TTrackPoint *)p->Data.Data();
+
+	for (const TTrackIndexEntry *e=std::lower_bound(Entries,End,ICAO,KeyLess);
+		 e!=End && e->Key==ICAO; e++)
+	  {
+	   const TTrackPoint &Point=Points[e->Record];
+	   if (Point.Time>=t0 && Point.Time<=t1) Out.push_back(Point);
+	  }
+   }
+
+ std::unordered_map<uint32_t,std::vector<uint32_t> >::const_iterator it=ActiveByICAO.find(ICAO);
+ if (it!=ActiveByICAO.end())
+   for (size_t i=0;i<it->second.size();i++)
+	 {
+	  const TTrackPoint &Point=ActivePoints[it->second[i]];
+	  if (Point.Time>=t0 && Point.Time<=t1) Out.push_back(Point);
+	 }
+ UnmapPartitions();
+
+ std::stable_sort(Out.begin()+First,Out.end(),
+				  [](const TTrackPoint &a, const TTrackPoint &b) { return a.Time<b.Time; });
+ return Out.size()-First;
+}
+//---------------------------------------------------------------------------
+size_t TTrackStore::QueryBox(double MinLatitude, double MinLongitude,
+							 double MaxLatitude, double MaxLongitude,
+							 int64_t t0, int64_t t1, std::vector<TTrackPoint> &Out)
+{
+ size_t First=Out.size();
+ double LonRanges[2][2];
+ int    NumRanges=1;
+
+ if (MinLatitude>MaxLatitude) return 0;
+ LonRanges[0][0]=MinLongitude;
+ LonRanges[0][1]=MaxLongitude;
+ if (MinLongitude>MaxLongitude)
+   {
+	LonRanges[0][1]=180.0;
+	LonRanges[1][0]=-180.0;
+	LonRanges[1][1]=MaxLongitude;
+	NumRanges=2;
+   }
+
+ for (int r=0;r<NumRanges;r++)
+   {
+	double   Lon0=LonRanges[r][0],Lon1=LonRanges[r][1];
+	uint32_t x0=QuantizeLongitude(Lon0),x1=QuantizeLongitude(Lon1);
+	uint32_t y0=QuantizeLatitude(MinLatitude),y1=QuantizeLatitude(MaxLatitude);
+
+	for (size_t i=0;i<Sealed.size();i++)
+	  {
+	   TPartition *p=Sealed[i];
+	   if (p->Header.MaxTime<t0 || p->Header.MinTime>t1) continue;
+	   if (p->Header.MaxLatitude<MinLatitude || p->Header.MinLatitude>MaxLatitude ||
+		   p->Header.MaxLongitude<Lon0 || p->Header.MinLongitude>Lon1) continue;
+	   if (!MapPartition(p)) continue;
+	   QuerySealedBox(p,x0,y0,x1,y1,MinLatitude,Lon0,MaxLatitude,Lon1,t0,t1,Out);
+	  }
+
+	for (size_t i=0;i<ActivePoints.size();i++)
+	  {
+	   const TTrackPoint &Point=ActivePoints[i];
+	   if (Point.Time>=t0 && Point.Time<=t1 &&
+		   Point.Latitude>=MinLatitude && Point.Latitude<=MaxLatitude &&
+		   Point.Longitude>=Lon0 && Point.Longitude<=Lon1) Out.push_back(Point);
+	  }
+   }
+ UnmapPartitions();
+
+ std::stable_sort(Out.begin()+First,Out.end(),[](const TTrackPoint &a, const TTrackPoint &b)
+   {
+	if (a.ICAO!=b.ICAO) return a.ICAO<b.ICAO;
+	return a.Time<b.Time;
+   });
+ return Out.size()-First;
+}
+//---------------------------------------------------------------------------
+/**
+ * Cover the quantized box with at most TS_MAX_QUERY_CELLS aligned squares,
+ * coarsening until it fits, and scan the geo index range of each square.
+ * Squares overlap the box only partly, so every record is still checked.
+ */
+void TTrackStore::QuerySealedBox(TPartition *p, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+								 double MinLatitude, double MinLongitude, double MaxLatitude,
+								 double MaxLongitude, int64_t t0, int64_t t1,
+								 std::vector<TTrackPoint> &Out)
+{
+ const TTrackIndexEntry *Entries=(const TTrackIndexEntry *)((const char *)p->Index.Data()+sizeof(TTrackIndexHeader))+p->Header.Count;
+ const TTrackIndexEntry *End=Entries+p->Header.Count;
+ const TTrackPoint      *Points=(const TTrackPoint *)p->Data.Data();
+ unsigned                Shift=0;
+
+ while (Shift<16 && (uint64_t)((x1>>Shift)-(x0>>Shift)+1)*((y1>>Shift)-(y0>>Shift)+1)>TS_MAX_QUERY_CELLS)
+   Shift++;
+
+ for (uint32_t cy=y0>>Shift;cy<=(y1>>Shift);cy++)
+   for (uint32_t cx=x0>>Shift;cx<=(x1>>Shift);cx++)
+	 {
+	  uint64_t Cell=Spread16(cx) | (Spread16(cy)<<1);
+	  uint64_t Low=Cell<<(2*Shift);
+	  uint64_t High=(Cell+1)<<(2*Shift);
+
+	  for (const TTrackIndexEntry *e=std::lower_bound(Entries,End,(uint32_t)Low,KeyLess);
+		   e!=End && e->Key<High; e++)
+		{
+		 const TTrackPoint &Point=Points[e->Record];
+		 if (Point.Time>=t0 && Point.Time<=t1 &&
+			 Point.Latitude>=MinLatitude && Point.Latitude<=MaxLatitude &&
+			 Point.Longitude>=MinLongitude && Point.Longitude<=MaxLongitude) Out.push_back(Point);
+		}
+	 }
+}
+//---------------------------------------------------------------------------
+uint64_t TTrackStore::NumPoints(void) const
+{
+ uint64_t n=ActivePoints.size();
+
+ for (size_t i=0;i<Sealed.size();i++) n+=Sealed[i]->Header.Count;
+ return n;
+}
+//---------------------------------------------------------------------------
+uint64_t TTrackStore::NumBytes(void) const
+{
+ uint64_t n=0;
+
+ for (size_t i=0;i<Sealed.size();i++) n+=Sealed[i]->Bytes;
+ return n;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,186 @@
+//---------------------------------------------------------------------------
+
+#ifndef TrackStoreH
+#define TrackStoreH
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "Aircraft.h"
+#include "MappedFile.h"
+//---------------------------------------------------------------------------
+#define TS_DEFAULT_PARTITION_MS   (15*60*1000)   /* Time covered by one partition. */
+#define TS_KEEP_ALL               0              /* No retention limit (SetRetention). */
+#define TS_DATA_EXTENSION         ".trk"
+#define TS_INDEX_EXTENSION        ".tix"
+
+/**
+ * One stored position. Times are msec on the same scale as
+ * TADS_B_Context::CurrentTime. 56 bytes, no padding.
+ */
+typedef struct
+{
+ int64_t  Time;
+ double   Latitude;
+ double   Longitude;
+ uint32_t ICAO;
+ float    Altitude;          /* Feet. */
+ float    Speed;             /* Knots. */
+ float    Heading;           /* Degrees. */
+ float    VerticalRate;      /* Feet per minute. */
+ char     FlightNum[8];      /* Space padded, not terminated. */
+ uint32_t Reserved;
+} TTrackPoint;
+
+/** Index entry: a key (ICAO address or geo cell) and the record it points at. */
+typedef struct
+{
+ uint32_t Key;
+ uint32_t Record;
+} TTrackIndexEntry;
+
+/** Header of a partition's index file, followed by the ICAO then the geo entries. */
+typedef struct
+{
+ char     Magic[8];          /* "ADSBTIX1" */
+ uint32_t Count;             /* Records in the data file when indexed. */
+ uint32_t Reserved;
+ int64_t  MinTime,MaxTime;
+ double   MinLatitude,MaxLatitude;
+ double   MinLongitude,MaxLongitude;
+} TTrackIndexHeader;
+
+/**
+ * Append-only local store of decoded positions for historical queries.
+ *
+ * Positions go into time partitions of PartitionMs each. The partition
+ * being written is held in memory and appended to <Dir>/P<start>_<n>.trk.
+ * When time moves past it the partition is sealed: an index file is written
+ * next to it holding the records sorted by ICAO address and by geo cell (a
+ * Morton code of the position quantized to 1/65536 of the globe per axis).
+ * Only the index header of a sealed partition is kept in memory; a query
+ * maps the partitions whose time and area overlap it, touches just the
+ * index ranges and records it needs, and unmaps them again. Partitions
+ * left without an index by a crash are indexed when the store is opened.
+ *
+ * The index is what marks a partition sealed: it is written (through a
+ * temporary file) only once the data file is complete. A store opened
+ * read-only, such as by a query tool while the display records into the
+ * same directory, opens only the partitions that have a matching index and
+ * never creates, writes or removes a file.
+ *
+ * With SetRetention(), the oldest sealed partitions are deleted when the
+ * store is opened and whenever a partition is sealed.
+ *
+ * Not thread safe; use one store from one thread (TTrackRecorder writes
+ * one from a thread of its own).
+ */
+class TTrackStore
+{
+public:
+  TTrackStore(int64_t PartitionMs=TS_DEFAULT_PARTITION_MS);
+  /** Seals the partition being written. */
+  ~TTrackStore();
+
+  /**
+   * Open (creating if needed) the store in Dir. With ReadOnly only the
+   * sealed partitions are opened and Append() fails. @return false on error.
+   */
+  bool Open(const char *Dir, bool ReadOnly=false);
+  void Close(void);
+  bool IsOpen(void) const { return !Dir.empty(); }
+
+  /**
+   * Delete sealed partitions whose positions are all more than MaxAgeMs
+   * older than the newest stored, then the oldest ones while the store
+   * holds more than MaxBytes. TS_KEEP_ALL turns a limit off.
+   */
+  void SetRetention(int64_t MaxAgeMs, uint64_t MaxBytes);
+
+  /** Store a position. Positions should arrive in roughly increasing time. */
+  bool Append(const TTrackPoint &Point);
+
+  /**
+   * Store the position if it (or the altitude) changed since the last
+   * position stored for the aircraft.
+   */
+  bool AppendChanged(const TTrackPoint &Point);
+
+  /**
+   * Store the aircraft's position at Time if it has one and it changed
+   * (see AppendChanged).
+   */
+  bool AppendAircraft(const TADS_B_Aircraft *a, int64_t Time);
+
+  /**
+   * Positions of ICAO between t0 and t1 (inclusive), appended to Out in
+   * time order. @return the number of positions found
+   */
+  size_t QueryICAO(uint32_t ICAO, int64_t t0, int64_t t1, std::vector<TTrackPoint> &Out);
+
+  /**
+   * Positions inside the box between t0 and t1 (inclusive), appended to
+   * Out ordered by aircraft then time, i.e. as tracks. MinLongitude may be
+   * greater than MaxLongitude for a box across the antimeridian.
+   * @return the number of positions found
+   */
+  size_t QueryBox(double MinLatitude, double MinLongitude,
+				  double MaxLatitude, double MaxLongitude,
+				  int64_t t0, int64_t t1, std::vector<TTrackPoint> &Out);
+
+  unsigned NumPartitions(void) const { return (unsigned)Sealed.size()+(Active ? 1 : 0); }
+  uint64_t NumPoints(void) const;
+  /** Bytes of the sealed partitions' files. */
+  uint64_t NumBytes(void) const;
+
+private:
+  TTrackStore(const TTrackStore &);
+  TTrackStore &operator=(const TTrackStore &);
+
+  struct TPartition
+  {
+   std::string        Name;
+   TTrackIndexHeader  Header;
+   uint64_t           Bytes;
+   TMappedFile        Data;     /* Mapped only during a query. */
+   TMappedFile        Index;
+  };
+  struct TLastPosition
+  {
+   double Latitude,Longitude,Altitude;
+  };
+
+  bool OpenPartition(const std::string &Name);
+  bool MapPartition(TPartition *p);
+  void UnmapPartitions(void);
+  void Expire(void);
+  bool StartActive(int64_t Time);
+  void SealActive(void);
+  void QuerySealedBox(TPartition *p, uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+					  double MinLatitude, double MinLongitude, double MaxLatitude,
+					  double MaxLongitude, int64_t t0, int64_t t1,
+					  std::vector<TTrackPoint> &Out);
+
+  std::string                                   Dir;
+  int64_t                                       PartitionMs;
+  int64_t                                       MaxAgeMs;
+  uint64_t                                      MaxBytes;
+  bool                                          ReadOnly;
+  std::vector<TPartition *>                     Sealed;
+
+  /* The partition being written. */
+  FILE                                         *Active;
+  std::string                                   ActiveName;
+  int64_t                                       ActiveStart;
+  std::vector<TTrackPoint>                      ActivePoints;
+  std::unordered_map<uint32_t,std::vector<uint32_t> > ActiveByICAO;
+
+  std::unordered_map<uint32_t,TLastPosition>    LastPosition;
+};
+
+/** Fill Point with the aircraft's position at Time. @return false if it has none */
+bool TrackPointFromAircraft(const TADS_B_Aircraft *a, int64_t Time, TTrackPoint &Point);
+//---------------------------------------------------------------------------
+#endif
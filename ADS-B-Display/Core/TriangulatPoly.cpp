@@ -0,0 +1,282 @@
+//---------------------------------------------------------------------------
+
+
+#pragma hdrstop
+
+#include "TriangulatPoly.h"
+#include <stdlib.h>
+#include <string.h>
+//---------------------------------------------------------------------------
+
+#pragma package(smart_init)
+static bool intersect( pfVec3* p,int n, int i1, int i2 );
+static bool ccw( double p1x, double p1y, double p2x, double p2y, double p3x, double p3y );
+static double cross2D(const pfVec3 a, const pfVec3 b, const pfVec3 c);
+
+#define EAR_CLIP            0
+#define EAR_DROP            1   /* Collinear: remove the vertex, no triangle. */
+#define EAR_NO              2
+
+/* State of one triangulatePoly() call. */
+typedef struct
+{
+ pfVec3       *Verts;
+ double        Sign;             /* +1 counterclockwise, -1 clockwise */
+ int          *Prev,*Next;
+ char         *Reflex;           /* Not strictly convex, and still in the polygon. */
+ int           NX,NY;
+ double        MinX,MinY,CellW,CellH;
+ int          *CellStart;        /* NX*NY+1 offsets into CellVerts. */
+ int          *CellVerts;        /* Reflex vertices, by cell. */
+} TEarState;
+
+static int  cellOf(double Offset, double Size, int Count);
+static bool isReflex(TEarState *st, int i);
+static int  earTest(TEarState *st, int a, int b, int c);
+//---------------------------------------------------------------------------
+static double cross2D(const pfVec3 a, const pfVec3 b, const pfVec3 c)
+{
+ return (b[0]-a[0])*(c[1]-a[1])-(b[1]-a[1])*(c[0]-a[0]);
+}
+//---------------------------------------------------------------------------
+static int cellOf(double Offset, double Size, int Count)
+{
+ int c=(int)(Offset/Size);
+ if (c<0) return 0;
+ if (c>=Count) return Count-1;
+ return c;
+}
+//---------------------------------------------------------------------------
+static bool isReflex(TEarState *st, int i)
+{
+ return st->Sign*cross2D(st->Verts[st->Prev[i]],st->Verts[i],st->Verts[st->Next[i]])<=0.0;
+}
+//---------------------------------------------------------------------------
+/*
+ * Can b, between a and c, be cut off? Only reflex vertices can lie inside
+ * the triangle of a convex vertex, so only those in the grid cells under
+ * the triangle's box are tested.
+ */
+static int earTest(TEarState *st, int a, int b, int c)
+{
+ double *pa=st->Verts[a],*pb=st->Verts[b],*pc=st->Verts[c];
+ double  Area=st->Sign*cross2D(pa,pb,pc);
+ double  MinX,MaxX,MinY,MaxY;
+ int     x0,x1,y0,y1;
+
+ if (Area==0.0) return EAR_DROP;
+ if (Area<0.0) return EAR_NO;
+
+ MinX=pa[0]<pb[0] ? (pa[0]<pc[0] ? pa[0] : pc[0]) : (pb[0]<pc[0] ? pb[0] : pc[0]);
+ MaxX=pa[0]>pb[0] ? (pa[0]>pc[0] ? pa[0] : pc[0]) : (pb[0]>pc[0] ? pb[0] : pc[0]);
+ MinY=pa[1]<pb[1] ? (pa[1]<pc[1] ? pa[1] : pc[1]) : (pb[1]<pc[1] ? pb[1] : pc[1]);
+ MaxY=pa[1]>pb[1] ? (pa[1]>pc[1] ? pa[1] : pc[1]) : (pb[1]>pc[1] ? pb[1] : pc[1]);
+ x0=cellOf(MinX-st->MinX,st->CellW,st->NX);
+ x1=cellOf(MaxX-st->MinX,st->CellW,st->NX);
+ y0=cellOf(MinY-st->MinY,st->CellH,st->NY);
+ y1=cellOf(MaxY-st->MinY,st->CellH,st->NY);
+
+ for (int y = y0; y <= y1; y++)
+   for (int x = x0; x <= x1; x++)
+	 {
+	  int Cell=y*st->NX+x;
+	  for (int k = st->CellStart[Cell]; k < st->CellStart[Cell+1]; k++)
+		{
+		 int     r=st->CellVerts[k];
+		 double *p=st->Verts[r];
+		 if (!st->Reflex[r] || r==a || r==b || r==c) continue;
+		 if (p[0]<MinX || p[0]>MaxX || p[1]<MinY || p[1]>MaxY) continue;
+		 /* A duplicate of a corner does not block the ear. */
+		 if ((p[0]==pa[0] && p[1]==pa[1]) || (p[0]==pb[0] && p[1]==pb[1]) ||
+			 (p[0]==pc[0] && p[1]==pc[1])) continue;
+		 if (st->Sign*cross2D(pa,pb,p)>=0.0 && st->Sign*cross2D(pb,pc,p)>=0.0 &&
+			 st->Sign*cross2D(pc,pa,p)>=0.0)
+		   return EAR_NO;
+		}
+	 }
+ return EAR_CLIP;
+}
+//---------------------------------------------------------------------------
+/*
+ * Triangulate a simple polygon, in either orientation, by ear clipping.
+ * The reflex vertices are binned into a grid of about one per cell, so
+ * checking an ear looks at a few vertices rather than all of them, and a
+ * reflex vertex that turns convex as its neighbours are cut off is simply
+ * skipped from then on. Collinear vertices are dropped without a triangle.
+ * A polygon that is not simple still terminates: when a full turn finds no
+ * ear, the current vertex is cut off anyway.
+ *
+ * Indices receives three vertex indices per triangle and must have room
+ * for 3*(NumVerts-2). Returns the number of triangles.
+ */
+long triangulatePoly(pfVec3 *Verts,int NumVerts, unsigned int *Indices)
+{
+ TEarState st;
+ double    Area=0.0,MaxX,MaxY;
+ long      NumTris=0;
+ int       NumReflex=0,Remaining,v,Stop;
+
+ if (NumVerts<3) return 0;
+
+ for (int i = 0; i < NumVerts; i++)
+   {
+	int j=(i+1)%NumVerts;
+	Area+=Verts[i][0]*Verts[j][1]-Verts[j][0]*Verts[i][1];
+   }
+ if (Area==0.0) return 0;
+
+ st.Verts=Verts;
+ st.Sign=Area>0.0 ? 1.0 : -1.0;
+ st.Prev=(int *)malloc(sizeof(int)*NumVerts);
+ st.Next=(int *)malloc(sizeof(int)*NumVerts);
+ st.Reflex=(char *)malloc(NumVerts);
+ st.MinX=MaxX=Verts[0][0];
+ st.MinY=MaxY=Verts[0][1];
+ for (int i = 0; i < NumVerts; i++)
+   {
+	st.Prev[i]=i ? i-1 : NumVerts-1;
+	st.Next[i]=i+1<NumVerts ? i+1 : 0;
+	if (Verts[i][0]<st.MinX) st.MinX=Verts[i][0];
+	if (Verts[i][0]>MaxX) MaxX=Verts[i][0];
+	if (Verts[i][1]<st.MinY) st.MinY=Verts[i][1];
+	if (Verts[i][1]>MaxY) MaxY=Verts[i][1];
+   }
+ for (int i = 0; i < NumVerts; i++)
+   {
+	st.Reflex[i]=isReflex(&st,i);
+	NumReflex+=st.Reflex[i];
+   }
+
+ st.NX=st.NY=1;
+ while (st.NX*st.NY<NumReflex && st.NX<256) st.NX++,st.NY++;
+ st.CellW=MaxX>st.MinX ? (MaxX-st.MinX)/st.NX : 1.0;
+ st.CellH=MaxY>st.MinY ? (MaxY-st.MinY)/st.NY : 1.0;
+ st.CellStart=(int *)calloc(st.NX*st.NY+1,sizeof(int));
+ st.CellVerts=(int *)malloc(sizeof(int)*(NumReflex+1));
+ for (int i = 0; i < NumVerts; i++)
+   if (st.Reflex[i])
+	 st.CellStart[cellOf(Verts[i][1]-st.MinY,st.CellH,st.NY)*st.NX+
+				  cellOf(Verts[i][0]-st.MinX,st.CellW,st.NX)+1]++;
+ for (int c = 0; c < st.NX*st.NY; c++) st.CellStart[c+1]+=st.CellStart[c];
+ {
+  int *Fill=(int *)malloc(sizeof(int)*st.NX*st.NY);
+  memcpy(Fill,st.CellStart,sizeof(int)*st.NX*st.NY);
+  for (int i = 0; i < NumVerts; i++)
+	if (st.Reflex[i])
+	  st.CellVerts[Fill[cellOf(Verts[i][1]-st.MinY,st.CellH,st.NY)*st.NX+
+						cellOf(Verts[i][0]-st.MinX,st.CellW,st.NX)]++]=i;
+  free(Fill);
+ }
+
+ Remaining=NumVerts;
+ v=0;
+ Stop=st.Prev[v];
+ while (Remaining>3)
+   {
+	int a=st.Prev[v],c=st.Next[v];
+	int Ear=earTest(&st,a,v,c);
+
+	if (Ear==EAR_NO && v!=Stop)
+	  {
+	   v=c;
+	   continue;
+	  }
+	/* An ear, a collinear vertex, or a full turn without an ear. */
+	if (Ear!=EAR_DROP)
+	  {
+	   Indices[3*NumTris]=a;
+	   Indices[3*NumTris+1]=v;
+	   Indices[3*NumTris+2]=c;
+	   NumTris++;
+	  }
+	st.Next[a]=c;
+	st.Prev[c]=a;
+	st.Reflex[v]=0;
+	Remaining--;
+	if (st.Reflex[a] && !isReflex(&st,a)) st.Reflex[a]=0;
+	if (st.Reflex[c] && !isReflex(&st,c)) st.Reflex[c]=0;
+	v=c;
+	Stop=a;
+   }
+ if (cross2D(Verts[st.Prev[v]],Verts[v],Verts[st.Next[v]])!=0.0)
+   {
+	Indices[3*NumTris]=st.Prev[v];
+	Indices[3*NumTris+1]=v;
+	Indices[3*NumTris+2]=st.Next[v];
+	NumTris++;
+   }
+
+ free(st.Prev);
+ free(st.Next);
+ free(st.Reflex);
+ free(st.CellStart);
+ free(st.CellVerts);
+ return NumTris;
+}
+
+// orientation2D_Polygon(): tests the orientation of a simple polygon
+//    Input:  int n = the number of vertices in the polygon
+//            Point* V = an array of n+1 vertices with V[n]=V[0]
+//    Return: >0 for counterclockwise 
+//            =0 for none (degenerate)
+//            <0 for clockwise
+//    Note: this algorithm is faster than computing the signed area.
+int orientation2D_Polygon( pfVec3* p,int n )
+{
+ int i,j,k;
+   int count = 0;
+   double z;
+
+   if (n < 3)
+      return(0);
+
+   for (i=0;i<n;i++) {
+      j = (i + 1) % n;
+      k = (i + 2) % n;
+	  z  = (p[j][0] - p[i][0]) * (p[k][1] - p[j][1]);
+	  z -= (p[j][1] - p[i][1]) * (p[k][0] - p[j][0]);
+      if (z < 0)
+         count--;
+      else if (z > 0)
+         count++;
+   }
+   if (count > 0)
+      return(COUNTERCLOCKWISE);
+   else if (count < 0)
+      return(CLOCKWISE);
+   else
+      return(0);
+}
+
+//---------------------------------------------------------------------------
+bool checkComplex( pfVec3* p,int n )
+{
+ int i = 0, j;
+ for( j = i + 2; j < n - 1; j++ )
+   if( intersect( p, n, i, j ) ) return true;
+   for( i = 1; i < n; i++ )
+	for( j = i + 2; j < n; j++ )
+	 if( intersect( p, n, i, j ) ) return true;
+ return false;
+}
+//---------------------------------------------------------------------------
+ static bool intersect( pfVec3* p,int n, int i1, int i2 )
+ {
+  int s1 = ( i1 > 0 ) ? i1 -1 : n - 1;
+  int s2 = ( i2 > 0 ) ? i2 -1 : n - 1;
+  return ccw( p[ s1 ][0], p[ s1 ][1], p[ i1 ][0], p[ i1 ][1], p[ s2 ][0], p[ s2 ][1] )
+	  != ccw( p[ s1 ][0], p[ s1 ][1], p[ i1 ][0], p[ i1 ][1], p[ i2 ][0], p[ i2 ][1] )
+	  && ccw( p[ s2 ][0], p[ s2 ][1], p[ i2 ][0], p[ i2 ][1], p[ s1 ][0], p[ s1 ][1] )
+	  != ccw( p[ s2 ][0], p[ s2 ][1], p[ i2 ][0], p[ i2 ][1], p[ i1 ][0], p[ i1 ][1] );
+ }
+//---------------------------------------------------------------------------
+static bool ccw( double p1x, double p1y, double p2x, double p2y, double p3x, double p3y )
+{
+  double dx1 = p2x - p1x;
+  double dy1 = p2y - p1y;
+  double dx2 = p3x - p2x;
+  double dy2 = p3y - p2y;
+  return dy1 * dx2 < dy2 * dx1;
+}
+//---------------------------------------------------------------------------
+
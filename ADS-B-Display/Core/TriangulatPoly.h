@@ -4,18 +4,14 @@
 #define TriangulatPolyH
 typedef double pfVec3[3];
 
-typedef struct _ttrianles {
-    long	*indexList;
-	struct _ttrianles *next;
-} TTriangles;
-
 
 #define CLOCKWISE 1
 #define COUNTERCLOCKWISE -1
 
 
 int  orientation2D_Polygon( pfVec3* V,int n );
-long triangulatePoly(pfVec3 *Verts,int NumVerts,  TTriangles **);
+/* Its output is kept in boundary caches: bump BC_VERSION when it changes. */
+long triangulatePoly(pfVec3 *Verts,int NumVerts, unsigned int *Indices);
 bool checkComplex(pfVec3* p,int n );
 
 //---------------------------------------------------------------------------
@@ -0,0 +1,132 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <algorithm>
+#include "VertexArena.h"
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+#define MIN_COMPACT_POINTS  4096    /* Smaller arrays are not worth squeezing. */
+
+TVertexArena::TVertexArena() : Used(0), Last(-1)
+{
+}
+//---------------------------------------------------------------------------
+int TVertexArena::Create(void)
+{
+ TSpan s;
+ int   Span;
+
+ s.First=Vertices.size()/3;
+ s.Count=0;
+ s.Active=true;
+ if (FreeSpans.empty())
+   {
+	Span=(int)Spans.size();
+	Spans.push_back(s);
+   }
+ else
+   {
+	Span=FreeSpans.back();
+	FreeSpans.pop_back();
+	Spans[Span]=s;
+   }
+ Last=Span;
+ return Span;
+}
+//---------------------------------------------------------------------------
+void TVertexArena::Append(int Span, double x, double y, double z)
+{
+ TSpan &s=Spans[Span];
+
+ if (Span!=Last)
+   {
+	/* Move it to the end; its old place becomes a hole. */
+	size_t First=Vertices.size()/3;
+	Vertices.resize(3*(First+s.Count));
+	std::copy(Vertices.begin()+3*s.First,Vertices.begin()+3*(s.First+s.Count),Vertices.begin()+3*First);
+	s.First=First;
+	Last=Span;
+   }
+ Vertices.push_back(x);
+ Vertices.push_back(y);
+ Vertices.push_back(z);
+ s.Count++;
+ Used++;
+}
+//---------------------------------------------------------------------------
+void TVertexArena::Append(int Span, const pfVec3 *Points, unsigned NumPoints)
+{
+ const double *Rest=(const double *)(Points+1);
+
+ if (NumPoints==0) return;
+ /* The first point moves the span to the end if needed. */
+ Append(Span,Points[0][0],Points[0][1],Points[0][2]);
+ Vertices.insert(Vertices.end(),Rest,Rest+3*(NumPoints-1));
+ Spans[Span].Count+=NumPoints-1;
+ Used+=NumPoints-1;
+}
+//---------------------------------------------------------------------------
+void TVertexArena::Reverse(int Span)
+{
+ pfVec3  *p=Points(Span);
+ unsigned n=Spans[Span].Count;
+
+ for (unsigned i = 0; i < n/2; i++)
+   for (int k = 0; k < 3; k++) std::swap(p[i][k],p[n-1-i][k]);
+}
+//---------------------------------------------------------------------------
+void TVertexArena::Release(int Span)
+{
+ TSpan &s=Spans[Span];
+
+ if (!s.Active) return;
+ Used-=s.Count;
+ if (Span==Last)
+   {
+	Vertices.resize(3*s.First);
+	Last=-1;
+   }
+ s.Active=false;
+ s.Count=0;
+ FreeSpans.push_back(Span);
+ if (Capacity()>MIN_COMPACT_POINTS && Capacity()>2*Used) Compact();
+}
+//---------------------------------------------------------------------------
+void TVertexArena::Clear(void)
+{
+ Vertices.clear();
+ Spans.clear();
+ FreeSpans.clear();
+ Used=0;
+ Last=-1;
+}
+//---------------------------------------------------------------------------
+pfVec3 *TVertexArena::Points(int Span)
+{
+ return (pfVec3 *)(Vertices.data()+3*Spans[Span].First);
+}
+//---------------------------------------------------------------------------
+/* Slide the spans down over the holes, keeping their order. */
+void TVertexArena::Compact(void)
+{
+ std::vector<std::pair<size_t,int> > Order;
+ size_t                              To=0;
+
+ for (size_t i = 0; i < Spans.size(); i++)
+   if (Spans[i].Active) Order.push_back(std::make_pair(Spans[i].First,(int)i));
+ std::sort(Order.begin(),Order.end());
+
+ for (size_t k = 0; k < Order.size(); k++)
+   {
+	TSpan &s=Spans[Order[k].second];
+	if (s.First!=To)
+	  std::copy(Vertices.begin()+3*s.First,Vertices.begin()+3*(s.First+s.Count),Vertices.begin()+3*To);
+	s.First=To;
+	To+=s.Count;
+   }
+ Vertices.resize(3*To);
+ Last=Order.empty() ? -1 : Order.back().second;
+ std::vector<double>(Vertices).swap(Vertices);
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,62 @@
+//---------------------------------------------------------------------------
+
+#ifndef VertexArenaH
+#define VertexArenaH
+
+#include <stddef.h>
+#include <vector>
+#include "TriangulatPoly.h"
+//---------------------------------------------------------------------------
+/**
+ * The vertices of many polygons in one array.
+ *
+ * Each polygon is a span of the array, named by the handle Create()
+ * returns, and can hold any number of points. Points are added at the end
+ * of the array; adding to a span that is not the last one moves it there
+ * first, so a polygon being built stays contiguous. Released spans leave
+ * holes that are squeezed out once they are more than half of the array,
+ * so the memory used follows the geometry held.
+ *
+ * The pointer from Points() is valid until the next call that changes the
+ * arena.
+ */
+class TVertexArena
+{
+public:
+  TVertexArena();
+
+  /** @return the handle of a new, empty span */
+  int      Create(void);
+  void     Append(int Span, double x, double y, double z);
+  void     Append(int Span, const pfVec3 *Points, unsigned NumPoints);
+  /** Reverse the order of the span's points. */
+  void     Reverse(int Span);
+  void     Release(int Span);
+  /** Release every span. */
+  void     Clear(void);
+
+  pfVec3  *Points(int Span);
+  unsigned Count(int Span) const { return Spans[Span].Count; }
+
+  /** Points held, and the size of the array including holes. */
+  size_t   NumPoints(void) const { return Used; }
+  size_t   Capacity(void) const { return Vertices.size()/3; }
+
+private:
+  struct TSpan
+  {
+   size_t   First;              /* Index of its first point. */
+   unsigned Count;
+   bool     Active;
+  };
+
+  void Compact(void);
+
+  std::vector<double> Vertices;      /* x,y,z of each point. */
+  std::vector<TSpan>  Spans;
+  std::vector<int>    FreeSpans;     /* Released handles, reused by Create(). */
+  size_t              Used;
+  int                 Last;          /* Span at the end of the array, -1 if none. */
+};
+//---------------------------------------------------------------------------
+#endif
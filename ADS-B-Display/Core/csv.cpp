@@ -0,0 +1,784 @@
+//---------------------------------------------------------------------------
+
+#pragma hdrstop
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include "csv.h"
+#include "MappedFile.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define CSV_HAVE_SSE2
+#endif
+//---------------------------------------------------------------------------
+#pragma package(smart_init)
+
+
+/**
+ * The default size of a CSV_context::parse_buf.
+ */
+#define DEFAULT_BUF_SIZE 1000
+
+/**
+ * Macro for getting a character into the CSV_context::parse_buf.
+ */
+#define PUTC(c)  do {                                                    \
+                   if (ctx->parse_ptr < ctx->parse_buf + ctx->line_size) \
+                      *ctx->parse_ptr++ = c;                             \
+                 } while (0)
+
+/**
+ * A simple state-machine for parsing CSV records.
+ *
+ * The parser starts in this state.
+ */
+static void state_normal (struct CSV_context *ctx)
+{
+  if (ctx->c_in == ctx->delimiter)
+  {
+    ctx->state = STATE_STOP;
+    return;
+  }
+
+  switch (ctx->c_in)
+  {
+    case -1:
+         ctx->state = STATE_EOF;
+         break;
+    case '"':
+         ctx->state = STATE_QUOTED;
+         break;
+    case '\r':     /* ignore */
+         break;
+    case '\n':
+         if (ctx->field_num > 0)     /* If field == 0, ignore empty lines */
+            ctx->state = STATE_STOP;
+         break;
+    case '#':
+         if (ctx->field_num == 0)    /* If field == 0, ignore comment lines */
+              ctx->state = STATE_COMMENT;
+         else PUTC (ctx->c_in);
+         break;
+    default:
+         PUTC (ctx->c_in);
+         break;
+  }
+}
+
+/**
+ * If the parser find a quote (`"`) in `state_normal()`, it enters this state
+ * to find the end of the quote. Ignoring escaped quotes (i.e. a `\\"`).
+ */
+static void state_quoted (struct CSV_context *ctx)
+{
+  switch (ctx->c_in)
+  {
+    case -1:
+         ctx->state = STATE_EOF;
+         break;
+    case '"':
+         ctx->state = STATE_NORMAL;
+         break;
+    case '\r':     /* ignore, but should not occur since `fopen (file, "rt")` was used */
+         break;
+    case '\n':     /* add a space in this field */
+         PUTC (' ');
+         break;
+    case '\\':
+         ctx->state = STATE_ESCAPED;
+         break;
+    default:
+         PUTC (ctx->c_in);
+         break;
+  }
+}
+
+/**
+ * Look for an escaped quote. <br>
+ * Go back to `state_quoted()` when found.
+ */
+static void state_escaped (struct CSV_context *ctx)
+{
+  switch (ctx->c_in)
+  {
+    case -1:
+         ctx->state = STATE_EOF;
+         break;
+    case '"':       /* '\"' -> '"' */
+         PUTC ('"');
+         ctx->state = STATE_QUOTED;
+         break;
+    case '\r':
+    case '\n':
+         break;
+    default:
+         ctx->state = STATE_QUOTED; /* Unsupported ctrl-char. Go back */
+         break;
+  }
+}
+
+/**
+ * Do nothing until a newline. <br>
+ * Go back to `state_normal()` when found.
+ */
+static void state_comment (struct CSV_context *ctx)
+{
+  switch (ctx->c_in)
+  {
+    case -1:
+         ctx->state = STATE_EOF;
+         break;
+    case '\n':
+         ctx->state = STATE_NORMAL;
+         break;
+  }
+}
+
+static void state_illegal (struct CSV_context *ctx)
+{
+  ctx->state = STATE_EOF;
+}
+
+/**
+ * Read from `ctx->file` until end-of-field.
+ */
+static const char *CSV_get_next_field (struct CSV_context *ctx)
+{
+  char     *ret;
+  CSV_STATE new_state = STATE_ILLEGAL;
+
+  ctx->parse_ptr = ctx->parse_buf;
+
+  while (1)
+  {
+    ctx->c_in = fgetc (ctx->file);
+
+    (*ctx->state_func) (ctx);
+    new_state = ctx->state;
+
+    /* Set new state for this context. (Or stay in same state).
+     */
+    switch (new_state)
+    {
+      case STATE_NORMAL:
+           ctx->state_func = state_normal;
+           break;
+      case STATE_QUOTED:
+           ctx->state_func = state_quoted;
+           break;
+      case STATE_ESCAPED:
+           ctx->state_func = state_escaped;
+           break;
+      case STATE_COMMENT:
+           ctx->state_func = state_comment;
+           break;
+      case STATE_ILLEGAL:   /* Avoid compiler warning */
+      case STATE_STOP:
+      case STATE_EOF:
+           break;
+    }
+    if (new_state == STATE_STOP && ctx->delimiter == ' ')
+    {
+      while ((ctx->c_in = fgetc (ctx->file)) == ' ') ;
+      ungetc (ctx->c_in, ctx->file);
+    }
+
+    if (new_state == STATE_STOP || new_state == STATE_EOF)
+       break;
+  }
+
+  *ctx->parse_ptr = '\0';
+  ret = ctx->parse_buf;
+  if (new_state == STATE_EOF)
+     return (NULL);
+  return (ret);
+}
+
+/**
+ * Open and parse CSV file and extract one record by calling the callback for each found field.
+ *
+ * \param[in]  ctx  the CSV context to work with.
+ * \retval     the number of CSV-records that could be parsed.
+ */
+static int CSV_parse_file (struct CSV_context *ctx)
+{
+  for (ctx->field_num = 0; ctx->field_num < ctx->num_fields; ctx->field_num++)
+  {
+    const char *val;
+    int         rc;
+
+    ctx->state = STATE_NORMAL;
+    ctx->state_func = state_normal;
+
+    val = CSV_get_next_field (ctx);
+    if (!val)
+       return (0);
+
+    rc = (*ctx->callback) (ctx, val);
+    if (!rc)
+       break;
+  }
+  ctx->rec_num++;
+  return (ctx->field_num == ctx->num_fields);
+}
+
+/**
+ * Try to auto-detect the number of fields in the CSV-file.
+ *
+ * Open and parse the first line and count the number of delimiters.
+ * If this line ends in a newline, this should count as the last field.
+ * Hence increment by 1.
+ *
+ * \param[in]  ctx  the CSV context to work with.
+ * \retval     0 on failure. 1 on success.
+ */
+static int CSV_autodetect_num_fields (struct CSV_context *ctx)
+{
+  unsigned num_fields = 0;
+  const char *delim, *next;
+
+  ctx->file = fopen (ctx->file_name, "rt");
+  if (!ctx->file)
+     return (0);
+
+  if (!fgets(ctx->parse_buf, ctx->line_size, ctx->file))
+  {
+    fclose (ctx->file);
+    return (0);
+  }
+
+  delim = ctx->parse_buf;
+  while (*delim)
+  {
+    next = strchr (delim, ctx->delimiter);
+    if (!next)
+    {
+      if (strchr(delim, '\r') || strchr(delim, '\n'))
+         num_fields++;
+      break;
+    }
+    delim = next + 1;
+    num_fields++;
+  }
+  ctx->num_fields = num_fields;
+  fseek (ctx->file, 0, SEEK_SET);
+  return (1);
+}
+
+/**
+ * Check for unset members of the CSV-context. <br>
+ * Set the field-delimiter to `,` if not already done.
+ *
+ * \param[in]  ctx  the CSV context to work with.
+ * \retval     1 if the members are okay.
+ * \retval    -1 if some members are not okay etc.
+ */
+static int CSV_check_and_fill_ctx (struct CSV_context *ctx)
+{
+  if (!ctx->callback || !ctx->file_name)
+  {
+    errno = EINVAL;
+    return (0);
+  }
+
+  if (!ctx->delimiter)
+     ctx->delimiter = ',';
+
+  if (strchr("#\"\r\n", ctx->delimiter))
+  {
+    errno = EINVAL;
+    return (0);
+  }
+
+  if (ctx->rec_max == 0)
+     ctx->rec_max = UINT_MAX;
+
+  if (ctx->line_size == 0)
+     ctx->line_size = DEFAULT_BUF_SIZE;
+
+  ctx->parse_buf = (char *)malloc (ctx->line_size+1);
+  if (!ctx->parse_buf)
+     return (0);
+
+  if (ctx->num_fields == 0 && !CSV_autodetect_num_fields(ctx))
+  {
+    free (ctx->parse_buf);
+    errno = EINVAL;
+    return (0);
+  }
+
+  if (!ctx->file)
+     ctx->file = fopen (ctx->file_name, "rt");
+
+  if (!ctx->file)
+  {
+    free (ctx->parse_buf);
+    return (0);
+  }
+
+  setvbuf (ctx->file, NULL, _IOFBF, 100*ctx->line_size);
+  ctx->state_func = state_illegal;
+  ctx->state      = STATE_ILLEGAL;
+  ctx->rec_num    = 0;
+  return (1);
+}
+
+/**
+ * Open and parse a CSV-file.
+ */
+int CSV_open_and_parse_file (struct CSV_context *ctx)
+{
+  if (!CSV_check_and_fill_ctx(ctx))
+     return (0);
+
+  while (1)
+  {
+    if (!CSV_parse_file(ctx) || ctx->rec_num >= ctx->rec_max)
+       break;
+  }
+  fclose (ctx->file);
+  ctx->file = NULL;
+  free (ctx->parse_buf);
+  return (ctx->rec_num);
+}
+
+/*
+ * The parallel parser.
+ *
+ * The file is mapped and cut into chunks of about CSV_CHUNK_SIZE, each
+ * starting after a newline. Whether that newline ends a record depends on
+ * the quotes before it, so in a first pass every chunk is run through
+ * the quote, escape and comment rules alone as if it started a record,
+ * noting the state it ends in. Chaining those in file order gives the true
+ * record boundaries (a chunk found to start inside quotes is run again
+ * from there to find its first record), and in a
+ * second pass the records between them are parsed by all threads at once.
+ * The rules are those of the parser above, except that a record is a
+ * line (a newline outside quotes always ends it) and only lines starting
+ * with `#` are comments.
+ *
+ * Both passes look for the next special character 16 bytes at a time
+ * where SSE2 is available. The callback is called on the calling thread,
+ * with the records of one chunk at a time, in file order.
+ */
+
+/**
+ * The bytes per chunk, and the chunks parsed ahead of the callback per thread.
+ */
+#define CSV_CHUNK_SIZE  (1024*1024)
+#define CSV_CHUNK_AHEAD 4
+
+/**
+ * Where a chunk may start: after a newline that ended a record, or inside
+ * a quoted field (possibly just after a `\`).
+ */
+enum {
+  SPLIT_RECORD = 0,
+  SPLIT_QUOTED,
+  SPLIT_ESCAPED,
+  SPLIT_STATES
+};
+
+/**
+ * A chunk as seen by the first pass, for each state it may start in.
+ */
+typedef struct CSV_split {
+        size_t start;                       /**< Offset in the file. */
+        size_t end;
+        size_t first_record[SPLIT_STATES];  /**< Offset of the first record start, or `end`. */
+        int    end_state[SPLIT_STATES];
+      } CSV_split;
+
+/**
+ * The parsed records of one range of the file.
+ */
+typedef struct CSV_chunk {
+        size_t                    start, end;
+        std::vector<char>         text;       /* Unquoted fields, each zero terminated. */
+        std::vector<const char*>  fields;     /* Into `text`. */
+        std::vector<unsigned>     first;      /* First field of each record, plus one past the last. */
+        std::vector<CSV_row>      rows;
+        bool                      done;
+      } CSV_chunk;
+
+/**
+ * Find the first of the characters `a` to `d` in `[p, end)`.
+ * \retval  `end` if none.
+ */
+static const char *CSV_scan (const char *p, const char *end, char a, char b, char c, char d)
+{
+#ifdef CSV_HAVE_SSE2
+  const __m128i va = _mm_set1_epi8 (a);
+  const __m128i vb = _mm_set1_epi8 (b);
+  const __m128i vc = _mm_set1_epi8 (c);
+  const __m128i vd = _mm_set1_epi8 (d);
+
+  while (end - p >= 16)
+  {
+    __m128i  x = _mm_loadu_si128 ((const __m128i*) p);
+    __m128i  m = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (x, va), _mm_cmpeq_epi8 (x, vb)),
+                               _mm_or_si128 (_mm_cmpeq_epi8 (x, vc), _mm_cmpeq_epi8 (x, vd)));
+    unsigned mask = (unsigned) _mm_movemask_epi8 (m);
+
+    if (mask)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      return (p + __builtin_ctz (mask));
+#else
+      while (!(mask & 1))
+      {
+        mask >>= 1;
+        p++;
+      }
+      return (p);
+#endif
+    }
+    p += 16;
+  }
+#endif
+  while (p < end && *p != a && *p != b && *p != c && *p != d)
+     p++;
+  return (p);
+}
+
+/**
+ * First pass over a chunk: follow the quotes, escapes and comments from
+ * `state` to the end of the chunk.
+ *
+ * \param[out] first_record  the offset (from `data`) where the first record
+ *                           starts, or `split->end` if none does.
+ * \retval     the state at the end of the chunk.
+ */
+static int CSV_split_chunk (const char *data, const CSV_split *split, int state, size_t *first_record)
+{
+  const char *p   = data + split->start;
+  const char *end = data + split->end;
+  enum { LINE_START, NORMAL, QUOTED, ESCAPED, COMMENT } s;
+
+  *first_record = split->end;
+  if (state == SPLIT_RECORD)
+  {
+    *first_record = split->start;
+    s = LINE_START;
+  }
+  else s = (state == SPLIT_QUOTED) ? QUOTED : ESCAPED;
+
+  while (p < end)
+  {
+    switch (s)
+    {
+      case LINE_START:
+           if (*p == '#')
+              s = COMMENT;
+           else if (*p != '\r' && *p != '\n')
+              s = NORMAL;
+           else p++;
+           break;
+      case NORMAL:
+           p = CSV_scan (p, end, '"', '\n', '"', '\n');
+           if (p == end)
+              break;
+           if (*p++ == '"')
+              s = QUOTED;
+           else goto new_line;
+           break;
+      case QUOTED:
+           p = CSV_scan (p, end, '"', '\\', '"', '\\');
+           if (p == end)
+              break;
+           s = (*p++ == '"') ? NORMAL : ESCAPED;
+           break;
+      case ESCAPED:
+           if (*p != '\r' && *p != '\n')
+              s = QUOTED;
+           p++;
+           break;
+      case COMMENT:
+           p = (const char*) memchr (p, '\n', end - p);
+           if (!p)
+           {
+             p = end;
+             break;
+           }
+           p++;
+           goto new_line;
+    }
+    continue;
+
+new_line:
+    s = LINE_START;
+    if (*first_record == split->end)
+       *first_record = p - data;
+  }
+
+  if (s == QUOTED)
+     return (SPLIT_QUOTED);
+  if (s == ESCAPED)
+     return (SPLIT_ESCAPED);
+  return (SPLIT_RECORD);
+}
+
+/**
+ * Second pass: parse the records in `[chunk->start, chunk->end)`, which
+ * starts at the start of a record.
+ */
+static void CSV_parse_chunk (const char *data, int delimiter, CSV_chunk *chunk)
+{
+  const char *p   = data + chunk->start;
+  const char *end = data + chunk->end;
+  enum { LINE_START, NORMAL, QUOTED, ESCAPED } s = LINE_START;
+  char       *out;
+  const char *q;
+
+  /* Nothing grows in unquoting, and every field but the last ends at a
+   * delimiter or newline, so `text` needs at most one byte more.
+   */
+  chunk->text.resize (chunk->end - chunk->start + 1);
+  out = &chunk->text[0];
+
+  while (p < end)
+  {
+    switch (s)
+    {
+      case LINE_START:
+           if (*p == '\r' || *p == '\n')
+              p++;
+           else if (*p == '#')
+           {
+             p = (const char*) memchr (p, '\n', end - p);
+             p = p ? p + 1 : end;
+           }
+           else
+           {
+             chunk->first.push_back ((unsigned)chunk->fields.size());
+             chunk->fields.push_back (out);
+             s = NORMAL;
+           }
+           break;
+      case NORMAL:
+           q = CSV_scan (p, end, (char)delimiter, '"', '\n', '\r');
+           memcpy (out, p, q - p);
+           out += q - p;
+           p = q;
+           if (p == end)
+              break;
+           if (*p == delimiter)
+           {
+             *out++ = '\0';
+             chunk->fields.push_back (out);
+             p++;
+             if (delimiter == ' ')
+                while (p < end && *p == ' ')
+                   p++;
+           }
+           else if (*p == '"')
+           {
+             s = QUOTED;
+             p++;
+           }
+           else if (*p++ == '\n')
+           {
+             *out++ = '\0';
+             s = LINE_START;
+           }
+           break;
+      case QUOTED:
+           q = CSV_scan (p, end, '"', '\\', '\n', '\r');
+           memcpy (out, p, q - p);
+           out += q - p;
+           p = q;
+           if (p == end)
+              break;
+           if (*p == '"')
+              s = NORMAL;
+           else if (*p == '\\')
+              s = ESCAPED;
+           else if (*p == '\n')     /* add a space in this field */
+              *out++ = ' ';
+           p++;
+           break;
+      case ESCAPED:
+           if (*p == '"')
+           {
+             *out++ = '"';
+             s = QUOTED;
+           }
+           else if (*p != '\r' && *p != '\n')
+             s = QUOTED;             /* Unsupported ctrl-char. Go back */
+           p++;
+           break;
+    }
+  }
+  if (s != LINE_START)
+     *out++ = '\0';                 /* The last line had no newline. */
+  chunk->first.push_back ((unsigned)chunk->fields.size());
+
+  chunk->rows.resize (chunk->first.size() - 1);
+  for (size_t i = 0; i < chunk->rows.size(); i++)
+  {
+    chunk->rows[i].rec_num    = 0;
+    chunk->rows[i].num_fields = chunk->first[i+1] - chunk->first[i];
+    chunk->rows[i].fields     = &chunk->fields[chunk->first[i]];
+  }
+}
+
+/**
+ * Memory-map and parse a CSV file on `num_threads` threads (0 for one per
+ * processor), handing the records to `callback` in batches.
+ *
+ * \param[in]  file_name  the .csv-file.
+ * \param[in]  delimiter  the field delimiter, `,` if 0.
+ * \retval     the number of records handed to the callback, -1 on failure with `errno` set.
+ */
+int CSV_parse_file_parallel (const char *file_name, int delimiter, unsigned num_threads,
+                             CSV_rows_callback callback, void *user)
+{
+  TMappedFile             file;
+  const char             *data;
+  size_t                  size;
+  std::vector<CSV_split>  splits;
+  std::vector<CSV_chunk>  chunks;
+  std::vector<std::thread> threads;
+  std::atomic<size_t>     next_split (0);
+  std::mutex              lock;
+  std::condition_variable changed;
+  size_t                  next_chunk = 0, emitted = 0;
+  bool                    stop = false;
+  unsigned                rec_num = 0;
+  int                     state;
+
+  if (!delimiter)
+     delimiter = ',';
+  if (!callback || !file_name || strchr("#\"\r\n", delimiter))
+  {
+    errno = EINVAL;
+    return (-1);
+  }
+  if (!file.Open(file_name))
+     return (-1);
+
+  data = (const char*) file.Data();
+  size = file.Size();
+  if (num_threads == 0)
+     num_threads = std::thread::hardware_concurrency();
+  if (num_threads == 0)
+     num_threads = 1;
+
+  /* Cut the file after the first newline past every CSV_CHUNK_SIZE bytes.
+   */
+  for (size_t start = 0; start < size; )
+  {
+    CSV_split   split;
+    const char *nl = NULL;
+
+    split.start = start;
+    if (size - start > CSV_CHUNK_SIZE)
+       nl = (const char*) memchr (data + start + CSV_CHUNK_SIZE, '\n', size - start - CSV_CHUNK_SIZE);
+    split.end = nl ? (size_t)(nl - data) + 1 : size;
+    splits.push_back (split);
+    start = split.end;
+  }
+
+  /* First pass, from the start of a record.
+   */
+  for (unsigned t = 0; t < num_threads && t < splits.size(); t++)
+      threads.push_back (std::thread ([&]() {
+        size_t i;
+        while ((i = next_split++) < splits.size())
+          splits[i].end_state[SPLIT_RECORD] = CSV_split_chunk (data, &splits[i], SPLIT_RECORD,
+                                                               &splits[i].first_record[SPLIT_RECORD]);
+      }));
+  for (size_t t = 0; t < threads.size(); t++)
+      threads[t].join();
+  threads.clear();
+
+  /* Chain the states to find where the records start; the text of a chunk
+   * before its first record belongs to the record of the chunk before.
+   * Chunks rarely start inside quotes, so that case is followed only here.
+   */
+  state = SPLIT_RECORD;
+  for (size_t i = 0; i < splits.size(); i++)
+  {
+    size_t first;
+
+    if (state != SPLIT_RECORD)
+       splits[i].end_state[state] = CSV_split_chunk (data, &splits[i], state, &splits[i].first_record[state]);
+    first = splits[i].first_record[state];
+
+    if (first < splits[i].end)
+    {
+      if (!chunks.empty())
+         chunks.back().end = first;
+      chunks.push_back (CSV_chunk());
+      chunks.back().start = first;
+      chunks.back().end   = size;
+      chunks.back().done  = false;
+    }
+    state = splits[i].end_state[state];
+  }
+
+  /* Second pass, keeping at most CSV_CHUNK_AHEAD chunks per thread parsed
+   * ahead of the callback.
+   */
+  for (unsigned t = 0; t < num_threads && t < chunks.size(); t++)
+      threads.push_back (std::thread ([&]() {
+        std::unique_lock<std::mutex> guard (lock);
+        while (1)
+        {
+          changed.wait (guard, [&]() {
+            return (stop || next_chunk >= chunks.size() ||
+                    next_chunk < emitted + (size_t)num_threads * CSV_CHUNK_AHEAD);
+          });
+          if (stop || next_chunk >= chunks.size())
+             break;
+          size_t i = next_chunk++;
+          guard.unlock();
+          CSV_parse_chunk (data, delimiter, &chunks[i]);
+          guard.lock();
+          chunks[i].done = true;
+          changed.notify_all();
+        }
+      }));
+
+  for (size_t i = 0; i < chunks.size(); i++)
+  {
+    CSV_chunk &chunk = chunks[i];
+    bool       go = true;
+    {
+      std::unique_lock<std::mutex> guard (lock);
+      changed.wait (guard, [&]() { return (chunk.done); });
+    }
+    for (size_t r = 0; r < chunk.rows.size(); r++)
+        chunk.rows[r].rec_num = rec_num++;
+    if (!chunk.rows.empty())
+       go = (*callback) (user, &chunk.rows[0], (unsigned)chunk.rows.size()) != 0;
+
+    std::lock_guard<std::mutex> guard (lock);
+    chunk = CSV_chunk();
+    chunk.done = true;
+    emitted = i + 1;
+    stop = !go;
+    changed.notify_all();
+    if (stop)
+       break;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard (lock);
+    stop = true;
+    changed.notify_all();
+  }
+  for (size_t t = 0; t < threads.size(); t++)
+      threads[t].join();
+  return ((int)rec_num);
+}
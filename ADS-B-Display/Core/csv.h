@@ -48,5 +48,23 @@ typedef struct CSV_context {
 
 int CSV_open_and_parse_file (struct CSV_context *ctx);
 
+/**
+ * One record as handed out by `CSV_parse_file_parallel()`.
+ */
+typedef struct CSV_row {
+        unsigned     rec_num;       /**< The record number in the file. */
+        unsigned     num_fields;    /**< The fields in this record (line); may differ between records. */
+        const char **fields;        /**< The fields, unquoted and zero terminated. */
+      } CSV_row;
+
+/**
+ * The user callback for a batch of records, in file order.
+ * The rows are only valid during the call. Return 0 to stop parsing.
+ */
+typedef int (*CSV_rows_callback) (void *user, const CSV_row *rows, unsigned num_rows);
+
+int CSV_parse_file_parallel (const char *file_name, int delimiter, unsigned num_threads,
+                             CSV_rows_callback callback, void *user);
+
 //---------------------------------------------------------------------------
 #endif
@@ -2,6 +2,7 @@
 
 #include <vcl.h>
 #include <new>
+#include <memory>
 #include <math.h>
 #include <dir.h>
 #include <float.h>
@@ -26,6 +27,7 @@
 #include "CPA.h"
 #include "AircraftDB.h"
 #include "csv.h"
+#include "BoundaryCache.h"
 
 #define AIRCRAFT_DATABASE_URL   "https://opensky-network.org/datasets/metadata/aircraftDatabase.zip"
 #define AIRCRAFT_DATABASE_FILE   "aircraftDatabase.csv"
@@ -33,11 +35,13 @@
 //"https://vrs-standing-data.adsb.lol/routes.csv.gz"
 #define API_SERVICE_URL_JSON  "https://vrs-standing-data.adsb.lol/routes/%.2s/%s.json"
 #define API_SERVICE_URL_TXT  "https://vrs-standing-data.adsb.lol/routes/%.2s/%s.txt"
+#define ROUTE_TIMEOUT_MS     5000
+#define ROUTE_CACHE_FILE     "RouteCache.txt"
 #define MAP_CENTER_LAT  40.73612;
 #define MAP_CENTER_LON -80.33158;
 
-#define BIG_QUERY_UPLOAD_COUNT 50000
-#define BIG_QUERY_RUN_FILENAME  "SimpleCSVtoBigQuery.py"
+#define BIG_QUERY_RUN_FILENAME  "SpoolToBigQuery.py"
+#define CONFLICT_MAX_AGE        60000  /* Aircraft not updated for longer are ignored. */
 #define   LEFT_MOUSE_DOWN   1
 #define   RIGHT_MOUSE_DOWN  2
 #define   MIDDLE_MOUSE_DOWN 4
@@ -52,18 +56,26 @@
 #pragma link "Map\jpeg\Win64\Release\jpeg.a"
 #pragma link "Map\png\Win64\Release\png.a"
 #pragma link "HashTable\Lib\Win64\Release\HashTableLib.a"
+#pragma link "Core\Win64\Release\ADSBCoreLib.a"
 #pragma link "cspin"
 #pragma link "SpeechLib_OCX"
 #pragma resource "*.dfm"
 TForm1 *Form1;
  //---------------------------------------------------------------------------
- static void RunPythonScript(AnsiString scriptPath,AnsiString args);
+ static HANDLE RunPythonScript(AnsiString scriptPath,AnsiString args);
  static bool DeleteFilesWithExtension(AnsiString dirPath, AnsiString extension);
  static int FinshARTCCBoundary(void);
+ static void AddARTCCArea(TArea *Area);
+ static int LoadARTCCCache(AnsiString CacheFile, AnsiString FileName);
+ static void SaveARTCCCache(AnsiString CacheFile, AnsiString FileName, int FirstArea);
+ static void OnNewAircraft(TADS_B_Context *Ctx, TADS_B_Aircraft *ADS_B_Aircraft);
+ static void OnAircraftUpdate(TADS_B_Context *Ctx, TADS_B_Aircraft *ADS_B_Aircraft);
+ static void OnRemoveAircraft(TADS_B_Context *Ctx, TADS_B_Aircraft *ADS_B_Aircraft);
  //---------------------------------------------------------------------------
 
 static char *stristr(const char *String, const char *Pattern);
 static const char * strnistr(const char * pszSource, DWORD dwLength, const char * pszFind) ;
+static TRouteFetchResult FetchRoute(const std::string &Callsign, std::string &Route);
 
 //---------------------------------------------------------------------------
 uint32_t createRGB(uint8_t r, uint8_t g, uint8_t b)
@@ -146,6 +158,36 @@ static const char * strnistr(const char * pszSource, DWORD dwLength, const char
 	return pszSubStr;
 }
 //---------------------------------------------------------------------------
+/*
+ * Runs on the route resolver's worker threads, so each request has its own
+ * client. A 404 means the service has no route for the callsign; anything
+ * else that is not an answer is a failure to be retried later.
+ */
+static TRouteFetchResult FetchRoute(const std::string &Callsign, std::string &Route)
+{
+ char Url[1024];
+
+ snprintf(Url,sizeof(Url),API_SERVICE_URL_TXT,Callsign.c_str(),Callsign.c_str());
+ try
+   {
+	std::unique_ptr<THTTPClient> Client(THTTPClient::Create());
+	Client->ConnectionTimeout=ROUTE_TIMEOUT_MS;
+	Client->ResponseTimeout=ROUTE_TIMEOUT_MS;
+	_di_IHTTPResponse Response=Client->Get(AnsiString(Url));
+	if (Response->StatusCode==200)
+	  {
+	   AnsiString Text=Response->ContentAsString(TEncoding::ASCII);
+	   Route=Text.c_str();
+	   return RF_FOUND;
+	  }
+	if (Response->StatusCode==404) return RF_NOT_FOUND;
+   }
+ catch (...)
+   {
+   }
+ return RF_ERROR;
+}
+//---------------------------------------------------------------------------
 static char *stristr(const char *String, const char *Pattern)
 {
   char *pptr, *sptr, *start;
@@ -192,23 +234,27 @@ __fastcall TForm1::TForm1(TComponent* Owner)
   ARTCCBoundaryDataPathFileName=ExtractFilePath(ExtractFileDir(Application->ExeName)) +AnsiString("..\\ARTCC_Boundary_Data\\")+ARTCC_BOUNDARY_FILE;
   BigQueryPath=ExtractFilePath(ExtractFileDir(Application->ExeName)) +AnsiString("..\\BigQuery\\");
   BigQueryPythonScript= BigQueryPath+ AnsiString(BIG_QUERY_RUN_FILENAME);
-  DeleteFilesWithExtension(BigQueryPath, "csv");
+  DeleteFilesWithExtension(BigQueryPath, "part");
+  DeleteFilesWithExtension(BigQueryPath, "active");
   BigQueryLogFileName=BigQueryPath+"BigQuery.log";
+  TrackStorePath=ExtractFilePath(ExtractFileDir(Application->ExeName)) +AnsiString("..\\TrackStore");
   DeleteFileA(BigQueryLogFileName.c_str());
   CurrentSpriteImage=0;
-  InitDecodeRawADS_B();
   RecordRawStream=NULL;
   PlayBackRawStream=NULL;
   TrackHook.Valid_CC=false;
   TrackHook.Valid_CPA=false;
 
-  HashTable = ght_create(50000);
+  Context = ADS_B_CreateContext(50000);
 
-  if ( !HashTable)
+  if ( !Context)
 	{
 	  throw Sysutils::Exception("Create Hash Failed");
 	}
-  ght_set_rehash(HashTable, TRUE);
+  Context->OnNewAircraft=OnNewAircraft;
+  Context->OnAircraftUpdate=OnAircraftUpdate;
+  Context->OnRemoveAircraft=OnRemoveAircraft;
+  Context->UserData=this;
 
   AreaTemp=NULL;
   Areas= new TList;
@@ -228,9 +274,19 @@ __fastcall TForm1::TForm1(TComponent* Owner)
  g_EarthView->m_Eye.h /= pow(1.3,18);//pow(1.3,43);
  SetMapCenter(g_EarthView->m_Eye.x, g_EarthView->m_Eye.y);
  TimeToGoTrackBar->Position=120;
- BigQueryCSV=NULL;
- BigQueryRowCount=0;
- BigQueryFileCount=0;
+ BigQueryExport=NULL;
+ BigQueryUploader=NULL;
+ ConflictMonitor=new TConflictMonitor(CD_DEFAULT_LOOKAHEAD_SEC,CD_DEFAULT_HORIZONTAL_NM,
+									   CD_DEFAULT_VERTICAL_FT,CONFLICT_MAX_AGE);
+ Geofence=new TGeofenceEngine();
+ TrackRecorder=new TTrackRecorder();
+ if (!TrackRecorder->Open(TrackStorePath.c_str()))
+   {
+	delete TrackRecorder;
+	TrackRecorder=NULL;
+   }
+ RouteResolver=new TRouteResolver(FetchRoute,(ExtractFilePath(ExtractFileDir(Application->ExeName))+
+								  AnsiString("..\\" ROUTE_CACHE_FILE)).c_str());
  InitAircraftDB(AircraftDBPathFileName);
  SpVoice1->Rate=2; // Set Rate of Voice
  SpVoice1->Volume=100;  //Set Volume of Voice
@@ -360,12 +416,22 @@ __fastcall TForm1::~TForm1()
  delete g_EarthView;
  if (g_GETileManager) delete g_GETileManager;
  delete g_MasterLayer;
- delete g_Storage;
+ g_LegacyStorage->Detach();
+ g_Storage->Detach();
  if (LoadMapFromInternet)
  {
    if (g_Keyhole) delete g_Keyhole;
  }
-
+ delete g_LegacyStorage;
+ delete g_Storage;
+ CloseBigQueryExport();
+ /* The uploader carries on until the spool is empty. */
+ if (BigQueryUploader) CloseHandle(BigQueryUploader);
+ delete TrackRecorder;
+ delete RouteResolver;
+ delete ConflictMonitor;
+ delete Geofence;
+ ADS_B_FreeContext(Context);
 }
 //---------------------------------------------------------------------------
 void __fastcall  TForm1::SetMapCenter(double &x, double &y)
@@ -439,6 +505,7 @@ void __fastcall TForm1::Timer1Timer(TObject *Sender)
 
  CurrentTime=GetCurrentTimeInMsec();
  SystemTime->Caption=TimeToChar(CurrentTime);
+ UpdateAreaLoads();
 
  ObjectDisplay->Repaint();
 }
@@ -474,36 +541,48 @@ void __fastcall TForm1::DrawObjects(void)
   ght_iterator_t iterator;
   TADS_B_Aircraft* Data,*DataCPA;
 
-  DWORD i,j,Count;
+  DWORD i,Count;
 
   if (AreaTemp)
   {
+   pfVec3 *Points=AreaPoints(AreaTemp);
+   DWORD   NumPoints=AreaNumPoints(AreaTemp);
+   std::vector<double> X(NumPoints),Y(NumPoints);
+
    glPointSize(3.0);
-	for (DWORD i = 0; i <AreaTemp->NumPoints ; i++)
-		LatLon2XY(AreaTemp->Points[i][1],AreaTemp->Points[i][0],
-				  AreaTemp->PointsAdj[i][0],AreaTemp->PointsAdj[i][1]);
+	for (DWORD i = 0; i <NumPoints ; i++)
+		LatLon2XY(Points[i][1],Points[i][0],X[i],Y[i]);
 
    glBegin(GL_POINTS);
-   for (DWORD i = 0; i <AreaTemp->NumPoints ; i++)
+   for (DWORD i = 0; i <NumPoints ; i++)
 	{
-	glVertex2f(AreaTemp->PointsAdj[i][0],
-			   AreaTemp->PointsAdj[i][1]);
+	glVertex2f(X[i],Y[i]);
 	}
 	glEnd();
    glBegin(GL_LINE_STRIP);
-   for (DWORD i = 0; i <AreaTemp->NumPoints ; i++)
+   for (DWORD i = 0; i <NumPoints ; i++)
 	{
-	glVertex2f(AreaTemp->PointsAdj[i][0],
-			   AreaTemp->PointsAdj[i][1]);
+	glVertex2f(X[i],Y[i]);
 	}
 	glEnd();
   }
+	for (i = 0; i < StaleDisplayLists.size(); i++) glDeleteLists(StaleDisplayLists[i],2);
+	StaleDisplayLists.clear();
+
 	Count=Areas->Count;
 	for (i = 0; i < Count; i++)
 	 {
 	   TArea *Area = (TArea *)Areas->Items[i];
 	   TMultiColor MC;
 
+	   if (!Area->DisplayLists) BuildAreaDisplayLists(Area);
+
+	   /* The lists are in Mercator units around the area's origin; this is Mercator2XY(). */
+	   glPushMatrix();
+	   glTranslated(Map_v[1].x-(Map_w[1].x-Area->OriginX)/xf,
+					Map_v[3].y-(Map_w[1].y-Area->OriginY)/yf, 0.0);
+	   glScaled(1.0/xf, 1.0/yf, 1.0);
+
 	   MC.Rgb=ColorToRGB(Area->Color);
 	   if (Area->Selected)
 	   {
@@ -514,13 +593,7 @@ void __fastcall TForm1::DrawObjects(void)
 
 
 	   glColor4f(MC.Red/255.0, MC.Green/255.0, MC.Blue/255.0, 1.0);
-	   glBegin(GL_LINE_LOOP);
-	   for (j = 0; j <Area->NumPoints; j++)
-	   {
-		LatLon2XY(Area->Points[j][1],Area->Points[j][0], ScrX, ScrY);
-		glVertex2f(ScrX,ScrY);
-	   }
-	  glEnd();
+	   glCallList(Area->DisplayLists);
 	   if (Area->Selected)
 	   {
 		glPopAttrib ();
@@ -528,38 +601,20 @@ void __fastcall TForm1::DrawObjects(void)
 	   }
 
 	   glColor4f(MC.Red/255.0, MC.Green/255.0, MC.Blue/255.0, 0.4);
-
-	   for (j = 0; j <Area->NumPoints; j++)
-	   {
-		LatLon2XY(Area->Points[j][1],Area->Points[j][0],
-				  Area->PointsAdj[j][0],Area->PointsAdj[j][1]);
-	   }
-	  TTriangles *Tri=Area->Triangles;
-
-	  while(Tri)
-	  {
-		glBegin(GL_TRIANGLES);
-		glVertex2f(Area->PointsAdj[Tri->indexList[0]][0],
-				   Area->PointsAdj[Tri->indexList[0]][1]);
-		glVertex2f(Area->PointsAdj[Tri->indexList[1]][0],
-				   Area->PointsAdj[Tri->indexList[1]][1]);
-		glVertex2f(Area->PointsAdj[Tri->indexList[2]][0],
-				   Area->PointsAdj[Tri->indexList[2]][1]);
-		glEnd();
-		Tri=Tri->next;
-	  }
+	   glCallList(Area->DisplayLists+1);
+	   glPopMatrix();
 	 }
 
-    AircraftCountLabel->Caption=IntToStr((int)ght_size(HashTable));
-	for(Data = (TADS_B_Aircraft *)ght_first(HashTable, &iterator,(const void **) &Key);
-			  Data; Data = (TADS_B_Aircraft *)ght_next(HashTable, &iterator, (const void **)&Key))
+    AircraftCountLabel->Caption=IntToStr((int)ght_size(Context->HashTable));
+	for(Data = (TADS_B_Aircraft *)ght_first(Context->HashTable, &iterator,(const void **) &Key);
+			  Data; Data = (TADS_B_Aircraft *)ght_next(Context->HashTable, &iterator, (const void **)&Key))
 	{
 	  if (Data->HaveLatLon)
 	  {
 		ViewableAircraft++;
 	   glColor4f(1.0, 1.0, 1.0, 1.0);
 
-	   LatLon2XY(Data->Latitude,Data->Longitude, ScrX, ScrY);
+	   Mercator2XY(Data->MercatorX,Data->MercatorY, ScrX, ScrY);
 	   //DrawPoint(ScrX,ScrY);
 	   if (Data->HaveSpeedAndHeading)   glColor4f(1.0, 0.0, 1.0, 1.0);
 	   else
@@ -574,55 +629,48 @@ void __fastcall TForm1::DrawObjects(void)
 
 	   if ((Data->HaveSpeedAndHeading) && (TimeToGoCheckBox->State==cbChecked))
 	   {
-		double lat,lon,az;
-		if (VDirect(Data->Latitude,Data->Longitude,
-					Data->Heading,Data->Speed/3060.0*TimeToGoTrackBar->Position ,&lat,&lon,&az)==OKNOERROR)
-		  {
-			 double ScrX2, ScrY2;
-			 LatLon2XY(lat,lon, ScrX2, ScrY2);
-             glColor4f(1.0, 1.0, 0.0, 1.0);
-			 glBegin(GL_LINE_STRIP);
-			 glVertex2f(ScrX,ScrY);
-			 glVertex2f(ScrX2,ScrY2);
-			 glEnd();
-		  }
+		double mx,my,ScrX2, ScrY2;
+		AircraftMercatorAhead(Data,TimeToGoTrackBar->Position,&mx,&my);
+		Mercator2XY(mx,my, ScrX2, ScrY2);
+		glColor4f(1.0, 1.0, 0.0, 1.0);
+		glBegin(GL_LINE_STRIP);
+		glVertex2f(ScrX,ScrY);
+		glVertex2f(ScrX2,ScrY2);
+		glEnd();
 	   }
 	 }
 	}
  ViewableAircraftCountLabel->Caption=ViewableAircraft;
+ DrawConflicts();
  if (TrackHook.Valid_CC)
  {
 
-		Data= (TADS_B_Aircraft *)ght_get(HashTable, sizeof(TrackHook.ICAO_CC), (void *)&TrackHook.ICAO_CC);
+		Data= (TADS_B_Aircraft *)ght_get(Context->HashTable, sizeof(TrackHook.ICAO_CC), (void *)&TrackHook.ICAO_CC);
 		if (Data)
 		{
+		TAircraftDBInfo DBInfo;
 		ICAOLabel->Caption=Data->HexAddr;
+		if (GetAircraftDBRecord(Data->ICAO,&DBInfo))
+		  ICAOLabel->Caption=ICAOLabel->Caption+"  "+DBInfo.Field[AC_DB_Registration]+
+							 " "+DBInfo.Field[AC_DB_ICAOAircraftType];
+		else if (AircraftDBState()==AR_PENDING)
+		  ICAOLabel->Caption=ICAOLabel->Caption+"  (DB loading)";
 		if (Data->HaveFlightNum)
 		  {
            FlightNumLabel->Caption=Data->FlightNum;
-           if (Data->RequestedRoute==false)
+           // Never waits for the network: the resolver answers from its cache
+           // and looks the callsign up in the background, so ask every frame.
+           TRouteState RouteState=ROUTE_KNOWN;
+           if (!Data->HaveRoute)
            {
-             _di_IHTTPResponse Repsonse;
-             char _GetStr[1024];
-             Data->RequestedRoute=true;
-		     snprintf (_GetStr, sizeof(_GetStr), API_SERVICE_URL_TXT, Data->FlightNum, Data->FlightNum);
-             //printf("%s\n", _GetStr);
-             Repsonse=NetHTTPClientRoute->Get(AnsiString(_GetStr));
-             if (Repsonse->StatusCode==200)
-             {
-              AnsiString Route=Repsonse->ContentAsString(TEncoding::ASCII);
-              if (strlen(Route.c_str())<sizeof(Data->Route))
-              {
-               strcpy(Data->Route,Route.c_str());
-               Data->HaveRoute=true;
-              }
-             }
-            // else  printf("No Route Error\n");
+             RouteState=RouteResolver->Lookup(Data->FlightNum,Data->Route,sizeof(Data->Route));
+             Data->HaveRoute=RouteState==ROUTE_KNOWN;
            }
            if (Data->HaveRoute)
            {
               RouteLabel->Caption=Data->Route;
            }
+           else if (RouteState==ROUTE_PENDING) RouteLabel->Caption="LOOKING UP";
            else RouteLabel->Caption="UNKNOWN";
 
 		  }
@@ -648,14 +696,19 @@ void __fastcall TForm1::DrawObjects(void)
 		 HdgLabel->Caption="N/A";
         }
         if (Data->Altitude)
-		 AltLabel->Caption= FloatToStrF(Data->Altitude, ffFixed,12,2)+" FT";
+		 {
+		  TArea *Sector=Data->HaveLatLon ?
+			 AreaOfFence(Geofence->Owner(Data->Latitude,Data->Longitude,Data->Altitude)) : NULL;
+		  AltLabel->Caption= FloatToStrF(Data->Altitude, ffFixed,12,2)+" FT";
+		  if (Sector) AltLabel->Caption=AltLabel->Caption+"  "+Sector->Name;
+		 }
 		else AltLabel->Caption="N/A";
 
 		MsgCntLabel->Caption="Raw: "+IntToStr((int)Data->NumMessagesRaw)+" SBS: "+IntToStr((int)Data->NumMessagesSBS);
 		TrkLastUpdateTimeLabel->Caption=TimeToChar(Data->LastSeen);
 
         glColor4f(1.0, 0.0, 0.0, 1.0);
-        LatLon2XY(Data->Latitude,Data->Longitude, ScrX, ScrY);
+        Mercator2XY(Data->MercatorX,Data->MercatorY, ScrX, ScrY);
         DrawTrackHook(ScrX, ScrY);
         }
 
@@ -676,23 +729,19 @@ void __fastcall TForm1::DrawObjects(void)
  if (TrackHook.Valid_CPA)
  {
   bool CpaDataIsValid=false;
-  DataCPA= (TADS_B_Aircraft *)ght_get(HashTable, sizeof(TrackHook.ICAO_CPA), (void *)&TrackHook.ICAO_CPA);
+  DataCPA= (TADS_B_Aircraft *)ght_get(Context->HashTable, sizeof(TrackHook.ICAO_CPA), (void *)&TrackHook.ICAO_CPA);
   if ((DataCPA) && (TrackHook.Valid_CC))
 	{
 
 	  double tcpa,cpa_distance_nm, vertical_cpa;
 	  double lat1, lon1,lat2, lon2, junk;
-	  if (computeCPA(Data->Latitude, Data->Longitude, Data->Altitude,
-					 Data->Speed,Data->Heading,
-					 DataCPA->Latitude, DataCPA->Longitude, DataCPA->Altitude,
-					 DataCPA->Speed,DataCPA->Heading,
-					 tcpa,cpa_distance_nm, vertical_cpa))
+	  if (AircraftCPA(Data,DataCPA,tcpa,cpa_distance_nm, vertical_cpa))
 	  {
-		if (VDirect(Data->Latitude,Data->Longitude,
-					Data->Heading,Data->Speed/3600.0*tcpa,&lat1,&lon1,&junk)==OKNOERROR)
+		if (GeoDirect(Data->Latitude,Data->Longitude,
+					  Data->Heading,Data->Speed/3600.0*tcpa,&lat1,&lon1,&junk)==OKNOERROR)
 		{
-		  if (VDirect(DataCPA->Latitude,DataCPA->Longitude,
-					  DataCPA->Heading,DataCPA->Speed/3600.0*tcpa,&lat2,&lon2,&junk)==OKNOERROR)
+		  if (GeoDirect(DataCPA->Latitude,DataCPA->Longitude,
+						DataCPA->Heading,DataCPA->Speed/3600.0*tcpa,&lat2,&lon2,&junk)==OKNOERROR)
 		   {
 			 glColor4f(0.0, 1.0, 0.0, 1.0);
 			 glBegin(GL_LINE_STRIP);
@@ -730,6 +779,35 @@ void __fastcall TForm1::DrawObjects(void)
  }
 }
 //---------------------------------------------------------------------------
+/**
+ * Bring the conflict monitor up to date with the aircraft updated since the
+ * last frame and join each conflicting pair with a line.
+ */
+void __fastcall TForm1::DrawConflicts(void)
+{
+ TADS_B_Aircraft *a1,*a2;
+ double ScrX, ScrY;
+
+ ConflictMonitor->Evaluate(GetCurrentTimeInMsec(),ConflictAlerts);
+ if (ConflictAlerts.empty()) ConflictCountValue->Caption="None";
+ else ConflictCountValue->Caption=IntToStr((int)ConflictAlerts.size())+" NEXT: "+
+								   TimeToChar(ConflictAlerts[0].TCPA*1000);
+
+ glColor4f(1.0, 0.5, 0.0, 1.0);
+ for (unsigned int i = 0; i < ConflictAlerts.size(); i++)
+   {
+	a1=(TADS_B_Aircraft *)ght_get(Context->HashTable,sizeof(uint32_t),(void *)&ConflictAlerts[i].ICAO1);
+	a2=(TADS_B_Aircraft *)ght_get(Context->HashTable,sizeof(uint32_t),(void *)&ConflictAlerts[i].ICAO2);
+	if ((!a1) || (!a2)) continue;
+	glBegin(GL_LINE_STRIP);
+	Mercator2XY(a1->MercatorX,a1->MercatorY, ScrX, ScrY);
+	glVertex2f(ScrX, ScrY);
+	Mercator2XY(a2->MercatorX,a2->MercatorY, ScrX, ScrY);
+	glVertex2f(ScrX, ScrY);
+	glEnd();
+   }
+}
+//---------------------------------------------------------------------------
 void __fastcall TForm1::ObjectDisplayMouseDown(TObject *Sender,
 	  TMouseButton Button, TShiftState Shift, int X, int Y)
 {
@@ -752,11 +830,7 @@ void __fastcall TForm1::ObjectDisplayMouseDown(TObject *Sender,
   {
   if (AreaTemp)
    {
-	if (AreaTemp->NumPoints<MAX_AREA_POINTS)
-	{
 	  AddPoint(X, Y);
-	}
-	else ShowMessage("Max Area Points Reached");
    }
   else
    {
@@ -799,7 +873,7 @@ void __fastcall TForm1::ObjectDisplayMouseMove(TObject *Sender,
    for (i = 0; i < Areas->Count; i++)
 	 {
 	   TArea *Area = (TArea *)Areas->Items[i];
-	   if (PointInPolygon(Area->Points,Area->NumPoints,Point))
+	   if (PointInPolygon(AreaPoints(Area),AreaNumPoints(Area),Point))
 	   {
 #if 0
 		  MsgLog->Lines->Add("In Polygon "+ Area->Name);
@@ -834,10 +908,7 @@ void __fastcall TForm1::Exit1Click(TObject *Sender)
  if (XY2LatLon2(X,Y,Lat,Lon)==0)
  {
 
-	AreaTemp->Points[AreaTemp->NumPoints][1]=Lat;
-	AreaTemp->Points[AreaTemp->NumPoints][0]=Lon;
-	AreaTemp->Points[AreaTemp->NumPoints][2]=0.0;
-	AreaTemp->NumPoints++;
+	AreaVertices.Append(AreaTemp->Span,Lon,Lat,0.0);
 	ObjectDisplay->Repaint();
  }
  }
@@ -871,8 +942,8 @@ return Str.WideChar(str, Str.WideCharBufSize());
 
   MinRange=16.0;
 
-  for(Data = (TADS_B_Aircraft *)ght_first(HashTable, &iterator,(const void **) &Key);
-			  Data; Data = (TADS_B_Aircraft *)ght_next(HashTable, &iterator, (const void **)&Key))
+  for(Data = (TADS_B_Aircraft *)ght_first(Context->HashTable, &iterator,(const void **) &Key);
+			  Data; Data = (TADS_B_Aircraft *)ght_next(Context->HashTable, &iterator, (const void **)&Key))
 	{
 	  if (Data->HaveLatLon)
 	  {
@@ -889,17 +960,19 @@ return Str.WideChar(str, Str.WideCharBufSize());
 	if (MinRange< 0.2)
 	{
 	  TADS_B_Aircraft * ADS_B_Aircraft =(TADS_B_Aircraft *)
-			ght_get(HashTable,sizeof(Current_ICAO),
+			ght_get(Context->HashTable,sizeof(Current_ICAO),
 					&Current_ICAO);
 	  if (ADS_B_Aircraft)
 	  {
 		if (!CPA_Hook)
 		{
-         AnsiString Text="Hooked Aircraft "+(AnsiString)GetAircraftDBInfo(ADS_B_Aircraft->ICAO) ;
+         char Info[2048];
+         GetAircraftDBInfo(ADS_B_Aircraft->ICAO,Info,sizeof(Info));
+         AnsiString Text="Hooked Aircraft "+(AnsiString)Info;
          wchar_t *wtext= AnsiTowchar_t(Text);
 		 TrackHook.Valid_CC=true;
 		 TrackHook.ICAO_CC=ADS_B_Aircraft->ICAO;
-		 printf("%s\n\n",GetAircraftDBInfo(ADS_B_Aircraft->ICAO));
+		 printf("%s\n\n",Info);
          SpVoice1->Speak(wtext, SpeechVoiceSpeakFlags::SVSFlagsAsync );  // Say Text and continue
          delete wtext;
 		}
@@ -939,8 +1012,61 @@ return Str.WideChar(str, Str.WideCharBufSize());
 //---------------------------------------------------------------------------
 void __fastcall TForm1::LatLon2XY(double lat,double lon, double &x, double &y)
 {
- x=(Map_v[1].x-((Map_w[1].x-(lon/360.0))/xf));
- y= Map_v[3].y- (Map_w[1].y/yf)+ (asinh(tan(lat*M_PI/180.0))/(2*M_PI*yf));
+ Mercator2XY(lon/360.0,asinh(tan(lat*M_PI/180.0))/(2*M_PI), x, y);
+}
+//---------------------------------------------------------------------------
+/*
+ * Compile the area's outline and fill into two display lists. The vertices
+ * are in Mercator units relative to the first point, so they hold for any
+ * view and keep float precision however far the map is zoomed in; the
+ * lists are only rebuilt when the area itself is replaced.
+ */
+void __fastcall TForm1::BuildAreaDisplayLists(TArea *Area)
+{
+ pfVec3 *Points=AreaPoints(Area);
+ DWORD   NumPoints=AreaNumPoints(Area);
+ std::vector<double> XY(2*NumPoints+2);
+
+ for (DWORD j = 0; j < NumPoints; j++)
+   {
+	XY[2*j]=Points[j][0]/360.0;
+	XY[2*j+1]=asinh(tan(Points[j][1]*M_PI/180.0))/(2*M_PI);
+   }
+ Area->OriginX=NumPoints ? XY[0] : 0.0;
+ Area->OriginY=NumPoints ? XY[1] : 0.0;
+ for (DWORD j = 0; j < NumPoints; j++)
+   {
+	XY[2*j]-=Area->OriginX;
+	XY[2*j+1]-=Area->OriginY;
+   }
+
+ /* The arrays are read when each list is compiled; each list is one draw call. */
+ glEnableClientState(GL_VERTEX_ARRAY);
+ glVertexPointer(2,GL_DOUBLE,0,&XY[0]);
+ Area->DisplayLists=glGenLists(2);
+ glNewList(Area->DisplayLists,GL_COMPILE);
+ glDrawArrays(GL_LINE_LOOP,0,NumPoints);
+ glEndList();
+
+ glNewList(Area->DisplayLists+1,GL_COMPILE);
+ if (!Area->Triangles.empty())
+   glDrawElements(GL_TRIANGLES,(GLsizei)Area->Triangles.size(),GL_UNSIGNED_INT,&Area->Triangles[0]);
+ glEndList();
+ glDisableClientState(GL_VERTEX_ARRAY);
+}
+//---------------------------------------------------------------------------
+/* The GL context is only current while painting, so the lists wait for DrawObjects(). */
+void __fastcall TForm1::ReleaseAreaDisplayLists(TArea *Area)
+{
+ if (Area->DisplayLists) StaleDisplayLists.push_back(Area->DisplayLists);
+ Area->DisplayLists=0;
+}
+//---------------------------------------------------------------------------
+/* Screen position of Web Mercator coordinates, e.g. TADS_B_Aircraft::MercatorX/Y. */
+void __fastcall TForm1::Mercator2XY(double mx,double my, double &x, double &y)
+{
+ x=(Map_v[1].x-((Map_w[1].x-mx)/xf));
+ y= Map_v[3].y- (Map_w[1].y/yf)+ (my/yf);
 }
 //---------------------------------------------------------------------------
 int __fastcall TForm1::XY2LatLon2(int x, int y,double &lat,double &lon )
@@ -976,28 +1102,12 @@ void __fastcall TForm1::ZoomOutClick(TObject *Sender)
 //---------------------------------------------------------------------------
 void __fastcall TForm1::Purge(void)
 {
-  uint32_t *Key;
-  ght_iterator_t iterator;
-  TADS_B_Aircraft* Data;
-  void *p;
-  __int64 CurrentTime=GetCurrentTimeInMsec();
   __int64  StaleTimeInMs=CSpinStaleTime->Value*1000;
 
   if (PurgeStale->Checked==false) return;
 
-  for(Data = (TADS_B_Aircraft *)ght_first(HashTable, &iterator,(const void **) &Key);
-			  Data; Data = (TADS_B_Aircraft *)ght_next(HashTable, &iterator, (const void **)&Key))
-	{
-	  if ((CurrentTime-Data->LastSeen)>=StaleTimeInMs)
-	  {
-	  p = ght_remove(HashTable,sizeof(*Key), Key);;
-	  if (!p)
-		ShowMessage("Removing the current iterated entry failed! This is a BUG\n");
-
-	  delete Data;
-
-	  }
-	}
+  Context->CurrentTime=GetCurrentTimeInMsec();
+  ADS_B_PurgeAircraft(Context,StaleTimeInMs);
 }
 //---------------------------------------------------------------------------
 void __fastcall TForm1::Timer2Timer(TObject *Sender)
@@ -1007,22 +1117,34 @@ void __fastcall TForm1::Timer2Timer(TObject *Sender)
 //---------------------------------------------------------------------------
 void __fastcall TForm1::PurgeButtonClick(TObject *Sender)
 {
-  uint32_t *Key;
-  ght_iterator_t iterator;
-  TADS_B_Aircraft* Data;
-  void *p;
-
-  for(Data = (TADS_B_Aircraft *)ght_first(HashTable, &iterator,(const void **) &Key);
-			  Data; Data = (TADS_B_Aircraft *)ght_next(HashTable, &iterator, (const void **)&Key))
-	{
-
-	  p = ght_remove(HashTable,sizeof(*Key), Key);
-	  if (!p)
-		ShowMessage("Removing the current iterated entry failed! This is a BUG\n");
-
-	  delete Data;
+  ADS_B_PurgeAircraft(Context,0);
+  ConflictMonitor->Clear();
+}
+//---------------------------------------------------------------------------
+pfVec3 * __fastcall TForm1::AreaPoints(TArea *Area)
+{
+ return AreaVertices.Points(Area->Span);
+}
+//---------------------------------------------------------------------------
+DWORD __fastcall TForm1::AreaNumPoints(TArea *Area)
+{
+ return AreaVertices.Count(Area->Span);
+}
+//---------------------------------------------------------------------------
+/* Free an area's points and the area itself. */
+void __fastcall TForm1::FreeArea(TArea *Area)
+{
+ AreaVertices.Release(Area->Span);
+ delete Area;
+}
+//---------------------------------------------------------------------------
+void __fastcall TForm1::TriangulateArea(TArea *Area)
+{
+ DWORD NumPoints=AreaNumPoints(Area);
 
-	}
+ Area->Triangles.resize(NumPoints>2 ? 3*(NumPoints-2) : 0);
+ if (Area->Triangles.empty()) return;
+ Area->Triangles.resize(3*triangulatePoly(AreaPoints(Area),NumPoints,&Area->Triangles[0]));
 }
 //---------------------------------------------------------------------------
 void __fastcall TForm1::InsertClick(TObject *Sender)
@@ -1034,10 +1156,13 @@ void __fastcall TForm1::InsertClick(TObject *Sender)
  //Delete->Enabled=false;
 
  AreaTemp= new TArea;
- AreaTemp->NumPoints=0;
+ AreaTemp->Span=AreaVertices.Create();
  AreaTemp->Name="";
  AreaTemp->Selected=false;
- AreaTemp->Triangles=NULL;
+ AreaTemp->DisplayLists=0;
+ AreaTemp->Fence=-1;
+ AreaTemp->LowerAltitude=GF_NO_FLOOR;
+ AreaTemp->UpperAltitude=GF_NO_CEILING;
 
 }
 //---------------------------------------------------------------------------
@@ -1046,7 +1171,7 @@ void __fastcall TForm1::CancelClick(TObject *Sender)
  TArea *Temp;
  Temp= AreaTemp;
  AreaTemp=NULL;
- delete  Temp;
+ FreeArea(Temp);
  Insert->Enabled=true;
  Complete->Enabled=false;
  Cancel->Enabled=false;
@@ -1059,25 +1184,15 @@ void __fastcall TForm1::CancelClick(TObject *Sender)
 void __fastcall TForm1::CompleteClick(TObject *Sender)
 {
 
-  int or1=orientation2D_Polygon( AreaTemp->Points,AreaTemp->NumPoints);
+  int or1=orientation2D_Polygon( AreaPoints(AreaTemp),AreaNumPoints(AreaTemp));
   if (or1==0)
    {
 	ShowMessage("Degenerate Polygon");
     CancelClick(NULL);
 	return;
    }
-  if (or1==CLOCKWISE)
-  {
-	DWORD i;
-
-	memcpy(AreaTemp->PointsAdj,AreaTemp->Points,sizeof(AreaTemp->Points));
-	for (i = 0; i <AreaTemp->NumPoints; i++)
-	 {
-	   memcpy(AreaTemp->Points[i],
-			 AreaTemp->PointsAdj[AreaTemp->NumPoints-1-i],sizeof( pfVec3));
-	 }
-  }
-  if (checkComplex( AreaTemp->Points,AreaTemp->NumPoints))
+  if (or1==CLOCKWISE) AreaVertices.Reverse(AreaTemp->Span);
+  if (checkComplex( AreaPoints(AreaTemp),AreaNumPoints(AreaTemp)))
    {
 	ShowMessage("Polygon is Complex");
 	CancelClick(NULL);
@@ -1134,15 +1249,9 @@ void __fastcall TForm1::DeleteClick(TObject *Sender)
 	  {
 	   Areas->Delete(Index);
 	   AreaListView->Items->Item[i]->Delete();
-	   TTriangles *Tri=Area->Triangles;
-	   while(Tri)
-	   {
-		TTriangles *temp=Tri;
-		Tri=Tri->next;
-		free(temp->indexList);
-		free(temp);
-	   }
-	   delete Area;
+	   ReleaseAreaDisplayLists(Area);
+	   Geofence->RemoveFence(Area->Fence);
+	   FreeArea(Area);
 	   break;
 	  }
 	 }
@@ -1174,14 +1283,22 @@ void __fastcall TForm1::AreaListViewCustomDrawItem(TCustomListView *Sender,
 
  Left = AreaListView->Column[0]->Width;
 
-  for(int   i=0   ;i<Item->SubItems->Count;i++)
+  if (Item->SubItems->Count>0)
 	 {
 	  R=Item->DisplayRect(drBounds);
 	  R.Left=R.Left+Left;
+	  R.Right=R.Left+AreaListView->Column[1]->Width;
 	   TArea *Area=(TArea *)Item->Data;
 	  AreaListView->Canvas->Brush->Color=Area->Color;
 	  AreaListView->Canvas->FillRect(R);
 	 }
+  if (Item->SubItems->Count>1)
+	 {
+	  R=Item->DisplayRect(drBounds);
+	  AreaListView->Canvas->Brush->Color = AreaListView->Color;
+	  AreaListView->Canvas->TextOut(R.Left+Left+AreaListView->Column[1]->Width+2, R.Top,
+									Item->SubItems->Strings[1]);
+	 }
 
   if (Item->Selected)
 	 {
@@ -1208,15 +1325,9 @@ void __fastcall TForm1::DeleteAllAreas(void)
 	  {
 	   Areas->Delete(Index);
 	   AreaListView->Items->Item[i]->Delete();
-	   TTriangles *Tri=Area->Triangles;
-	   while(Tri)
-	   {
-		TTriangles *temp=Tri;
-		Tri=Tri->next;
-		free(temp->indexList);
-		free(temp);
-	   }
-	   delete Area;
+	   ReleaseAreaDisplayLists(Area);
+	   Geofence->RemoveFence(Area->Fence);
+	   FreeArea(Area);
 	   break;
 	  }
 	 }
@@ -1245,11 +1356,12 @@ void __fastcall TTCPClientRawHandleThread::HandleInput(void)
   {
    __int64 CurrentTime;
    CurrentTime=GetCurrentTimeInMsec();
-   Form1->RecordRawStream->WriteLine(IntToStr(CurrentTime));
-   Form1->RecordRawStream->WriteLine(StringMsgBuffer);
+   AnsiString Record=IntToStr(CurrentTime)+AW_NEWLINE+StringMsgBuffer;
+   Form1->RecordRawStream->WriteLine(Record.c_str());
   }
 
-  Status=decode_RAW_message(StringMsgBuffer, &mm);
+  Form1->Context->CurrentTime=GetCurrentTimeInMsec();
+  Status=decode_RAW_message(Form1->Context,StringMsgBuffer.c_str(), &mm);
   if (Status==HaveMsg)
   {
    TADS_B_Aircraft *ADS_B_Aircraft;
@@ -1257,37 +1369,10 @@ void __fastcall TTCPClientRawHandleThread::HandleInput(void)
 
 	addr = (mm.AA[0] << 16) | (mm.AA[1] << 8) | mm.AA[2];
 
-
-	ADS_B_Aircraft =(TADS_B_Aircraft *) ght_get(Form1->HashTable,sizeof(addr),&addr);
-	if (ADS_B_Aircraft)
-	  {
-      	//Form1->MsgLog->Lines->Add("Retrived");
-      }
-    else
-	  {
-  	   ADS_B_Aircraft= new TADS_B_Aircraft;
-	   ADS_B_Aircraft->ICAO=addr;
-	   snprintf(ADS_B_Aircraft->HexAddr,sizeof(ADS_B_Aircraft->HexAddr),"%06X",(int)addr);
-	   ADS_B_Aircraft->NumMessagesSBS=0;
-       ADS_B_Aircraft->NumMessagesRaw=0;
-       ADS_B_Aircraft->VerticalRate=0;
-	   ADS_B_Aircraft->HaveAltitude=false;
-       ADS_B_Aircraft->HaveLatLon=false;
-	   ADS_B_Aircraft->HaveSpeedAndHeading=false;
-	   ADS_B_Aircraft->HaveFlightNum=false;
-       ADS_B_Aircraft->HaveRoute=false;
-       ADS_B_Aircraft->RequestedRoute=false;
-       ADS_B_Aircraft->Route[0]=NULL;
-	   ADS_B_Aircraft->SpriteImage=Form1->CurrentSpriteImage;
-	   if (Form1->CycleImages->Checked)
-		 Form1->CurrentSpriteImage=(Form1->CurrentSpriteImage+1)%Form1->NumSpriteImages;
-	   if (ght_insert(Form1->HashTable,ADS_B_Aircraft,sizeof(addr), &addr) < 0)
-		  {
-			printf("ght_insert Error - Should Not Happen\n");
-		  }
-	  }
-
-	  RawToAircraft(&mm,ADS_B_Aircraft);
+	ADS_B_Aircraft=FindOrAddAircraft(Form1->Context,addr);
+	RawToAircraft(Form1->Context,&mm,ADS_B_Aircraft);
+	if (Form1->TrackRecorder)
+	  Form1->TrackRecorder->AppendAircraft(ADS_B_Aircraft,Form1->Context->CurrentTime);
   }
   else  printf("Raw Decode Error:%d\n",Status);
 }
@@ -1347,9 +1432,12 @@ void __fastcall TForm1::RawRecordButtonClick(TObject *Sender)
 	else
 	{
 		// Open a file for writing. Creates the file if it doesn't exist, or overwrites it if it does.
-	RecordRawStream= new TStreamWriter(RecordRawSaveDialog->FileName, false);
-	if (RecordRawStream==NULL)
+	RecordRawStream= new TAsyncWriter(AnsiString(RecordRawSaveDialog->FileName).c_str(),
+									   AW_DEFAULT_BUFFER_SIZE,AW_FSYNC_PERIODIC);
+	if (!RecordRawStream->IsOpen())
 	  {
+		delete RecordRawStream;
+		RecordRawStream=NULL;
 		ShowMessage("Cannot Open File "+RecordRawSaveDialog->FileName);
 	  }
 	 else RawRecordButton->Caption="Stop Raw Recording";
@@ -1496,6 +1584,77 @@ void __fastcall TForm1::CycleImagesClick(TObject *Sender)
  CurrentSpriteImage=0;
 }
 //---------------------------------------------------------------------------
+static void OnNewAircraft(TADS_B_Context *Ctx, TADS_B_Aircraft *ADS_B_Aircraft)
+{
+ ((TForm1 *)Ctx->UserData)->AssignSpriteImage(ADS_B_Aircraft);
+}
+//---------------------------------------------------------------------------
+static void OnAircraftUpdate(TADS_B_Context *Ctx, TADS_B_Aircraft *ADS_B_Aircraft)
+{
+ ((TForm1 *)Ctx->UserData)->ConflictMonitor->Update(ADS_B_Aircraft);
+ ((TForm1 *)Ctx->UserData)->CheckGeofences(ADS_B_Aircraft);
+}
+//---------------------------------------------------------------------------
+static void OnRemoveAircraft(TADS_B_Context *Ctx, TADS_B_Aircraft *ADS_B_Aircraft)
+{
+ ((TForm1 *)Ctx->UserData)->Geofence->Forget(ADS_B_Aircraft->ICAO);
+}
+//---------------------------------------------------------------------------
+/* Show the latest aircraft to enter or leave an area under the area list. */
+void __fastcall TForm1::CheckGeofences(TADS_B_Aircraft *ADS_B_Aircraft)
+{
+ GeofenceEvents.clear();
+ Geofence->Update(ADS_B_Aircraft,GeofenceEvents);
+ for (unsigned int i = 0; i < GeofenceEvents.size(); i++)
+   for (int j = 0; j < Areas->Count; j++)
+	 {
+	  TArea *Area = (TArea *)Areas->Items[j];
+	  if (Area->Fence!=GeofenceEvents[i].Fence) continue;
+	  GeofenceEventLabel->Caption=AnsiString(TimeToChar(Context->CurrentTime))+"  "+
+		AnsiString(ADS_B_Aircraft->HexAddr)+
+		(GeofenceEvents[i].Type==GEOFENCE_ENTER ? " entered " : " left ")+Area->Name;
+	  GeofenceEventLabel->Font->Color=GeofenceEvents[i].Type==GEOFENCE_ENTER ? clRed : clWindowText;
+	  break;
+	 }
+}
+//---------------------------------------------------------------------------
+/* Show the number of aircraft in each area (sector load) where it changed. */
+void __fastcall TForm1::UpdateAreaLoads(void)
+{
+ bool Changed=false;
+
+ for (int i = 0; i < AreaListView->Items->Count; i++)
+   {
+	TListItem *Item=AreaListView->Items->Item[i];
+	TArea     *Area=(TArea *)Item->Data;
+	if (Item->SubItems->Count<2) continue;
+	AnsiString Load=IntToStr((int)Geofence->NumInside(Area->Fence));
+	if (Item->SubItems->Strings[1]==Load) continue;
+	if (!Changed) AreaListView->Items->BeginUpdate();
+	Item->SubItems->Strings[1]=Load;
+	Changed=true;
+   }
+ if (Changed) AreaListView->Items->EndUpdate();
+}
+//---------------------------------------------------------------------------
+TArea * __fastcall TForm1::AreaOfFence(int Fence)
+{
+ if (Fence<0) return NULL;
+ for (int i = 0; i < Areas->Count; i++)
+   {
+	TArea *Area = (TArea *)Areas->Items[i];
+	if (Area->Fence==Fence) return Area;
+   }
+ return NULL;
+}
+//---------------------------------------------------------------------------
+void __fastcall TForm1::AssignSpriteImage(TADS_B_Aircraft *ADS_B_Aircraft)
+{
+ ADS_B_Aircraft->SpriteImage=CurrentSpriteImage;
+ if (CycleImages->Checked)
+   CurrentSpriteImage=(CurrentSpriteImage+1)%NumSpriteImages;
+}
+//---------------------------------------------------------------------------
 void __fastcall TForm1::SBSConnectButtonClick(TObject *Sender)
 {
  IdTCPClientSBS->Host=SBSIpAddress->Text;
@@ -1538,23 +1697,17 @@ void __fastcall TTCPClientSBSHandleThread::HandleInput(void)
   {
    __int64 CurrentTime;
    CurrentTime=GetCurrentTimeInMsec();
-   Form1->RecordSBSStream->WriteLine(IntToStr(CurrentTime));
-   Form1->RecordSBSStream->WriteLine(StringMsgBuffer);
+   AnsiString Record=IntToStr(CurrentTime)+AW_NEWLINE+StringMsgBuffer;
+   Form1->RecordSBSStream->WriteLine(Record.c_str());
   }
 
-  if (Form1->BigQueryCSV)
-  {
-    Form1->BigQueryCSV->WriteLine(StringMsgBuffer);
-    Form1->BigQueryRowCount++;
-	if (Form1->BigQueryRowCount>=BIG_QUERY_UPLOAD_COUNT)
-	{
-	 Form1->CloseBigQueryCSV();
-	 //printf("string is:%s\n", Form1->BigQueryPythonScript.c_str());
-	 RunPythonScript(Form1->BigQueryPythonScript,Form1->BigQueryPath+" "+Form1->BigQueryCSVFileName);
-	 Form1->CreateBigQueryCSV();
-	}
-  }
-  SBS_Message_Decode( StringMsgBuffer.c_str());
+  if (Form1->BigQueryExport)
+	Form1->BigQueryExport->Append(StringMsgBuffer.c_str());
+  TADS_B_Aircraft *ADS_B_Aircraft;
+  Form1->Context->CurrentTime=GetCurrentTimeInMsec();
+  ADS_B_Aircraft=SBS_Message_Decode(Form1->Context,StringMsgBuffer.c_str());
+  if (ADS_B_Aircraft && Form1->TrackRecorder)
+	Form1->TrackRecorder->AppendAircraft(ADS_B_Aircraft,Form1->Context->CurrentTime);
 
 }
 //---------------------------------------------------------------------------
@@ -1658,9 +1811,12 @@ void __fastcall TForm1::SBSRecordButtonClick(TObject *Sender)
 	else
 	{
 		// Open a file for writing. Creates the file if it doesn't exist, or overwrites it if it does.
-	RecordSBSStream= new TStreamWriter(RecordSBSSaveDialog->FileName, false);
-	if (RecordSBSStream==NULL)
+	RecordSBSStream= new TAsyncWriter(AnsiString(RecordSBSSaveDialog->FileName).c_str(),
+									   AW_DEFAULT_BUFFER_SIZE,AW_FSYNC_PERIODIC);
+	if (!RecordSBSStream->IsOpen())
 	  {
+		delete RecordSBSStream;
+		RecordSBSStream=NULL;
 		ShowMessage("Cannot Open File "+RecordSBSSaveDialog->FileName);
 	  }
 	 else SBSRecordButton->Caption="Stop SBS Recording";
@@ -1741,82 +1897,30 @@ void __fastcall TForm1::TimeToGoTrackBarChange(TObject *Sender)
 void __fastcall TForm1::LoadMap(int Type)
 {
    AnsiString  HomeDir = ExtractFilePath(ExtractFileDir(Application->ExeName));
-    if (Type==GoogleMaps)
-   {
-     HomeDir+= "..\\GoogleMap";
-     if (LoadMapFromInternet) HomeDir+= "_Live\\";
-     else  HomeDir+= "\\";
-     std::string cachedir;
-     cachedir=HomeDir.c_str();
-
-     if (mkdir(cachedir.c_str()) != 0 && errno != EEXIST)
-	    throw Sysutils::Exception("Can not create cache directory");
-
-     g_Storage = new FilesystemStorage(cachedir,true);
-     if (LoadMapFromInternet)
-       {
-	    g_Keyhole = new KeyholeConnection(GoogleMaps);
-        g_Keyhole->SetSaveStorage(g_Storage);
-	    g_Storage->SetNextLoadStorage(g_Keyhole);
-	   }
-    }
-  else if (Type==SkyVector_VFR)
-   {
-     HomeDir+= "..\\VFR_Map";
-     if (LoadMapFromInternet) HomeDir+= "_Live\\";
-     else  HomeDir+= "\\";
-     std::string cachedir;
-     cachedir=HomeDir.c_str();
-
-     if (mkdir(cachedir.c_str()) != 0 && errno != EEXIST)
-	    throw Sysutils::Exception("Can not create cache directory");
-
-     g_Storage = new FilesystemStorage(cachedir,true);
-     if (LoadMapFromInternet)
-       {
-	    g_Keyhole = new KeyholeConnection(SkyVector_VFR);
-        g_Keyhole->SetSaveStorage(g_Storage);
-	    g_Storage->SetNextLoadStorage(g_Keyhole);
-	   }
-    }
-  else if (Type==SkyVector_IFR_Low)
-   {
-     HomeDir+= "..\\IFR_Low_Map";
-     if (LoadMapFromInternet) HomeDir+= "_Live\\";
-     else  HomeDir+= "\\";
-     std::string cachedir;
-     cachedir=HomeDir.c_str();
-
-     if (mkdir(cachedir.c_str()) != 0 && errno != EEXIST)
-	    throw Sysutils::Exception("Can not create cache directory");
-
-     g_Storage = new FilesystemStorage(cachedir,true);
-     if (LoadMapFromInternet)
-       {
-	    g_Keyhole = new KeyholeConnection(SkyVector_IFR_Low);
-        g_Keyhole->SetSaveStorage(g_Storage);
-	    g_Storage->SetNextLoadStorage(g_Keyhole);
-	   }
-    }
-  else if (Type==SkyVector_IFR_High)
-   {
-     HomeDir+= "..\\IFR_High_Map";
-     if (LoadMapFromInternet) HomeDir+= "_Live\\";
-     else  HomeDir+= "\\";
-     std::string cachedir;
-     cachedir=HomeDir.c_str();
-
-     if (mkdir(cachedir.c_str()) != 0 && errno != EEXIST)
-	    throw Sysutils::Exception("Can not create cache directory");
-
-     g_Storage = new FilesystemStorage(cachedir,true);
-     if (LoadMapFromInternet)
-       {
-	    g_Keyhole = new KeyholeConnection(SkyVector_IFR_High);
-        g_Keyhole->SetSaveStorage(g_Storage);
-	    g_Storage->SetNextLoadStorage(g_Keyhole);
-	   }
-    }
+   if (Type==GoogleMaps)              HomeDir+= "..\\GoogleMap";
+   else if (Type==SkyVector_VFR)      HomeDir+= "..\\VFR_Map";
+   else if (Type==SkyVector_IFR_Low)  HomeDir+= "..\\IFR_Low_Map";
+   else if (Type==SkyVector_IFR_High) HomeDir+= "..\\IFR_High_Map";
+   if (LoadMapFromInternet) HomeDir+= "_Live\\";
+   else  HomeDir+= "\\";
+   std::string cachedir;
+   cachedir=HomeDir.c_str();
+
+   if (mkdir(cachedir.c_str()) != 0 && errno != EEXIST)
+	  throw Sysutils::Exception("Can not create cache directory");
+
+   // Tiles are kept in an archive in the cache directory; tiles still in
+   // files of their own from before are moved into it as they are loaded
+   g_Storage = new TileArchiveStorage(cachedir);
+   g_LegacyStorage = new FilesystemStorage(cachedir,true);
+   g_LegacyStorage->SetSaveStorage(g_Storage);
+   g_Storage->SetNextLoadStorage(g_LegacyStorage);
+   if (LoadMapFromInternet)
+     {
+	  g_Keyhole = new KeyholeConnection(Type);
+      g_Keyhole->SetSaveStorage(g_Storage);
+	  g_LegacyStorage->SetNextLoadStorage(g_Keyhole);
+	 }
    g_GETileManager = new TileManager(g_Storage);
    g_MasterLayer = new GoogleLayer(g_GETileManager);
 
@@ -1836,11 +1940,14 @@ void __fastcall TForm1::MapComboBoxChange(TObject *Sender)
   delete g_EarthView;
   if (g_GETileManager) delete g_GETileManager;
   delete g_MasterLayer;
-  delete g_Storage;
+  g_LegacyStorage->Detach();
+  g_Storage->Detach();
   if (LoadMapFromInternet)
   {
    if (g_Keyhole) delete g_Keyhole;
   }
+  delete g_LegacyStorage;
+  delete g_Storage;
   if (MapComboBox->ItemIndex==0)   LoadMap(GoogleMaps);
 
   else if (MapComboBox->ItemIndex==1)  LoadMap(SkyVector_VFR);
@@ -1860,39 +1967,52 @@ void __fastcall TForm1::MapComboBoxChange(TObject *Sender)
 
 void __fastcall TForm1::BigQueryCheckBoxClick(TObject *Sender)
 {
- if (BigQueryCheckBox->State==cbChecked) CreateBigQueryCSV();
- else {
-	   CloseBigQueryCSV();
-	   RunPythonScript(BigQueryPythonScript,BigQueryPath+" "+BigQueryCSVFileName);
-	  }
+ if (BigQueryCheckBox->State==cbChecked)
+   {
+	// The uploader follows the spool directory until the export is closed.
+	if (CreateBigQueryExport()) StartBigQueryUploader();
+   }
+ else CloseBigQueryExport();
 }
 //---------------------------------------------------------------------------
-void __fastcall TForm1::CreateBigQueryCSV(void)
+bool __fastcall TForm1::CreateBigQueryExport(void)
 {
-    AnsiString  HomeDir = ExtractFilePath(ExtractFileDir(Application->ExeName));
-    BigQueryCSVFileName="BigQuery"+UIntToStr(BigQueryFileCount)+".csv";
-    BigQueryRowCount=0;
-    BigQueryFileCount++;
-    BigQueryCSV=new TStreamWriter(HomeDir+"..\\BigQuery\\"+BigQueryCSVFileName, false);
-    if (BigQueryCSV==NULL)
+	BigQueryExport=new TColumnarExporter(BigQueryPath.c_str(),(BigQueryPath+"spool").c_str(),"BigQuery");
+	if (!BigQueryExport->IsOpen())
 	  {
-		ShowMessage("Cannot Open BigQuery CSV File "+HomeDir+"..\\BigQuery\\"+BigQueryCSVFileName);
-        BigQueryCheckBox->State=cbUnchecked;
+		delete BigQueryExport;
+		BigQueryExport=NULL;
+		ShowMessage("Cannot Start BigQuery Export in "+BigQueryPath);
+		BigQueryCheckBox->State=cbUnchecked;
+		return false;
 	  }
-	AnsiString Header=AnsiString("Message Type,Transmission Type,SessionID,AircraftID,HexIdent,FlightID,Date_MSG_Generated,Time_MSG_Generated,Date_MSG_Logged,Time_MSG_Logged,Callsign,Altitude,GroundSpeed,Track,Latitude,Longitude,VerticalRate,Squawk,Alert,Emergency,SPI,IsOnGround");
-	BigQueryCSV->WriteLine(Header);
+	return true;
 }
 //--------------------------------------------------------------------------
-void __fastcall TForm1::CloseBigQueryCSV(void)
+void __fastcall TForm1::CloseBigQueryExport(void)
 {
-    if (BigQueryCSV)
-    {
-     delete BigQueryCSV;
-     BigQueryCSV=NULL;
-    }
+	if (BigQueryExport)
+	{
+	 delete BigQueryExport;
+	 BigQueryExport=NULL;
+	}
 }
 //--------------------------------------------------------------------------
-	 static void RunPythonScript(AnsiString scriptPath,AnsiString args)
+/*
+ * Start the uploader unless the one started before is still running: it is
+ * draining the spool and picks up the new export's files as well.
+ */
+void __fastcall TForm1::StartBigQueryUploader(void)
+{
+	if (BigQueryUploader)
+	{
+	 if (WaitForSingleObject(BigQueryUploader,0)==WAIT_TIMEOUT) return;
+	 CloseHandle(BigQueryUploader);
+	}
+	BigQueryUploader=RunPythonScript(BigQueryPythonScript,BigQueryPath);
+}
+//--------------------------------------------------------------------------
+	 static HANDLE RunPythonScript(AnsiString scriptPath,AnsiString args)
      {
         STARTUPINFOA si;
         PROCESS_INFORMATION pi;
@@ -1941,14 +2061,19 @@ void __fastcall TForm1::CloseBigQueryCSV(void)
             &pi))             // Pointer to PROCESS_INFORMATION structure
          {
             std::cerr << "CreateProcess failed (" << GetLastError() << ").\n";
+	#if LOG_PYTHON
+			CloseHandle(h);
+	#endif
             delete[] cmdLineCharArray;
-            return;
+            return NULL;
          }
 
-        // Optionally, detach from the process
-        CloseHandle(pi.hProcess);
+	#if LOG_PYTHON
+		CloseHandle(h);   // the child has its own copy
+	#endif
 		CloseHandle(pi.hThread);
 		delete[] cmdLineCharArray;
+		return pi.hProcess;
     }
 
  //--------------------------------------------------------------------------
@@ -1987,12 +2112,15 @@ static bool DeleteFilesWithExtension(AnsiString dirPath, AnsiString extension)
 }
 static bool IsFirstRow=true;
 static bool CallBackInit=false;
+static bool ARTCCDuplicate=false;
 //---------------------------------------------------------------------------
  static int CSV_callback_ARTCCBoundaries (struct CSV_context *ctx, const char *value)
 {
   int    rc = 1;
   static char LastArea[512];
   static char Area[512];
+  static char Lower[512];
+  static char Upper[512];
   static char Lat[512];
   static char Lon[512];
   int    Deg,Min,Sec,Hsec;
@@ -2002,6 +2130,14 @@ static bool CallBackInit=false;
    {
 	strcpy(Area,value);
    }
+   else if (ctx->field_num==1)
+   {
+	strcpy(Lower,value);
+   }
+   else if (ctx->field_num==2)
+   {
+	strcpy(Upper,value);
+   }
    else if (ctx->field_num==3)
    {
 	strcpy(Lat,value);
@@ -2035,10 +2171,15 @@ static bool CallBackInit=false;
 	   if (Form1->AreaTemp==NULL)
 		   {
 			Form1->AreaTemp= new TArea;
-			Form1->AreaTemp->NumPoints=0;
+			Form1->AreaTemp->Span=Form1->AreaVertices.Create();
 			Form1->AreaTemp->Name=Area;
 			Form1->AreaTemp->Selected=false;
-			Form1->AreaTemp->Triangles=NULL;
+			Form1->AreaTemp->DisplayLists=0;
+			Form1->AreaTemp->Fence=-1;
+			Form1->AreaTemp->LowerAltitude=Lower[0] ? atof(Lower) : GF_NO_FLOOR;
+			Form1->AreaTemp->UpperAltitude=Upper[0] ? atof(Upper) : GF_NO_CEILING;
+			if (Form1->AreaTemp->UpperAltitude<=Form1->AreaTemp->LowerAltitude)
+			  Form1->AreaTemp->UpperAltitude=GF_NO_CEILING;
 			 printf("Loading ID %s\n",Area);
 		   }
 	   if (sscanf(Lat,"%2d%2d%2d%2d%c",&Deg,&Min,&Sec,&Hsec,&Dir)!=5)
@@ -2051,14 +2192,7 @@ static bool CallBackInit=false;
 	   fLon=Deg+Min/60.0+Sec/3600.0+Hsec/360000.00;
 	   if (Dir=='W') fLon=-fLon;
 	   //printf("%f, %f\n",fLat,fLon);
-	   if (Form1->AreaTemp->NumPoints<MAX_AREA_POINTS)
-	   {
-		Form1->AreaTemp->Points[Form1->AreaTemp->NumPoints][1]=fLat;
-		Form1->AreaTemp->Points[Form1->AreaTemp->NumPoints][0]=fLon;
-		Form1->AreaTemp->Points[Form1->AreaTemp->NumPoints][2]=0.0;
-		Form1->AreaTemp->NumPoints++;
-	   }
-		else printf("Max Area Points Reached\n");
+	   Form1->AreaVertices.Append(Form1->AreaTemp->Span,fLon,fLat,0.0);
 
    }
    if (IsFirstRow) IsFirstRow=false;
@@ -2069,6 +2203,15 @@ static bool CallBackInit=false;
 bool __fastcall TForm1::LoadARTCCBoundaries(AnsiString FileName)
 {
   CSV_context  csv_ctx;
+  AnsiString   CacheFile=ChangeFileExt(FileName,BC_EXTENSION);
+  int          FirstArea=Areas->Count;
+  int          Cached=LoadARTCCCache(CacheFile,FileName);
+
+   if (Cached>=0)
+	{
+	 printf("Loaded %d areas from %s\n",Cached,CacheFile.c_str());
+	 return(true);
+	}
    memset (&csv_ctx, 0, sizeof(csv_ctx));
    csv_ctx.file_name = FileName.c_str();
    csv_ctx.delimiter = ',';
@@ -2076,12 +2219,15 @@ bool __fastcall TForm1::LoadARTCCBoundaries(AnsiString FileName)
    csv_ctx.line_size = 2000;
    IsFirstRow=true;
    CallBackInit=false;
+   ARTCCDuplicate=false;
+   AreaListView->Items->BeginUpdate();
    if (!CSV_open_and_parse_file(&csv_ctx))
     {
+	  AreaListView->Items->EndUpdate();
 	  printf("Parsing of \"%s\" failed: %s\n", FileName.c_str(), strerror(errno));
       return (false);
 	}
-   if ((Form1->AreaTemp!=NULL) && (Form1->AreaTemp->NumPoints>0))
+   if ((Form1->AreaTemp!=NULL) && (Form1->AreaNumPoints(Form1->AreaTemp)>0))
    {
      char Area[512];
      strcpy(Area,Form1->AreaTemp->Name.c_str());
@@ -2091,10 +2237,71 @@ bool __fastcall TForm1::LoadARTCCBoundaries(AnsiString FileName)
 	    }
         else printf("Loaded ID %s\n",Area);
    }
+   AreaListView->Items->EndUpdate();
+   /* Areas already loaded under the same names were skipped, so the set is incomplete. */
+   if (!ARTCCDuplicate) SaveARTCCCache(CacheFile,FileName,FirstArea);
    printf("Done\n");
    return(true);
 }
 //---------------------------------------------------------------------------
+/*
+ * Add the areas of a boundary cache built from FileName, as parsing it
+ * would. @return the number of areas added, -1 without a valid cache
+ */
+static int LoadARTCCCache(AnsiString CacheFile, AnsiString FileName)
+{
+ TBoundaryCache Cache;
+ int            Loaded=0;
+
+ if (!Cache.Open(CacheFile.c_str(),FileName.c_str())) return(-1);
+
+ Form1->AreaListView->Items->BeginUpdate();
+ for (unsigned int i = 0; i < Cache.NumAreas(); i++)
+   {
+	const TBoundaryRecord *r=Cache.Area(i);
+	bool                   Duplicate=false;
+
+	for (int j = 0; j < Form1->Areas->Count && !Duplicate; j++)
+	  Duplicate=((TArea *)Form1->Areas->Items[j])->Name==r->Name;
+	if (Duplicate)
+	  {
+	   printf("Duplicate Area Name %s\n",r->Name);
+	   continue;
+	  }
+	TArea *Area= new TArea;
+	Area->Name=r->Name;
+	Area->Selected=false;
+	Area->DisplayLists=0;
+	Area->Fence=-1;
+	Area->LowerAltitude=r->LowerAltitude;
+	Area->UpperAltitude=r->UpperAltitude;
+	Area->Span=Form1->AreaVertices.Create();
+	Form1->AreaVertices.Append(Area->Span,Cache.Points(i),r->NumPoints);
+	Area->Triangles.assign(Cache.Indices(i),Cache.Indices(i)+r->NumIndices);
+	AddARTCCArea(Area);
+	Loaded++;
+   }
+ Form1->AreaListView->Items->EndUpdate();
+ return(Loaded);
+}
+//---------------------------------------------------------------------------
+/* Write the areas from FirstArea on, just loaded from FileName, to its cache. */
+static void SaveARTCCCache(AnsiString CacheFile, AnsiString FileName, int FirstArea)
+{
+ TBoundaryCacheWriter Writer;
+
+ for (int i = FirstArea; i < Form1->Areas->Count; i++)
+   {
+	TArea *Area = (TArea *)Form1->Areas->Items[i];
+	Writer.Add(Area->Name.c_str(),Area->LowerAltitude,Area->UpperAltitude,
+			   Form1->AreaPoints(Area),Form1->AreaNumPoints(Area),
+			   Area->Triangles.empty() ? NULL : &Area->Triangles[0],
+			   (unsigned int)Area->Triangles.size());
+   }
+ if (Writer.Save(CacheFile.c_str(),FileName.c_str()))
+   printf("Saved %s\n",CacheFile.c_str());
+}
+//---------------------------------------------------------------------------
 void __fastcall TForm1::LoadARTCCBoundaries1Click(TObject *Sender)
 {
    LoadARTCCBoundaries(ARTCCBoundaryDataPathFileName);
@@ -2102,37 +2309,27 @@ void __fastcall TForm1::LoadARTCCBoundaries1Click(TObject *Sender)
 //---------------------------------------------------------------------------
 static int FinshARTCCBoundary(void)
 {
-  int or1=orientation2D_Polygon( Form1->AreaTemp->Points,Form1->AreaTemp->NumPoints);
+  int or1=orientation2D_Polygon( Form1->AreaPoints(Form1->AreaTemp),Form1->AreaNumPoints(Form1->AreaTemp));
   if (or1==0)
    {
 	TArea *Temp;
 	Temp= Form1->AreaTemp;
 	Form1->AreaTemp=NULL;
-	delete  Temp;
+	Form1->FreeArea(Temp);
 	printf("Degenerate Polygon\n");
 	return(-1);
    }
-  if (or1==CLOCKWISE)
-  {
-	DWORD i;
-
-	memcpy(Form1->AreaTemp->PointsAdj,Form1->AreaTemp->Points,sizeof(Form1->AreaTemp->Points));
-	for (i = 0; i <Form1->AreaTemp->NumPoints; i++)
-	 {
-	   memcpy(Form1->AreaTemp->Points[i],
-			 Form1->AreaTemp->PointsAdj[Form1->AreaTemp->NumPoints-1-i],sizeof( pfVec3));
-	 }
-  }
-  if (checkComplex( Form1->AreaTemp->Points,Form1->AreaTemp->NumPoints))
+  if (or1==CLOCKWISE) Form1->AreaVertices.Reverse(Form1->AreaTemp->Span);
+  if (checkComplex( Form1->AreaPoints(Form1->AreaTemp),Form1->AreaNumPoints(Form1->AreaTemp)))
    {
 	TArea *Temp;
 	Temp= Form1->AreaTemp;
 	Form1->AreaTemp=NULL;
-	delete  Temp;
+	Form1->FreeArea(Temp);
 	printf("Polygon is Complex\n");
     return(-2);
    }
-  DWORD Row,Count,i;
+  DWORD Count,i;
 
 
  Count=Form1->Areas->Count;
@@ -2144,28 +2341,38 @@ static int FinshARTCCBoundary(void)
    TArea *Temp;
    Temp= Form1->AreaTemp;
    printf("Duplicate Area Name %s\n",Form1->AreaTemp->Name.c_str());;
+   ARTCCDuplicate=true;
    Form1->AreaTemp=NULL;
-   delete  Temp;
+   Form1->FreeArea(Temp);
    return(-3);
    }
  }
 
- triangulatePoly(Form1->AreaTemp->Points,Form1->AreaTemp->NumPoints,
-				 &Form1->AreaTemp->Triangles);
+ Form1->TriangulateArea(Form1->AreaTemp);
+ AddARTCCArea(Form1->AreaTemp);
+ Form1->AreaTemp=NULL;
+ return 0 ;
+}
+//---------------------------------------------------------------------------
+/* Give a triangulated boundary its fence and color and list it. */
+static void AddARTCCArea(TArea *Area)
+{
+ DWORD Row;
 
- Form1->AreaTemp->Color=TColor(PopularColors[CurrentColor]);
+ Area->Fence=Form1->Geofence->AddFence(Form1->AreaPoints(Area),Form1->AreaNumPoints(Area),
+									   Area->LowerAltitude,Area->UpperAltitude);
+ Area->Color=TColor(PopularColors[CurrentColor]);
  CurrentColor++ ;
  CurrentColor=CurrentColor%NumColors;
- Form1->Areas->Add(Form1->AreaTemp);
+ Form1->Areas->Add(Area);
  Form1->AreaListView->Items->BeginUpdate();
  Form1->AreaListView->Items->Add();
  Row=Form1->AreaListView->Items->Count-1;
- Form1->AreaListView->Items->Item[Row]->Caption=Form1->AreaTemp->Name;
- Form1->AreaListView->Items->Item[Row]->Data=Form1->AreaTemp;
+ Form1->AreaListView->Items->Item[Row]->Caption=Area->Name;
+ Form1->AreaListView->Items->Item[Row]->Data=Area;
  Form1->AreaListView->Items->Item[Row]->SubItems->Add("");
+ Form1->AreaListView->Items->Item[Row]->SubItems->Add("0");
  Form1->AreaListView->Items->EndUpdate();
- Form1->AreaTemp=NULL;
- return 0 ;
 }
 //---------------------------------------------------------------------------
 
@@ -14,12 +14,21 @@
 #include <IdBaseComponent.hpp>
 #include <IdComponent.hpp>
 #include <Graphics.hpp>
-#include "FilesystemStorage.h"
+#include "TileArchiveStorage.h"
 #include "KeyholeConnection.h"
 #include "GoogleLayer.h"
 #include "FlatEarthView.h"
 #include "ght_hash_table.h"
 #include "TriangulatPoly.h"
+#include "AsyncWriter.h"
+#include "ColumnarExport.h"
+#include "TrackRecorder.h"
+#include "ConflictDetect.h"
+#include "Geofence.h"
+#include "RouteResolver.h"
+#include "VertexArena.h"
+#include "ADSBCore.h"
+#include "Aircraft.h"
 #include <Dialogs.hpp>
 #include <IdTCPClient.hpp>
 #include <IdTCPConnection.hpp>
@@ -50,16 +59,18 @@ typedef struct
 }TPolyLine;
 
 
-#define MAX_AREA_POINTS 500
 typedef struct
 {
  AnsiString  Name;
  TColor      Color;
- DWORD       NumPoints;
- pfVec3      Points[MAX_AREA_POINTS];
- pfVec3      PointsAdj[MAX_AREA_POINTS];
- TTriangles *Triangles;
+ int         Span;                /* Its points in TForm1::AreaVertices. */
+ std::vector<unsigned int> Triangles;  /* Three indices into its points each. */
  bool        Selected;
+ GLuint      DisplayLists;        /* Outline and fill, built on first draw, 0 until then. */
+ double      OriginX,OriginY;     /* Mercator point the lists are relative to. */
+ int         Fence;               /* In TForm1::Geofence, -1 until the area is added. */
+ double      LowerAltitude;       /* Feet, the volume is LowerAltitude up to UpperAltitude. */
+ double      UpperAltitude;
 }TArea;
 //---------------------------------------------------------------------------
 class  TTCPClientRawHandleThread : public TThread
@@ -121,6 +132,7 @@ __published:	// IDE-managed Components
 	TButton *Delete;
 	TButton *Complete;
 	TButton *Cancel;
+	TLabel *GeofenceEventLabel;
 	TButton *RawConnectButton;
 	TLabel *Label16;
 	TLabel *Label17;
@@ -176,13 +188,14 @@ __published:	// IDE-managed Components
 	TLabel *Label19;
 	TLabel *CpaTimeValue;
 	TLabel *CpaDistanceValue;
+	TLabel *Label21;
+	TLabel *ConflictCountValue;
 	TPanel *Panel2;
 	TComboBox *MapComboBox;
 	TCheckBox *BigQueryCheckBox;
 	TMenuItem *UseSBSLocal;
 	TMenuItem *UseSBSRemote;
 	TMenuItem *LoadARTCCBoundaries1;
-	TNetHTTPClient *NetHTTPClientRoute;
 	TLabel *Label20;
 	TLabel *RouteLabel;
 	TSpVoice *SpVoice1;
@@ -250,18 +263,31 @@ public:		// User declarations
 	__fastcall TForm1(TComponent* Owner);
 	__fastcall ~TForm1();
 	void __fastcall LatLon2XY(double lat,double lon, double &x, double &y);
+	void __fastcall Mercator2XY(double mx,double my, double &x, double &y);
+	void __fastcall BuildAreaDisplayLists(TArea *Area);
+	void __fastcall ReleaseAreaDisplayLists(TArea *Area);
+	pfVec3 * __fastcall AreaPoints(TArea *Area);
+	DWORD __fastcall AreaNumPoints(TArea *Area);
+	void __fastcall FreeArea(TArea *Area);
+	void __fastcall TriangulateArea(TArea *Area);
+	void __fastcall CheckGeofences(TADS_B_Aircraft *ADS_B_Aircraft);
+	void __fastcall UpdateAreaLoads(void);
+	TArea * __fastcall AreaOfFence(int Fence);
 	int __fastcall  XY2LatLon2(int x, int y,double &lat,double &lon );
 	void __fastcall HookTrack(int X, int Y,bool CPA_Hook);
 	void __fastcall DrawObjects(void);
+	void __fastcall DrawConflicts(void);
 	void __fastcall DeleteAllAreas(void);
 	void __fastcall Purge(void);
 	void __fastcall SendCotMessage(AnsiString IP_address, unsigned short Port,char *Buffer,DWORD Length);
 	void __fastcall RegisterWithCoTRouter(void);
     void __fastcall SetMapCenter(double &x, double &y);
     void __fastcall LoadMap(int Type);
-    void __fastcall CreateBigQueryCSV(void);
-    void __fastcall CloseBigQueryCSV(void);
+    bool __fastcall CreateBigQueryExport(void);
+    void __fastcall CloseBigQueryExport(void);
+    void __fastcall StartBigQueryUploader(void);
     bool __fastcall LoadARTCCBoundaries(AnsiString FileName);
+    void __fastcall AssignSpriteImage(TADS_B_Aircraft *ADS_B_Aircraft);
 
     // Speech Recognition
     ISpeechRecoGrammar         *SRGrammar;  // OLD: SAPI (keep for TTS)
@@ -274,7 +300,8 @@ public:		// User declarations
 	Vector2d                   Map_w[2];
 	double                     Mw1,Mw2,Mh1,Mh2,xf,yf;
 	KeyholeConnection	      *g_Keyhole;
-	FilesystemStorage	      *g_Storage;
+	TileArchiveStorage	      *g_Storage;
+	FilesystemStorage	      *g_LegacyStorage;
 	MasterLayer	      	      *g_MasterLayer;
 	TileManager		          *g_GETileManager;
 	EarthView		          *g_EarthView;
@@ -285,17 +312,24 @@ public:		// User declarations
 	bool                       LoadMapFromInternet;
 	TList                     *Areas;
 	TArea                     *AreaTemp;
-	ght_hash_table_t          *HashTable;
+	TVertexArena               AreaVertices;       /* Points of all areas, AreaTemp's last. */
+	std::vector<GLuint>        StaleDisplayLists;  /* Of deleted areas, freed in DrawObjects(). */
+	TADS_B_Context            *Context;
 	TTCPClientRawHandleThread *TCPClientRawHandleThread;
     TTCPClientSBSHandleThread *TCPClientSBSHandleThread;
-	TStreamWriter              *RecordRawStream;
+	TAsyncWriter               *RecordRawStream;
 	TStreamReader              *PlayBackRawStream;
-    TStreamWriter              *RecordSBSStream;
+    TAsyncWriter               *RecordSBSStream;
 	TStreamReader              *PlayBackSBSStream;
-	TStreamWriter              *BigQueryCSV;
-    AnsiString                 BigQueryCSVFileName;
-	unsigned int               BigQueryRowCount;
-	unsigned int               BigQueryFileCount;
+	TColumnarExporter          *BigQueryExport;
+	HANDLE                     BigQueryUploader;   /* Process of BIG_QUERY_RUN_FILENAME, NULL if never started. */
+	TTrackRecorder             *TrackRecorder;
+	TConflictMonitor           *ConflictMonitor;
+	std::vector<TConflictAlert> ConflictAlerts;
+	TGeofenceEngine            *Geofence;
+	TRouteResolver             *RouteResolver;
+	std::vector<TGeofenceEvent> GeofenceEvents;
+	AnsiString                 TrackStorePath;
     AnsiString                 BigQueryPythonScript;
 	AnsiString                 BigQueryPath;
     AnsiString                 BigQueryLogFileName;
@@ -13,15 +13,16 @@
 
 
 
-FilesystemStorage::FilesystemStorage(std::string root,bool UseGE) {
+FilesystemStorage::FilesystemStorage(std::string root,bool UseGE,int nthreads): SimpleTileStorage(nthreads) {
 	m_StorageRoot = root;
 	m_UseGE=UseGE;
 }
 
 FilesystemStorage::~FilesystemStorage() {
+	StopThreads();
 }
 
-void FilesystemStorage::Process(TilePtr tile) {
+void FilesystemStorage::Process(TilePtr tile, int thread) {
 	if (!tile->IsLoaded()) { /* loading */
 	   std::string path;
 		if (m_UseGE)
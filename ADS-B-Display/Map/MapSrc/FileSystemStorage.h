@@ -9,11 +9,14 @@
 
 #include "SimpleTileStorage.h"
 
+#define FILESYSTEM_STORAGE_THREADS	4
+
 /**
  * Filesystem cache to store tiles locally.
  *
  * @deprecated This implementation wastes tons of inodes, lots of space, is
- * very slow and ineffective. Will be replaced, see TODO file.
+ * very slow and ineffective. Replaced by TileArchiveStorage, which uses it
+ * only to take over caches written by it.
  *
  * @deprecated should be restructured and merged to GoogleLayer
  */
@@ -23,8 +26,9 @@ public:
 	 * Constructor.
 	 *
 	 * @param root path to root directory of the storage
+	 * @param nthreads number of threads reading (and decoding) tiles
 	 */
-	FilesystemStorage(std::string root,bool UseGE);
+	FilesystemStorage(std::string root,bool UseGE,int nthreads = FILESYSTEM_STORAGE_THREADS);
 
 	/**
 	 * Destructor.
@@ -35,7 +39,7 @@ protected:
 	/**
 	 * Load/save tile
 	 */
-	void Process(TilePtr tile);
+	void Process(TilePtr tile, int thread);
 
 private:
 	/**
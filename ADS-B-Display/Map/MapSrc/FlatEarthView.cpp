@@ -17,6 +17,9 @@ FlatEarthView::~FlatEarthView() {
 }
 
 void FlatEarthView::Render(bool drawmap) {
+	/* one frame per render; tiles not drawn for a few frames are old (Tile::IsOld) */
+	Timer::Instance()->Update(GetTickCount());
+
 	/* x and y span of viewable size in global coords */
 	double yspan = m_Eye.yspan((double)m_ViewportWidth/(double)m_ViewportHeight);
 	double xspan = m_Eye.xspan((double)m_ViewportWidth/(double)m_ViewportHeight);
@@ -84,7 +87,7 @@ void FlatEarthView::Render(bool drawmap) {
 
 
 	/* call master layer */
- if (drawmap)	m_MasterLayer->RenderRegion(&rgn);
+ if (drawmap)	m_MasterLayer->Render(&rgn);
 }
 
 void FlatEarthView::Animate(void) {
@@ -17,13 +17,19 @@ GoogleLayer::~GoogleLayer() {
 
 #define EPSILON 0.00001
 
+void GoogleLayer::Render(Region *view) {
+	/* storages load what is nearest the middle of the view first; set once
+	 * per frame, as a new focus reorders their queues */
+	m_TileManager->SetFocus((view->w[0].x + view->w[1].x)/2.0 + 0.5, (view->w[0].y + view->w[1].y)/2.0 + 0.5,
+			GetRegionLevel(view));
+
+	RenderRegion(view);
+}
+
 void GoogleLayer::RenderRegion(Region *rgn) {
 	/* select maximal tile level for this region
 	 * (later every tile is checked and it's individual level may be lowered */
-	int level = max4(GetSplitLevel(rgn->w[1].x - rgn->w[0].x, rgn->proj_length(0,1)),
-			GetSplitLevel(rgn->w[1].x - rgn->w[0].x, rgn->proj_length(2,3)),
-			GetSplitLevel(rgn->w[1].y - rgn->w[0].y, rgn->proj_length(1,2)),
-			GetSplitLevel(rgn->w[1].y - rgn->w[0].y, rgn->proj_length(3,0)));
+	int level = GetRegionLevel(rgn);
 
 	double step = 1.0/(double)(1 << level);
 
@@ -171,6 +177,13 @@ void GoogleLayer::RenderRegion(Region *rgn) {
 			(*i)->Overdraw(rgn);
 }
 
+int GoogleLayer::GetRegionLevel(Region *rgn) {
+	return max4(GetSplitLevel(rgn->w[1].x - rgn->w[0].x, rgn->proj_length(0,1)),
+			GetSplitLevel(rgn->w[1].x - rgn->w[0].x, rgn->proj_length(2,3)),
+			GetSplitLevel(rgn->w[1].y - rgn->w[0].y, rgn->proj_length(1,2)),
+			GetSplitLevel(rgn->w[1].y - rgn->w[0].y, rgn->proj_length(3,0)));
+}
+
 int GoogleLayer::GetSplitLevel(double wlen, double plen) {
 	int level = 0;
 	while(1) {
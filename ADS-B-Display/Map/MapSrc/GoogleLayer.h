@@ -13,9 +13,11 @@ public:
 	GoogleLayer(TileManager *tm);
 	virtual ~GoogleLayer();
 
+	void Render(Region *view);
 	void RenderRegion(Region *rgn);
 
 	int GetSplitLevel(double wlen, double plen);
+	int GetRegionLevel(Region *rgn);
 
 protected:
 	TileManager	*m_TileManager;
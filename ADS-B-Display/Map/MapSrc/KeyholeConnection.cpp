@@ -25,7 +25,7 @@
 #define SKYVECTOR_EDITION         "2504"
 
 
-KeyholeConnection::KeyholeConnection(int type)
+KeyholeConnection::KeyholeConnection(int type, int nthreads): SimpleTileStorage(nthreads)
 {
   const char * url;
 	if (type== GoogleMaps)
@@ -57,24 +57,35 @@ KeyholeConnection::KeyholeConnection(int type)
 	  Chart=SKYVECTOR_CHART_IFR_HIGH;
 	  Edition=SKYVECTOR_EDITION;
 	}
-	if ((m_GEFetch = gefetch_init(url)) == 0)
-		throw Exception("gefetch_init() failed");
+	/* threads only take tiles once enqueued, after this */
+	for (int i = 0; i < GetThreadCount(); i++) {
+		gefetch_t handle;
+		if ((handle = gefetch_init(url)) == 0) {
+			StopThreads();
+			for (size_t j = 0; j < m_GEFetch.size(); j++)
+				gefetch_cleanup(m_GEFetch[j]);
+			throw Exception("gefetch_init() failed");
+		}
+		m_GEFetch.push_back(handle);
+	}
 }
 
 KeyholeConnection::~KeyholeConnection() {
-	if (m_GEFetch)
-		gefetch_cleanup(m_GEFetch);
+	StopThreads();
+	for (size_t i = 0; i < m_GEFetch.size(); i++)
+		gefetch_cleanup(m_GEFetch[i]);
 }
 
-void KeyholeConnection::Process(TilePtr tile) {
+void KeyholeConnection::Process(TilePtr tile, int thread) {
+	gefetch_t fetch = m_GEFetch[thread];
 	gefetch_error res;
     if (ServerType== GoogleMaps)
     {
-      res = gefetch_fetch_image_googlemaps(m_GEFetch, tile->GetX(), tile->GetY(), tile->GetLevel());
+      res = gefetch_fetch_image_googlemaps(fetch, tile->GetX(), tile->GetY(), tile->GetLevel());
     }
     else if (ServerType== SkyVector)
 	{
-	  res = gefetch_fetch_image_skyvector(m_GEFetch,Key,Chart,Edition, tile->GetX(), tile->GetY(), tile->GetLevel());
+	  res = gefetch_fetch_image_skyvector(fetch,Key,Chart,Edition, tile->GetX(), tile->GetY(), tile->GetLevel());
     }
 
 	if ((res == GEFETCH_NOT_FOUND) ||  (res == GEFETCH_INVALID_ZOOM))
@@ -87,7 +98,7 @@ void KeyholeConnection::Process(TilePtr tile) {
 		throw Exception("gefetch_fetch_image() failed");
 	}
 
-	RawBuffer *buf = new RawBuffer(gefetch_get_data_ptr(m_GEFetch), gefetch_get_data_size(m_GEFetch));
+	RawBuffer *buf = new RawBuffer(gefetch_get_data_ptr(fetch), gefetch_get_data_size(fetch));
 
 	try {
 		tile->Load(buf, m_pSaveStorage != 0);
@@ -2,6 +2,7 @@
 
 #ifndef KeyholeConnectionH
 #define KeyholeConnectionH
+#include <vector>
 #include <gefetch.h>
 
 #include "SimpleTileStorage.h"
@@ -12,6 +13,8 @@
 #define SkyVector_IFR_High     3
 #define SkyVector              4
 
+#define KEYHOLE_CONNECTION_THREADS 4
+
 /**
  * Connection to Google server.
  *
@@ -25,8 +28,10 @@ class KeyholeConnection: public SimpleTileStorage {
 public:
 	/**
 	 * Constructor.
+	 *
+	 * @param nthreads number of tiles downloaded at once
 	 */
-	KeyholeConnection(int Type);
+	KeyholeConnection(int Type, int nthreads = KEYHOLE_CONNECTION_THREADS);
 
 	/**
 	 * Destructor.
@@ -37,10 +42,10 @@ protected:
 	/**
 	 * Download tile from google.
 	 */
-	void Process(TilePtr tile);
+	void Process(TilePtr tile, int thread);
 
 private:
-	gefetch_t	m_GEFetch;
+	std::vector<gefetch_t>	m_GEFetch;	///< One connection per thread
 	int         ServerType;
 	const char  *Key;
 	const char  *Chart;
@@ -15,6 +15,10 @@ MasterLayer::MasterLayer() {
 MasterLayer::~MasterLayer() {
 }
 
+void MasterLayer::Render(Region *view) {
+	RenderRegion(view);
+}
+
 void MasterLayer::BindSlaveLayer(SlaveLayer *layer) {
 	m_SlaveLayers.push_back(layer);
 }
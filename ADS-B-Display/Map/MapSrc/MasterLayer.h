@@ -33,6 +33,16 @@ public:
 	 */
 	virtual ~MasterLayer();
 
+	/**
+	 * Render the whole view, once per frame
+	 *
+	 * Views call this rather than RenderRegion(), so that a layer can
+	 * do its per-frame work once before rendering the regions.
+	 *
+	 * @param view region covering the view
+	 */
+	virtual void Render(Region *view);
+
 	/**
 	 * Render one specific region of earth surface
 	 *
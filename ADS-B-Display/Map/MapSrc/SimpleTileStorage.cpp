@@ -3,15 +3,20 @@
 
 #pragma hdrstop
 
+#include <algorithm>
 #include "SimpleTileStorage.h"
 
 //---------------------------------------------------------------------------
 
 #pragma package(smart_init)
-SimpleTileStorage::SimpleTileStorage() {
+
+/* every level outranks any distance within a level */
+#define LEVEL_PRIORITY	1.0e7
+
+SimpleTileStorage::SimpleTileStorage(int nthreads) {
      DWORD id;
 
-	m_QueueMutex = CreateMutex( 
+	m_QueueMutex = CreateMutex(
         NULL,              // default security attributes
         FALSE,             // initially not owned
         NULL);             // unnamed mutex
@@ -21,15 +26,15 @@ SimpleTileStorage::SimpleTileStorage() {
 	}
 
 	 ThreadKillEvent=CreateEvent (NULL,  // No security attributes
-                                  FALSE, // Manual-reset event
-                                  FALSE, // Initial state is signaled
+                                  TRUE,  // Manual-reset event, so it stops every thread
+                                  FALSE, // Initial state is not signaled
                                   NULL); // Object name
 
 	if (ThreadKillEvent == NULL) {
 		CloseHandle(m_QueueMutex);
 		throw SysException("CreateEvent() failed", GetLastError());
 	}
-    
+
 	SemQueueCount=CreateSemaphore(NULL, 0, LONG_MAX, NULL);
 
 	if (SemQueueCount == NULL) {
@@ -37,72 +42,163 @@ SimpleTileStorage::SimpleTileStorage() {
 		CloseHandle(ThreadKillEvent);
 		throw SysException("CreateSemaphore() failed", GetLastError());
 	}
- 
-     m_Thread= CreateThread(NULL, 0, ThreadEntryPoint, (LPVOID)this, 0, &id);
-	if (m_Thread== NULL) {
-		CloseHandle(SemQueueCount);
-		CloseHandle(m_QueueMutex);
-		CloseHandle(ThreadKillEvent);
-		throw SysException("CreateThread() failed", GetLastError());
-	}
 
 	m_pNextLoadStorage = 0;
 	m_pSaveStorage = 0;
+
+	m_FocusX = m_FocusY = 0.5;
+	m_FocusLevel = 0;
+	m_FocusVersion = m_QueueVersion = 0;
+	m_ThreadsStarted = 0;
+
+	if (nthreads < 1)
+		nthreads = 1;
+	for (int i = 0; i < nthreads; i++) {
+		HANDLE thread = CreateThread(NULL, 0, ThreadEntryPoint, (LPVOID)this, 0, &id);
+		if (thread == NULL) {
+			DWORD err = GetLastError();
+			StopThreads();
+			CloseHandle(SemQueueCount);
+			CloseHandle(m_QueueMutex);
+			CloseHandle(ThreadKillEvent);
+			throw SysException("CreateThread() failed", err);
+		}
+		m_Threads.push_back(thread);
+	}
 }
 
 SimpleTileStorage::~SimpleTileStorage() {
 
-	/* wait for loader thread to finish */
-	SetEvent(ThreadKillEvent);
-    WaitForSingleObject(m_Thread,INFINITE);
-
+	/* wait for loader threads to finish */
+	StopThreads();
 
 	/* cleanup synchronisation objects */
 		CloseHandle(SemQueueCount);
 		CloseHandle(m_QueueMutex);
 		CloseHandle(ThreadKillEvent);
-		CloseHandle(m_Thread);
+}
+
+void SimpleTileStorage::StopThreads() {
+	SetEvent(ThreadKillEvent);
+	for (size_t i = 0; i < m_Threads.size(); i++) {
+		WaitForSingleObject(m_Threads[i],INFINITE);
+		CloseHandle(m_Threads[i]);
+	}
+	m_Threads.clear();
+}
+
+int SimpleTileStorage::GetThreadCount() {
+	return (int)m_Threads.size();
 }
 
 DWORD WINAPI SimpleTileStorage::ThreadEntryPoint(LPVOID pthis) {
 	SimpleTileStorage* ts = (SimpleTileStorage*)pthis;
 
 	/* start loader */
-	ts->ThreadRun();
+	ts->ThreadRun(InterlockedIncrement(&ts->m_ThreadsStarted) - 1);
 
 	return (0);
 }
 
 void SimpleTileStorage::Enqueue(TilePtr tile) {
 	/* insert requested item in queue */
-    WaitForSingleObject(m_QueueMutex,INFINITE); 
-	m_Queue.push(tile);
+    WaitForSingleObject(m_QueueMutex,INFINITE);
+	QueuedTile q;
+	q.tile = tile;
+	q.priority = Priority(tile);
+	m_Queue.push_back(q);
+	std::push_heap(m_Queue.begin(), m_Queue.end());
 	ReleaseMutex(m_QueueMutex);
 	ReleaseSemaphore(SemQueueCount,1,NULL);
 
 }
 
-void SimpleTileStorage::ThreadRun() {
+void SimpleTileStorage::SetFocus(double x, double y, int level) {
+	WaitForSingleObject(m_QueueMutex,INFINITE);
+	if (x != m_FocusX || y != m_FocusY || level != m_FocusLevel) {
+		m_FocusX = x;
+		m_FocusY = y;
+		m_FocusLevel = level;
+		m_FocusVersion++;
+	}
+	ReleaseMutex(m_QueueMutex);
+
+	if (m_pNextLoadStorage)
+		m_pNextLoadStorage->SetFocus(x, y, level);
+}
+
+double SimpleTileStorage::Priority(TilePtr tile) {
+	/* save what was loaded, so it is not downloaded again */
+	if (tile->IsLoaded())
+		return -1.0;
+
+	/* distance from focus to tile centre, in tiles of the focus level */
+	double scale = (double)(1 << tile->GetLevel());
+	double dx = ((double)tile->GetX() + 0.5) / scale - m_FocusX;
+	double dy = ((double)tile->GetY() + 0.5) / scale - m_FocusY;
+	double distance = sqrt(dx*dx + dy*dy) * (double)(1 << m_FocusLevel);
+
+	return (double)tile->GetLevel() * LEVEL_PRIORITY + distance;
+}
+
+int SimpleTileStorage::Dequeue(TilePtr &tile) {
+	/* the view moved: reorder, dropping what went out of it */
+	if (m_QueueVersion != m_FocusVersion) {
+		size_t n = 0;
+		for (size_t i = 0; i < m_Queue.size(); i++) {
+			TilePtr t = m_Queue[i].tile;
+			if (!t->IsLoaded() && t->IsOld()) {
+				t->SetRequested(0);
+				continue;
+			}
+			m_Queue[n] = m_Queue[i];
+			m_Queue[n].priority = Priority(t);
+			n++;
+		}
+		m_Queue.resize(n);
+		std::make_heap(m_Queue.begin(), m_Queue.end());
+		m_QueueVersion = m_FocusVersion;
+	}
+
+	while (!m_Queue.empty()) {
+		std::pop_heap(m_Queue.begin(), m_Queue.end());
+		tile = m_Queue.back().tile;
+		m_Queue.pop_back();
+
+		/* cancel loading of tiles not drawn anymore; TileManager asks again if they are */
+		if (!tile->IsLoaded() && tile->IsOld()) {
+			tile->SetRequested(0);
+			continue;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+void SimpleTileStorage::ThreadRun(int thread) {
 	 HANDLE         Handles[2];
      DWORD          Result;
     Handles[0]=SemQueueCount;
     Handles[1]=ThreadKillEvent;
 
-	/* spin in this loop forever */
+	/* spin in this loop until killed */
 	while(1) {
-		Result=WaitForMultipleObjects(2,Handles,false,INFINITE);   
+		Result=WaitForMultipleObjects(2,Handles,false,INFINITE);
         if ((Result==WAIT_OBJECT_0+1) || (Result!=WAIT_OBJECT_0)) break;
 
-		WaitForSingleObject(m_QueueMutex,INFINITE); 
-		TilePtr current = m_Queue.front();
-		m_Queue.pop();
+		TilePtr current;
+		WaitForSingleObject(m_QueueMutex,INFINITE);
+		int have = Dequeue(current);
 		ReleaseMutex(m_QueueMutex);
 
-		if (!current->IsOld()) {
+		/* the tile this wakeup was for was cancelled */
+		if (!have)
+			continue;
+
 			try {
 				try {
 					/* do actual processing - defined in derived class */
-					Process(current);
+					Process(current, thread);
 				} catch (std::exception &e) {
 					/* storage error worth to be reported to user, like:
 					 * - unable to download from web due to `cannot connect' or `authentication failed'
@@ -126,7 +222,6 @@ void SimpleTileStorage::ThreadRun() {
 				/* fatal error in enqueue?! */
 				warning("SimpleTileStorage: fatal error (%s) (%d %d %d)\n", e.what(), current->GetX(), current->GetY(), current->GetLevel());
 			}
-		}
 	}
 }
 
@@ -142,4 +237,3 @@ void SimpleTileStorage::Detach() {
 	m_pNextLoadStorage = 0;
 	m_pSaveStorage = 0;
 }
-
@@ -2,14 +2,23 @@
 
 #ifndef SimpleTileStorageH
 #define SimpleTileStorageH
-#include <queue>
+#include <vector>
 
 #include "Exceptions.h"
 #include "TileStorage.h"
-#include "global.h"
+#include "Global.h"
 
 /**
- * Base class for tile storages with queue and one working thread;
+ * Base class for tile storages with a priority queue and a pool of
+ * working threads.
+ *
+ * Tiles waiting to be saved go first; tiles waiting to be loaded are
+ * taken coarsest level first (they are what is drawn until the finer ones
+ * arrive) and, within a level, nearest to the centre of the view first.
+ * The view is given by SetFocus(); when it changes the queue is reordered
+ * before the next tile is taken, and tiles that are no longer being drawn
+ * (Tile::IsOld) are dropped from it unloaded, to be requested again if
+ * they come back into view.
  *
  * @deprecated should be restructured and merged to GoogleLayer
  */
@@ -17,8 +26,10 @@ class SimpleTileStorage: public TileStorage {
 public:
 	/**
 	 * Constructor.
+	 *
+	 * @param nthreads number of working threads
 	 */
-	SimpleTileStorage();
+	SimpleTileStorage(int nthreads = 1);
 
 	/**
 	 * Destructor.
@@ -30,6 +41,12 @@ public:
 	 */
 	void Enqueue(TilePtr tile);
 
+	/**
+	 * Set the view tiles are prioritised by, and pass it on to
+	 * NextLoadStorage.
+	 */
+	void SetFocus(double x, double y, int level);
+
 	/**
 	 * Set next storage for tile loading.
 	 *
@@ -53,13 +70,43 @@ public:
 	 */
 	void Detach();
 
+	/**
+	 * Get number of working threads.
+	 */
+	int GetThreadCount();
+
 protected:
 	/**
 	 * Do actual processing - defined in derived class.
+	 *
+	 * Called from all working threads at once.
+	 *
+	 * @param thread index of the calling thread [0..GetThreadCount()-1],
+	 * for storages keeping per-thread state
 	 */
-	virtual void Process(TilePtr tile) = 0;
+	virtual void Process(TilePtr tile, int thread) = 0;
+
+	/**
+	 * Stop and wait for working threads.
+	 *
+	 * Derived classes call this in their destructor before releasing
+	 * anything Process() uses.
+	 */
+	void StopThreads();
 
 private:
+	/**
+	 * Tile in the queue with its priority (lower goes first).
+	 */
+	struct QueuedTile {
+		TilePtr	tile;
+		double	priority;
+
+		bool operator< (const QueuedTile &q) const {
+			return priority > q.priority;	/* std heap keeps the greatest on top */
+		}
+	};
+
 	/**
 	 * Entry point for worker thread.
 	 */
@@ -68,19 +115,39 @@ private:
 	/**
 	 * Thread function.
 	 *
-	 * This function loops endlessly taking tiles from queue one
-	 * by one and processig them with Process()
+	 * This function loops until the storage is destroyed, taking
+	 * tiles from queue by priority and processig them with Process()
 	 */
-	void ThreadRun();
+	void ThreadRun(int thread);
+
+	/**
+	 * Priority of a tile for the current focus. Queue mutex must be held.
+	 */
+	double Priority(TilePtr tile);
+
+	/**
+	 * Take the next tile to process off the queue, dropping tiles no
+	 * longer in view. Queue mutex must be held.
+	 *
+	 * @returns false if there is none
+	 */
+	int Dequeue(TilePtr &tile);
 
 /* variables */
 private:
-	std::queue<TilePtr>	m_Queue;	///< Queue of tiles waiting to be saved/loaded with this storage
+	std::vector<QueuedTile>	m_Queue;	///< Heap of tiles waiting to be saved/loaded with this storage
 
-	HANDLE			m_QueueMutex;		///< Mutex to protect queue
+	HANDLE			m_QueueMutex;		///< Mutex to protect queue and focus
 	HANDLE          SemQueueCount;      ///<  Condition to wake up thread after sleep
 	HANDLE          ThreadKillEvent;
-	HANDLE          m_Thread;		///< Thread in which all actual loading/saving goes asynchronously
+	std::vector<HANDLE>	m_Threads;	///< Threads in which all actual loading/saving goes asynchronously
+	volatile LONG	m_ThreadsStarted;	///< Hands out thread indexes
+
+	double			m_FocusX;		///< Centre of the view, in world units [0..1]
+	double			m_FocusY;
+	int				m_FocusLevel;	///< Level of the tiles drawn
+	unsigned		m_FocusVersion;	///< Bumped when the focus changes
+	unsigned		m_QueueVersion;	///< Focus version the queue is ordered for
 
 protected:
 	TileStorage	*m_pNextLoadStorage;	///< Storage to pass tile to for loading, if we couldn't load it
@@ -35,6 +35,19 @@ void Texture::Unload() {
 	}
 }
 
+size_t Texture::GetMemorySize() {
+	size_t bpp;
+
+	switch (m_glFormat) {
+	case GL_LUMINANCE:		bpp = 1; break;
+	case GL_LUMINANCE_ALPHA:	bpp = 2; break;
+	case GL_RGB:			bpp = 3; break;
+	default:			bpp = 4; break;
+	}
+
+	return (size_t)m_Width * (size_t)m_Height * bpp;
+}
+
 void Texture::SetTexture() {
 	if (!m_ID && !m_Pixels)
 		throw Exception("attempt to use empty texture");
@@ -2,7 +2,7 @@
 
 #ifndef TextureH
 #define TextureH
-#include "global.h"
+#include "Global.h"
 #include "Exceptions.h"
 
 #ifdef WIN32
@@ -81,6 +81,12 @@ public:
 	 */
 	void LoadPNG(int source, ...);
 
+	/**
+	 * Memory taken by the pixels, in system memory before the texture
+	 * is first set and in OpenGL after.
+	 */
+	size_t GetMemorySize();
+
 private:
 	static void my_jpeg_noop(j_decompress_ptr cinfo);
 	static boolean my_jpeg_fill_input_buffer(j_decompress_ptr cinfo);
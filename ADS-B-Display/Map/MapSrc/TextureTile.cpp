@@ -13,6 +13,8 @@ TextureTile::TextureTile(int x, int y, int level, TextureTilePtr parent): Tile(x
 	m_Texture = 0;
 	m_Parent = parent;
 	m_Child[0] = m_Child[1] = m_Child[2] = m_Child[3] = TextureTilePtr(0);
+	m_LruPrev = m_LruNext = 0;
+	m_LruBytes = 0;
 }
 
 TextureTile::~TextureTile() {
@@ -84,3 +86,9 @@ void TextureTile::Unload() {
 		m_Texture->Unload();
 }
 
+size_t TextureTile::GetMemorySize() {
+	Texture *tex = m_Texture;	/* may be set by a storage thread meanwhile */
+
+	return sizeof(TextureTile) + (tex ? tex->GetMemorySize() : 0);
+}
+
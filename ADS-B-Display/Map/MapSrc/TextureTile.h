@@ -2,7 +2,7 @@
 
 #ifndef TextureTileH
 #define TextureTileH
-#include "global.h"
+#include "Global.h"
 #include "Tile.h"
 #include "Texture.h"
 
@@ -20,6 +20,7 @@ class TextureTile: public Tile {
 	friend class	SmartPtr<TextureTile>;
 	friend class	TileManager;
 	friend class	WorldWindTileManager;
+	friend class	TileManagerTest;
 public:
 	/**
 	 * Constructor. Creates empty TextureTile.
@@ -73,6 +74,11 @@ public:
 	 */
 	void Unload();
 
+	/**
+	 * Memory taken by the tile and its texture.
+	 */
+	size_t GetMemorySize();
+
 protected:
 	/**
 	 * Get child in quadtree.
@@ -118,6 +124,10 @@ protected:
 	TextureTilePtr	m_Parent;	///< Parent tile in quadtree
 	TextureTilePtr	m_Child[4];	///< Child tiles in quadtree
 
+	TextureTile	*m_LruPrev;	///< More recently used tile in TileManager's LRU list
+	TextureTile	*m_LruNext;	///< Less recently used tile in TileManager's LRU list
+	size_t		m_LruBytes;	///< Memory TileManager counts for this tile
+
 private:
 	Texture		*m_Texture;	///< The texture itself
 };
@@ -9,7 +9,7 @@
 
 #pragma package(smart_init)
 Tile::Tile(int x, int y, int level) {
-
+#ifdef WIN32
 	m_rcMutex = CreateMutex( 
         NULL,              // default security attributes
         FALSE,             // initially not owned
@@ -18,6 +18,7 @@ Tile::Tile(int x, int y, int level) {
     if (m_rcMutex == NULL) {
         throw SysException("CreateMutex() failed", GetLastError());
     }
+#endif
 	m_X = x;
 	m_Y = y;
 	m_Level = level;
@@ -28,13 +29,17 @@ Tile::Tile(int x, int y, int level) {
 
 	m_RawData = 0;
 	m_IsNull = 0;
+	m_Requested = 0;
 }
 
 Tile::~Tile() {
 	delete m_RawData;
+#ifdef WIN32
     CloseHandle(m_rcMutex);
+#endif
 }
 
+#ifdef WIN32
 int Tile::IncRef()
 {
     WaitForSingleObject(m_rcMutex,INFINITE); 
@@ -50,6 +55,19 @@ int Tile::DecRef()
     ReleaseMutex(m_rcMutex);
     return rc;
 }
+#else
+int Tile::IncRef()
+{
+    std::lock_guard<std::mutex> lock(m_rcMutex);
+    return ++refcount;
+}
+
+int Tile::DecRef()
+{
+    std::lock_guard<std::mutex> lock(m_rcMutex);
+    return --refcount;
+}
+#endif
 
 /* coord ops */
 int Tile::GetX() {
@@ -90,6 +108,19 @@ int Tile::IsNull() {
 	return m_IsNull;
 }
 
+/* request ops */
+void Tile::SetRequested(int requested) {
+#ifdef WIN32
+	InterlockedExchange(&m_Requested, requested ? 1 : 0);
+#else
+	m_Requested = requested ? 1 : 0;
+#endif
+}
+
+int Tile::IsRequested() {
+	return m_Requested != 0;
+}
+
 /* load/save */
 void Tile::Load(RawBuffer *data, int keep) {
 	if (keep)
@@ -6,7 +6,11 @@
 #include "Timer.h"
 #include "SmartPtr.h"
 #include "RawBuffer.h"
-#include "global.h"
+#include "Global.h"
+#ifndef WIN32
+#include <mutex>
+#include <atomic>
+#endif
 
 enum {
 	TILETYPE_NONE,
@@ -143,6 +147,20 @@ public:
 	 */
 	virtual int IsNull();
 
+	/**
+	 * Mark tile as queued for loading in a storage (or not).
+	 *
+	 * Set by TileManager when it enqueues the tile; cleared by a
+	 * storage that drops the tile from its queue because it went
+	 * out of view, so that it is asked for again when it comes back.
+	 */
+	void SetRequested(int requested);
+
+	/**
+	 * Test whether tile is queued for loading.
+	 */
+	int IsRequested();
+
 protected:
 	int     m_X;            ///< X coordinate. Range is [0..(2^level)-1]
 	int     m_Y;            ///< Y coordinate. Range is [0..(2^level)-1]
@@ -151,12 +169,21 @@ protected:
 	ticks_t m_LastUsed;	///< Last time the tile was used
 
 	int	m_IsNull;	///< Indicates whether this tile is know to not exist 
+#ifdef WIN32
+	volatile LONG	m_Requested;	///< See SetRequested, shared with storage threads
+#else
+	std::atomic<long>	m_Requested;
+#endif
 	RawBuffer	*m_RawData;	///< Raw (compressed) data stored to be saved later
 
 protected:
     int IncRef();               ///< Return resulting value after increment
     int DecRef();               ///< Return resulting value after decrement
+#ifdef WIN32
     HANDLE  m_rcMutex;          ///< Mutex to protect refcount
+#else
+    std::mutex  m_rcMutex;
+#endif
 
 	unsigned int	refcount;	///< Reference counter, see SmartPtr
 };
@@ -0,0 +1,50 @@
+//---------------------------------------------------------------------------
+
+
+#pragma hdrstop
+
+#include "TileArchiveStorage.h"
+//---------------------------------------------------------------------------
+
+#pragma package(smart_init)
+
+TileArchiveStorage::TileArchiveStorage(std::string root, int nthreads): SimpleTileStorage(nthreads) {
+	if (!m_Archive.Open(root.c_str())) {
+		StopThreads();
+		throw Exception("cannot open tile archive");
+	}
+}
+
+TileArchiveStorage::~TileArchiveStorage() {
+	StopThreads();
+	m_Archive.Close();
+}
+
+void TileArchiveStorage::Process(TilePtr tile, int thread) {
+	uint64_t key = TileArchiveKey(tile->GetX(), tile->GetY(), tile->GetLevel(), tile->GetType());
+
+	if (!tile->IsLoaded()) { /* loading */
+		std::vector<char> data;
+
+		if (!m_Archive.Find(key, data))
+			return;	/* not in archive, next storage gets it */
+
+		if (data.empty()) {
+			tile->Null();
+			return;
+		}
+
+		try {
+			tile->Load(new RawBuffer(&data[0], data.size()), m_pSaveStorage != 0);
+		} catch(std::exception &) {
+			/* undecodable tile: leave it to the next storage */
+		}
+	} else if (tile->IsSaveable()) { /* saving */
+		RawBuffer *buf = tile->ReleaseRawData();
+		int ok = m_Archive.Add(key, buf->Data(), (uint32_t)buf->Size());
+
+		delete buf;
+		if (!ok)
+			throw SysException("cannot write tile into archive storage", errno);
+	}
+}
@@ -0,0 +1,48 @@
+//---------------------------------------------------------------------------
+
+#ifndef TileArchiveStorageH
+#define TileArchiveStorageH
+#include <string>
+
+#include "SimpleTileStorage.h"
+#include "FileSystemStorage.h"
+#include "TileArchive.h"
+
+/**
+ * Local tile cache kept in a TTileArchive: two files in the root
+ * directory instead of a file per tile.
+ *
+ * Tiles are read straight out of the mapped archive. A FilesystemStorage
+ * over the same directory may be chained as NextLoadStorage with this as
+ * its SaveStorage, so tiles still in loose files from before are moved
+ * into the archive the first time they are drawn (adsb_tilepack moves
+ * them all at once).
+ *
+ * @deprecated should be restructured and merged to GoogleLayer
+ */
+class TileArchiveStorage: public SimpleTileStorage {
+public:
+	/**
+	 * Constructor.
+	 *
+	 * @param root path to directory of the archive, created there if missing
+	 * @param nthreads number of threads reading (and decoding) tiles
+	 */
+	TileArchiveStorage(std::string root, int nthreads = FILESYSTEM_STORAGE_THREADS);
+
+	/**
+	 * Destructor. Writes the index of tiles added.
+	 */
+	virtual ~TileArchiveStorage();
+
+protected:
+	/**
+	 * Load/save tile
+	 */
+	void Process(TilePtr tile, int thread);
+
+private:
+	TTileArchive	m_Archive;	///< Tiles of the storage
+};
+//---------------------------------------------------------------------------
+#endif
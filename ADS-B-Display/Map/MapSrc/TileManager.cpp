@@ -8,9 +8,12 @@
 //---------------------------------------------------------------------------
 
 #pragma package(smart_init)
-TileManager::TileManager(TileStorage *ts): m_TextureRoot(new TextureTile(0, 0, 0, TextureTilePtr(0))) {
+TileManager::TileManager(TileStorage *ts, size_t memory): m_TextureRoot(new TextureTile(0, 0, 0, TextureTilePtr(0))) {
 	m_FirstTileStorage = ts;
 	m_nTextureTiles = 1;
+	m_LruHead = m_LruTail = 0;
+	m_MemoryUsed = 0;
+	m_MemoryLimit = memory;
 }
 
 TileManager::~TileManager() {
@@ -31,32 +34,70 @@ TextureTilePtr TileManager::GetTexture(int x, int y, int level) {
 
 			cur->SetChild(dx, dy, child);
 			m_nTextureTiles++;
-			m_FirstTileStorage->Enqueue(TilePtr((Tile*)child.GetPtr()));	// XXX: unsafe. double check
 			cur = child;
 		} else
 			cur = cur->GetChild(dx, dy);
 
 		cur->Touch();
+
+		/* new tile, or one a storage dropped while it was out of view */
+		if (!cur->IsLoaded() && !cur->IsRequested()) {
+			cur->SetRequested(1);
+			m_FirstTileStorage->Enqueue(TilePtr((Tile*)cur.GetPtr()));	// XXX: unsafe. double check
+		}
 	}
 
+	/* most recently used: the tile, then its ancestors ahead of it */
+	for (TextureTile *t = cur.GetPtr(); t != m_TextureRoot.GetPtr(); t = t->m_Parent.GetPtr())
+		LruTouch(t);
+
 	return cur;
 }
 
-TextureTilePtr TileManager::FindTextureToDrop(TextureTilePtr cur, TextureTilePtr best) {
-	if (cur == 0)
-		return best;
-
-	if (cur->GetParent() != 0 && cur->IsLeaf() && cur->IsOld()) {
-		if (best == 0 || cur->GetLevel() > best->GetLevel())
-			best = cur;
-		else if (best == 0 || cur->GetAge() > best->GetAge())
-			best = cur;
-	}
+void TileManager::SetFocus(double x, double y, int level) {
+	m_FirstTileStorage->SetFocus(x, y, level);
+}
 
-	for (int i = 0; i < 4; i++)
-		best = FindTextureToDrop(cur->GetChild(i), best);
+void TileManager::LruTouch(TextureTile *tile) {
+	size_t bytes = tile->GetMemorySize();
+
+	m_MemoryUsed += bytes - tile->m_LruBytes;
+	tile->m_LruBytes = bytes;
+
+	if (m_LruHead == tile)
+		return;
+
+	/* unlink, if it is in the list at all */
+	if (tile->m_LruPrev)
+		tile->m_LruPrev->m_LruNext = tile->m_LruNext;
+	if (tile->m_LruNext)
+		tile->m_LruNext->m_LruPrev = tile->m_LruPrev;
+	else if (m_LruTail == tile)
+		m_LruTail = tile->m_LruPrev;
+
+	/* and put first */
+	tile->m_LruPrev = 0;
+	tile->m_LruNext = m_LruHead;
+	if (m_LruHead)
+		m_LruHead->m_LruPrev = tile;
+	m_LruHead = tile;
+	if (!m_LruTail)
+		m_LruTail = tile;
+}
 
-	return best;
+void TileManager::LruRemove(TextureTile *tile) {
+	if (tile->m_LruPrev)
+		tile->m_LruPrev->m_LruNext = tile->m_LruNext;
+	else
+		m_LruHead = tile->m_LruNext;
+	if (tile->m_LruNext)
+		tile->m_LruNext->m_LruPrev = tile->m_LruPrev;
+	else
+		m_LruTail = tile->m_LruPrev;
+
+	tile->m_LruPrev = tile->m_LruNext = 0;
+	m_MemoryUsed -= tile->m_LruBytes;
+	tile->m_LruBytes = 0;
 }
 
 int TileManager::Cleanup() {
@@ -66,32 +107,37 @@ int TileManager::Cleanup() {
 	 * 0. Tiles with children are not dropped
 	 * 0. Tiles recently used (!IsOld) are not dropped
 	 * 0. Root is not dropped
-	 * 1. Tile with highest level is dropped first.
-	 * 2. Of same level, Tile with higher age is dropped first.
+	 * 1. Least recently used tile is dropped first, until memory
+	 *    of the rest is within the limit.
+	 *
+	 * GetTexture() moves the tile and then its ancestors to the head of
+	 * the list, so a tile is always ahead of its descendants and the
+	 * tail is always a leaf. Once the tail was used recently, all are.
 	 *
 	 * This ensures:
-	 * - Minimal number of textures loaded
+	 * - Constant time per tile dropped
 	 * - All visible tiles are always in memory
 	 * - No reloading tiles on zoomout
 	 */
+	int dropped = 0;
+
+	while (m_MemoryUsed > m_MemoryLimit && m_LruTail != 0 && m_LruTail->IsOld()) {
+		TextureTile *victim = m_LruTail;
+		TextureTilePtr parent = victim->GetParent();
+		int i;
+
+		for (i = 0; i < 4; i++)
+			if (parent->GetChild(i) == victim)
+				break;
+		if (!victim->IsLeaf() || i == 4)
+			break;	/* can't happen, see above; leave the list as it is */
+
+		LruRemove(victim);
+		victim->Unload();			/* be sure no opengl will be touched in threads XXX: review this */
+		parent->SetChild(i, 0);	/* after this, victim is doomed */
+		m_nTextureTiles--;
+		dropped++;
+	}
 
-	if (m_nTextureTiles <= DEFAULT_MAX_TEXTURES)
-		return 0;
-
-	TextureTilePtr victim = FindTextureToDrop(m_TextureRoot, 0);
-
-	if (victim == 0)
-		return 0;
-
-	for (int i = 0; i < 4; i++)
-		if (victim->GetParent()->GetChild(i) == victim) {
-			victim->GetParent()->SetChild(i, 0);	/* after this, victim is doomed */
-			victim->Unload();			/* be sure no opengl will be touched in threads XXX: review this */
-			m_nTextureTiles--;
-			return 1;
-		}
-
-	return 0;
-		}
-
-
+	return dropped;
+}
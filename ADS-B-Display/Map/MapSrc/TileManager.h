@@ -5,11 +5,11 @@
 //---------------------------------------------------------------------------
 #include <map>
 
-#include "global.h"
+#include "Global.h"
 #include "TextureTile.h"
 #include "TileStorage.h"
 
-#define DEFAULT_MAX_TEXTURES 100
+#define DEFAULT_TEXTURE_MEMORY	(128*1024*1024)
 
 /**
  * Tile manager.
@@ -17,16 +17,23 @@
  * Handles requests for tiles, starts retrival of needed tiles from
  * storages, removes unneeded tiles from memory.
  *
+ * Tiles in the tree are kept in a list from most to least recently
+ * used, so that a tile used in a frame is always ahead of its
+ * descendants: the last tile of the list is always a leaf, and the
+ * one to drop.
+ *
  * @deprecated should be restructured and merged to GoogleLayer
  */
 class TileManager {
+	friend class	TileManagerTest;
 public:
 	/**
 	 * Constructor.
 	 *
 	 * @param ts tile storage to pass tile to for loading
+	 * @param memory bytes of tiles and textures kept once out of view
 	 */
-	TileManager(TileStorage *ts);
+	TileManager(TileStorage *ts, size_t memory = DEFAULT_TEXTURE_MEMORY);
 
 	/**
 	 * Destructor.
@@ -38,27 +45,45 @@ public:
 	 */
 	TextureTilePtr GetTexture(int x, int y, int level);
 
+	/**
+	 * Pass the view being drawn to tile storages.
+	 *
+	 * See TileStorage::SetFocus
+	 */
+	void SetFocus(double x, double y, int level);
+
 	/**
 	 * Removes unneeded objects from memory.
 	 *
-	 * Currently removes one texture each call, until number
-	 * of textures >= DEFAULT_MAX_TEXTURES
+	 * Drops least recently used tiles not drawn in the last frames
+	 * until their memory is within the limit given to the constructor.
 	 *
-	 * @todo implement tunable limits
+	 * @returns number of tiles dropped
 	 */
 	int Cleanup();
 
 private:
 	/**
-	 * Finds best texture tile to remove from memory.
+	 * Move tile to the head of the LRU list, adding it if new, and
+	 * update the memory counted for it.
 	 */
-	TextureTilePtr FindTextureToDrop(TextureTilePtr cur, TextureTilePtr best);
+	void LruTouch(TextureTile *tile);
+
+	/**
+	 * Take tile out of the LRU list and the memory count.
+	 */
+	void LruRemove(TextureTile *tile);
 
 private:
 	TileStorage	*m_FirstTileStorage;	///< Tile storage to pass tile to for loading
 
-	int		m_nTextureTiles;	///< Root element of TextureTile quadtree
-	TextureTilePtr	m_TextureRoot;		///< Number of texture tiles in a tree
+	int		m_nTextureTiles;	///< Number of texture tiles in a tree
+	TextureTilePtr	m_TextureRoot;		///< Root element of TextureTile quadtree
+
+	TextureTile	*m_LruHead;		///< Most recently used tile
+	TextureTile	*m_LruTail;		///< Least recently used tile
+	size_t		m_MemoryUsed;		///< Memory counted for tiles in the LRU list
+	size_t		m_MemoryLimit;		///< Memory to keep tiles in
 };
 
 
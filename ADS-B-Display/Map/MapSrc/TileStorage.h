@@ -26,6 +26,15 @@ public:
 	 * Start procesing of tile, whatever that means.
 	 */
 	virtual void Enqueue(TilePtr tile) = 0;
+
+	/**
+	 * Tell storage what is being looked at, for ordering its work.
+	 *
+	 * @param x x coordinate of the centre of the view, [0..1] across the world
+	 * @param y y coordinate of the centre of the view, [0..1]
+	 * @param level level of the tiles being drawn
+	 */
+	virtual void SetFocus(double x, double y, int level) {}
 };
 
 #endif
@@ -2,9 +2,15 @@
 
 #ifndef TimerH
 #define TimerH
+#ifdef WIN32
 #include <windows.h>
 typedef DWORD64  	   ticks_t;
 typedef DWORD		   unsafe_ticks_t;
+#else
+#include <stdint.h>
+typedef uint64_t	   ticks_t;
+typedef uint32_t	   unsafe_ticks_t;
+#endif
 
 #define UNSAFE_TICKS_LENGTH	0x100000000ULL
 
@@ -0,0 +1,84 @@
+//---------------------------------------------------------------------------
+// adsb_geodesic_test - check FastDirect/FastInverse against Vincenty.
+//
+// Sweeps latitude, azimuth and distance over the range the fast forms are
+// used for (up to FAST_GEODESIC_MAX_NM, |latitude| <= 89 degrees, from both
+// sides of the antimeridian) and fails if any error exceeds the bounds
+// documented in LatLonConv.h.
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <math.h>
+#include "LatLonConv.h"
+
+#define MAX_DIRECT_ERROR_M      35.0    /* FastDirect end point */
+#define MAX_DIRECT_AZIMUTH_DEG  0.008   /* FastDirect back azimuth */
+#define MAX_INVERSE_ERROR_M     25.0    /* FastInverse distance */
+#define MAX_INVERSE_AZIMUTH_DEG 0.003   /* FastInverse azimuths */
+
+static double AzimuthError(double a, double b);
+//---------------------------------------------------------------------------
+static double AzimuthError(double a, double b)
+{
+ double d=fmod(fabs(a-b),360.0);
+ return d>180.0 ? 360.0-d : d;
+}
+//---------------------------------------------------------------------------
+int main(void)
+{
+ static const double Longitudes[]={0.0,179.7,-179.7};
+ double MaxDirect=0,MaxDirectAz=0,MaxInverse=0,MaxInverseAz=0;
+ unsigned Cases=0,Failed=0;
+
+ for (int Lat=-89;Lat<=89;Lat++)
+  for (size_t l=0;l<sizeof(Longitudes)/sizeof(Longitudes[0]);l++)
+   for (int Az=0;Az<360;Az+=5)
+	for (double Dist=1.0;Dist<=FAST_GEODESIC_MAX_NM;Dist+=Dist<50.0 ? 7.0 : 20.0)
+	 {
+	  double Lon=Longitudes[l];
+	  double VLat,VLon,VBack,FLat,FLon,FBack;
+	  double Err,Az12,Az21,VDist,VAz12,VAz21,FDist,FAz12,FAz21;
+
+	  if (VDirect(Lat,Lon,Az,Dist,&VLat,&VLon,&VBack)!=OKNOERROR ||
+		  FastDirect(Lat,Lon,Az,Dist,&FLat,&FLon,&FBack)!=OKNOERROR)
+		{
+		 printf("direct failed at %d %.1f %d %.0f\n",Lat,Lon,Az,Dist);
+		 Failed++;
+		 continue;
+		}
+	  Cases++;
+	  if (VInverse(VLat,VLon,FLat,FLon,&Err,&Az12,&Az21)==OKNOERROR)
+		{
+		 Err*=METERS_PER_NAUICAL_MILE;
+		 if (Err>MaxDirect) MaxDirect=Err;
+		}
+	  if (AzimuthError(VBack,FBack)>MaxDirectAz) MaxDirectAz=AzimuthError(VBack,FBack);
+
+	  /* The inverse between the start and the Vincenty end point, Dist apart. */
+	  if (VInverse(Lat,Lon,VLat,VLon,&VDist,&VAz12,&VAz21)!=OKNOERROR ||
+		  FastInverse(Lat,Lon,VLat,VLon,&FDist,&FAz12,&FAz21)!=OKNOERROR)
+		{
+		 printf("inverse failed at %d %.1f %d %.0f\n",Lat,Lon,Az,Dist);
+		 Failed++;
+		 continue;
+		}
+	  Err=fabs(FDist-VDist)*METERS_PER_NAUICAL_MILE;
+	  if (Err>MaxInverse) MaxInverse=Err;
+	  if (AzimuthError(VAz12,FAz12)>MaxInverseAz) MaxInverseAz=AzimuthError(VAz12,FAz12);
+	  if (AzimuthError(VAz21,FAz21)>MaxInverseAz) MaxInverseAz=AzimuthError(VAz21,FAz21);
+	 }
+
+ printf("%u cases\n",Cases);
+ printf("FastDirect  end point %.1f m (max %.1f), back azimuth %.4f deg (max %.4f)\n",
+		MaxDirect,MAX_DIRECT_ERROR_M,MaxDirectAz,MAX_DIRECT_AZIMUTH_DEG);
+ printf("FastInverse distance  %.1f m (max %.1f), azimuths     %.4f deg (max %.4f)\n",
+		MaxInverse,MAX_INVERSE_ERROR_M,MaxInverseAz,MAX_INVERSE_AZIMUTH_DEG);
+ if (Failed || MaxDirect>MAX_DIRECT_ERROR_M || MaxDirectAz>MAX_DIRECT_AZIMUTH_DEG ||
+	 MaxInverse>MAX_INVERSE_ERROR_M || MaxInverseAz>MAX_INVERSE_AZIMUTH_DEG)
+   {
+	printf("FAILED\n");
+	return 1;
+   }
+ return 0;
+}
+//---------------------------------------------------------------------------
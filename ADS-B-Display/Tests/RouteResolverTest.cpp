@@ -0,0 +1,168 @@
+//---------------------------------------------------------------------------
+// adsb_route_resolver_test - drive TRouteResolver with a stub fetch.
+//
+// Checks that concurrent lookups of one callsign make a single request,
+// that routes and "no route" answers expire after their TTLs, that a
+// failed request is retried after the retry delay and that the cache
+// survives a Save() and a new resolver reading it back.
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include "RouteResolver.h"
+
+#define CACHE_FILE       "RouteResolverTest.cache"
+#define SHORT_TTL_SEC    2       /* TTLs and retry delay of the expiry test */
+#define WAIT_MS          5000    /* Longest wait for a request to finish */
+
+/* Answers by callsign: E... fails, N... has no route, anything else has one. */
+class TStub
+{
+public:
+  TStub(unsigned DelayMs=0) : DelayMs(DelayMs) {}
+
+  TRouteFetch Fetch(void)
+  {
+   return [this](const std::string &Callsign, std::string &Route) { return Answer(Callsign,Route); };
+  }
+  unsigned Calls(const std::string &Callsign)
+  {
+   std::lock_guard<std::mutex> Guard(Lock);
+   return Count[Callsign];
+  }
+
+private:
+  TRouteFetchResult Answer(const std::string &Callsign, std::string &Route)
+  {
+   {
+	std::lock_guard<std::mutex> Guard(Lock);
+	Count[Callsign]++;
+   }
+   if (DelayMs) std::this_thread::sleep_for(std::chrono::milliseconds(DelayMs));
+   if (Callsign[0]=='E') return RF_ERROR;
+   if (Callsign[0]=='N') return RF_NOT_FOUND;
+   Route="EGLL-KJFK "+Callsign;
+   return RF_FOUND;
+  }
+
+  unsigned                       DelayMs;
+  std::mutex                     Lock;
+  std::map<std::string,unsigned> Count;
+};
+
+static unsigned    Failed;
+
+static void        Check(bool Ok, const char *What);
+static TRouteState Resolve(TRouteResolver &Resolver, const char *Callsign);
+static void        TestConcurrent(void);
+static void        TestExpiry(void);
+static void        TestSaveLoad(void);
+//---------------------------------------------------------------------------
+static void Check(bool Ok, const char *What)
+{
+ printf("%-60s %s\n",What,Ok ? "ok" : "FAILED");
+ if (!Ok) Failed++;
+}
+//---------------------------------------------------------------------------
+/* Look the callsign up until it is no longer pending. */
+static TRouteState Resolve(TRouteResolver &Resolver, const char *Callsign)
+{
+ char        Text[256];
+ TRouteState State=ROUTE_PENDING;
+
+ for (int t = 0; t < WAIT_MS/10 && State==ROUTE_PENDING; t++)
+   {
+	State=Resolver.Lookup(Callsign,Text,sizeof(Text));
+	if (State==ROUTE_PENDING) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+ return State;
+}
+//---------------------------------------------------------------------------
+static void TestConcurrent(void)
+{
+ TStub                    Stub(200);
+ TRouteResolver           Resolver(Stub.Fetch(),NULL,4);
+ std::vector<std::thread> Threads;
+ TRouteState              States[8];
+
+ for (int i = 0; i < 8; i++)
+   Threads.push_back(std::thread([&Resolver,&States,i] { States[i]=Resolve(Resolver,i&1 ? "BAW 123" : "baw123"); }));
+ for (size_t i = 0; i < Threads.size(); i++) Threads[i].join();
+
+ bool AllKnown=true;
+ for (int i = 0; i < 8; i++) AllKnown=AllKnown && States[i]==ROUTE_KNOWN;
+ Check(AllKnown,"concurrent lookups all see the route");
+ Check(Stub.Calls("BAW123")==1 && Resolver.NumFetches()==1,"concurrent lookups make one request");
+}
+//---------------------------------------------------------------------------
+static void TestExpiry(void)
+{
+ TStub          Stub;
+ TRouteResolver Resolver(Stub.Fetch(),NULL,2,SHORT_TTL_SEC,SHORT_TTL_SEC,SHORT_TTL_SEC);
+ char           Route[256];
+
+ Check(Resolve(Resolver,"UAL1")==ROUTE_KNOWN,"route found");
+ Check(Resolve(Resolver,"NKS2")==ROUTE_UNKNOWN,"no route");
+ Check(Resolve(Resolver,"ERR3")==ROUTE_UNKNOWN,"failed request reported unknown");
+
+ /* Within the TTLs every answer comes from the cache. */
+ Check(Resolver.Lookup("UAL1",Route,sizeof(Route))==ROUTE_KNOWN &&
+	   Resolver.Lookup("NKS2",Route,sizeof(Route))==ROUTE_UNKNOWN &&
+	   Resolver.Lookup("ERR3",Route,sizeof(Route))==ROUTE_UNKNOWN &&
+	   Resolver.NumFetches()==3,"answers cached within their TTL");
+
+ std::this_thread::sleep_for(std::chrono::seconds(SHORT_TTL_SEC+1));
+ Check(Resolver.Lookup("UAL1",Route,sizeof(Route))==ROUTE_PENDING &&
+	   Resolver.Lookup("NKS2",Route,sizeof(Route))==ROUTE_PENDING &&
+	   Resolver.Lookup("ERR3",Route,sizeof(Route))==ROUTE_PENDING,"expired answers looked up again");
+ Check(Resolve(Resolver,"UAL1")==ROUTE_KNOWN && Stub.Calls("UAL1")==2,"positive TTL expires");
+ Check(Resolve(Resolver,"NKS2")==ROUTE_UNKNOWN && Stub.Calls("NKS2")==2,"negative TTL expires");
+ Check(Resolve(Resolver,"ERR3")==ROUTE_UNKNOWN && Stub.Calls("ERR3")==2,"failed request retried");
+}
+//---------------------------------------------------------------------------
+static void TestSaveLoad(void)
+{
+ remove(CACHE_FILE);
+ {
+  TStub          Stub;
+  TRouteResolver Resolver(Stub.Fetch(),CACHE_FILE);
+
+  Resolve(Resolver,"DAL10");
+  Resolve(Resolver,"NKS20");
+  Resolve(Resolver,"ERR30");
+  Check(Resolver.Save(),"cache saved");
+ }
+ {
+  TStub          Stub;
+  TRouteResolver Resolver(Stub.Fetch(),CACHE_FILE);
+  char           Text[256];
+
+  Check(Resolver.Lookup("DAL10",Text,sizeof(Text))==ROUTE_KNOWN &&
+		strcmp(Text,"EGLL-KJFK DAL10")==0,"route read back");
+  Check(Resolver.Lookup("NKS20",Text,sizeof(Text))==ROUTE_UNKNOWN,"no route read back");
+  Check(Resolver.Lookup("ERR30",Text,sizeof(Text))==ROUTE_PENDING,"failed request not kept");
+  Check(Resolve(Resolver,"ERR30")==ROUTE_UNKNOWN && Resolver.NumFetches()==1,
+		"only the failed request asked again");
+ }
+ remove(CACHE_FILE);
+}
+//---------------------------------------------------------------------------
+int main(void)
+{
+ TestConcurrent();
+ TestExpiry();
+ TestSaveLoad();
+ if (Failed)
+   {
+	printf("FAILED\n");
+	return 1;
+   }
+ return 0;
+}
+//---------------------------------------------------------------------------
@@ -0,0 +1,132 @@
+//---------------------------------------------------------------------------
+// adsb_tile_manager_test - check TileManager's LRU list while panning.
+//
+// Pans a 6x6 window of level 8 tiles across the map a frame at a time, with
+// a storage that loads every tile as soon as it is asked for, and cleans up
+// after each frame as the display does. Every frame the LRU list must hold
+// each tile of the tree once, every tile behind its parent, and end with a
+// leaf; after Cleanup() the memory counted must match the tiles' sizes and
+// be within the limit.
+//
+// Textures are stubbed: the test needs the OpenGL, PNG and JPEG headers but
+// not the libraries.
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <set>
+#include "TileManager.h"
+
+#define LEVEL           8
+#define WINDOW          6               /* Tiles across the window. */
+#define FRAMES          1200
+#define TEXTURE_BYTES   (256*256*3)     /* Of each loaded tile. */
+#define LIMIT_TILES     400             /* Memory limit, in loaded tiles. */
+
+/* Loads every tile as it is queued. */
+class TLoadingStorage: public TileStorage {
+public:
+	void Enqueue(TilePtr tile) {
+		char byte = 0;
+		tile->Load(new RawBuffer(&byte, 1), 0);
+	}
+};
+
+class TileManagerTest {
+public:
+	static const char *CheckList(TileManager &m, unsigned &tiles);
+	static const char *CheckMemory(TileManager &m);
+	static unsigned    CountTree(TextureTile *t);
+};
+
+/* Textures without OpenGL. */
+Texture::Texture() { m_ID = 0; m_Pixels = 0; }
+Texture::~Texture() {}
+void Texture::SetTexture() {}
+void Texture::Unload() {}
+void Texture::LoadJPEG(int source, ...) {}
+void Texture::LoadPNG(int source, ...) {}
+size_t Texture::GetMemorySize() { return TEXTURE_BYTES; }
+//---------------------------------------------------------------------------
+unsigned TileManagerTest::CountTree(TextureTile *t)
+{
+ unsigned n=1;
+
+ for (int i = 0; i < 4; i++)
+   if (t->GetChild(i) != 0) n+=CountTree(t->GetChild(i).GetPtr());
+ return n;
+}
+//---------------------------------------------------------------------------
+/* @return NULL if the list is in order, else what is wrong */
+const char *TileManagerTest::CheckList(TileManager &m, unsigned &tiles)
+{
+ std::set<TextureTile *> seen;
+ TextureTile            *root=m.m_TextureRoot.GetPtr();
+ TextureTile            *last=0;
+
+ for (TextureTile *t = m.m_LruHead; t; t = t->m_LruNext)
+   {
+	if (t->m_LruPrev!=last) return "list links broken";
+	if (t->m_Parent.GetPtr()!=root && !seen.count(t->m_Parent.GetPtr()))
+	  return "tile ahead of its parent";
+	if (!seen.insert(t).second) return "tile listed twice";
+	last=t;
+   }
+ if (m.m_LruTail!=last) return "tail is not the last tile";
+ if (last && !last->IsLeaf()) return "tail is not a leaf";
+ tiles=(unsigned)seen.size();
+ if (tiles!=CountTree(root)-1 || (int)tiles!=m.m_nTextureTiles-1)
+   return "list does not hold every tile";
+ return NULL;
+}
+//---------------------------------------------------------------------------
+const char *TileManagerTest::CheckMemory(TileManager &m)
+{
+ size_t bytes=0;
+
+ for (TextureTile *t = m.m_LruHead; t; t = t->m_LruNext)
+   {
+	if (t->m_LruBytes!=t->GetMemorySize()) return "tile memory out of date";
+	bytes+=t->m_LruBytes;
+   }
+ if (bytes!=m.m_MemoryUsed) return "memory count does not match the tiles";
+ if (m.m_MemoryUsed>m.m_MemoryLimit) return "memory over the limit";
+ return NULL;
+}
+//---------------------------------------------------------------------------
+int main(void)
+{
+ TLoadingStorage Storage;
+ TileManager     Manager(&Storage,LIMIT_TILES*(sizeof(TextureTile)+TEXTURE_BYTES));
+ unsigned        Tiles=0,MaxTiles=0,Dropped=0;
+ const char     *Error=NULL;
+ int             Frame;
+
+ for (Frame = 0; Frame < FRAMES && !Error; Frame++)
+   {
+	/* Across the map and back to its left edge, drifting down. */
+	int x0=Frame%((1<<LEVEL)-WINDOW);
+	int y0=(100+Frame/3)%((1<<LEVEL)-WINDOW);
+
+	Timer::Instance()->Update(Frame*40);
+	for (int x = x0; x < x0+WINDOW; x++)
+	  for (int y = y0; y < y0+WINDOW; y++)
+		Manager.GetTexture(x,y,LEVEL);
+	Error=TileManagerTest::CheckList(Manager,Tiles);
+	if (Error) break;
+	if (Tiles>MaxTiles) MaxTiles=Tiles;
+
+	Dropped+=Manager.Cleanup();
+	Error=TileManagerTest::CheckList(Manager,Tiles);
+	if (!Error) Error=TileManagerTest::CheckMemory(Manager);
+   }
+
+ printf("%d frames, at most %u tiles, %u dropped, %u kept\n",Frame,MaxTiles,Dropped,Tiles);
+ if (!Error && Dropped==0) Error="no tile dropped";
+ if (Error)
+   {
+	printf("frame %d: %s\nFAILED\n",Frame,Error);
+	return 1;
+   }
+ return 0;
+}
+//---------------------------------------------------------------------------
@@ -1,9 +0,0 @@
-//---------------------------------------------------------------------------
-
-#ifndef TimeFunctionsH
-#define TimeFunctionsH
-
- __int64   GetCurrentTimeInMsec(void);
- char * TimeToChar(__int64 hmsm);
-//---------------------------------------------------------------------------
-#endif